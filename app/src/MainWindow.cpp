@@ -1,6 +1,9 @@
 #include "MainWindow.h"
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
 
 #include <QCheckBox>
 #include <QCloseEvent>
@@ -12,6 +15,7 @@
 #include <QInputDialog>
 #include <QLineEdit>
 #include <QMessageBox>
+#include <QProgressDialog>
 #include <QPushButton>
 #include <QRegularExpression>
 #include <QSaveFile>
@@ -20,6 +24,9 @@
 #include <QTimer>
 
 #include "audio/EngineHub.h"
+#include "audio/MidiBatchImporter.h"
+#include "audio/ProjectExporter.h"
+#include "audio/SongExporter.h"
 #include "models/InstrumentStore.h"
 #include "models/SongDocument.h"
 #include "ngpc/instrument.h"
@@ -32,68 +39,10 @@
 #include "tabs/HelpTab.h"
 
 namespace {
-bool instrument_def_equals(const ngpc::BgmInstrumentDef& a, const ngpc::BgmInstrumentDef& b) {
-    return
-        a.attn == b.attn &&
-        a.env_on == b.env_on &&
-        a.env_step == b.env_step &&
-        a.env_speed == b.env_speed &&
-        a.env_curve_id == b.env_curve_id &&
-        a.pitch_curve_id == b.pitch_curve_id &&
-        a.vib_on == b.vib_on &&
-        a.vib_depth == b.vib_depth &&
-        a.vib_speed == b.vib_speed &&
-        a.vib_delay == b.vib_delay &&
-        a.sweep_on == b.sweep_on &&
-        a.sweep_end == b.sweep_end &&
-        a.sweep_step == b.sweep_step &&
-        a.sweep_speed == b.sweep_speed &&
-        a.mode == b.mode &&
-        a.noise_config == b.noise_config &&
-        a.macro_id == b.macro_id &&
-        a.adsr_on == b.adsr_on &&
-        a.adsr_attack == b.adsr_attack &&
-        a.adsr_decay == b.adsr_decay &&
-        a.adsr_sustain == b.adsr_sustain &&
-        a.adsr_sustain_rate == b.adsr_sustain_rate &&
-        a.adsr_release == b.adsr_release &&
-        a.lfo_on == b.lfo_on &&
-        a.lfo_wave == b.lfo_wave &&
-        a.lfo_hold == b.lfo_hold &&
-        a.lfo_rate == b.lfo_rate &&
-        a.lfo_depth == b.lfo_depth &&
-        a.lfo2_on == b.lfo2_on &&
-        a.lfo2_wave == b.lfo2_wave &&
-        a.lfo2_hold == b.lfo2_hold &&
-        a.lfo2_rate == b.lfo2_rate &&
-        a.lfo2_depth == b.lfo2_depth &&
-        a.lfo_algo == b.lfo_algo;
-}
-
 bool instrument_preset_equals(const ngpc::InstrumentPreset& a, const ngpc::InstrumentPreset& b) {
-    return a.name == b.name && instrument_def_equals(a.def, b.def);
+    return a.name == b.name && ngpc::InstrumentDefEquals(a.def, b.def);
 }
 
-QString c_string_escape(const QString& text) {
-    QString out;
-    out.reserve(text.size() + 8);
-    for (const QChar ch : text) {
-        if (ch == '\\') {
-            out += "\\\\";
-        } else if (ch == '\"') {
-            out += "\\\"";
-        } else if (ch == '\n') {
-            out += "\\n";
-        } else if (ch == '\r') {
-            out += "\\r";
-        } else if (ch == '\t') {
-            out += "\\t";
-        } else {
-            out += ch;
-        }
-    }
-    return out;
-}
 } // namespace
 
 MainWindow::MainWindow(const QString& project_root,
@@ -567,6 +516,96 @@ bool MainWindow::create_empty_song_file(const QString& abs_path, QString* error)
     return true;
 }
 
+bool MainWindow::import_midi_folder(const QString& folder, QString* report, QString* error) {
+    const QStringList names = QDir(folder).entryList(
+        QStringList{"*.mid", "*.midi"}, QDir::Files, QDir::Name | QDir::IgnoreCase);
+    if (names.isEmpty()) {
+        if (error) *error = QString("No MIDI files in %1").arg(folder);
+        return false;
+    }
+
+    const QString songs_dir = QDir(project_root_).filePath("songs");
+    if (!QDir().mkpath(songs_dir)) {
+        if (error) *error = QString("Cannot create song directory: %1").arg(songs_dir);
+        return false;
+    }
+
+    // Reserve one id per file up front, free in the project and on disk, so
+    // the files of the batch do not collide. The entries only join the
+    // project once their file is written: an autosave while the dialog pumps
+    // events must not persist songs that do not exist yet.
+    QSet<QString> reserved;
+    std::vector<ProjectSongEntry> entries;
+    std::vector<MidiBatchJob> jobs;
+    for (const QString& name : names) {
+        ProjectSongEntry entry;
+        entry.name = QFileInfo(name).completeBaseName();
+        entry.id = make_unique_song_id(entry.name, reserved);
+        entry.file = QString("songs/%1.ngps").arg(entry.id);
+        reserved.insert(entry.id);
+        jobs.push_back({QDir(folder).filePath(name), QDir(project_root_).filePath(entry.file)});
+        entries.push_back(entry);
+    }
+
+    // The batch runs on its own thread (which fans out to the pool); the GUI
+    // thread only pumps events and the progress dialog meanwhile.
+    std::atomic<bool> cancel{false};
+    std::atomic<int> done{0};
+    std::atomic<bool> finished{false};
+    std::vector<MidiBatchFileResult> results;
+    std::thread batch([&]() {
+        results = ImportMidiBatch(jobs, MidiImportSettings{},
+                                  [&](int, int) { done.fetch_add(1); }, &cancel);
+        finished.store(true);
+    });
+
+    QProgressDialog progress(ui("Import MIDI en cours...", "Importing MIDI files..."),
+                             ui("Annuler", "Cancel"), 0, static_cast<int>(jobs.size()), this);
+    progress.setWindowModality(Qt::WindowModal);
+    progress.setMinimumDuration(0);
+    while (!finished.load()) {
+        progress.setValue(done.load());
+        if (progress.wasCanceled()) cancel.store(true);
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 50);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    batch.join();
+    progress.setValue(static_cast<int>(jobs.size()));
+
+    // Add the songs whose file was written. The others' paths were free when
+    // reserved, so whatever is there now is a partial write of this batch.
+    QStringList lines;
+    int imported = 0;
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        const MidiBatchFileResult& r = results[i];
+        const QString& name = names[static_cast<int>(i)];
+        if (r.saved) {
+            ++imported;
+            project_doc_.songs.push_back(entries[i]);
+            QString line = QString("%1: %2 notes, %3 dropped, %4 patterns, TPR %5")
+                .arg(name).arg(r.import.notes_imported).arg(r.import.notes_dropped)
+                .arg(r.import.patterns_created).arg(r.import.suggested_tpr);
+            if (r.import.truncated) line += " (truncated)";
+            lines.append(line);
+            continue;
+        }
+        if (!r.done) {
+            lines.append(QString("%1: cancelled").arg(name));
+        } else {
+            lines.append(QString("%1: FAILED (%2)")
+                .arg(name, r.import.success ? r.save_error : r.import.error));
+            QFile::remove(jobs[i].song_path);
+        }
+    }
+
+    if (imported > 0 && !save_project_metadata(error)) {
+        return false;
+    }
+    lines.prepend(QString("%1 / %2 MIDI files imported").arg(imported).arg(jobs.size()));
+    if (report) *report = lines.join('\n');
+    return true;
+}
+
 QString MainWindow::song_abs_path(int index) const {
     if (index < 0 || index >= project_doc_.songs.size()) return QString();
     return QDir(project_root_).filePath(project_doc_.songs[index].file);
@@ -815,258 +854,20 @@ bool MainWindow::write_project_sfx_export(QString* error) const {
         if (error) *error = "No active project";
         return false;
     }
-    QDir root(project_root_);
-    if (!root.exists("exports") && !root.mkpath("exports")) {
-        if (error) *error = "Cannot create exports directory";
-        return false;
-    }
-
-    const QString out_path = root.filePath("exports/project_sfx.c");
-    QSaveFile out(out_path);
-    if (!out.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        if (error) *error = QString("Cannot write %1").arg(out_path);
-        return false;
-    }
-
-    QString code;
-    code += "/* Generated by NGPC Sound Creator - Project SFX Bank */\n";
-    code += "/* index -> name mapping is in comments below */\n\n";
-    code += "const unsigned char PROJECT_SFX_COUNT = " + QString::number(project_doc_.sfx.size()) + ";\n\n";
-
-    const auto append_u8 = [&](const QString& name, const auto& getter) {
-        code += "const unsigned char " + name + "[] = {";
-        if (project_doc_.sfx.empty()) {
-            code += "0";
-        } else {
-            for (int i = 0; i < project_doc_.sfx.size(); ++i) {
-                if (i) code += ", ";
-                code += QString::number(getter(project_doc_.sfx[i]));
-            }
-        }
-        code += "};\n";
-    };
-
-    const auto append_u16 = [&](const QString& name, const auto& getter) {
-        code += "const unsigned short " + name + "[] = {";
-        if (project_doc_.sfx.empty()) {
-            code += "0";
-        } else {
-            for (int i = 0; i < project_doc_.sfx.size(); ++i) {
-                if (i) code += ", ";
-                code += QString::number(getter(project_doc_.sfx[i]));
-            }
-        }
-        code += "};\n";
-    };
-
-    const auto append_s16 = [&](const QString& name, const auto& getter) {
-        code += "const signed short " + name + "[] = {";
-        if (project_doc_.sfx.empty()) {
-            code += "0";
-        } else {
-            for (int i = 0; i < project_doc_.sfx.size(); ++i) {
-                if (i) code += ", ";
-                code += QString::number(getter(project_doc_.sfx[i]));
-            }
-        }
-        code += "};\n";
-    };
-
-    append_u8("PROJECT_SFX_TONE_ON", [](const ProjectSfxEntry& e) { return e.tone_on; });
-    append_u8("PROJECT_SFX_TONE_CH", [](const ProjectSfxEntry& e) { return e.tone_ch; });
-    append_u16("PROJECT_SFX_TONE_DIV", [](const ProjectSfxEntry& e) { return e.tone_div; });
-    append_u8("PROJECT_SFX_TONE_ATTN", [](const ProjectSfxEntry& e) { return e.tone_attn; });
-    append_u8("PROJECT_SFX_TONE_FRAMES", [](const ProjectSfxEntry& e) { return e.tone_frames; });
-    append_u8("PROJECT_SFX_TONE_SW_ON", [](const ProjectSfxEntry& e) { return e.tone_sw_on; });
-    append_u16("PROJECT_SFX_TONE_SW_END", [](const ProjectSfxEntry& e) { return e.tone_sw_end; });
-    append_s16("PROJECT_SFX_TONE_SW_STEP", [](const ProjectSfxEntry& e) { return e.tone_sw_step; });
-    append_u8("PROJECT_SFX_TONE_SW_SPEED", [](const ProjectSfxEntry& e) { return e.tone_sw_speed; });
-    append_u8("PROJECT_SFX_TONE_SW_PING", [](const ProjectSfxEntry& e) { return e.tone_sw_ping; });
-    append_u8("PROJECT_SFX_TONE_ENV_ON", [](const ProjectSfxEntry& e) { return e.tone_env_on; });
-    append_u8("PROJECT_SFX_TONE_ENV_STEP", [](const ProjectSfxEntry& e) { return e.tone_env_step; });
-    append_u8("PROJECT_SFX_TONE_ENV_SPD", [](const ProjectSfxEntry& e) { return e.tone_env_spd; });
-    append_u8("PROJECT_SFX_NOISE_ON", [](const ProjectSfxEntry& e) { return e.noise_on; });
-    append_u8("PROJECT_SFX_NOISE_RATE", [](const ProjectSfxEntry& e) { return e.noise_rate; });
-    append_u8("PROJECT_SFX_NOISE_TYPE", [](const ProjectSfxEntry& e) { return e.noise_type; });
-    append_u8("PROJECT_SFX_NOISE_ATTN", [](const ProjectSfxEntry& e) { return e.noise_attn; });
-    append_u8("PROJECT_SFX_NOISE_FRAMES", [](const ProjectSfxEntry& e) { return e.noise_frames; });
-    append_u8("PROJECT_SFX_NOISE_BURST", [](const ProjectSfxEntry& e) { return e.noise_burst; });
-    append_u8("PROJECT_SFX_NOISE_BURST_DUR", [](const ProjectSfxEntry& e) { return e.noise_burst_dur; });
-    append_u8("PROJECT_SFX_NOISE_ENV_ON", [](const ProjectSfxEntry& e) { return e.noise_env_on; });
-    append_u8("PROJECT_SFX_NOISE_ENV_STEP", [](const ProjectSfxEntry& e) { return e.noise_env_step; });
-    append_u8("PROJECT_SFX_NOISE_ENV_SPD", [](const ProjectSfxEntry& e) { return e.noise_env_spd; });
-    append_u8("PROJECT_SFX_TONE_ADSR_ON", [](const ProjectSfxEntry& e) { return e.tone_adsr_on; });
-    append_u8("PROJECT_SFX_TONE_ADSR_AR", [](const ProjectSfxEntry& e) { return e.tone_adsr_ar; });
-    append_u8("PROJECT_SFX_TONE_ADSR_DR", [](const ProjectSfxEntry& e) { return e.tone_adsr_dr; });
-    append_u8("PROJECT_SFX_TONE_ADSR_SL", [](const ProjectSfxEntry& e) { return e.tone_adsr_sl; });
-    append_u8("PROJECT_SFX_TONE_ADSR_SR", [](const ProjectSfxEntry& e) { return e.tone_adsr_sr; });
-    append_u8("PROJECT_SFX_TONE_ADSR_RR", [](const ProjectSfxEntry& e) { return e.tone_adsr_rr; });
-    append_u8("PROJECT_SFX_TONE_LFO1_ON", [](const ProjectSfxEntry& e) { return e.tone_lfo1_on; });
-    append_u8("PROJECT_SFX_TONE_LFO1_WAVE", [](const ProjectSfxEntry& e) { return e.tone_lfo1_wave; });
-    append_u8("PROJECT_SFX_TONE_LFO1_HOLD", [](const ProjectSfxEntry& e) { return e.tone_lfo1_hold; });
-    append_u8("PROJECT_SFX_TONE_LFO1_RATE", [](const ProjectSfxEntry& e) { return e.tone_lfo1_rate; });
-    append_u8("PROJECT_SFX_TONE_LFO1_DEPTH", [](const ProjectSfxEntry& e) { return e.tone_lfo1_depth; });
-    append_u8("PROJECT_SFX_TONE_LFO2_ON", [](const ProjectSfxEntry& e) { return e.tone_lfo2_on; });
-    append_u8("PROJECT_SFX_TONE_LFO2_WAVE", [](const ProjectSfxEntry& e) { return e.tone_lfo2_wave; });
-    append_u8("PROJECT_SFX_TONE_LFO2_HOLD", [](const ProjectSfxEntry& e) { return e.tone_lfo2_hold; });
-    append_u8("PROJECT_SFX_TONE_LFO2_RATE", [](const ProjectSfxEntry& e) { return e.tone_lfo2_rate; });
-    append_u8("PROJECT_SFX_TONE_LFO2_DEPTH", [](const ProjectSfxEntry& e) { return e.tone_lfo2_depth; });
-    append_u8("PROJECT_SFX_TONE_LFO_ALGO", [](const ProjectSfxEntry& e) { return e.tone_lfo_algo; });
-    code += "\n";
-
-    for (int i = 0; i < project_doc_.sfx.size(); ++i) {
-        code += QString("/* %1: %2 */\n").arg(i).arg(project_doc_.sfx[i].name);
-    }
-
-    out.write(code.toUtf8());
-    if (!out.commit()) {
-        if (error) *error = QString("Cannot commit %1").arg(out_path);
-        return false;
-    }
-    return true;
+    return ProjectExporter::write_sfx(project_root_, project_doc_, error);
 }
 
-bool MainWindow::write_project_instruments_export(
-    QString* error,
-    const std::vector<ngpc::InstrumentPreset>* presets) const {
+bool MainWindow::write_project_instruments_export(QString* error) const {
     if (!project_ready_) {
         if (error) *error = "No active project";
         return false;
     }
-    QDir root(project_root_);
-    if (!root.exists("exports") && !root.mkpath("exports")) {
-        if (error) *error = "Cannot create exports directory";
-        return false;
-    }
-
-    const QString out_path = root.filePath("exports/project_instruments.c");
-    QSaveFile out(out_path);
-    if (!out.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        if (error) *error = QString("Cannot write %1").arg(out_path);
-        return false;
-    }
-
-    QString code;
-    std::vector<ngpc::InstrumentPreset> fallback_bank;
-    const std::vector<ngpc::InstrumentPreset>* bank = presets;
-    if (!bank) {
-        fallback_bank.reserve(static_cast<size_t>(instrument_store_->count()));
-        for (int i = 0; i < instrument_store_->count(); ++i) {
-            fallback_bank.push_back(instrument_store_->at(i));
-        }
-        bank = &fallback_bank;
-    }
-
-    code += "/* Generated by NGPC Sound Creator - Project Instrument Bank */\n";
-    code += "/* Shared across all songs exported from this project */\n\n";
-    code += QString::fromStdString(ngpc::InstrumentPresetsToCArray(*bank));
-
-    out.write(code.toUtf8());
-    if (!out.commit()) {
-        if (error) *error = QString("Cannot commit %1").arg(out_path);
-        return false;
+    std::vector<ngpc::InstrumentPreset> bank;
+    bank.reserve(static_cast<size_t>(instrument_store_->count()));
+    for (int i = 0; i < instrument_store_->count(); ++i) {
+        bank.push_back(instrument_store_->at(i));
     }
-    return true;
-}
-
-bool MainWindow::build_project_instrument_merge(
-    std::array<uint8_t, 128>* out_remap,
-    std::vector<ngpc::InstrumentPreset>* out_bank,
-    QString* error) {
-    if (!out_remap || !out_bank) {
-        if (error) *error = "Internal error: null output buffer for instrument merge";
-        return false;
-    }
-    if (!project_ready_) {
-        if (error) *error = "No active project";
-        return false;
-    }
-    if (!instrument_store_) {
-        if (error) *error = "Instrument store unavailable";
-        return false;
-    }
-
-    out_remap->fill(0);
-    out_bank->clear();
-
-    std::array<bool, 128> used{};
-    used.fill(false);
-
-    const QString old_active_id = project_doc_.active_song_id;
-    const int old_active_idx = active_song_index();
-
-    auto restore_active = [&]() {
-        if (old_active_idx < 0) return;
-        project_doc_.active_song_id = old_active_id;
-        QString ignored;
-        load_song_by_index(old_active_idx, &ignored);
-    };
-
-    for (int i = 0; i < project_doc_.songs.size(); ++i) {
-        QString io_error;
-        if (!load_song_by_index(i, &io_error)) {
-            restore_active();
-            if (error) {
-                *error = QString("Cannot load song '%1' for instrument merge: %2")
-                             .arg(project_doc_.songs[i].name)
-                             .arg(io_error);
-            }
-            return false;
-        }
-        const auto song_used = tracker_tab_->collect_used_instruments();
-        for (int id = 0; id < 128; ++id) {
-            used[static_cast<size_t>(id)] = used[static_cast<size_t>(id)] || song_used[static_cast<size_t>(id)];
-        }
-    }
-    restore_active();
-
-    bool has_any_used = false;
-    for (bool flag : used) {
-        if (flag) {
-            has_any_used = true;
-            break;
-        }
-    }
-    if (!has_any_used && instrument_store_->count() > 0) {
-        used[0] = true;
-    }
-
-    const int store_count = std::min(instrument_store_->count(), 128);
-    for (int old_id = 0; old_id < 128; ++old_id) {
-        if (!used[static_cast<size_t>(old_id)]) {
-            continue;
-        }
-        if (old_id >= store_count) {
-            (*out_remap)[static_cast<size_t>(old_id)] = 0;
-            continue;
-        }
-
-        const auto& src = instrument_store_->at(old_id);
-        int found = -1;
-        for (int merged_id = 0; merged_id < static_cast<int>(out_bank->size()); ++merged_id) {
-            if (instrument_def_equals(src.def, (*out_bank)[static_cast<size_t>(merged_id)].def)) {
-                found = merged_id;
-                break;
-            }
-        }
-        if (found < 0) {
-            found = static_cast<int>(out_bank->size());
-            out_bank->push_back(src);
-        }
-        (*out_remap)[static_cast<size_t>(old_id)] = static_cast<uint8_t>(found);
-    }
-
-    if (out_bank->empty()) {
-        if (instrument_store_->count() > 0) {
-            out_bank->push_back(instrument_store_->at(0));
-        } else {
-            ngpc::InstrumentPreset p;
-            p.name = "Default";
-            out_bank->push_back(p);
-        }
-    }
-
-    return true;
+    return ProjectExporter::write_instruments(project_root_, bank, error);
 }
 
 bool MainWindow::choose_project_song_export_mode(int* out_mode_index, QString* out_mode_label) {
@@ -1101,233 +902,6 @@ bool MainWindow::choose_project_song_export_mode(int* out_mode_index, QString* o
     return false;
 }
 
-QString MainWindow::make_song_symbol_prefix(const QString& song_id) {
-    QString stem = song_id.trimmed().toUpper();
-    if (stem.isEmpty()) stem = "SONG";
-    for (int i = 0; i < stem.size(); ++i) {
-        const QChar c = stem.at(i);
-        const bool ok = (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
-        if (!ok) stem[i] = '_';
-    }
-    while (stem.contains("__")) stem.replace("__", "_");
-    while (stem.startsWith('_')) stem.remove(0, 1);
-    while (stem.endsWith('_')) stem.chop(1);
-    if (stem.isEmpty()) stem = "SONG";
-    if (stem[0].isDigit()) stem.prepend("S_");
-    return QString("PROJECT_%1").arg(stem);
-}
-
-bool MainWindow::rewrite_song_export_symbols(const QString& out_path,
-                                             const QString& symbol_prefix,
-                                             QString* error) const {
-    QFile in(out_path);
-    if (!in.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        if (error) *error = QString("Cannot read %1").arg(out_path);
-        return false;
-    }
-    QString text = QString::fromUtf8(in.readAll());
-    in.close();
-
-    const QStringList base_symbols = {
-        "NOTE_TABLE",
-        "BGM_CH0_LOOP", "BGM_CH1_LOOP", "BGM_CH2_LOOP", "BGM_CHN_LOOP", "BGM_MONO_LOOP",
-        "BGM_CH0", "BGM_CH1", "BGM_CH2", "BGM_CHN", "BGM_MONO"
-    };
-
-    for (const QString& base : base_symbols) {
-        const QString renamed = QString("%1_%2").arg(symbol_prefix, base);
-        const QRegularExpression re(QString("\\b%1\\b").arg(QRegularExpression::escape(base)));
-        text.replace(re, renamed);
-    }
-
-    QSaveFile out(out_path);
-    if (!out.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        if (error) *error = QString("Cannot rewrite %1").arg(out_path);
-        return false;
-    }
-    out.write(text.toUtf8());
-    if (!out.commit()) {
-        if (error) *error = QString("Cannot commit rewritten file %1").arg(out_path);
-        return false;
-    }
-    return true;
-}
-
-bool MainWindow::write_project_audio_api_export(bool asm_export, QString* error) const {
-    if (!project_ready_) {
-        if (error) *error = "No active project";
-        return false;
-    }
-
-    QDir root(project_root_);
-    if (!root.exists("exports") && !root.mkpath("exports")) {
-        if (error) *error = "Cannot create exports directory";
-        return false;
-    }
-
-    const QString manifest_path = root.filePath("exports/project_audio_manifest.txt");
-    QSaveFile manifest(manifest_path);
-    if (!manifest.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        if (error) *error = QString("Cannot write %1").arg(manifest_path);
-        return false;
-    }
-
-    QString manifest_text;
-    manifest_text += "Generated by NGPC Sound Creator - Project Audio Manifest\n";
-    manifest_text += QString("mode=%1\n").arg(asm_export ? "ASM" : "C");
-    manifest_text += QString("song_count=%1\n").arg(project_doc_.songs.size());
-    manifest_text += "songs:\n";
-    const QString song_ext = asm_export ? ".inc" : ".c";
-    for (const auto& song : project_doc_.songs) {
-        manifest_text += "  - id=" + song.id
-                         + " | name=" + song.name
-                         + " | file=exports/" + song.id + song_ext
-                         + " | symbols=" + make_song_symbol_prefix(song.id) + "_*\n";
-    }
-    manifest_text += "instruments=exports/project_instruments.c\n";
-    manifest_text += "sfx=exports/project_sfx.c\n";
-    manifest_text += "notes:\n";
-    manifest_text += "  - Song symbols are namespaced to avoid collisions.\n";
-    manifest_text += "  - Include project_audio_api.h/.c for one-click C integration.\n";
-    manifest_text += "  - Use NgpcProject_BgmStartLoop4ByIndex(i) to auto-switch NOTE_TABLE + streams.\n";
-    manifest_text += "  - For ASM export, use this manifest as include/reference list.\n";
-
-    manifest.write(manifest_text.toUtf8());
-    if (!manifest.commit()) {
-        if (error) *error = QString("Cannot commit %1").arg(manifest_path);
-        return false;
-    }
-
-    if (asm_export) {
-        return true;
-    }
-
-    const QString header_path = root.filePath("exports/project_audio_api.h");
-    QSaveFile header(header_path);
-    if (!header.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        if (error) *error = QString("Cannot write %1").arg(header_path);
-        return false;
-    }
-
-    QString h;
-    h += "/* Generated by NGPC Sound Creator - Project Audio API */\n";
-    h += "#ifndef NGPC_PROJECT_AUDIO_API_H\n";
-    h += "#define NGPC_PROJECT_AUDIO_API_H\n\n";
-    h += "#ifdef __cplusplus\nextern \"C\" {\n#endif\n\n";
-    h += "typedef struct NgpcProjectSongRef {\n";
-    h += "    const char* id;\n";
-    h += "    const char* name;\n";
-    h += "    const unsigned char* note_table;\n";
-    h += "    const unsigned char* ch0;\n";
-    h += "    const unsigned char* ch1;\n";
-    h += "    const unsigned char* ch2;\n";
-    h += "    const unsigned char* chn;\n";
-    h += "    unsigned short loop_ch0;\n";
-    h += "    unsigned short loop_ch1;\n";
-    h += "    unsigned short loop_ch2;\n";
-    h += "    unsigned short loop_chn;\n";
-    h += "} NgpcProjectSongRef;\n\n";
-    h += "extern const unsigned short NGPC_PROJECT_SONG_COUNT;\n";
-    h += "extern const NgpcProjectSongRef NGPC_PROJECT_SONGS[];\n\n";
-    h += "const NgpcProjectSongRef* NgpcProject_GetSong(unsigned short index);\n";
-    h += "void NgpcProject_BgmStartLoop4ByIndex(unsigned short index);\n\n";
-    h += "#ifdef __cplusplus\n}\n#endif\n\n";
-    h += "#endif /* NGPC_PROJECT_AUDIO_API_H */\n";
-
-    header.write(h.toUtf8());
-    if (!header.commit()) {
-        if (error) *error = QString("Cannot commit %1").arg(header_path);
-        return false;
-    }
-
-    const QString source_path = root.filePath("exports/project_audio_api.c");
-    QSaveFile source(source_path);
-    if (!source.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        if (error) *error = QString("Cannot write %1").arg(source_path);
-        return false;
-    }
-
-    QString c;
-    c += "/* Generated by NGPC Sound Creator - Project Audio API */\n";
-    c += "#include \"project_audio_api.h\"\n\n";
-    c += "/* Driver entry points (sounds.c). */\n";
-    c += "extern void Bgm_SetNoteTable(const unsigned char* note_table);\n";
-    c += "extern void Bgm_StartLoop4Ex(const unsigned char* stream0, unsigned short loop0,\n";
-    c += "                             const unsigned char* stream1, unsigned short loop1,\n";
-    c += "                             const unsigned char* stream2, unsigned short loop2,\n";
-    c += "                             const unsigned char* streamN, unsigned short loopN);\n\n";
-    c += "#if defined(__GNUC__)\n";
-    c += "#define NGPC_PROJECT_WEAK __attribute__((weak))\n";
-    c += "#else\n";
-    c += "#define NGPC_PROJECT_WEAK\n";
-    c += "#endif\n";
-    c += "/* Link fallback only. Real table is selected per song at runtime. */\n";
-    c += "const unsigned char NOTE_TABLE[102] NGPC_PROJECT_WEAK = {\n";
-    for (int i = 0; i < 51; ++i) {
-        c += "    0x01, 0x00";
-        if (i < 50) c += ",";
-        c += "\n";
-    }
-    c += "};\n\n";
-    c += "/* Song symbols come from exports/song_*.c (namespaced by export pipeline). */\n";
-    for (const auto& song : project_doc_.songs) {
-        const QString pfx = make_song_symbol_prefix(song.id);
-        c += QString("extern const unsigned char %1_NOTE_TABLE[];\n").arg(pfx);
-        c += QString("extern const unsigned char %1_BGM_CH0[];\n").arg(pfx);
-        c += QString("extern const unsigned char %1_BGM_CH1[];\n").arg(pfx);
-        c += QString("extern const unsigned char %1_BGM_CH2[];\n").arg(pfx);
-        c += QString("extern const unsigned char %1_BGM_CHN[];\n").arg(pfx);
-        c += QString("extern const unsigned short %1_BGM_CH0_LOOP;\n").arg(pfx);
-        c += QString("extern const unsigned short %1_BGM_CH1_LOOP;\n").arg(pfx);
-        c += QString("extern const unsigned short %1_BGM_CH2_LOOP;\n").arg(pfx);
-        c += QString("extern const unsigned short %1_BGM_CHN_LOOP;\n").arg(pfx);
-    }
-    c += "\n";
-    c += QString("const unsigned short NGPC_PROJECT_SONG_COUNT = %1;\n\n")
-             .arg(project_doc_.songs.size());
-    c += "const NgpcProjectSongRef NGPC_PROJECT_SONGS[] = {\n";
-    for (const auto& song : project_doc_.songs) {
-        const QString pfx = make_song_symbol_prefix(song.id);
-        c += "    {\n";
-        c += QString("        \"%1\",\n").arg(c_string_escape(song.id));
-        c += QString("        \"%1\",\n").arg(c_string_escape(song.name));
-        c += QString("        %1_NOTE_TABLE,\n").arg(pfx);
-        c += QString("        %1_BGM_CH0,\n").arg(pfx);
-        c += QString("        %1_BGM_CH1,\n").arg(pfx);
-        c += QString("        %1_BGM_CH2,\n").arg(pfx);
-        c += QString("        %1_BGM_CHN,\n").arg(pfx);
-        c += QString("        %1_BGM_CH0_LOOP,\n").arg(pfx);
-        c += QString("        %1_BGM_CH1_LOOP,\n").arg(pfx);
-        c += QString("        %1_BGM_CH2_LOOP,\n").arg(pfx);
-        c += QString("        %1_BGM_CHN_LOOP\n").arg(pfx);
-        c += "    },\n";
-    }
-    c += "};\n\n";
-    c += "const NgpcProjectSongRef* NgpcProject_GetSong(unsigned short index)\n";
-    c += "{\n";
-    c += "    if (index >= NGPC_PROJECT_SONG_COUNT) return 0;\n";
-    c += "    return &NGPC_PROJECT_SONGS[index];\n";
-    c += "}\n\n";
-    c += "void NgpcProject_BgmStartLoop4ByIndex(unsigned short index)\n";
-    c += "{\n";
-    c += "    const NgpcProjectSongRef* song = NgpcProject_GetSong(index);\n";
-    c += "    if (!song) return;\n";
-    c += "    Bgm_SetNoteTable(song->note_table);\n";
-    c += "    Bgm_StartLoop4Ex(song->ch0, song->loop_ch0,\n";
-    c += "                     song->ch1, song->loop_ch1,\n";
-    c += "                     song->ch2, song->loop_ch2,\n";
-    c += "                     song->chn, song->loop_chn);\n";
-    c += "}\n";
-
-    source.write(c.toUtf8());
-    if (!source.commit()) {
-        if (error) *error = QString("Cannot commit %1").arg(source_path);
-        return false;
-    }
-
-    return true;
-}
-
 QString MainWindow::sanitize_song_id(const QString& name) {
     QString id = name.trimmed().toLower();
     for (int i = 0; i < id.size(); ++i) {
@@ -1342,12 +916,13 @@ QString MainWindow::sanitize_song_id(const QString& name) {
     return id;
 }
 
-QString MainWindow::make_unique_song_id(const QString& base_name) const {
+QString MainWindow::make_unique_song_id(const QString& base_name, const QSet<QString>& reserved) const {
     const QString base = sanitize_song_id(base_name);
     QString candidate = base;
     int suffix = 2;
 
     auto in_use = [&](const QString& id) {
+        if (reserved.contains(id)) return true;
         for (const auto& s : project_doc_.songs) {
             if (s.id == id) return true;
         }
@@ -1596,6 +1171,22 @@ void MainWindow::connect_project_signals() {
         refresh_project_tab();
     });
 
+    connect(project_tab_, &ProjectTab::import_midi_folder_requested, this,
+            [this](const QString& folder) {
+        if (!project_ready_) return;
+        autosave_now("import-midi-folder");
+
+        QString report;
+        QString error;
+        if (!import_midi_folder(folder, &report, &error)) {
+            QMessageBox::warning(this, "Import MIDI folder failed", error);
+            refresh_project_tab();
+            return;
+        }
+        refresh_project_tab();
+        QMessageBox::information(this, "Import MIDI folder", report);
+    });
+
     connect(project_tab_, &ProjectTab::import_ngps_song_requested, this,
             [this](const QString& name, const QString& ngps_path) {
         if (!project_ready_) return;
@@ -1866,7 +1457,7 @@ void MainWindow::connect_project_signals() {
         int mode_index = 1;
         if (!choose_project_song_export_mode(&mode_index, nullptr)) return;
         QString error;
-        if (!export_project_songs_only(false, mode_index, nullptr, false, &error)) {
+        if (!export_project_songs_only(false, mode_index, &error)) {
             QMessageBox::warning(this, "Export Songs C failed", error);
             return;
         }
@@ -1879,7 +1470,7 @@ void MainWindow::connect_project_signals() {
         int mode_index = 1;
         if (!choose_project_song_export_mode(&mode_index, nullptr)) return;
         QString error;
-        if (!export_project_songs_only(true, mode_index, nullptr, false, &error)) {
+        if (!export_project_songs_only(true, mode_index, &error)) {
             QMessageBox::warning(this, "Export Songs ASM failed", error);
             return;
         }
@@ -1946,115 +1537,34 @@ void MainWindow::connect_project_signals() {
     });
 }
 
-bool MainWindow::export_project_songs_only(bool asm_export,
-                                           int export_mode_index,
-                                           const std::array<uint8_t, 128>* instrument_remap,
-                                           bool namespace_symbols,
-                                           QString* error) {
-    if (project_doc_.songs.isEmpty()) {
-        if (error) *error = "Project has no songs";
-        return false;
-    }
-
+bool MainWindow::export_project_songs_only(bool asm_export, int export_mode_index, QString* error) {
     autosave_now("export-songs");
 
-    QDir root(project_root_);
-    if (!root.exists("exports") && !root.mkpath("exports")) {
-        if (error) *error = "Cannot create exports directory";
+    // Each song is loaded from its .ngps into a private document and exported
+    // on the worker pool; the tracker and the active song are left alone.
+    SongExporter::Settings settings;
+    settings.hybrid = (export_mode_index == 1);
+    settings.ticks_per_row = tracker_tab_->ticks_per_row();
+    settings.asm_export = asm_export;
+    if (!ProjectExporter::export_songs(project_root_, project_doc_, *instrument_store_, settings, false,
+                                       nullptr, error)) {
         return false;
     }
 
-    const QString old_active_id = project_doc_.active_song_id;
-    const int old_active_idx = active_song_index();
-
-    const QString ext = asm_export ? ".inc" : ".c";
-    for (int i = 0; i < project_doc_.songs.size(); ++i) {
-        QString io_error;
-        if (!load_song_by_index(i, &io_error)) {
-            if (error) *error = QString("Cannot load song '%1': %2")
-                                    .arg(project_doc_.songs[i].name)
-                                    .arg(io_error);
-            if (old_active_idx >= 0) {
-                project_doc_.active_song_id = old_active_id;
-                load_song_by_index(old_active_idx);
-            }
-            return false;
-        }
-
-        const QString out_file = root.filePath(QString("exports/%1%2").arg(project_doc_.songs[i].id, ext));
-        if (!tracker_tab_->export_song_to_path(
-                out_file, asm_export, false, &io_error, nullptr, export_mode_index, instrument_remap)) {
-            if (error) *error = QString("Cannot export song '%1': %2")
-                                    .arg(project_doc_.songs[i].name)
-                                    .arg(io_error);
-            if (old_active_idx >= 0) {
-                project_doc_.active_song_id = old_active_id;
-                load_song_by_index(old_active_idx);
-            }
-            return false;
-        }
-
-        if (namespace_symbols) {
-            const QString symbol_prefix = make_song_symbol_prefix(project_doc_.songs[i].id);
-            if (!rewrite_song_export_symbols(out_file, symbol_prefix, &io_error)) {
-                if (error) *error = QString("Cannot rewrite exported symbols for '%1': %2")
-                                        .arg(project_doc_.songs[i].name)
-                                        .arg(io_error);
-                if (old_active_idx >= 0) {
-                    project_doc_.active_song_id = old_active_id;
-                    load_song_by_index(old_active_idx);
-                }
-                return false;
-            }
-        }
-    }
-
-    if (old_active_idx >= 0) {
-        project_doc_.active_song_id = old_active_id;
-        QString restore_error;
-        if (!load_song_by_index(old_active_idx, &restore_error)) {
-            if (error) *error = QString("Export done but failed to restore active song: %1").arg(restore_error);
-            return false;
-        }
-    }
     save_project_metadata();
     refresh_project_tab();
     return true;
 }
 
 bool MainWindow::export_all_project_songs(bool asm_export, int export_mode_index, QString* error) {
-    std::array<uint8_t, 128> instrument_remap{};
-    std::vector<ngpc::InstrumentPreset> merged_bank;
-    const bool use_hybrid_merge = (export_mode_index == 1);
-
-    if (use_hybrid_merge) {
-        QString merge_error;
-        if (!build_project_instrument_merge(&instrument_remap, &merged_bank, &merge_error)) {
-            if (error) *error = QString("Cannot build project instrument merge: %1").arg(merge_error);
-            return false;
-        }
-    }
-
-    const std::array<uint8_t, 128>* remap_ptr = use_hybrid_merge ? &instrument_remap : nullptr;
-    if (!export_project_songs_only(asm_export, export_mode_index, remap_ptr, true, error)) {
-        return false;
-    }
-
-    QString io_error;
-    if (!write_project_instruments_export(&io_error, use_hybrid_merge ? &merged_bank : nullptr)) {
-        if (error) *error = QString("Cannot export project instruments: %1").arg(io_error);
-        return false;
-    }
-
-    QString sfx_error;
-    if (!write_project_sfx_export(&sfx_error)) {
-        if (error) *error = QString("Cannot export project SFX: %1").arg(sfx_error);
-        return false;
-    }
-
-    QString api_error;
-    if (!write_project_audio_api_export(asm_export, &api_error)) {
-        if (error) *error = QString("Cannot export project audio API: %1").arg(api_error);
+    // The merge and the export read the songs from disk.
+    autosave_now("export-all");
+
+    SongExporter::Settings settings;
+    settings.hybrid = (export_mode_index == 1);
+    settings.ticks_per_row = tracker_tab_->ticks_per_row();
+    settings.asm_export = asm_export;
+    if (!ProjectExporter::export_all(project_root_, project_doc_, *instrument_store_, settings, nullptr, error)) {
         return false;
     }
 
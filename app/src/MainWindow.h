@@ -1,10 +1,10 @@
 #pragma once
 
 #include <QMainWindow>
+#include <QSet>
 #include <QString>
 #include <QStringList>
 
-#include <array>
 #include <vector>
 
 #include "i18n/AppLanguage.h"
@@ -61,6 +61,7 @@ private:
     bool create_new_project(const QString& project_name, QString* error);
     bool load_existing_project(QString* error);
     bool create_empty_song_file(const QString& abs_path, QString* error);
+    bool import_midi_folder(const QString& folder, QString* report, QString* error = nullptr);
     bool switch_to_existing_project(const QString& root, QString* error);
     bool save_project_as(const QString& new_root, QString* error);
 
@@ -80,27 +81,12 @@ private:
     void push_recent_project(const QString& path) const;
     QStringList recent_projects() const;
     bool write_project_sfx_export(QString* error = nullptr) const;
-    bool write_project_instruments_export(
-        QString* error = nullptr,
-        const std::vector<ngpc::InstrumentPreset>* presets = nullptr) const;
-    bool build_project_instrument_merge(
-        std::array<uint8_t, 128>* out_remap,
-        std::vector<ngpc::InstrumentPreset>* out_bank,
-        QString* error = nullptr);
+    bool write_project_instruments_export(QString* error = nullptr) const;
 
     void connect_project_signals();
     bool choose_project_song_export_mode(int* out_mode_index, QString* out_mode_label = nullptr);
-    bool export_project_songs_only(bool asm_export,
-                                   int export_mode_index,
-                                   const std::array<uint8_t, 128>* instrument_remap = nullptr,
-                                   bool namespace_symbols = false,
-                                   QString* error = nullptr);
+    bool export_project_songs_only(bool asm_export, int export_mode_index, QString* error = nullptr);
     bool export_all_project_songs(bool asm_export, int export_mode_index, QString* error = nullptr);
-    bool rewrite_song_export_symbols(const QString& out_path,
-                                     const QString& symbol_prefix,
-                                     QString* error = nullptr) const;
-    bool write_project_audio_api_export(bool asm_export, QString* error = nullptr) const;
-    static QString make_song_symbol_prefix(const QString& song_id);
     QString ui(const char* fr, const char* en) const;
     QString resolve_driver_source_dir() const;
     bool export_driver_package_to(const QString& out_dir, QString* error = nullptr) const;
@@ -108,5 +94,6 @@ private:
     void show_driver_required_export_notice();
 
     static QString sanitize_song_id(const QString& name);
-    QString make_unique_song_id(const QString& base_name) const;
+    // Free both in the project and under songs/; `reserved` ids count as taken.
+    QString make_unique_song_id(const QString& base_name, const QSet<QString>& reserved = {}) const;
 };
@@ -6,6 +6,7 @@
 #include <QIODevice>
 #include <QMediaDevices>
 #include <QTimer>
+#include <algorithm>
 #include <cmath>
 #include <vector>
 
@@ -15,6 +16,10 @@ namespace {
 static constexpr int kZ80ClockHz = 3072000;
 static constexpr double kIrqHz = 7800.0;
 static constexpr double kCyclesPerIrq = static_cast<double>(kZ80ClockHz) / kIrqHz;
+static constexpr int kMeterBlockFrames = 256;     // ~5.8 ms at 44.1 kHz
+static constexpr size_t kMaxMeterBlocks = 256;    // far more than the sink buffer holds
+static constexpr float kMeterDecayPerBlock = 0.95f;
+static constexpr int kClipHoldMs = 400;
 }
 
 AudioOutput::AudioOutput(QObject* parent)
@@ -70,6 +75,11 @@ bool AudioOutput::start(ngpc::SoundEngine* engine, int sample_rate) {
     cycles_per_sample_ = static_cast<double>(kZ80ClockHz) / format_sample_rate_;
     cycles_accum_ = 0.0;
     irq_cycle_pos_ = 0.0;
+    frames_written_ = 0;
+    rendered_end_ = engine_->samples_rendered();
+    meter_blocks_.clear();
+    peak_level_ = 0.0f;
+    clip_until_ = 0;
 
     device_ = sink_->start();
     if (!device_) {
@@ -148,13 +158,14 @@ QString AudioOutput::debug_info() const {
             break;
         }
     }
-    return QString("%1 Hz, %2 ch, %3 (%4), state=%5, err=%6")
+    return QString("%1 Hz, %2 ch, %3 (%4), state=%5, err=%6, latency=%7 ms")
         .arg(format_sample_rate_)
         .arg(format_channels_)
         .arg(fmt)
         .arg(device_desc_)
         .arg(state)
-        .arg(err);
+        .arg(err)
+        .arg(latency_ms());
 }
 
 void AudioOutput::set_step_z80(bool enabled) {
@@ -162,6 +173,7 @@ void AudioOutput::set_step_z80(bool enabled) {
 }
 
 int AudioOutput::peak_percent() const {
+    advance_meter();
     int p = static_cast<int>(std::lround(peak_level_ * 100.0f));
     if (p < 0) p = 0;
     if (p > 100) p = 100;
@@ -169,7 +181,83 @@ int AudioOutput::peak_percent() const {
 }
 
 bool AudioOutput::clip_recent() const {
-    return clip_hold_ticks_ > 0;
+    advance_meter();
+    return sink_ && audible_sample_pos() < clip_until_;
+}
+
+uint64_t AudioOutput::audible_sample_pos() const {
+    if (!sink_ || format_sample_rate_ <= 0) {
+        return rendered_end_;
+    }
+    // processedUSecs() counts what the sink has pulled out of our buffer since
+    // start(); the difference to what we wrote is still waiting to be played.
+    const int64_t played = static_cast<int64_t>(sink_->processedUSecs()) *
+                           format_sample_rate_ / 1000000;
+    int64_t queued = frames_written_ - played;
+    if (queued < 0) {
+        queued = 0;
+    }
+    const uint64_t q = static_cast<uint64_t>(queued);
+    return (rendered_end_ > q) ? rendered_end_ - q : 0;
+}
+
+int AudioOutput::latency_ms() const {
+    if (!sink_ || format_sample_rate_ <= 0) {
+        return 0;
+    }
+    const uint64_t audible = audible_sample_pos();
+    const uint64_t queued = (rendered_end_ > audible) ? rendered_end_ - audible : 0;
+    return static_cast<int>(queued * 1000 / static_cast<uint64_t>(format_sample_rate_));
+}
+
+void AudioOutput::push_meter_blocks(uint64_t start_pos, int frames) {
+    for (int off = 0; off < frames; off += kMeterBlockFrames) {
+        const int end = std::min(frames, off + kMeterBlockFrames);
+        int peak_abs = 0;
+        bool clipped = false;
+        for (int i = off; i < end; ++i) {
+            const int av = std::abs(static_cast<int>(mono_[static_cast<size_t>(i)]));
+            if (av > peak_abs) {
+                peak_abs = av;
+            }
+            if (av >= 32767) {
+                clipped = true;
+            }
+        }
+        MeterBlock b;
+        b.end_pos = start_pos + static_cast<uint64_t>(end);
+        b.peak = static_cast<float>(peak_abs) / 32767.0f;
+        b.clipped = clipped;
+        meter_blocks_.push_back(b);
+    }
+    while (meter_blocks_.size() > kMaxMeterBlocks) {
+        meter_blocks_.pop_front();
+    }
+}
+
+void AudioOutput::advance_meter() const {
+    if (!sink_) {
+        return;
+    }
+    // Fold in every block that has reached the speaker, in order, so the
+    // meter decays at the same pace the audio is heard.
+    const uint64_t audible = audible_sample_pos();
+    while (!meter_blocks_.empty() && meter_blocks_.front().end_pos <= audible) {
+        const MeterBlock& b = meter_blocks_.front();
+        if (b.peak > peak_level_) {
+            peak_level_ = b.peak;
+        } else {
+            peak_level_ *= kMeterDecayPerBlock;
+            if (b.peak > peak_level_) {
+                peak_level_ = b.peak;
+            }
+        }
+        if (b.clipped) {
+            clip_until_ = b.end_pos +
+                static_cast<uint64_t>(format_sample_rate_) * kClipHoldMs / 1000;
+        }
+        meter_blocks_.pop_front();
+    }
 }
 
 void AudioOutput::on_audio_tick() {
@@ -214,39 +302,13 @@ void AudioOutput::on_audio_tick() {
     }
 
     mono_.resize(static_cast<size_t>(frames));
+    const uint64_t render_start = engine_->samples_rendered();
     engine_->render(mono_.data(), frames);
     if (stopping_ || !device_ || !sink_) {
         return;
     }
-
-    {
-        int peak_abs = 0;
-        bool clipped = false;
-        for (int i = 0; i < frames; ++i) {
-            const int v = static_cast<int>(mono_[static_cast<size_t>(i)]);
-            const int av = std::abs(v);
-            if (av > peak_abs) {
-                peak_abs = av;
-            }
-            if (av >= 32767) {
-                clipped = true;
-            }
-        }
-        const float instant = static_cast<float>(peak_abs) / 32767.0f;
-        if (instant > peak_level_) {
-            peak_level_ = instant;
-        } else {
-            peak_level_ *= 0.92f;
-            if (instant > peak_level_) {
-                peak_level_ = instant;
-            }
-        }
-        if (clipped) {
-            clip_hold_ticks_ = 20;  // ~400 ms at 20 ms tick
-        } else if (clip_hold_ticks_ > 0) {
-            --clip_hold_ticks_;
-        }
-    }
+    rendered_end_ = engine_->samples_rendered();
+    push_meter_blocks(render_start, frames);
 
     if (format_is_float_) {
         const int total_samples = frames * format_channels_;
@@ -257,8 +319,11 @@ void AudioOutput::on_audio_tick() {
                 out[static_cast<size_t>(i * format_channels_ + ch)] = sample;
             }
         }
-        device_->write(reinterpret_cast<const char*>(out.data()),
-                       total_samples * static_cast<int>(sizeof(float)));
+        const qint64 written = device_->write(reinterpret_cast<const char*>(out.data()),
+                                              total_samples * static_cast<int>(sizeof(float)));
+        if (written > 0) {
+            frames_written_ += written / bytes_per_frame;
+        }
     } else {
         const int total_samples = frames * format_channels_;
         std::vector<int16_t> out(static_cast<size_t>(total_samples));
@@ -268,8 +333,11 @@ void AudioOutput::on_audio_tick() {
                 out[static_cast<size_t>(i * format_channels_ + ch)] = sample;
             }
         }
-        device_->write(reinterpret_cast<const char*>(out.data()),
-                       total_samples * static_cast<int>(sizeof(int16_t)));
+        const qint64 written = device_->write(reinterpret_cast<const char*>(out.data()),
+                                              total_samples * static_cast<int>(sizeof(int16_t)));
+        if (written > 0) {
+            frames_written_ += written / bytes_per_frame;
+        }
     }
 }
 
@@ -294,8 +362,10 @@ void AudioOutput::finalize_stop() {
     cycles_per_sample_ = 0.0;
     cycles_accum_ = 0.0;
     irq_cycle_pos_ = 0.0;
+    frames_written_ = 0;
+    meter_blocks_.clear();
     peak_level_ = 0.0f;
-    clip_hold_ticks_ = 0;
+    clip_until_ = 0;
     stopping_ = false;
     cleanup_pending_ = false;
 }
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <QObject>
+#include <cstdint>
+#include <deque>
 #include <vector>
 
 class QAudioSink;
@@ -28,9 +30,25 @@ public:
     int peak_percent() const;
     bool clip_recent() const;
 
+    // Latency compensation. Positions are in SoundEngine::samples_rendered()
+    // units: audible_sample_pos() is the rendered sample the sink is playing
+    // right now, i.e. everything still queued in the device buffer is
+    // subtracted. Peak/clip above follow the same clock.
+    uint64_t audible_sample_pos() const;
+    int latency_ms() const;
+
 private:
+    // Peak of one small slice of rendered audio, kept until it is heard.
+    struct MeterBlock {
+        uint64_t end_pos = 0;
+        float peak = 0.0f;
+        bool clipped = false;
+    };
+
     void on_audio_tick();
     void finalize_stop();
+    void push_meter_blocks(uint64_t start_pos, int frames);
+    void advance_meter() const;
 
     QAudioSink* sink_ = nullptr;
     QIODevice* device_ = nullptr;
@@ -49,6 +67,9 @@ private:
     bool step_z80_ = true;
     bool stopping_ = false;
     bool cleanup_pending_ = false;
-    float peak_level_ = 0.0f;
-    int clip_hold_ticks_ = 0;
+    int64_t frames_written_ = 0;
+    uint64_t rendered_end_ = 0;
+    mutable std::deque<MeterBlock> meter_blocks_;
+    mutable float peak_level_ = 0.0f;
+    mutable uint64_t clip_until_ = 0;
 };
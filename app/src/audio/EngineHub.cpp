@@ -135,6 +135,17 @@ bool EngineHub::audio_clip_recent() const {
     return audio_ ? audio_->clip_recent() : false;
 }
 
+uint64_t EngineHub::audio_audible_sample_pos() const {
+    if (audio_ && audio_->is_running()) {
+        return audio_->audible_sample_pos();
+    }
+    return engine_.samples_rendered();
+}
+
+int EngineHub::audio_latency_ms() const {
+    return audio_ ? audio_->latency_ms() : 0;
+}
+
 void EngineHub::set_step_z80(bool enabled) {
     if (audio_) {
         audio_->set_step_z80(enabled);
@@ -32,6 +32,10 @@ public:
     QString audio_debug_info() const;
     int audio_peak_percent() const;
     bool audio_clip_recent() const;
+    // Rendered sample currently coming out of the speaker (see AudioOutput).
+    // Without a running sink this is simply the render position.
+    uint64_t audio_audible_sample_pos() const;
+    int audio_latency_ms() const;
     void set_step_z80(bool enabled);
 
     ngpc::SoundEngine& engine();
@@ -0,0 +1,49 @@
+#include "audio/MidiBatchImporter.h"
+
+#include <QSaveFile>
+
+#include "models/SongDocument.h"
+#include "ngpc/parallel.h"
+
+// ============================================================
+// ImportMidiBatch
+// ============================================================
+
+std::vector<MidiBatchFileResult> ImportMidiBatch(
+    const std::vector<MidiBatchJob>& jobs,
+    const MidiImportSettings& settings,
+    const std::function<void(int done, int total)>& progress,
+    const std::atomic<bool>* cancel)
+{
+    std::vector<MidiBatchFileResult> results(jobs.size());
+    std::atomic<int> finished{0};
+    const int total = static_cast<int>(jobs.size());
+
+    ngpc::ParallelFor(jobs.size(), 0, [&](size_t i) {
+        const MidiBatchJob& job = jobs[i];
+        MidiBatchFileResult& out = results[i];
+
+        // Created and destroyed on this worker; never crosses threads.
+        SongDocument song;
+        out.import = ImportMidi(job.midi_path, &song, settings);
+        if (out.import.success) {
+            QSaveFile file(job.song_path);
+            if (!file.open(QIODevice::WriteOnly)) {
+                out.save_error = QString("Cannot write song file: %1").arg(job.song_path);
+            } else {
+                file.write(song.to_json());
+                if (!file.commit()) {
+                    out.save_error = QString("Cannot commit song file: %1").arg(job.song_path);
+                } else {
+                    out.saved = true;
+                }
+            }
+        }
+        out.done = true;
+
+        const int done = finished.fetch_add(1) + 1;
+        if (progress) progress(done, total);
+    }, cancel);
+
+    return results;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <QString>
+
+#include <atomic>
+#include <functional>
+#include <vector>
+
+#include "audio/MidiImporter.h"
+
+// One MIDI file of a batch and the .ngps it is written to.
+struct MidiBatchJob {
+    QString midi_path;
+    QString song_path;
+};
+
+struct MidiBatchFileResult {
+    bool done = false;          // false: cancelled before this file started
+    MidiImportResult import;    // import.success && saved -> song_path written
+    bool saved = false;
+    QString save_error;
+};
+
+// Imports every job on its own SongDocument, on a worker pool, and writes the
+// result with SongDocument::to_json(). Nothing is shared between jobs, so the
+// calling thread's songs and widgets are never touched.
+//
+// `progress(done, total)` is called from worker threads after each file.
+// Setting `*cancel` stops new files from starting. Blocks until the started
+// files are finished; results are in job order.
+std::vector<MidiBatchFileResult> ImportMidiBatch(
+    const std::vector<MidiBatchJob>& jobs,
+    const MidiImportSettings& settings,
+    const std::function<void(int done, int total)>& progress = {},
+    const std::atomic<bool>* cancel = nullptr);
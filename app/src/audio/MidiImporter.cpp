@@ -2,61 +2,17 @@
 
 #include <algorithm>
 #include <cmath>
-#include <cstring>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
-#include <QFile>
-
 #include "audio/TrackerPlaybackEngine.h"
 #include "models/SongDocument.h"
 #include "models/TrackerDocument.h"
-
-// ============================================================
-// MIDI binary helpers (local)
-// ============================================================
+#include "ngpc/midi.h"
 
 namespace {
 
-bool ReadU16BE(const uint8_t* d, size_t sz, size_t pos, uint16_t* out) {
-    if (pos + 2 > sz) return false;
-    *out = static_cast<uint16_t>((d[pos] << 8) | d[pos + 1]);
-    return true;
-}
-
-bool ReadU32BE(const uint8_t* d, size_t sz, size_t pos, uint32_t* out) {
-    if (pos + 4 > sz) return false;
-    *out = (uint32_t(d[pos]) << 24) | (uint32_t(d[pos+1]) << 16) |
-           (uint32_t(d[pos+2]) << 8) | uint32_t(d[pos+3]);
-    return true;
-}
-
-bool ReadVLQ(const uint8_t* d, size_t sz, size_t* pos, uint32_t* out) {
-    uint32_t v = 0;
-    for (int i = 0; i < 4; ++i) {
-        if (*pos >= sz) return false;
-        uint8_t b = d[*pos]; (*pos)++;
-        v = (v << 7) | (b & 0x7F);
-        if ((b & 0x80) == 0) { *out = v; return true; }
-    }
-    return false;
-}
-
-// ============================================================
-// MIDI event types for intermediate representation
-// ============================================================
-
-struct MidiNoteEvent {
-    int32_t tick;        // absolute tick position
-    uint8_t channel;     // MIDI channel (0-15)
-    uint8_t note;        // MIDI note number
-    uint8_t velocity;    // 0 = note off
-};
-
-struct MidiTempoEvent {
-    int32_t tick;
-    uint32_t us_per_beat; // microseconds per beat
-};
-
 // velocity (1-127) to PSG attenuation (0-15), 0=loud 15=silent
 uint8_t velocity_to_attn(uint8_t vel) {
     if (vel == 0) return 15;
@@ -100,160 +56,34 @@ MidiImportResult ImportMidi(const QString& path, SongDocument* song,
 {
     MidiImportResult result;
 
-    // --- Read file ---
-    QFile file(path);
-    if (!file.open(QIODevice::ReadOnly)) {
-        result.error = "Cannot open file";
+    // --- Read file: notes and tempo changes, sorted by tick ---
+    // Note-offs come before note-ons on the same tick.
+    ngpc::MidiSong midi;
+    std::string read_error;
+    if (!ngpc::ReadMidiSong(path.toStdString(), &midi, &read_error)) {
+        result.error = QString::fromStdString(read_error);
         return result;
     }
-    QByteArray raw = file.readAll();
-    file.close();
-
-    const auto* d = reinterpret_cast<const uint8_t*>(raw.constData());
-    const size_t sz = static_cast<size_t>(raw.size());
-
-    // --- Parse MThd ---
-    if (sz < 14 || std::memcmp(d, "MThd", 4) != 0) {
-        result.error = "Not a valid MIDI file (missing MThd)";
-        return result;
-    }
-
-    uint32_t header_len = 0;
-    if (!ReadU32BE(d, sz, 4, &header_len) || header_len < 6) {
-        result.error = "Invalid MIDI header";
-        return result;
-    }
-
-    uint16_t format = 0, num_tracks = 0, division = 0;
-    ReadU16BE(d, sz, 8, &format);
-    ReadU16BE(d, sz, 10, &num_tracks);
-    ReadU16BE(d, sz, 12, &division);
-
-    if (format > 1) {
-        result.error = "Only MIDI type 0 and 1 supported";
-        return result;
-    }
-    if (division & 0x8000) {
-        result.error = "SMPTE time division not supported";
-        return result;
-    }
-    if (division == 0) {
-        result.error = "Invalid MIDI division (0)";
-        return result;
-    }
-
-    int ticks_per_beat = division;
-
-    // --- Parse all tracks: extract note events + tempo ---
-    std::vector<MidiNoteEvent> notes;
-    std::vector<MidiTempoEvent> tempos;
-
-    size_t pos = 8 + header_len;
-
-    for (uint16_t trk = 0; trk < num_tracks; ++trk) {
-        if (pos + 8 > sz || std::memcmp(d + pos, "MTrk", 4) != 0) {
-            result.error = QString("Missing MTrk for track %1").arg(trk);
-            return result;
+    const int ticks_per_beat = midi.ticks_per_beat;
+
+    uint32_t first_tempo = 0;
+    int32_t max_tick = -1;
+    for (const ngpc::MidiEvent& ev : midi.events) {
+        if (ev.type == ngpc::kMidiTempo) {
+            if (first_tempo == 0) first_tempo = ev.tempo_us();
+        } else if (ev.type == ngpc::kMidiNoteOn || ev.type == ngpc::kMidiNoteOff) {
+            max_tick = static_cast<int32_t>(ev.tick);
         }
-
-        uint32_t track_len = 0;
-        ReadU32BE(d, sz, pos + 4, &track_len);
-        pos += 8;
-        size_t track_end = pos + track_len;
-        if (track_end > sz) track_end = sz;
-
-        int32_t abs_tick = 0;
-        uint8_t running = 0;
-
-        while (pos < track_end) {
-            uint32_t delta = 0;
-            if (!ReadVLQ(d, sz, &pos, &delta)) break;
-            abs_tick += static_cast<int32_t>(delta);
-
-            if (pos >= track_end) break;
-
-            uint8_t status = d[pos];
-            if (status < 0x80) {
-                if (running == 0) break;
-                status = running;
-            } else {
-                pos++;
-                if (status < 0xF0) running = status;
-            }
-
-            // Meta event
-            if (status == 0xFF) {
-                if (pos >= track_end) break;
-                uint8_t meta = d[pos++];
-                uint32_t len = 0;
-                if (!ReadVLQ(d, sz, &pos, &len)) break;
-                if (pos + len > track_end) break;
-
-                // Set Tempo
-                if (meta == 0x51 && len == 3) {
-                    uint32_t us = (uint32_t(d[pos]) << 16) |
-                                  (uint32_t(d[pos+1]) << 8) |
-                                  uint32_t(d[pos+2]);
-                    tempos.push_back({abs_tick, us});
-                }
-                pos += len;
-                continue;
-            }
-
-            // SysEx
-            if (status == 0xF0 || status == 0xF7) {
-                uint32_t len = 0;
-                if (!ReadVLQ(d, sz, &pos, &len)) break;
-                if (pos + len > track_end) break;
-                pos += len;
-                continue;
-            }
-
-            uint8_t hi = status & 0xF0;
-            uint8_t ch = status & 0x0F;
-            int data_bytes = 0;
-            switch (hi) {
-            case 0x80: case 0x90: case 0xA0:
-            case 0xB0: case 0xE0: data_bytes = 2; break;
-            case 0xC0: case 0xD0: data_bytes = 1; break;
-            default: data_bytes = 0; break;
-            }
-
-            if (pos + data_bytes > track_end) break;
-
-            if (hi == 0x90 && data_bytes == 2) {
-                uint8_t note = d[pos];
-                uint8_t vel = d[pos + 1];
-                notes.push_back({abs_tick, ch, note, vel});
-            } else if (hi == 0x80 && data_bytes == 2) {
-                uint8_t note = d[pos];
-                notes.push_back({abs_tick, ch, note, 0}); // note off
-            }
-
-            pos += data_bytes;
-        }
-
-        pos = track_end; // skip to next track
     }
 
-    if (notes.empty()) {
+    if (max_tick < 0) {
         result.error = "No note events found in MIDI file";
         return result;
     }
 
-    // Sort by tick, then by velocity descending (note-offs before note-ons at same tick)
-    std::sort(notes.begin(), notes.end(), [](const MidiNoteEvent& a, const MidiNoteEvent& b) {
-        if (a.tick != b.tick) return a.tick < b.tick;
-        // Note-offs (vel=0) should come before note-ons at same tick
-        if (a.velocity == 0 && b.velocity != 0) return true;
-        if (a.velocity != 0 && b.velocity == 0) return false;
-        return false;
-    });
-
     // --- Compute tempo for TPR suggestion ---
-    uint32_t first_tempo = 500000; // default 120 BPM
-    if (!tempos.empty()) {
-        first_tempo = tempos[0].us_per_beat;
+    if (first_tempo == 0) {
+        first_tempo = 500000; // default 120 BPM
     }
     // BPM = 60,000,000 / us_per_beat
     double bpm = 60000000.0 / first_tempo;
@@ -276,7 +106,6 @@ MidiImportResult ImportMidi(const QString& path, SongDocument* song,
     };
 
     // Find total rows needed
-    int32_t max_tick = notes.back().tick;
     int total_rows = tick_to_row(max_tick) + settings.rows_per_beat; // add one beat of margin
 
     // --- Voice allocation ---
@@ -294,9 +123,15 @@ MidiImportResult ImportMidi(const QString& path, SongDocument* song,
     VoiceSlot noise_slot = {};
 
     // Output: flat array of cells indexed by [row * 4 + tracker_ch]
-    int num_patterns = (total_rows + settings.pattern_length - 1) / settings.pattern_length;
-    num_patterns = std::clamp(num_patterns, 1, 64);
-    int actual_total_rows = num_patterns * settings.pattern_length;
+    // One order entry per pattern-length slice; identical slices share a
+    // pattern (see below), so the order list is the real limit.
+    int num_slices = (total_rows + settings.pattern_length - 1) / settings.pattern_length;
+    if (num_slices > SongDocument::kMaxOrderLength) {
+        num_slices = SongDocument::kMaxOrderLength;
+        result.truncated = true;
+    }
+    num_slices = std::max(num_slices, 1);
+    int actual_total_rows = num_slices * settings.pattern_length;
 
     struct CellEntry {
         bool has_note = false;
@@ -320,16 +155,17 @@ MidiImportResult ImportMidi(const QString& path, SongDocument* song,
     int notes_imported = 0;
     int notes_dropped = 0;
 
-    for (const auto& ev : notes) {
-        int row = tick_to_row(ev.tick);
+    for (const ngpc::MidiEvent& ev : midi.events) {
+        if (ev.type != ngpc::kMidiNoteOn && ev.type != ngpc::kMidiNoteOff) continue;
+        int row = tick_to_row(static_cast<int32_t>(ev.tick));
         if (row >= actual_total_rows) continue;
 
         bool is_drum = (ev.channel == 9);
 
-        if (ev.velocity == 0) {
+        if (ev.type == ngpc::kMidiNoteOff) {
             // Note off
             if (is_drum) {
-                if (noise_slot.active && noise_slot.note == ev.note) {
+                if (noise_slot.active && noise_slot.note == ev.key) {
                     // Write note-off at this row if cell is empty
                     auto& c = get_cell(row, 3);
                     if (!c.has_note) {
@@ -340,7 +176,7 @@ MidiImportResult ImportMidi(const QString& path, SongDocument* song,
                 }
             } else {
                 for (int i = 0; i < 3; ++i) {
-                    if (tone_slots[i].active && tone_slots[i].note == ev.note &&
+                    if (tone_slots[i].active && tone_slots[i].note == ev.key &&
                         tone_slots[i].midi_ch == ev.channel) {
                         auto& c = get_cell(row, i);
                         if (!c.has_note) {
@@ -369,10 +205,10 @@ MidiImportResult ImportMidi(const QString& path, SongDocument* song,
             }
             CellEntry ce;
             ce.has_note = true;
-            ce.note = gm_drum_to_noise(ev.note);
+            ce.note = gm_drum_to_noise(ev.key);
             ce.attn = attn;
             set_cell(row, 3, ce);
-            noise_slot = {true, ev.note, ev.channel, ev.tick};
+            noise_slot = {true, ev.key, ev.channel, static_cast<int32_t>(ev.tick)};
             notes_imported++;
         } else {
             // Find free tone slot
@@ -400,7 +236,7 @@ MidiImportResult ImportMidi(const QString& path, SongDocument* song,
             }
 
             // Convert MIDI note to tracker 1-based note
-            uint8_t tracker_note = midi_to_tracker_note(ev.note);
+            uint8_t tracker_note = midi_to_tracker_note(ev.key);
 
             CellEntry ce;
             ce.has_note = true;
@@ -408,65 +244,81 @@ MidiImportResult ImportMidi(const QString& path, SongDocument* song,
             ce.attn = attn;
             set_cell(row, slot, ce);
 
-            tone_slots[slot] = {true, ev.note, ev.channel, ev.tick};
+            tone_slots[slot] = {true, ev.key, ev.channel, static_cast<int32_t>(ev.tick)};
             notes_imported++;
         }
     }
 
     // --- Write cells into SongDocument patterns ---
-    // Clear existing song data
+    // Each slice is built in a scratch pattern and only becomes a new pattern
+    // when no earlier slice has the same cells; repeats reuse the earlier one
+    // in the order list, so loop-based songs stay well under kMaxPatterns.
     while (song->pattern_count() > 1) {
         song->remove_pattern(song->pattern_count() - 1);
     }
 
-    // Setup first pattern
-    TrackerDocument* pat = song->pattern(0);
-    pat->set_length(settings.pattern_length);
-    pat->clear_all();
-
-    // Create additional patterns
-    for (int p = 1; p < num_patterns; ++p) {
-        song->add_pattern();
-        TrackerDocument* np = song->pattern(p);
-        np->set_length(settings.pattern_length);
-    }
-
-    // Write cells
-    for (int row = 0; row < actual_total_rows; ++row) {
-        int pat_idx = row / settings.pattern_length;
-        int pat_row = row % settings.pattern_length;
-        TrackerDocument* p = song->pattern(pat_idx);
-        if (!p) continue;
-
-        for (int ch = 0; ch < 4; ++ch) {
-            const auto& ce = get_cell(row, ch);
-            if (!ce.has_note) continue;
-
-            if (ce.is_note_off) {
-                p->set_note(ch, pat_row, 0xFF); // note off
-            } else {
-                p->set_note(ch, pat_row, ce.note);
-                if (ce.attn != 0xFF) {
-                    p->set_attn(ch, pat_row, ce.attn);
+    TrackerDocument scratch;
+    scratch.set_length(settings.pattern_length);
+    std::unordered_map<uint64_t, std::vector<int>> by_hash; // content hash -> pattern indices
+    std::vector<int> order;
+
+    for (int s = 0; s < num_slices; ++s) {
+        scratch.clear_all();
+        for (int pat_row = 0; pat_row < settings.pattern_length; ++pat_row) {
+            const int row = s * settings.pattern_length + pat_row;
+            for (int ch = 0; ch < 4; ++ch) {
+                const auto& ce = get_cell(row, ch);
+                if (!ce.has_note) continue;
+
+                if (ce.is_note_off) {
+                    scratch.set_note(ch, pat_row, 0xFF); // note off
+                } else {
+                    scratch.set_note(ch, pat_row, ce.note);
+                    if (ce.attn != 0xFF) {
+                        scratch.set_attn(ch, pat_row, ce.attn);
+                    }
+                    scratch.set_instrument(ch, pat_row, ce.instrument);
                 }
-                p->set_instrument(ch, pat_row, ce.instrument);
             }
         }
+
+        auto& bucket = by_hash[scratch.content_hash()];
+        int target = -1;
+        for (int k : bucket) {
+            if (song->pattern(k)->same_content(scratch)) {
+                target = k;
+                break;
+            }
+        }
+        if (target >= 0) {
+            result.patterns_reused++;
+        } else {
+            target = order.empty() ? 0 : song->add_pattern();
+            if (target < 0) {
+                // Pattern bank full: the song stops at the last slice that fit.
+                result.truncated = true;
+                break;
+            }
+            song->pattern(target)->copy_content(scratch);
+            bucket.push_back(target);
+        }
+        order.push_back(target);
     }
 
-    // Setup order list: one entry per pattern
+    // Setup order list: one entry per slice
     // Clear old order and build new
     while (song->order_length() > 1) {
         song->order_remove(song->order_length() - 1);
     }
-    song->order_set_entry(0, 0);
-    for (int p = 1; p < num_patterns; ++p) {
-        song->order_insert(p, p);
+    song->order_set_entry(0, order[0]);
+    for (size_t i = 1; i < order.size(); ++i) {
+        song->order_insert(static_cast<int>(i), order[i]);
     }
     song->set_loop_point(0);
+    song->set_active_pattern(0);
 
     result.success = true;
-    result.patterns_created = num_patterns;
+    result.patterns_created = song->pattern_count();
     result.notes_imported = notes_imported;
     result.notes_dropped = notes_dropped;
     return result;
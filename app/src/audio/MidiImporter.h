@@ -15,6 +15,8 @@ struct MidiImportResult {
     bool success = false;
     QString error;
     int patterns_created = 0;
+    int patterns_reused = 0;  // order entries that point at an earlier identical slice
+    bool truncated = false;   // song cut at kMaxOrderLength slices or kMaxPatterns patterns
     int notes_imported = 0;
     int notes_dropped = 0;  // notes dropped due to polyphony limits
     int suggested_tpr = 8;  // suggested ticks-per-row for correct tempo
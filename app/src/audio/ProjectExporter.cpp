@@ -0,0 +1,536 @@
+#include "audio/ProjectExporter.h"
+
+#include <QDir>
+#include <QSaveFile>
+#include <QStringList>
+
+#include <algorithm>
+
+#include "models/InstrumentStore.h"
+#include "models/ProjectDocument.h"
+
+namespace {
+QString c_string_escape(const QString& text) {
+    QString out;
+    out.reserve(text.size() + 8);
+    for (const QChar ch : text) {
+        if (ch == '\\') {
+            out += "\\\\";
+        } else if (ch == '\"') {
+            out += "\\\"";
+        } else if (ch == '\n') {
+            out += "\\n";
+        } else if (ch == '\r') {
+            out += "\\r";
+        } else if (ch == '\t') {
+            out += "\\t";
+        } else {
+            out += ch;
+        }
+    }
+    return out;
+}
+} // namespace
+
+// ============================================================
+// Symbols and instrument bank
+// ============================================================
+
+QString ProjectExporter::song_symbol_prefix(const QString& song_id) {
+    QString stem = song_id.trimmed().toUpper();
+    if (stem.isEmpty()) stem = "SONG";
+    for (int i = 0; i < stem.size(); ++i) {
+        const QChar c = stem.at(i);
+        const bool ok = (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+        if (!ok) stem[i] = '_';
+    }
+    while (stem.contains("__")) stem.replace("__", "_");
+    while (stem.startsWith('_')) stem.remove(0, 1);
+    while (stem.endsWith('_')) stem.chop(1);
+    if (stem.isEmpty()) stem = "SONG";
+    if (stem[0].isDigit()) stem.prepend("S_");
+    return QString("PROJECT_%1").arg(stem);
+}
+bool ProjectExporter::build_instrument_merge(const QString& root_path,
+                                             const ProjectDocument& project,
+                                             const InstrumentStore& store,
+                                             std::array<uint8_t, 128>* remap,
+                                             std::vector<ngpc::InstrumentPreset>* bank,
+                                             QString* error) {
+    if (!remap || !bank) {
+        if (error) *error = "Internal error: null output buffer for instrument merge";
+        return false;
+    }
+
+    remap->fill(0);
+    bank->clear();
+
+    QStringList song_paths;
+    for (const auto& song : project.songs) {
+        song_paths.push_back(QDir(root_path).filePath(song.file));
+    }
+    std::array<bool, 128> used{};
+    QString io_error;
+    if (!SongExporter::collect_used_instruments(song_paths, &used, &io_error)) {
+        if (error) *error = QString("Cannot load song for instrument merge: %1").arg(io_error);
+        return false;
+    }
+
+    const bool has_any_used = std::find(used.begin(), used.end(), true) != used.end();
+    if (!has_any_used && store.count() > 0) {
+        used[0] = true;
+    }
+
+    const int store_count = std::min(store.count(), 128);
+    for (int old_id = 0; old_id < 128; ++old_id) {
+        if (!used[static_cast<size_t>(old_id)]) {
+            continue;
+        }
+        if (old_id >= store_count) {
+            (*remap)[static_cast<size_t>(old_id)] = 0;
+            continue;
+        }
+
+        const auto& src = store.at(old_id);
+        int found = -1;
+        for (int merged_id = 0; merged_id < static_cast<int>(bank->size()); ++merged_id) {
+            if (ngpc::InstrumentDefEquals(src.def, (*bank)[static_cast<size_t>(merged_id)].def)) {
+                found = merged_id;
+                break;
+            }
+        }
+        if (found < 0) {
+            found = static_cast<int>(bank->size());
+            bank->push_back(src);
+        }
+        (*remap)[static_cast<size_t>(old_id)] = static_cast<uint8_t>(found);
+    }
+
+    if (bank->empty()) {
+        if (store.count() > 0) {
+            bank->push_back(store.at(0));
+        } else {
+            ngpc::InstrumentPreset p;
+            p.name = "Default";
+            bank->push_back(p);
+        }
+    }
+    return true;
+}
+
+bool ProjectExporter::write_instruments(const QString& root_path,
+                                        const std::vector<ngpc::InstrumentPreset>& bank,
+                                        QString* error) {
+    QDir root(root_path);
+    if (!root.exists("exports") && !root.mkpath("exports")) {
+        if (error) *error = "Cannot create exports directory";
+        return false;
+    }
+
+    const QString out_path = root.filePath("exports/project_instruments.c");
+    QSaveFile out(out_path);
+    if (!out.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        if (error) *error = QString("Cannot write %1").arg(out_path);
+        return false;
+    }
+
+    QString code;
+    code += "/* Generated by NGPC Sound Creator - Project Instrument Bank */\n";
+    code += "/* Shared across all songs exported from this project */\n\n";
+    code += QString::fromStdString(ngpc::InstrumentPresetsToCArray(bank));
+
+    out.write(code.toUtf8());
+    if (!out.commit()) {
+        if (error) *error = QString("Cannot commit %1").arg(out_path);
+        return false;
+    }
+    return true;
+}
+
+// ============================================================
+// SFX bank and audio API
+// ============================================================
+
+bool ProjectExporter::write_sfx(const QString& root_path, const ProjectDocument& project, QString* error) {
+    QDir root(root_path);
+    if (!root.exists("exports") && !root.mkpath("exports")) {
+        if (error) *error = "Cannot create exports directory";
+        return false;
+    }
+
+    const QString out_path = root.filePath("exports/project_sfx.c");
+    QSaveFile out(out_path);
+    if (!out.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        if (error) *error = QString("Cannot write %1").arg(out_path);
+        return false;
+    }
+
+    QString code;
+    code += "/* Generated by NGPC Sound Creator - Project SFX Bank */\n";
+    code += "/* index -> name mapping is in comments below */\n\n";
+    code += "const unsigned char PROJECT_SFX_COUNT = " + QString::number(project.sfx.size()) + ";\n\n";
+
+    const auto append_u8 = [&](const QString& name, const auto& getter) {
+        code += "const unsigned char " + name + "[] = {";
+        if (project.sfx.empty()) {
+            code += "0";
+        } else {
+            for (int i = 0; i < project.sfx.size(); ++i) {
+                if (i) code += ", ";
+                code += QString::number(getter(project.sfx[i]));
+            }
+        }
+        code += "};\n";
+    };
+
+    const auto append_u16 = [&](const QString& name, const auto& getter) {
+        code += "const unsigned short " + name + "[] = {";
+        if (project.sfx.empty()) {
+            code += "0";
+        } else {
+            for (int i = 0; i < project.sfx.size(); ++i) {
+                if (i) code += ", ";
+                code += QString::number(getter(project.sfx[i]));
+            }
+        }
+        code += "};\n";
+    };
+
+    const auto append_s16 = [&](const QString& name, const auto& getter) {
+        code += "const signed short " + name + "[] = {";
+        if (project.sfx.empty()) {
+            code += "0";
+        } else {
+            for (int i = 0; i < project.sfx.size(); ++i) {
+                if (i) code += ", ";
+                code += QString::number(getter(project.sfx[i]));
+            }
+        }
+        code += "};\n";
+    };
+
+    append_u8("PROJECT_SFX_TONE_ON", [](const ProjectSfxEntry& e) { return e.tone_on; });
+    append_u8("PROJECT_SFX_TONE_CH", [](const ProjectSfxEntry& e) { return e.tone_ch; });
+    append_u16("PROJECT_SFX_TONE_DIV", [](const ProjectSfxEntry& e) { return e.tone_div; });
+    append_u8("PROJECT_SFX_TONE_ATTN", [](const ProjectSfxEntry& e) { return e.tone_attn; });
+    append_u8("PROJECT_SFX_TONE_FRAMES", [](const ProjectSfxEntry& e) { return e.tone_frames; });
+    append_u8("PROJECT_SFX_TONE_SW_ON", [](const ProjectSfxEntry& e) { return e.tone_sw_on; });
+    append_u16("PROJECT_SFX_TONE_SW_END", [](const ProjectSfxEntry& e) { return e.tone_sw_end; });
+    append_s16("PROJECT_SFX_TONE_SW_STEP", [](const ProjectSfxEntry& e) { return e.tone_sw_step; });
+    append_u8("PROJECT_SFX_TONE_SW_SPEED", [](const ProjectSfxEntry& e) { return e.tone_sw_speed; });
+    append_u8("PROJECT_SFX_TONE_SW_PING", [](const ProjectSfxEntry& e) { return e.tone_sw_ping; });
+    append_u8("PROJECT_SFX_TONE_ENV_ON", [](const ProjectSfxEntry& e) { return e.tone_env_on; });
+    append_u8("PROJECT_SFX_TONE_ENV_STEP", [](const ProjectSfxEntry& e) { return e.tone_env_step; });
+    append_u8("PROJECT_SFX_TONE_ENV_SPD", [](const ProjectSfxEntry& e) { return e.tone_env_spd; });
+    append_u8("PROJECT_SFX_NOISE_ON", [](const ProjectSfxEntry& e) { return e.noise_on; });
+    append_u8("PROJECT_SFX_NOISE_RATE", [](const ProjectSfxEntry& e) { return e.noise_rate; });
+    append_u8("PROJECT_SFX_NOISE_TYPE", [](const ProjectSfxEntry& e) { return e.noise_type; });
+    append_u8("PROJECT_SFX_NOISE_ATTN", [](const ProjectSfxEntry& e) { return e.noise_attn; });
+    append_u8("PROJECT_SFX_NOISE_FRAMES", [](const ProjectSfxEntry& e) { return e.noise_frames; });
+    append_u8("PROJECT_SFX_NOISE_BURST", [](const ProjectSfxEntry& e) { return e.noise_burst; });
+    append_u8("PROJECT_SFX_NOISE_BURST_DUR", [](const ProjectSfxEntry& e) { return e.noise_burst_dur; });
+    append_u8("PROJECT_SFX_NOISE_ENV_ON", [](const ProjectSfxEntry& e) { return e.noise_env_on; });
+    append_u8("PROJECT_SFX_NOISE_ENV_STEP", [](const ProjectSfxEntry& e) { return e.noise_env_step; });
+    append_u8("PROJECT_SFX_NOISE_ENV_SPD", [](const ProjectSfxEntry& e) { return e.noise_env_spd; });
+    append_u8("PROJECT_SFX_TONE_ADSR_ON", [](const ProjectSfxEntry& e) { return e.tone_adsr_on; });
+    append_u8("PROJECT_SFX_TONE_ADSR_AR", [](const ProjectSfxEntry& e) { return e.tone_adsr_ar; });
+    append_u8("PROJECT_SFX_TONE_ADSR_DR", [](const ProjectSfxEntry& e) { return e.tone_adsr_dr; });
+    append_u8("PROJECT_SFX_TONE_ADSR_SL", [](const ProjectSfxEntry& e) { return e.tone_adsr_sl; });
+    append_u8("PROJECT_SFX_TONE_ADSR_SR", [](const ProjectSfxEntry& e) { return e.tone_adsr_sr; });
+    append_u8("PROJECT_SFX_TONE_ADSR_RR", [](const ProjectSfxEntry& e) { return e.tone_adsr_rr; });
+    append_u8("PROJECT_SFX_TONE_LFO1_ON", [](const ProjectSfxEntry& e) { return e.tone_lfo1_on; });
+    append_u8("PROJECT_SFX_TONE_LFO1_WAVE", [](const ProjectSfxEntry& e) { return e.tone_lfo1_wave; });
+    append_u8("PROJECT_SFX_TONE_LFO1_HOLD", [](const ProjectSfxEntry& e) { return e.tone_lfo1_hold; });
+    append_u8("PROJECT_SFX_TONE_LFO1_RATE", [](const ProjectSfxEntry& e) { return e.tone_lfo1_rate; });
+    append_u8("PROJECT_SFX_TONE_LFO1_DEPTH", [](const ProjectSfxEntry& e) { return e.tone_lfo1_depth; });
+    append_u8("PROJECT_SFX_TONE_LFO2_ON", [](const ProjectSfxEntry& e) { return e.tone_lfo2_on; });
+    append_u8("PROJECT_SFX_TONE_LFO2_WAVE", [](const ProjectSfxEntry& e) { return e.tone_lfo2_wave; });
+    append_u8("PROJECT_SFX_TONE_LFO2_HOLD", [](const ProjectSfxEntry& e) { return e.tone_lfo2_hold; });
+    append_u8("PROJECT_SFX_TONE_LFO2_RATE", [](const ProjectSfxEntry& e) { return e.tone_lfo2_rate; });
+    append_u8("PROJECT_SFX_TONE_LFO2_DEPTH", [](const ProjectSfxEntry& e) { return e.tone_lfo2_depth; });
+    append_u8("PROJECT_SFX_TONE_LFO_ALGO", [](const ProjectSfxEntry& e) { return e.tone_lfo_algo; });
+    code += "\n";
+
+    for (int i = 0; i < project.sfx.size(); ++i) {
+        code += QString("/* %1: %2 */\n").arg(i).arg(project.sfx[i].name);
+    }
+
+    out.write(code.toUtf8());
+    if (!out.commit()) {
+        if (error) *error = QString("Cannot commit %1").arg(out_path);
+        return false;
+    }
+    return true;
+}
+
+bool ProjectExporter::write_audio_api(const QString& root_path,
+                                      const ProjectDocument& project,
+                                      bool asm_export,
+                                      QString* error) {
+    QDir root(root_path);
+    if (!root.exists("exports") && !root.mkpath("exports")) {
+        if (error) *error = "Cannot create exports directory";
+        return false;
+    }
+
+    const QString manifest_path = root.filePath("exports/project_audio_manifest.txt");
+    QSaveFile manifest(manifest_path);
+    if (!manifest.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        if (error) *error = QString("Cannot write %1").arg(manifest_path);
+        return false;
+    }
+
+    QString manifest_text;
+    manifest_text += "Generated by NGPC Sound Creator - Project Audio Manifest\n";
+    manifest_text += QString("mode=%1\n").arg(asm_export ? "ASM" : "C");
+    manifest_text += QString("song_count=%1\n").arg(project.songs.size());
+    manifest_text += "songs:\n";
+    const QString song_ext = asm_export ? ".inc" : ".c";
+    for (const auto& song : project.songs) {
+        manifest_text += "  - id=" + song.id
+                         + " | name=" + song.name
+                         + " | file=exports/" + song.id + song_ext
+                         + " | symbols=" + song_symbol_prefix(song.id) + "_*\n";
+    }
+    manifest_text += "instruments=exports/project_instruments.c\n";
+    manifest_text += "sfx=exports/project_sfx.c\n";
+    manifest_text += "notes:\n";
+    manifest_text += "  - Song symbols are namespaced to avoid collisions.\n";
+    manifest_text += "  - Include project_audio_api.h/.c for one-click C integration.\n";
+    manifest_text += "  - Use NgpcProject_BgmStartLoop4ByIndex(i) to auto-switch NOTE_TABLE + streams.\n";
+    manifest_text += "  - For ASM export, use this manifest as include/reference list.\n";
+
+    manifest.write(manifest_text.toUtf8());
+    if (!manifest.commit()) {
+        if (error) *error = QString("Cannot commit %1").arg(manifest_path);
+        return false;
+    }
+
+    if (asm_export) {
+        return true;
+    }
+
+    const QString header_path = root.filePath("exports/project_audio_api.h");
+    QSaveFile header(header_path);
+    if (!header.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        if (error) *error = QString("Cannot write %1").arg(header_path);
+        return false;
+    }
+
+    QString h;
+    h += "/* Generated by NGPC Sound Creator - Project Audio API */\n";
+    h += "#ifndef NGPC_PROJECT_AUDIO_API_H\n";
+    h += "#define NGPC_PROJECT_AUDIO_API_H\n\n";
+    h += "#ifdef __cplusplus\nextern \"C\" {\n#endif\n\n";
+    h += "typedef struct NgpcProjectSongRef {\n";
+    h += "    const char* id;\n";
+    h += "    const char* name;\n";
+    h += "    const unsigned char* note_table;\n";
+    h += "    const unsigned char* ch0;\n";
+    h += "    const unsigned char* ch1;\n";
+    h += "    const unsigned char* ch2;\n";
+    h += "    const unsigned char* chn;\n";
+    h += "    unsigned short loop_ch0;\n";
+    h += "    unsigned short loop_ch1;\n";
+    h += "    unsigned short loop_ch2;\n";
+    h += "    unsigned short loop_chn;\n";
+    h += "} NgpcProjectSongRef;\n\n";
+    h += "extern const unsigned short NGPC_PROJECT_SONG_COUNT;\n";
+    h += "extern const NgpcProjectSongRef NGPC_PROJECT_SONGS[];\n\n";
+    h += "const NgpcProjectSongRef* NgpcProject_GetSong(unsigned short index);\n";
+    h += "void NgpcProject_BgmStartLoop4ByIndex(unsigned short index);\n\n";
+    h += "#ifdef __cplusplus\n}\n#endif\n\n";
+    h += "#endif /* NGPC_PROJECT_AUDIO_API_H */\n";
+
+    header.write(h.toUtf8());
+    if (!header.commit()) {
+        if (error) *error = QString("Cannot commit %1").arg(header_path);
+        return false;
+    }
+
+    const QString source_path = root.filePath("exports/project_audio_api.c");
+    QSaveFile source(source_path);
+    if (!source.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        if (error) *error = QString("Cannot write %1").arg(source_path);
+        return false;
+    }
+
+    QString c;
+    c += "/* Generated by NGPC Sound Creator - Project Audio API */\n";
+    c += "#include \"project_audio_api.h\"\n\n";
+    c += "/* Driver entry points (sounds.c). */\n";
+    c += "extern void Bgm_SetNoteTable(const unsigned char* note_table);\n";
+    c += "extern void Bgm_StartLoop4Ex(const unsigned char* stream0, unsigned short loop0,\n";
+    c += "                             const unsigned char* stream1, unsigned short loop1,\n";
+    c += "                             const unsigned char* stream2, unsigned short loop2,\n";
+    c += "                             const unsigned char* streamN, unsigned short loopN);\n\n";
+    c += "#if defined(__GNUC__)\n";
+    c += "#define NGPC_PROJECT_WEAK __attribute__((weak))\n";
+    c += "#else\n";
+    c += "#define NGPC_PROJECT_WEAK\n";
+    c += "#endif\n";
+    c += "/* Link fallback only. Real table is selected per song at runtime. */\n";
+    c += "const unsigned char NOTE_TABLE[102] NGPC_PROJECT_WEAK = {\n";
+    for (int i = 0; i < 51; ++i) {
+        c += "    0x01, 0x00";
+        if (i < 50) c += ",";
+        c += "\n";
+    }
+    c += "};\n\n";
+    c += "/* Song symbols come from exports/song_*.c (namespaced by export pipeline). */\n";
+    for (const auto& song : project.songs) {
+        const QString pfx = song_symbol_prefix(song.id);
+        c += QString("extern const unsigned char %1_NOTE_TABLE[];\n").arg(pfx);
+        c += QString("extern const unsigned char %1_BGM_CH0[];\n").arg(pfx);
+        c += QString("extern const unsigned char %1_BGM_CH1[];\n").arg(pfx);
+        c += QString("extern const unsigned char %1_BGM_CH2[];\n").arg(pfx);
+        c += QString("extern const unsigned char %1_BGM_CHN[];\n").arg(pfx);
+        c += QString("extern const unsigned short %1_BGM_CH0_LOOP;\n").arg(pfx);
+        c += QString("extern const unsigned short %1_BGM_CH1_LOOP;\n").arg(pfx);
+        c += QString("extern const unsigned short %1_BGM_CH2_LOOP;\n").arg(pfx);
+        c += QString("extern const unsigned short %1_BGM_CHN_LOOP;\n").arg(pfx);
+    }
+    c += "\n";
+    c += QString("const unsigned short NGPC_PROJECT_SONG_COUNT = %1;\n\n")
+             .arg(project.songs.size());
+    c += "const NgpcProjectSongRef NGPC_PROJECT_SONGS[] = {\n";
+    for (const auto& song : project.songs) {
+        const QString pfx = song_symbol_prefix(song.id);
+        c += "    {\n";
+        c += QString("        \"%1\",\n").arg(c_string_escape(song.id));
+        c += QString("        \"%1\",\n").arg(c_string_escape(song.name));
+        c += QString("        %1_NOTE_TABLE,\n").arg(pfx);
+        c += QString("        %1_BGM_CH0,\n").arg(pfx);
+        c += QString("        %1_BGM_CH1,\n").arg(pfx);
+        c += QString("        %1_BGM_CH2,\n").arg(pfx);
+        c += QString("        %1_BGM_CHN,\n").arg(pfx);
+        c += QString("        %1_BGM_CH0_LOOP,\n").arg(pfx);
+        c += QString("        %1_BGM_CH1_LOOP,\n").arg(pfx);
+        c += QString("        %1_BGM_CH2_LOOP,\n").arg(pfx);
+        c += QString("        %1_BGM_CHN_LOOP\n").arg(pfx);
+        c += "    },\n";
+    }
+    c += "};\n\n";
+    c += "const NgpcProjectSongRef* NgpcProject_GetSong(unsigned short index)\n";
+    c += "{\n";
+    c += "    if (index >= NGPC_PROJECT_SONG_COUNT) return 0;\n";
+    c += "    return &NGPC_PROJECT_SONGS[index];\n";
+    c += "}\n\n";
+    c += "void NgpcProject_BgmStartLoop4ByIndex(unsigned short index)\n";
+    c += "{\n";
+    c += "    const NgpcProjectSongRef* song = NgpcProject_GetSong(index);\n";
+    c += "    if (!song) return;\n";
+    c += "    Bgm_SetNoteTable(song->note_table);\n";
+    c += "    Bgm_StartLoop4Ex(song->ch0, song->loop_ch0,\n";
+    c += "                     song->ch1, song->loop_ch1,\n";
+    c += "                     song->ch2, song->loop_ch2,\n";
+    c += "                     song->chn, song->loop_chn);\n";
+    c += "}\n";
+
+    source.write(c.toUtf8());
+    if (!source.commit()) {
+        if (error) *error = QString("Cannot commit %1").arg(source_path);
+        return false;
+    }
+
+    return true;
+}
+// ============================================================
+// Songs and Export All
+// ============================================================
+
+bool ProjectExporter::export_songs(const QString& root_path,
+                                   const ProjectDocument& project,
+                                   const InstrumentStore& store,
+                                   const SongExporter::Settings& settings,
+                                   bool namespace_symbols,
+                                   std::vector<SongExporter::Result>* results,
+                                   QString* error) {
+    if (project.songs.isEmpty()) {
+        if (error) *error = "Project has no songs";
+        return false;
+    }
+    QDir root(root_path);
+    if (!root.exists("exports") && !root.mkpath("exports")) {
+        if (error) *error = "Cannot create exports directory";
+        return false;
+    }
+
+    // Songs whose cache key has not changed skip simulation and encoding.
+    SongExporter::Settings cached_settings = settings;
+    if (root.mkpath("exports/.cache")) {
+        cached_settings.cache_dir = root.filePath("exports/.cache");
+    }
+
+    const QString ext = settings.asm_export ? ".inc" : ".c";
+    std::vector<SongExporter::Job> jobs;
+    for (const auto& song : project.songs) {
+        SongExporter::Job job;
+        job.song_path = root.filePath(song.file);
+        job.out_path = root.filePath(QString("exports/%1%2").arg(song.id, ext));
+        if (namespace_symbols) {
+            job.symbol_prefix = song_symbol_prefix(song.id);
+        }
+        jobs.push_back(job);
+    }
+
+    std::vector<SongExporter::Result> song_results = SongExporter::export_files(jobs, &store, cached_settings);
+    bool ok = true;
+    for (int i = 0; i < project.songs.size(); ++i) {
+        const SongExporter::Result& r = song_results[static_cast<size_t>(i)];
+        if (!r.ok) {
+            if (error) *error = QString("Cannot export song '%1': %2")
+                                    .arg(project.songs[i].name)
+                                    .arg(r.error);
+            ok = false;
+            break;
+        }
+    }
+    if (results) *results = std::move(song_results);
+    return ok;
+}
+
+bool ProjectExporter::export_all(const QString& root_path,
+                                 const ProjectDocument& project,
+                                 const InstrumentStore& store,
+                                 const SongExporter::Settings& settings,
+                                 std::vector<SongExporter::Result>* results,
+                                 QString* error) {
+    std::array<uint8_t, 128> instrument_remap{};
+    std::vector<ngpc::InstrumentPreset> bank;
+    SongExporter::Settings song_settings = settings;
+    song_settings.instrument_remap = nullptr;
+
+    if (settings.hybrid) {
+        QString merge_error;
+        if (!build_instrument_merge(root_path, project, store, &instrument_remap, &bank, &merge_error)) {
+            if (error) *error = QString("Cannot build project instrument merge: %1").arg(merge_error);
+            return false;
+        }
+        song_settings.instrument_remap = &instrument_remap;
+    } else {
+        bank.reserve(static_cast<size_t>(store.count()));
+        for (int i = 0; i < store.count(); ++i) {
+            bank.push_back(store.at(i));
+        }
+    }
+
+    if (!export_songs(root_path, project, store, song_settings, true, results, error)) {
+        return false;
+    }
+
+    QString io_error;
+    if (!write_instruments(root_path, bank, &io_error)) {
+        if (error) *error = QString("Cannot export project instruments: %1").arg(io_error);
+        return false;
+    }
+    if (!write_sfx(root_path, project, &io_error)) {
+        if (error) *error = QString("Cannot export project SFX: %1").arg(io_error);
+        return false;
+    }
+    if (!write_audio_api(root_path, project, settings.asm_export, &io_error)) {
+        if (error) *error = QString("Cannot export project audio API: %1").arg(io_error);
+        return false;
+    }
+    return true;
+}
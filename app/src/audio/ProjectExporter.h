@@ -0,0 +1,68 @@
+#pragma once
+
+#include <QString>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "audio/SongExporter.h"
+#include "ngpc/instrument.h"
+
+class InstrumentStore;
+class ProjectDocument;
+
+// ============================================================
+// ProjectExporter — headless project -> exports/ pipeline
+// Everything "Export All" writes, from a project root, its ProjectDocument
+// and its InstrumentStore: namespaced songs, the merged instrument bank,
+// the SFX bank, the audio API and the manifest. Shared by the GUI and
+// ngpc_sound_cli.
+// ============================================================
+
+class ProjectExporter
+{
+public:
+    // PROJECT_<ID>: prefix of a song's symbols in project exports.
+    static QString song_symbol_prefix(const QString& song_id);
+
+    // Instruments used by any song of the project, deduplicated by
+    // definition. `remap` maps store ids to bank ids.
+    static bool build_instrument_merge(const QString& root_path,
+                                       const ProjectDocument& project,
+                                       const InstrumentStore& store,
+                                       std::array<uint8_t, 128>* remap,
+                                       std::vector<ngpc::InstrumentPreset>* bank,
+                                       QString* error = nullptr);
+
+    // exports/<song id>.c|.inc for every song. `settings.symbol_prefix` is
+    // ignored; `namespace_symbols` applies song_symbol_prefix() instead.
+    static bool export_songs(const QString& root_path,
+                             const ProjectDocument& project,
+                             const InstrumentStore& store,
+                             const SongExporter::Settings& settings,
+                             bool namespace_symbols,
+                             std::vector<SongExporter::Result>* results = nullptr,
+                             QString* error = nullptr);
+
+    // exports/project_instruments.c
+    static bool write_instruments(const QString& root_path,
+                                  const std::vector<ngpc::InstrumentPreset>& bank,
+                                  QString* error = nullptr);
+    // exports/project_sfx.c
+    static bool write_sfx(const QString& root_path, const ProjectDocument& project, QString* error = nullptr);
+    // exports/project_audio_manifest.txt, plus project_audio_api.h/.c for C.
+    static bool write_audio_api(const QString& root_path,
+                                const ProjectDocument& project,
+                                bool asm_export,
+                                QString* error = nullptr);
+
+    // Export All: songs (with the merged bank in hybrid mode), instruments,
+    // SFX and API. Songs are read from their .ngps files.
+    static bool export_all(const QString& root_path,
+                           const ProjectDocument& project,
+                           const InstrumentStore& store,
+                           const SongExporter::Settings& settings,
+                           std::vector<SongExporter::Result>* results = nullptr,
+                           QString* error = nullptr);
+};
@@ -0,0 +1,1047 @@
+#include "audio/SongExporter.h"
+
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QSaveFile>
+
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+
+#include "audio/TrackerPlaybackEngine.h"
+#include "models/InstrumentStore.h"
+#include "models/SongDocument.h"
+#include "models/TrackerDocument.h"
+#include "ngpc/bgm_binary.h"
+#include "ngpc/bgm_compress.h"
+#include "ngpc/bgm_voice.h"
+#include "ngpc/instrument.h"
+#include "ngpc/note_table.h"
+#include "ngpc/parallel.h"
+
+namespace {
+constexpr int kMaxExportWarnings = 20;
+constexpr size_t kMaxDetuneWarnings = 5;
+
+void append_export_warning(QStringList& warnings, int& hidden_count, const QString& message) {
+    if (warnings.size() < kMaxExportWarnings) {
+        warnings.push_back(message);
+    } else {
+        hidden_count++;
+    }
+}
+
+// Run-length encoder for one channel of the pre-baked export, fed one tick at
+// a time. Tone notes are written with a placeholder byte; resolve_notes()
+// patches in the NOTE_TABLE index once the table is built.
+class PrebakedChannelEncoder {
+public:
+    PrebakedChannelEncoder(std::vector<uint8_t>* stream, bool noise) : stream_(stream), noise_(noise) {}
+
+    // The loop point is the next tick pushed.
+    void mark_loop() { loop_pending_ = true; }
+
+    void push(bool active, uint16_t divider, uint8_t attn, uint8_t noise_val) {
+        if (loop_pending_) {
+            loop_offset_ = static_cast<uint16_t>(stream_->size());
+            loop_pending_ = false;
+        }
+
+        if (!active) {
+            // Channel silent
+            if (cur_active_ && cur_key_ != 0) {
+                // Was playing a note → flush it, then start rest
+                flush();
+                cur_key_ = 0;
+            }
+            cur_active_ = false;
+            // Accumulate rest duration (0xFF)
+            if (cur_key_ == 0) {
+                pending_dur_++;
+            }
+            return;
+        }
+
+        // Note key: noise value + 1, or divider + 1 on tone channels (0 = rest)
+        const uint32_t key = noise_ ? static_cast<uint32_t>((noise_val & 0x07) + 1)
+                                    : static_cast<uint32_t>(divider) + 1;
+        const bool note_changed = (key != cur_key_) || !cur_active_;
+        const bool attn_changed = (attn != cur_attn_);
+
+        if (note_changed || attn_changed) {
+            flush();
+
+            // Emit attenuation change if needed
+            if (attn_changed) {
+                stream_->push_back(0xF0);
+                stream_->push_back(static_cast<uint8_t>(attn & 0x0F));
+                cur_attn_ = attn;
+            }
+
+            cur_key_ = key;
+            cur_active_ = true;
+        }
+
+        pending_dur_++;
+    }
+
+    // A loop point after the last tick is dropped (offset 0).
+    void finish(uint16_t* loop_offset) {
+        flush();
+        // End marker
+        stream_->push_back(0x00);
+        *loop_offset = loop_offset_;
+    }
+
+    void resolve_notes(const ngpc::NoteTablePlanner& planner) {
+        for (const NoteFix& fix : fixes_) {
+            const uint8_t index = static_cast<uint8_t>(planner.index_of(fix.divider) + 1);
+            for (size_t pos = fix.begin; pos < fix.end; pos += 2) {
+                (*stream_)[pos] = index;
+            }
+        }
+        fixes_.clear();
+    }
+
+private:
+    struct NoteFix {
+        size_t begin;  // first note byte; AppendBgmEvent splits long notes
+        size_t end;
+        uint16_t divider;
+    };
+
+    void flush() {
+        if (pending_dur_ <= 0) return;
+        if (cur_key_ == 0) {
+            ngpc::AppendBgmEvent(*stream_, 0xFF, pending_dur_);
+        } else if (noise_) {
+            ngpc::AppendBgmEvent(*stream_, static_cast<uint8_t>(cur_key_), pending_dur_);
+        } else {
+            const size_t begin = stream_->size();
+            ngpc::AppendBgmEvent(*stream_, 0x01, pending_dur_);
+            fixes_.push_back({begin, stream_->size(), static_cast<uint16_t>(cur_key_ - 1)});
+        }
+        pending_dur_ = 0;
+    }
+
+    std::vector<uint8_t>* stream_;
+    bool noise_;
+    std::vector<NoteFix> fixes_;
+    bool cur_active_ = false;
+    uint32_t cur_key_ = 0;  // 0 = no note playing
+    uint8_t cur_attn_ = 15;
+    int pending_dur_ = 0;
+    bool loop_pending_ = false;
+    uint16_t loop_offset_ = 0;
+};
+
+// ============================================================
+// Export cache: one file per song under the cache directory
+//   u32 magic, u32 version, u64 key, NOTE_TABLE, 4 x (stream, loop),
+//   warnings, header notes, raw stream bytes
+// ============================================================
+
+constexpr quint32 kCacheMagic = 0x4E475343;  // "NGSC"
+constexpr quint32 kCacheVersion = 1;         // bump when the encoders change
+
+struct EncodedSong {
+    ngpc::BgmExportStreams es;
+    QStringList warnings;
+    QStringList notes;  // header comments (compression stats)
+    int raw_stream_bytes = 0;
+};
+
+bool read_cache_entry(const QString& path, uint64_t key, EncodedSong* out) {
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly)) return false;
+    QDataStream in(&f);
+    quint32 magic = 0;
+    quint32 version = 0;
+    quint64 stored_key = 0;
+    in >> magic >> version >> stored_key;
+    if (in.status() != QDataStream::Ok || magic != kCacheMagic || version != kCacheVersion ||
+        stored_key != key) {
+        return false;
+    }
+    EncodedSong e;
+    quint32 note_count = 0;
+    in >> note_count;
+    if (note_count > 1024) return false;
+    e.es.note_table.resize(note_count);
+    for (quint32 i = 0; i < note_count; ++i) {
+        quint16 div = 0;
+        in >> div;
+        e.es.note_table[i] = div;
+    }
+    for (size_t ch = 0; ch < 4; ++ch) {
+        QByteArray bytes;
+        quint16 loop = 0;
+        in >> bytes >> loop;
+        e.es.streams[ch].assign(bytes.begin(), bytes.end());
+        e.es.loop_offsets[ch] = loop;
+    }
+    qint32 raw_bytes = 0;
+    in >> e.warnings >> e.notes >> raw_bytes;
+    if (in.status() != QDataStream::Ok || e.es.note_table.empty()) return false;
+    e.raw_stream_bytes = raw_bytes;
+    *out = std::move(e);
+    return true;
+}
+
+// Best effort: a cache that cannot be written only costs the next export time.
+void write_cache_entry(const QString& path, uint64_t key, const EncodedSong& e) {
+    QSaveFile f(path);
+    if (!f.open(QIODevice::WriteOnly)) return;
+    QDataStream out(&f);
+    out << kCacheMagic << kCacheVersion << static_cast<quint64>(key);
+    out << static_cast<quint32>(e.es.note_table.size());
+    for (uint16_t div : e.es.note_table) out << static_cast<quint16>(div);
+    for (size_t ch = 0; ch < 4; ++ch) {
+        const auto& stream = e.es.streams[ch];
+        out << QByteArray(reinterpret_cast<const char*>(stream.data()), static_cast<int>(stream.size()))
+            << static_cast<quint16>(e.es.loop_offsets[ch]);
+    }
+    out << e.warnings << e.notes << static_cast<qint32>(e.raw_stream_bytes);
+    f.commit();
+}
+} // namespace
+
+// ============================================================
+// Audit
+// ============================================================
+
+QStringList SongExporter::audit(const SongDocument* song,
+                                const InstrumentStore* store,
+                                bool hybrid_mode) {
+    QStringList warnings;
+    int hidden_count = 0;
+
+    if (!song) {
+        warnings.push_back("No song loaded.");
+        return warnings;
+    }
+
+    const auto& order = song->order();
+    if (order.empty()) {
+        warnings.push_back("Order list is empty; export will contain no music.");
+        return warnings;
+    }
+
+    const int store_count = store ? store->count() : 0;
+    std::array<bool, 128> warned_missing_instrument{};
+    warned_missing_instrument.fill(false);
+    std::array<bool, 16> warned_unsupported_fx{};
+    warned_unsupported_fx.fill(false);
+    ngpc::NoteTablePlanner note_planner;
+    std::array<QString, 1024> divider_first_loc;
+
+    bool warned_invalid_note = false;
+    bool warned_invalid_attn = false;
+    bool warned_b00 = false;
+    int hybrid_bxx_off_ch0 = 0;
+    int hybrid_exx_off_ch0 = 0;
+    QString first_bxx_off_ch0;
+    QString first_exx_off_ch0;
+
+    for (int ord_pos = 0; ord_pos < static_cast<int>(order.size()); ++ord_pos) {
+        const int pat_idx = order[static_cast<size_t>(ord_pos)];
+        const TrackerDocument* pat = song->pattern(pat_idx);
+        if (!pat) {
+            append_export_warning(
+                warnings, hidden_count,
+                QString("Order %1 references missing pattern %2.").arg(ord_pos).arg(pat_idx));
+            continue;
+        }
+
+        for (int row = 0; row < pat->length(); ++row) {
+            for (int ch = 0; ch < 4; ++ch) {
+                const TrackerCell& c = pat->cell(ch, row);
+                const QString loc = QString("ord %1 pat %2 row %3 ch%4")
+                                        .arg(ord_pos).arg(pat_idx).arg(row).arg(ch);
+
+                if (c.note != 0 && c.note != 0xFF && !c.is_note_on() && !warned_invalid_note) {
+                    append_export_warning(
+                        warnings, hidden_count,
+                        QString("Invalid note value %1 at %2 (expected 1..127, OFF or empty).")
+                            .arg(c.note).arg(loc));
+                    warned_invalid_note = true;
+                }
+
+                if (c.attn != 0xFF && c.attn > 15 && !warned_invalid_attn) {
+                    append_export_warning(
+                        warnings, hidden_count,
+                        QString("Invalid attenuation %1 at %2 (expected 0..15 or AUTO).")
+                            .arg(c.attn).arg(loc));
+                    warned_invalid_attn = true;
+                }
+
+                const uint8_t fx_nibble = static_cast<uint8_t>(c.fx & 0x0F);
+                if (c.has_fx()) {
+                    switch (fx_nibble) {
+                    case 0x0:
+                    case 0x1:
+                    case 0x2:
+                    case 0x3:
+                    case 0x4:
+                    case 0xA:
+                    case 0xB:
+                    case 0xC:
+                    case 0xD:
+                    case 0xE:
+                    case 0xF:
+                        break;
+                    default:
+                        if (!warned_unsupported_fx[fx_nibble]) {
+                            append_export_warning(
+                                warnings, hidden_count,
+                                QString("FX %1 is not supported at runtime (first seen at %2).")
+                                    .arg(fx_nibble, 1, 16, QChar('0')).toUpper()
+                                    .arg(loc));
+                            warned_unsupported_fx[fx_nibble] = true;
+                        }
+                        break;
+                    }
+
+                    if (fx_nibble == 0xB && c.fx_param == 0 && !warned_b00) {
+                        append_export_warning(
+                            warnings, hidden_count,
+                            QString("B00 has no effect (first seen at %1).").arg(loc));
+                        warned_b00 = true;
+                    }
+                    if (hybrid_mode && fx_nibble == 0xB && ch != 0) {
+                        hybrid_bxx_off_ch0++;
+                        if (first_bxx_off_ch0.isEmpty()) first_bxx_off_ch0 = loc;
+                    }
+                    if (hybrid_mode && fx_nibble == 0xE && ch != 0) {
+                        hybrid_exx_off_ch0++;
+                        if (first_exx_off_ch0.isEmpty()) first_exx_off_ch0 = loc;
+                    }
+                }
+
+                if (!c.is_note_on()) continue;
+
+                if (store_count <= 0) {
+                    if (c.instrument != 0 && !warned_missing_instrument[c.instrument]) {
+                        append_export_warning(
+                            warnings, hidden_count,
+                            QString("Instrument %1 used at %2 but instrument bank is empty.")
+                                .arg(c.instrument).arg(loc));
+                        warned_missing_instrument[c.instrument] = true;
+                    }
+                } else if (c.instrument >= store_count && !warned_missing_instrument[c.instrument]) {
+                    append_export_warning(
+                        warnings, hidden_count,
+                        QString("Instrument %1 used at %2 but only 0..%3 exist. Fallback to default.")
+                            .arg(c.instrument).arg(loc).arg(store_count - 1));
+                    warned_missing_instrument[c.instrument] = true;
+                }
+
+                if (ch < 3) {
+                    const uint16_t div = TrackerPlaybackEngine::midi_to_divider(c.note);
+                    note_planner.add(div);
+                    QString& first_loc = divider_first_loc[static_cast<size_t>(std::clamp<int>(div, 1, 1023))];
+                    if (first_loc.isEmpty()) first_loc = loc;
+                }
+            }
+        }
+    }
+
+    note_planner.build();
+    if (note_planner.capped()) {
+        append_export_warning(
+            warnings, hidden_count,
+            QString("Tone note table uses %1 unique dividers; driver limit is %2 "
+                    "(table chosen for the least usage-weighted detune).")
+                .arg(note_planner.distinct())
+                .arg(ngpc::kMaxDriverNotes));
+        for (const auto& d : note_planner.worst_detunings(kMaxDetuneWarnings)) {
+            append_export_warning(
+                warnings, hidden_count,
+                QString("Divider %1 (first at %2, %3 use(s)) plays as %4: %5 cents.")
+                    .arg(d.divider)
+                    .arg(divider_first_loc[static_cast<size_t>(std::clamp<int>(d.divider, 1, 1023))])
+                    .arg(d.uses)
+                    .arg(d.entry)
+                    .arg(d.cents, 0, 'f', 1));
+        }
+    }
+
+    if (hybrid_mode && hybrid_bxx_off_ch0 > 0) {
+        append_export_warning(
+            warnings, hidden_count,
+            QString("Hybrid export found %1 Bxx command(s) outside CH0 (first: %2). "
+                    "Prefer putting global speed changes on CH0 for deterministic timing.")
+                .arg(hybrid_bxx_off_ch0).arg(first_bxx_off_ch0));
+    }
+
+    if (hybrid_mode && hybrid_exx_off_ch0 > 0) {
+        append_export_warning(
+            warnings, hidden_count,
+            QString("Hybrid export found %1 Exx host command(s) outside CH0 (first: %2). "
+                    "Prefer CH0 for global host commands.")
+                .arg(hybrid_exx_off_ch0).arg(first_exx_off_ch0));
+    }
+
+    if (hidden_count > 0) {
+        warnings.push_back(QString("%1 additional warning(s) hidden.").arg(hidden_count));
+    }
+
+    return warnings;
+}
+
+std::array<bool, 128> SongExporter::collect_used_instruments(const SongDocument& song) {
+    std::array<bool, 128> used{};
+    used.fill(false);
+
+    auto collect_from_pattern = [&](const TrackerDocument* pat) {
+        if (!pat) return;
+        for (int row = 0; row < pat->length(); ++row) {
+            for (int ch = 0; ch < 4; ++ch) {
+                const TrackerCell& c = pat->cell(ch, row);
+                if (c.is_note_on()) {
+                    used[static_cast<uint8_t>(c.instrument)] = true;
+                }
+            }
+        }
+    };
+
+    const auto& order = song.order();
+    if (!order.empty()) {
+        for (int pat_idx : order) {
+            collect_from_pattern(song.pattern(pat_idx));
+        }
+        return used;
+    }
+
+    for (int i = 0; i < song.pattern_count(); ++i) {
+        collect_from_pattern(song.pattern(i));
+    }
+    return used;
+}
+
+// ============================================================
+// Export — pre-baked (tick-by-tick with effects + instruments)
+// ============================================================
+
+ngpc::BgmExportStreams SongExporter::build_streams_prebaked(const SongDocument& song,
+                                                             const InstrumentStore* store,
+                                                             int ticks_per_row)
+{
+    ngpc::BgmExportStreams result;
+    result.loop_offsets.fill(0);
+
+    if (song.pattern_count() == 0) return result;
+
+    const auto& order = song.order();
+    if (order.empty()) return result;
+
+    // Tick-by-tick simulation (like WavExporter), each tick fed straight to
+    // the four channel encoders. Tone notes go out with a placeholder byte
+    // and their divider; once the NOTE_TABLE is known a fix-up pass writes
+    // the real indices. Memory follows the output, not the song length.
+
+    TrackerPlaybackEngine engine;
+    engine.set_instrument_store(const_cast<InstrumentStore*>(store));
+    engine.set_ticks_per_row(ticks_per_row);
+
+    ngpc::NoteTablePlanner note_planner;
+    std::array<PrebakedChannelEncoder, 4> encoders = {
+        PrebakedChannelEncoder(&result.streams[0], false),
+        PrebakedChannelEncoder(&result.streams[1], false),
+        PrebakedChannelEncoder(&result.streams[2], false),
+        PrebakedChannelEncoder(&result.streams[3], true),
+    };
+    bool had_any_tick = false;
+
+    for (int ord_pos = 0; ord_pos < static_cast<int>(order.size()); ++ord_pos) {
+        // Record loop point (the next tick encoded)
+        if (ord_pos == song.loop_point()) {
+            for (auto& encoder : encoders) encoder.mark_loop();
+        }
+
+        int pat_idx = order[static_cast<size_t>(ord_pos)];
+        // The engine only reads the pattern.
+        TrackerDocument* pat = const_cast<TrackerDocument*>(song.pattern(pat_idx));
+        if (!pat) continue;
+
+        engine.set_document(pat);
+        engine.start(0);
+
+        bool pattern_done = false;
+        bool had_ticks = false;
+        while (!pattern_done) {
+            engine.tick();
+            had_ticks = true;
+            had_any_tick = true;
+
+            for (int ch = 0; ch < 4; ++ch) {
+                const auto out = engine.channel_output(ch);
+                if (ch < 3 && out.active && out.divider > 0) {
+                    note_planner.add(out.divider);
+                }
+                encoders[static_cast<size_t>(ch)].push(out.active, out.divider, out.attn, out.noise_val);
+            }
+
+            // Pattern finished detection (same as WavExporter)
+            if (engine.current_row() == 0 && engine.tick_counter() == 0 && had_ticks) {
+                pattern_done = true;
+            }
+        }
+        engine.stop();
+    }
+
+    if (!had_any_tick) return result;
+
+    for (int ch = 0; ch < 4; ++ch) {
+        encoders[static_cast<size_t>(ch)].finish(&result.loop_offsets[static_cast<size_t>(ch)]);
+    }
+
+    // NOTE_TABLE from every divider, weighted by ticks, then the fix-up.
+    note_planner.build();
+    result.note_table = note_planner.table();
+    if (result.note_table.empty()) result.note_table.push_back(1);
+    for (auto& encoder : encoders) {
+        encoder.resolve_notes(note_planner);
+    }
+
+    return result;
+}
+
+// ============================================================
+// Export — hybrid (row-based with instrument opcodes)
+// ============================================================
+
+ngpc::BgmExportStreams SongExporter::build_streams_hybrid(
+    const SongDocument& song,
+    const InstrumentStore* store,
+    int ticks_per_row,
+    const std::array<uint8_t, 128>* instrument_remap)
+{
+    ngpc::BgmExportStreams result;
+    result.loop_offsets.fill(0);
+
+    if (song.pattern_count() == 0) return result;
+
+    const auto& order = song.order();
+    if (order.empty()) return result;
+
+    // --- NOTE_TABLE from every tone note-on, weighted by use ---
+    // Channel by channel, the order the streams are written in.
+
+    ngpc::NoteTablePlanner note_planner;
+    for (int ch = 0; ch < 3; ++ch) {
+        for (int pat_idx : order) {
+            const TrackerDocument* pat = song.pattern(pat_idx);
+            if (!pat) continue;
+            for (int row = 0; row < pat->length(); ++row) {
+                const TrackerCell& c = pat->cell(ch, row);
+                if (c.is_note_on()) {
+                    note_planner.add(TrackerPlaybackEngine::midi_to_divider(c.note));
+                }
+            }
+        }
+    }
+    note_planner.build();
+    std::vector<uint16_t>& note_table = result.note_table;
+    note_table = note_planner.table();
+
+    // Helper: emit instrument inline opcodes (0xF4 + 0xF0-0xF3)
+    auto emit_instrument = [&](std::vector<uint8_t>& stream, int inst_idx) {
+        const uint8_t src_inst = static_cast<uint8_t>(inst_idx & 0x7F);
+        const uint8_t driver_inst = instrument_remap ? (*instrument_remap)[src_inst] : src_inst;
+        ngpc::BgmInstrumentDef def;
+        if (store && src_inst < store->count()) {
+            def = store->at(src_inst).def;
+        }
+        // 0xF4 SET_INST (for real driver)
+        stream.push_back(0xF4);
+        stream.push_back(driver_inst);
+        // 0xF0 SET_ATTN (for PlayerTab preview)
+        stream.push_back(0xF0);
+        stream.push_back(static_cast<uint8_t>(def.attn & 0x0F));
+        // 0xF1 SET_ENV
+        if (def.env_on) {
+            stream.push_back(0xF1);
+            stream.push_back(def.env_step);
+            stream.push_back(def.env_speed);
+        } else {
+            stream.push_back(0xF1);
+            stream.push_back(0); // step=0 → env off
+            stream.push_back(1);
+        }
+        // 0xF2 SET_VIB
+        stream.push_back(0xF2);
+        stream.push_back(def.vib_depth);
+        stream.push_back(def.vib_speed > 0 ? def.vib_speed : static_cast<uint8_t>(1));
+        stream.push_back(def.vib_delay);
+        // 0xF3 SET_SWEEP
+        if (def.sweep_on) {
+            stream.push_back(0xF3);
+            stream.push_back(static_cast<uint8_t>(def.sweep_end & 0xFF));
+            stream.push_back(static_cast<uint8_t>((def.sweep_end >> 8) & 0xFF));
+            stream.push_back(static_cast<uint8_t>(def.sweep_step & 0xFF));
+            stream.push_back(def.sweep_speed > 0 ? def.sweep_speed : static_cast<uint8_t>(1));
+        }
+        // 0xF9 SET_ADSR (legacy 4 params, kept for fallback)
+        if (def.adsr_on) {
+            stream.push_back(0xF9);
+            stream.push_back(def.adsr_attack);
+            stream.push_back(def.adsr_decay);
+            stream.push_back(def.adsr_sustain);
+            stream.push_back(def.adsr_release);
+        }
+        // 0xFA SET_LFO (legacy LFO1 shorthand, kept for fallback)
+        stream.push_back(0xFA);
+        stream.push_back(static_cast<uint8_t>(std::clamp<int>(def.lfo_wave, 0, 4)));
+        stream.push_back(def.lfo_rate);
+        stream.push_back(def.lfo_on ? def.lfo_depth : static_cast<uint8_t>(0));
+        // 0xFE EXT 0x01: ADSR5 (A,D,SL,SR,RR)
+        if (def.adsr_on) {
+            stream.push_back(0xFE);
+            stream.push_back(0x01);
+            stream.push_back(def.adsr_attack);
+            stream.push_back(def.adsr_decay);
+            stream.push_back(def.adsr_sustain);
+            stream.push_back(def.adsr_sustain_rate);
+            stream.push_back(def.adsr_release);
+        }
+        // 0xFE EXT 0x02: MOD2 (algo + LFO1 + LFO2)
+        stream.push_back(0xFE);
+        stream.push_back(0x02);
+        stream.push_back(static_cast<uint8_t>(std::clamp<int>(def.lfo_algo, 0, 7)));
+        stream.push_back(def.lfo_on ? static_cast<uint8_t>(1) : static_cast<uint8_t>(0));
+        stream.push_back(static_cast<uint8_t>(std::clamp<int>(def.lfo_wave, 0, 4)));
+        stream.push_back(def.lfo_hold);
+        stream.push_back(def.lfo_rate);
+        stream.push_back(def.lfo_depth);
+        stream.push_back(def.lfo2_on ? static_cast<uint8_t>(1) : static_cast<uint8_t>(0));
+        stream.push_back(static_cast<uint8_t>(std::clamp<int>(def.lfo2_wave, 0, 4)));
+        stream.push_back(def.lfo2_hold);
+        stream.push_back(def.lfo2_rate);
+        stream.push_back(def.lfo2_depth);
+        // 0xFB SET_ENV_CURVE (curve_id)
+        stream.push_back(0xFB);
+        stream.push_back(def.env_curve_id);
+        // 0xFC SET_PITCH_CURVE (curve_id)
+        stream.push_back(0xFC);
+        stream.push_back(def.pitch_curve_id);
+        // 0xFD SET_MACRO (macro_id)
+        stream.push_back(0xFD);
+        stream.push_back(def.macro_id);
+    };
+
+    // --- Build streams row by row ---
+
+    for (int ch = 0; ch < 4; ++ch) {
+        auto& stream = result.streams[static_cast<size_t>(ch)];
+        const bool is_noise = (ch == 3);
+
+        int cur_instrument = -1;
+        uint8_t cur_attn = 0xFF; // no override yet
+
+        // Pending state: accumulate durations for same note/silence
+        enum PendingType { PEND_NONE, PEND_NOTE, PEND_SILENCE };
+        PendingType pending = PEND_NONE;
+        uint8_t pending_note_idx = 0;
+        int pending_dur = 0;
+
+        auto flush_pending = [&]() {
+            if (pending_dur <= 0) return;
+            if (pending == PEND_NOTE && pending_note_idx > 0) {
+                ngpc::AppendBgmEvent(stream, pending_note_idx, pending_dur);
+            } else if (pending == PEND_SILENCE) {
+                ngpc::AppendBgmEvent(stream, 0xFF, pending_dur);
+            }
+            pending = PEND_NONE;
+            pending_dur = 0;
+        };
+
+        int local_tpr = ticks_per_row;
+
+        for (int ord_pos = 0; ord_pos < static_cast<int>(order.size()); ++ord_pos) {
+            // Record loop point
+            if (ch == 0 || true) { // all channels
+                if (ord_pos == song.loop_point()) {
+                    flush_pending();
+                    result.loop_offsets[static_cast<size_t>(ch)] = static_cast<uint16_t>(stream.size());
+                }
+            }
+
+            int pat_idx = order[static_cast<size_t>(ord_pos)];
+            const TrackerDocument* pat = song.pattern(pat_idx);
+            if (!pat) continue;
+
+            for (int row = 0; row < pat->length(); ++row) {
+                const TrackerCell& c = pat->cell(ch, row);
+                int dur = local_tpr;
+                PendingType resume_pending = PEND_NONE;
+                uint8_t resume_note_idx = 0;
+                bool resume_after_inline = false;
+                auto flush_pending_inline = [&]() {
+                    if (pending_dur <= 0) {
+                        return;
+                    }
+                    resume_pending = pending;
+                    resume_note_idx = pending_note_idx;
+                    resume_after_inline = true;
+                    flush_pending();
+                };
+
+                // Bxx: speed change
+                if (c.fx == 0xB && c.fx_param > 0) {
+                    local_tpr = c.fx_param;
+                    dur = local_tpr;
+                }
+
+                // Exx: host commands (emit on channel 0 only)
+                if (c.fx == 0xE && ch == 0) {
+                    flush_pending_inline();
+                    uint8_t sub = (c.fx_param >> 4) & 0x0F;
+                    uint8_t val = c.fx_param & 0x0F;
+                    stream.push_back(0xF6); // HOST_CMD
+                    stream.push_back(sub);  // type: 0=fade, 1=tempo
+                    stream.push_back(val);  // data
+                }
+
+                // Fxx: expression (per-channel)
+                if (c.fx == 0xF) {
+                    flush_pending_inline();
+                    uint8_t expr = c.fx_param;
+                    if (expr > 15) expr = 15;
+                    stream.push_back(0xF7); // SET_EXPR
+                    stream.push_back(expr);
+                }
+
+                // 4xx: pitch bend (per-channel, signed byte -> s16 LE)
+                if (c.fx == 0x4) {
+                    flush_pending_inline();
+                    int8_t sb = static_cast<int8_t>(c.fx_param);
+                    int16_t bend = static_cast<int16_t>(sb);
+                    stream.push_back(0xF8); // PITCH_BEND
+                    stream.push_back(static_cast<uint8_t>(bend & 0xFF));
+                    stream.push_back(static_cast<uint8_t>((bend >> 8) & 0xFF));
+                }
+
+                if (c.is_note_on()) {
+                    // Flush any pending note/silence
+                    flush_pending();
+
+                    // Instrument change?
+                    if (static_cast<int>(c.instrument) != cur_instrument) {
+                        cur_instrument = c.instrument;
+                        emit_instrument(stream, cur_instrument);
+                    }
+
+                    // Attn override?
+                    if (c.attn != 0xFF) {
+                        stream.push_back(0xF0);
+                        stream.push_back(static_cast<uint8_t>(c.attn & 0x0F));
+                        cur_attn = c.attn;
+                    }
+
+                    // Compute note index
+                    uint8_t note_idx;
+                    if (is_noise) {
+                        note_idx = static_cast<uint8_t>((TrackerPlaybackEngine::midi_note_to_noise_val(c.note) & 0x07) + 1);
+                    } else {
+                        uint16_t div = TrackerPlaybackEngine::midi_to_divider(c.note);
+                        note_idx = static_cast<uint8_t>(note_planner.index_of(div) + 1);
+                    }
+
+                    // Handle Cxx (note cut)
+                    if (c.fx == 0xC) {
+                        int cut = std::min(static_cast<int>(c.fx_param), dur);
+                        if (cut > 0) {
+                            ngpc::AppendBgmEvent(stream, note_idx, cut);
+                        }
+                        int rest = dur - cut;
+                        if (rest > 0) {
+                            pending = PEND_SILENCE;
+                            pending_dur = rest;
+                        }
+                    }
+                    // Handle Dxx (note delay)
+                    else if (c.fx == 0xD) {
+                        int delay = std::min(static_cast<int>(c.fx_param), dur);
+                        if (delay > 0) {
+                            ngpc::AppendBgmEvent(stream, 0xFF, delay);
+                        }
+                        int rest = dur - delay;
+                        if (rest > 0) {
+                            pending = PEND_NOTE;
+                            pending_note_idx = note_idx;
+                            pending_dur = rest;
+                        }
+                    }
+                    else {
+                        pending = PEND_NOTE;
+                        pending_note_idx = note_idx;
+                        pending_dur = dur;
+                    }
+                }
+                else if (c.is_note_off()) {
+                    flush_pending();
+                    pending = PEND_SILENCE;
+                    pending_dur = dur;
+                }
+                else {
+                    // Empty row or effect-only row
+                    // Attn change on empty row: emit inline
+                    if (c.attn != 0xFF && c.attn != cur_attn) {
+                        flush_pending_inline();
+                        stream.push_back(0xF0);
+                        stream.push_back(static_cast<uint8_t>(c.attn & 0x0F));
+                        cur_attn = c.attn;
+                        // Restart same state (the note/silence continues)
+                    }
+                    if (resume_after_inline && pending == PEND_NONE) {
+                        pending = resume_pending;
+                        pending_note_idx = resume_note_idx;
+                    }
+                    // Accumulate duration
+                    if (pending == PEND_NONE) {
+                        // No note was playing → silence
+                        pending = PEND_SILENCE;
+                        pending_dur = dur;
+                    } else {
+                        pending_dur += dur;
+                    }
+                }
+            }
+        }
+
+        // Flush remaining
+        flush_pending();
+
+        // End marker
+        stream.push_back(0x00);
+    }
+
+    if (note_table.empty()) note_table.push_back(1);
+
+    return result;
+}
+
+// ============================================================
+// Export — write one song
+// ============================================================
+
+QString SongExporter::namespace_symbols(const QString& source, const QString& symbol_prefix) {
+    static const QStringList base_symbols = {
+        "NOTE_TABLE",
+        "BGM_CH0_LOOP", "BGM_CH1_LOOP", "BGM_CH2_LOOP", "BGM_CHN_LOOP", "BGM_MONO_LOOP",
+        "BGM_CH0", "BGM_CH1", "BGM_CH2", "BGM_CHN", "BGM_MONO"
+    };
+
+    QString text = source;
+    for (const QString& base : base_symbols) {
+        const QString renamed = QString("%1_%2").arg(symbol_prefix, base);
+        const QRegularExpression re(QString("\\b%1\\b").arg(QRegularExpression::escape(base)));
+        text.replace(re, renamed);
+    }
+    return text;
+}
+
+uint64_t SongExporter::cache_key(const SongDocument& song,
+                                 const InstrumentStore* store,
+                                 const Settings& settings) {
+    // FNV-1a over everything the encoded streams depend on.
+    uint64_t h = 1469598103934665603ull;
+    auto mix = [&h](uint64_t value) {
+        for (int i = 0; i < 8; ++i) {
+            h ^= static_cast<uint8_t>(value >> (8 * i));
+            h *= 1099511628211ull;
+        }
+    };
+    mix(kCacheVersion);
+    mix(settings.hybrid ? 1 : 0);
+    mix(static_cast<uint64_t>(settings.ticks_per_row));
+    mix(settings.compress ? 1 : 0);
+
+    mix(static_cast<uint64_t>(song.loop_point()));
+    mix(song.order().size());
+    for (int pat_idx : song.order()) {
+        const TrackerDocument* pat = song.pattern(pat_idx);
+        mix(static_cast<uint64_t>(pat_idx));
+        mix(pat ? pat->content_hash() : 0);
+    }
+
+    const int store_count = store ? store->count() : 0;
+    mix(static_cast<uint64_t>(store_count));
+    const std::array<bool, 128> used = collect_used_instruments(song);
+    for (size_t id = 0; id < used.size(); ++id) {
+        if (!used[id]) continue;
+        mix(id);
+        if (settings.hybrid && settings.instrument_remap) {
+            mix((*settings.instrument_remap)[id]);
+        }
+        if (static_cast<int>(id) < store_count) {
+            h = ngpc::InstrumentDefHash(store->at(static_cast<int>(id)).def, h);
+        }
+    }
+    const auto tables = store ? store->fx_tables() : nullptr;
+    mix(tables ? tables->content_hash() : ngpc::FactoryFxTables().content_hash());
+    return h;
+}
+
+SongExporter::Result SongExporter::export_to_path(const QString& path,
+                                                  const SongDocument& song,
+                                                  const InstrumentStore* store,
+                                                  const Settings& settings) {
+    Result result;
+    if (path.isEmpty()) {
+        result.error = "Empty export path";
+        return result;
+    }
+
+    // Build, audit and compress, or take all three from the cache.
+    EncodedSong encoded;
+    QString cache_path;
+    uint64_t key = 0;
+    if (!settings.cache_dir.isEmpty()) {
+        cache_path = QDir(settings.cache_dir).filePath(QFileInfo(path).completeBaseName() + ".bin");
+        key = cache_key(song, store, settings);
+        result.cached = read_cache_entry(cache_path, key, &encoded);
+    }
+    if (!result.cached) {
+        encoded.es = settings.hybrid
+            ? build_streams_hybrid(song, store, settings.ticks_per_row, settings.instrument_remap)
+            : build_streams_prebaked(song, store, settings.ticks_per_row);
+        if (encoded.es.note_table.empty()) {
+            result.error = "Nothing to export";
+            return result;
+        }
+        encoded.warnings = audit(&song, store, settings.hybrid);
+        encoded.raw_stream_bytes = 0;
+        for (const auto& stream : encoded.es.streams) {
+            encoded.raw_stream_bytes += static_cast<int>(stream.size());
+        }
+        if (settings.compress) {
+            const ngpc::BgmCompressStats stats = ngpc::CompressBgmStreams(&encoded.es);
+            if (stats.subroutines > 0) {
+                encoded.notes.push_back(QString("Subroutines: %1, calls: %2, stream bytes %3 -> %4")
+                                            .arg(stats.subroutines)
+                                            .arg(stats.calls)
+                                            .arg(stats.total_before())
+                                            .arg(stats.total_after()));
+            }
+        }
+        if (!cache_path.isEmpty()) {
+            write_cache_entry(cache_path, key, encoded);
+        }
+    }
+    const ngpc::BgmExportStreams& es = encoded.es;
+    result.warnings = encoded.warnings;
+    result.raw_stream_bytes = encoded.raw_stream_bytes;
+
+    ngpc::BgmSourceOptions source_options;
+    source_options.mode_label = settings.hybrid ? "Hybrid" : "Pre-baked";
+    for (const QString& w : encoded.warnings) {
+        source_options.warnings.push_back(w.toUtf8().toStdString());
+    }
+    for (const QString& n : encoded.notes) {
+        source_options.notes.push_back(n.toStdString());
+    }
+    const std::string source = settings.asm_export ? ngpc::FormatBgmAsm(es, source_options)
+                                                   : ngpc::FormatBgmC(es, source_options);
+    QString text = QString::fromStdString(source);
+    if (!settings.symbol_prefix.isEmpty()) {
+        text = namespace_symbols(text, settings.symbol_prefix);
+    }
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        result.error = QString("Could not write %1").arg(path);
+        return result;
+    }
+    file.write(text.toUtf8());
+    if (!file.commit()) {
+        result.error = QString("Could not commit %1").arg(path);
+        return result;
+    }
+    if (settings.write_binary) {
+        const QFileInfo info(path);
+        const QString bin_path = info.dir().filePath(info.completeBaseName() + ".ngpb");
+        const std::vector<uint8_t> bytes = ngpc::FormatBgmBinary(es);
+        QSaveFile bin(bin_path);
+        if (!bin.open(QIODevice::WriteOnly)) {
+            result.error = QString("Could not write %1").arg(bin_path);
+            return result;
+        }
+        bin.write(reinterpret_cast<const char*>(bytes.data()), static_cast<qint64>(bytes.size()));
+        if (!bin.commit()) {
+            result.error = QString("Could not commit %1").arg(bin_path);
+            return result;
+        }
+    }
+
+    result.note_count = static_cast<int>(es.note_table.size());
+    for (const auto& stream : es.streams) {
+        result.stream_bytes += static_cast<int>(stream.size());
+    }
+    result.ok = true;
+    return result;
+}
+
+// ============================================================
+// Project batch
+// ============================================================
+
+bool SongExporter::load_song_file(const QString& path, SongDocument* song, QString* error) {
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly)) {
+        if (error) *error = QString("Could not open %1").arg(path);
+        return false;
+    }
+    if (!song->from_json(f.readAll())) {
+        if (error) *error = QString("Invalid file %1").arg(path);
+        return false;
+    }
+    return true;
+}
+
+std::vector<SongExporter::Result> SongExporter::export_files(const std::vector<Job>& jobs,
+                                                             const InstrumentStore* store,
+                                                             const Settings& settings) {
+    std::vector<Result> results(jobs.size());
+    ngpc::ParallelFor(jobs.size(), 0, [&](size_t i) {
+        const Job& job = jobs[i];
+        // Created and destroyed on this worker; never crosses threads.
+        SongDocument song;
+        if (!load_song_file(job.song_path, &song, &results[i].error)) {
+            return;
+        }
+        Settings job_settings = settings;
+        job_settings.symbol_prefix = job.symbol_prefix;
+        results[i] = export_to_path(job.out_path, song, store, job_settings);
+    });
+    return results;
+}
+
+bool SongExporter::collect_used_instruments(const QStringList& song_paths,
+                                            std::array<bool, 128>* used,
+                                            QString* error) {
+    std::vector<std::array<bool, 128>> per_song(static_cast<size_t>(song_paths.size()));
+    std::vector<QString> errors(static_cast<size_t>(song_paths.size()));
+    ngpc::ParallelFor(per_song.size(), 0, [&](size_t i) {
+        SongDocument song;
+        if (load_song_file(song_paths[static_cast<int>(i)], &song, &errors[i])) {
+            per_song[i] = collect_used_instruments(song);
+        }
+    });
+
+    used->fill(false);
+    for (size_t i = 0; i < per_song.size(); ++i) {
+        if (!errors[i].isEmpty()) {
+            if (error) *error = errors[i];
+            return false;
+        }
+        for (size_t id = 0; id < 128; ++id) {
+            (*used)[id] = (*used)[id] || per_song[i][id];
+        }
+    }
+    return true;
+}
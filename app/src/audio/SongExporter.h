@@ -0,0 +1,105 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "ngpc/bgm_export.h"
+
+class SongDocument;
+class InstrumentStore;
+
+// ============================================================
+// SongExporter — headless song -> NGPC stream export
+// Works on a SongDocument and explicit settings only, so songs can be
+// exported without the tracker widgets and several at once.
+// ============================================================
+
+class SongExporter
+{
+public:
+    struct Settings {
+        bool hybrid = true;          // false: pre-baked (tick-by-tick)
+        int ticks_per_row = 8;
+        bool asm_export = false;     // .inc instead of .c
+        // Hybrid only: source instrument id -> driver id (project merge).
+        const std::array<uint8_t, 128>* instrument_remap = nullptr;
+        // Non-empty: NOTE_TABLE / BGM_* symbols become <prefix>_NOTE_TABLE...
+        QString symbol_prefix;
+        // Fold repeated event runs into driver subroutines (EXT CALL/RET).
+        bool compress = true;
+        // Non-empty: reuse the encoded streams stored in
+        // <cache_dir>/<output base name>.bin when cache_key() still matches.
+        QString cache_dir;
+        // Also write <output base name>.ngpb next to the source: the same
+        // streams as a binary container (ngpc/bgm_binary.h) tools can map.
+        bool write_binary = false;
+    };
+
+    struct Result {
+        bool ok = false;
+        QString error;
+        int note_count = 0;      // NOTE_TABLE entries
+        int stream_bytes = 0;
+        int raw_stream_bytes = 0;  // before compression
+        QStringList warnings;
+        bool cached = false;       // streams came from Settings::cache_dir
+    };
+
+    // Stream builders. The pre-baked one runs a private TrackerPlaybackEngine.
+    static ngpc::BgmExportStreams build_streams_prebaked(const SongDocument& song,
+                                                         const InstrumentStore* store,
+                                                         int ticks_per_row);
+    static ngpc::BgmExportStreams build_streams_hybrid(
+        const SongDocument& song,
+        const InstrumentStore* store,
+        int ticks_per_row,
+        const std::array<uint8_t, 128>* instrument_remap = nullptr);
+
+    static QStringList audit(const SongDocument* song,
+                             const InstrumentStore* store,
+                             bool hybrid_mode);
+
+    // Instruments referenced by note-ons of the order list (every pattern
+    // when the order list is empty).
+    static std::array<bool, 128> collect_used_instruments(const SongDocument& song);
+
+    static QString namespace_symbols(const QString& source, const QString& symbol_prefix);
+
+    // Hash of what the encoded streams depend on: order, loop point, the
+    // patterns played, the instruments they use (and their remap), the FX
+    // tables and the stream settings. Symbol prefix and C/ASM are not part
+    // of it; they only change the formatting.
+    static uint64_t cache_key(const SongDocument& song,
+                              const InstrumentStore* store,
+                              const Settings& settings);
+
+    // Build, audit, format and write one song.
+    static Result export_to_path(const QString& path,
+                                 const SongDocument& song,
+                                 const InstrumentStore* store,
+                                 const Settings& settings);
+
+    // --- Project batch (worker pool) ---
+    // Each job loads its .ngps into a private SongDocument. `store` is only
+    // read and must not change until the call returns.
+    struct Job {
+        QString song_path;       // .ngps
+        QString out_path;        // .c / .inc
+        QString symbol_prefix;   // overrides Settings::symbol_prefix
+    };
+
+    static std::vector<Result> export_files(const std::vector<Job>& jobs,
+                                            const InstrumentStore* store,
+                                            const Settings& settings);
+
+    // Union of collect_used_instruments() over .ngps files, loaded in parallel.
+    static bool collect_used_instruments(const QStringList& song_paths,
+                                         std::array<bool, 128>* used,
+                                         QString* error = nullptr);
+
+    static bool load_song_file(const QString& path, SongDocument* song, QString* error = nullptr);
+};
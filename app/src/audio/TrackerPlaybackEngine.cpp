@@ -41,7 +41,8 @@ void TrackerPlaybackEngine::start(int from_row) {
     current_row_ = std::clamp(from_row, 0, doc_->length() - 1);
     tick_counter_ = 0;
 
-    for (auto& v : voices_) v.note_off();
+    bind_fx_tables();
+    for (int ch = 0; ch < 4; ++ch) voices_.note_off(ch);
     for (auto& fs : fx_state_) fs.reset();
     noise_val_ = 0;
     fade_speed_ = 0;
@@ -53,13 +54,32 @@ void TrackerPlaybackEngine::start(int from_row) {
 
 void TrackerPlaybackEngine::stop() {
     playing_ = false;
-    for (auto& v : voices_) v.note_off();
+    for (int ch = 0; ch < 4; ++ch) voices_.note_off(ch);
     for (auto& fs : fx_state_) fs.reset();
     fade_speed_ = 0;
     fade_counter_ = 0;
     fade_attn_ = 0;
 }
 
+void TrackerPlaybackEngine::copy_state_from(const TrackerPlaybackEngine& other) {
+    if (&other == this) return;
+    doc_ = other.doc_;
+    playing_ = other.playing_;
+    current_row_ = other.current_row_;
+    tick_counter_ = other.tick_counter_;
+    ticks_per_row_ = other.ticks_per_row_;
+    loop_start_ = other.loop_start_;
+    loop_end_ = other.loop_end_;
+    voices_ = other.voices_;
+    fx_tables_ = other.fx_tables_;
+    fx_state_ = other.fx_state_;
+    noise_val_ = other.noise_val_;
+    for (int ch = 0; ch < 4; ++ch) channel_muted_[ch] = other.channel_muted_[ch];
+    fade_speed_ = other.fade_speed_;
+    fade_counter_ = other.fade_counter_;
+    fade_attn_ = other.fade_attn_;
+}
+
 void TrackerPlaybackEngine::set_ticks_per_row(int tpr) {
     ticks_per_row_ = std::clamp(tpr, 1, 32);
 }
@@ -82,8 +102,8 @@ bool TrackerPlaybackEngine::tick() {
     if (!playing_ || !doc_) return false;
 
     // Advance voices and effects
+    voices_.tick();
     for (int ch = 0; ch < 4; ++ch) {
-        voices_[ch].tick();
         tick_fx(ch);
     }
 
@@ -132,16 +152,15 @@ TrackerPlaybackEngine::ChannelOutput TrackerPlaybackEngine::channel_output(int c
     ChannelOutput out;
     if (ch < 0 || ch >= 4) return out;
 
-    const auto& v = voices_[static_cast<size_t>(ch)];
     const auto& fs = fx_state_[static_cast<size_t>(ch)];
 
-    out.active = v.active();
+    out.active = voices_.active(ch);
 
     if (!out.active) return out;
 
     // Base values from voice
-    uint16_t divider = v.final_divider();
-    uint8_t attn = v.final_attn();
+    uint16_t divider = voices_.output_divider(ch);
+    uint8_t attn = voices_.output_attn(ch);
 
     // Apply effect overrides
     if (fs.fx == 0x0 && fs.param != 0) {
@@ -189,6 +208,34 @@ TrackerPlaybackEngine::ChannelOutput TrackerPlaybackEngine::channel_output(int c
     return out;
 }
 
+// ============================================================
+// Voice note-on
+// ============================================================
+
+void TrackerPlaybackEngine::bind_fx_tables() {
+    // Only rebind between runs: the bank resets its voices on a new table.
+    std::shared_ptr<const ngpc::BgmFxTables> tables = store_ ? store_->fx_tables() : nullptr;
+    if (tables != fx_tables_) {
+        fx_tables_ = std::move(tables);
+        voices_.set_tables(fx_tables_.get());
+    }
+}
+
+void TrackerPlaybackEngine::voice_note_on(int ch, const TrackerCell& cell) {
+    ngpc::BgmInstrumentDef def;
+    if (store_ && cell.instrument < store_->count()) {
+        def = store_->at(cell.instrument).def;
+    }
+    voices_.apply_instrument(ch, def, ch == 3);
+    if (cell.attn != 0xFF) {
+        voices_.set_attn(ch, cell.attn);
+    }
+    voices_.note_on(ch, midi_to_divider(cell.note));
+    if (ch == 3) {
+        noise_val_ = midi_note_to_noise_val(cell.note);
+    }
+}
+
 // ============================================================
 // Mute
 // ============================================================
@@ -209,31 +256,8 @@ bool TrackerPlaybackEngine::is_channel_muted(int ch) const {
 void TrackerPlaybackEngine::process_row(int row) {
     if (!doc_) return;
 
-    const auto env_curves = ngpc::FactoryEnvCurves();
-    const auto pitch_curves = ngpc::FactoryPitchCurves();
     auto trigger_note_on = [&](int ch, const TrackerCell& cell) {
-        int inst_idx = cell.instrument;
-        ngpc::BgmInstrumentDef def;
-        if (store_ && inst_idx < store_->count()) {
-            def = store_->at(inst_idx).def;
-        }
-
-        if (ch == 3) def.mode = 1;
-
-        std::vector<int8_t> ec;
-        if (def.env_curve_id < static_cast<uint8_t>(env_curves.size())) {
-            ec = env_curves[def.env_curve_id].steps;
-        }
-        std::vector<int16_t> pc;
-        if (def.pitch_curve_id < static_cast<uint8_t>(pitch_curves.size())) {
-            pc = pitch_curves[def.pitch_curve_id].steps;
-        }
-
-        const uint16_t divider = midi_to_divider(cell.note);
-        voices_[ch].note_on(def, ec, pc, divider, cell.attn);
-        if (ch == 3) {
-            noise_val_ = midi_note_to_noise_val(cell.note);
-        }
+        voice_note_on(ch, cell);
     };
 
     for (int ch = 0; ch < 4; ++ch) {
@@ -297,12 +321,12 @@ void TrackerPlaybackEngine::process_row(int row) {
             if (c.is_note_on()) {
                 // XM-style fallback: if no previous note is active, start the note first
                 // so 3xx does not produce silence.
-                if (!voices_[ch].active()) {
+                if (!voices_.active(ch)) {
                     trigger_note_on(ch, c);
                 }
                 init_fx(ch, c);
             } else if (c.is_note_off()) {
-                voices_[ch].note_off();
+                voices_.note_off(ch);
                 fx_state_[ch].reset();
             } else {
                 init_fx(ch, c);
@@ -312,7 +336,7 @@ void TrackerPlaybackEngine::process_row(int row) {
 
         // Normal note processing
         if (c.is_note_off()) {
-            voices_[ch].note_off();
+            voices_.note_off(ch);
             fx_state_[ch].reset();
         } else if (c.is_note_on()) {
             trigger_note_on(ch, c);
@@ -349,7 +373,7 @@ void TrackerPlaybackEngine::init_fx(int ch, const TrackerCell& cell) {
     switch (cell.fx) {
     case 0x0: {
         if (hi == 0 && lo == 0) break;
-        uint16_t base_div = voices_[ch].active() ? voices_[ch].final_divider() : 0;
+        uint16_t base_div = voices_.active(ch) ? voices_.output_divider(ch) : 0;
         fs.arp_dividers[0] = base_div;
         if (cell.is_note_on()) {
             uint8_t base_note = cell.note;
@@ -358,7 +382,7 @@ void TrackerPlaybackEngine::init_fx(int ch, const TrackerCell& cell) {
                 static_cast<uint8_t>(std::clamp(static_cast<int>(base_note) + hi, 1, 127)));
             fs.arp_dividers[2] = midi_to_divider(
                 static_cast<uint8_t>(std::clamp(static_cast<int>(base_note) + lo, 1, 127)));
-        } else if (voices_[ch].active()) {
+        } else if (voices_.active(ch)) {
             fs.arp_dividers[0] = base_div;
             fs.arp_dividers[1] = transpose_divider_by_semitones(base_div, hi);
             fs.arp_dividers[2] = transpose_divider_by_semitones(base_div, lo);
@@ -376,8 +400,8 @@ void TrackerPlaybackEngine::init_fx(int ch, const TrackerCell& cell) {
         fs.porta_speed = (cell.fx_param != 0) ? cell.fx_param : saved_porta_speed;
         if (cell.is_note_on()) {
             fs.porta_target = midi_to_divider(cell.note);
-            if (voices_[ch].active()) {
-                fs.porta_current = voices_[ch].final_divider();
+            if (voices_.active(ch)) {
+                fs.porta_current = voices_.output_divider(ch);
                 fs.porta_active = (fs.porta_current != fs.porta_target);
             } else {
                 fs.porta_current = fs.porta_target;
@@ -396,7 +420,7 @@ void TrackerPlaybackEngine::init_fx(int ch, const TrackerCell& cell) {
             fs.vol_delta = -static_cast<int8_t>(hi);
         else
             fs.vol_delta = static_cast<int8_t>(lo);
-        fs.vol_current = voices_[ch].active() ? voices_[ch].final_attn() : 0;
+        fs.vol_current = voices_.active(ch) ? voices_.output_attn(ch) : 0;
         fs.vol_override = true;
         break;
     case 0xB:
@@ -404,7 +428,7 @@ void TrackerPlaybackEngine::init_fx(int ch, const TrackerCell& cell) {
     case 0xC:
         if (cell.fx_param == 0) {
             // C00: immediate cut at row start.
-            voices_[ch].note_off();
+            voices_.note_off(ch);
             fs.fx = 0;
             fs.param = 0;
             fs.cut_countdown = -1;
@@ -472,7 +496,7 @@ void TrackerPlaybackEngine::tick_fx(int ch) {
         if (fs.cut_countdown > 0) {
             fs.cut_countdown--;
             if (fs.cut_countdown == 0) {
-                voices_[ch].note_off();
+                voices_.note_off(ch);
             }
         }
         break;
@@ -483,27 +507,7 @@ void TrackerPlaybackEngine::tick_fx(int ch) {
                 fs.note_delayed = false;
                 const auto& dc = fs.delayed_cell;
                 if (dc.is_note_on()) {
-                    int inst_idx = dc.instrument;
-                    ngpc::BgmInstrumentDef def;
-                    if (store_ && inst_idx < store_->count()) {
-                        def = store_->at(inst_idx).def;
-                    }
-                    if (ch == 3) def.mode = 1;
-
-                    const auto env_curves = ngpc::FactoryEnvCurves();
-                    const auto pitch_curves = ngpc::FactoryPitchCurves();
-                    std::vector<int8_t> ec;
-                    if (def.env_curve_id < static_cast<uint8_t>(env_curves.size()))
-                        ec = env_curves[def.env_curve_id].steps;
-                    std::vector<int16_t> pc;
-                    if (def.pitch_curve_id < static_cast<uint8_t>(pitch_curves.size()))
-                        pc = pitch_curves[def.pitch_curve_id].steps;
-
-                    uint16_t divider = midi_to_divider(dc.note);
-                    voices_[ch].note_on(def, ec, pc, divider, dc.attn);
-                    if (ch == 3) {
-                        noise_val_ = midi_note_to_noise_val(dc.note);
-                    }
+                    voice_note_on(ch, dc);
                 }
             }
         }
@@ -5,8 +5,10 @@
 
 #include <array>
 #include <cstdint>
+#include <memory>
 
 #include "models/TrackerDocument.h"
+#include "ngpc/bgm_voice.h"
 
 class InstrumentStore;
 
@@ -88,12 +90,17 @@ public:
     // Channel output (computed after each tick)
     ChannelOutput channel_output(int ch) const;
 
+    // Takes over `other`'s playback state (document, row, voices, effects,
+    // fade), so tick() carries on where `other` is. The instrument store is
+    // kept. Offline renders use it to resume from a checkpoint.
+    void copy_state_from(const TrackerPlaybackEngine& other);
+
     // Mute
     void set_channel_muted(int ch, bool muted);
     bool is_channel_muted(int ch) const;
 
     // Direct access for advanced use
-    TrackerVoice& voice(int ch) { return voices_[static_cast<size_t>(ch)]; }
+    const ngpc::BgmVoiceBank& voices() const { return voices_; }
     const ChannelFxState& fx_state(int ch) const { return fx_state_[static_cast<size_t>(ch)]; }
 
     // Noise helpers
@@ -123,7 +130,8 @@ private:
     int loop_start_ = -1;
     int loop_end_ = -1;
 
-    std::array<TrackerVoice, 4> voices_;
+    ngpc::BgmVoiceBank voices_;
+    std::shared_ptr<const ngpc::BgmFxTables> fx_tables_; // keeps voices_' tables alive
     std::array<ChannelFxState, 4> fx_state_;
     uint8_t noise_val_ = 0; // CH3 noise register bits (0-7)
     bool channel_muted_[4] = {};
@@ -133,7 +141,9 @@ private:
     uint8_t fade_counter_ = 0;
     uint8_t fade_attn_ = 0;    // additional global attn (0-15)
 
+    void bind_fx_tables();
     void process_row(int row);
+    void voice_note_on(int ch, const TrackerCell& cell);
     void init_fx(int ch, const TrackerCell& cell);
     void tick_fx(int ch);
 };
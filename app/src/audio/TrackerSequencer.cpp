@@ -0,0 +1,230 @@
+#include "audio/TrackerSequencer.h"
+
+#include <QObject>
+
+#include "audio/PsgHelpers.h"
+#include "audio/TrackerPlaybackEngine.h"
+#include "models/SongDocument.h"
+#include "models/TrackerDocument.h"
+#include "ngpc/sound_engine.h"
+
+// ============================================================
+// Construction
+// ============================================================
+
+TrackerSequencer::TrackerSequencer(TrackerPlaybackEngine* engine)
+    : engine_(engine)
+{
+    for (auto& m : muted_) m.store(false, std::memory_order_relaxed);
+    if (!engine_) return;
+
+    // Both signals are emitted synchronously from inside tick(), i.e. from
+    // inside on_frame(); they only raise flags that on_frame() consumes.
+    wrap_conn_ = QObject::connect(engine_, &TrackerPlaybackEngine::pattern_finished,
+                                  [this]() { wrapped_ = true; });
+    speed_conn_ = QObject::connect(engine_, &TrackerPlaybackEngine::speed_changed,
+                                   [this](int) { speed_changed_ = true; });
+}
+
+TrackerSequencer::~TrackerSequencer() {
+    QObject::disconnect(wrap_conn_);
+    QObject::disconnect(speed_conn_);
+}
+
+void TrackerSequencer::set_song(SongDocument* song) {
+    song_ = song;
+}
+
+void TrackerSequencer::set_sound_engine(ngpc::SoundEngine* snd) {
+    snd_ = snd;
+}
+
+void TrackerSequencer::set_channel_muted(int ch, bool muted) {
+    if (ch >= 0 && ch < 4) {
+        muted_[static_cast<size_t>(ch)].store(muted, std::memory_order_relaxed);
+    }
+}
+
+bool TrackerSequencer::poll_event_until(uint64_t audible_pos, RowEvent* out) {
+    RowEvent ev;
+    if (!events_.peek(&ev) || ev.sample_pos > audible_pos) {
+        return false;
+    }
+    return events_.pop(out);
+}
+
+// ============================================================
+// Transport
+// ============================================================
+
+void TrackerSequencer::start_pattern(TrackerDocument* doc, int from_row, int max_passes) {
+    if (!engine_ || !doc) return;
+    mode_ = Mode::Pattern;
+    order_pos_ = -1;
+    max_passes_ = max_passes;
+    passes_ = 0;
+    finish_sample_ = 0;
+    engine_->set_document(doc);
+    engine_->start(from_row);
+    first_frame_ = true;
+    finished_.store(false, std::memory_order_release);
+    running_.store(true, std::memory_order_release);
+}
+
+void TrackerSequencer::start_song(int order_pos, int max_passes) {
+    if (!engine_ || !song_ || song_->order_length() == 0) return;
+    const auto& ord = song_->order();
+    if (order_pos < 0 || order_pos >= static_cast<int>(ord.size())) order_pos = 0;
+    TrackerDocument* doc = song_->pattern(ord[static_cast<size_t>(order_pos)]);
+    if (!doc) return;
+
+    mode_ = Mode::Song;
+    order_pos_ = order_pos;
+    max_passes_ = max_passes;
+    passes_ = 0;
+    finish_sample_ = 0;
+    engine_->set_document(doc);
+    engine_->start(0);
+    first_frame_ = true;
+    finished_.store(false, std::memory_order_release);
+    running_.store(true, std::memory_order_release);
+}
+
+void TrackerSequencer::copy_state_from(const TrackerSequencer& other) {
+    if (&other == this) return;
+    mode_ = other.mode_;
+    order_pos_ = other.order_pos_;
+    max_passes_ = other.max_passes_;
+    passes_ = other.passes_;
+    first_frame_ = other.first_frame_;
+    wrapped_ = other.wrapped_;
+    speed_changed_ = other.speed_changed_;
+    finish_sample_ = other.finish_sample_;
+    finished_.store(other.finished_.load(std::memory_order_acquire), std::memory_order_release);
+    running_.store(other.running_.load(std::memory_order_acquire), std::memory_order_release);
+    for (size_t ch = 0; ch < muted_.size(); ++ch) {
+        muted_[ch].store(other.muted_[ch].load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+}
+
+void TrackerSequencer::stop() {
+    running_.store(false, std::memory_order_release);
+    if (engine_) engine_->stop();
+}
+
+// ============================================================
+// Frame
+// ============================================================
+
+void TrackerSequencer::on_frame(uint64_t sample_pos) {
+    if (!running_.load(std::memory_order_acquire) || !engine_) return;
+
+    auto finish = [&]() {
+        engine_->stop();
+        silence();
+        finish_sample_ = sample_pos;
+        running_.store(false, std::memory_order_release);
+        finished_.store(true, std::memory_order_release);
+        post(sample_pos, kEventFinished);
+    };
+
+    if (first_frame_) {
+        first_frame_ = false;
+        post(sample_pos, kEventPatternSwitched);
+    }
+
+    wrapped_ = false;
+    speed_changed_ = false;
+    const bool new_row = engine_->tick();
+
+    // E0x fade reached full attenuation: the driver stops the song outright.
+    if (!engine_->is_playing()) {
+        finish();
+        return;
+    }
+
+    uint8_t flags = speed_changed_ ? kEventSpeedChanged : 0;
+    if (wrapped_) {
+        if (mode_ == Mode::Song) {
+            if (!advance_order()) {
+                finish();
+                return;
+            }
+            flags |= kEventPatternSwitched;
+        } else {
+            ++passes_;
+            if (max_passes_ > 0 && passes_ >= max_passes_) {
+                finish();
+                return;
+            }
+        }
+    }
+
+    write_outputs();
+    if (new_row || wrapped_) {
+        post(sample_pos, flags);
+    }
+}
+
+bool TrackerSequencer::advance_order() {
+    if (!song_ || song_->order_length() == 0) return false;
+    const auto& ord = song_->order();
+    ++order_pos_;
+    if (order_pos_ >= static_cast<int>(ord.size())) {
+        ++passes_;
+        if (max_passes_ > 0 && passes_ >= max_passes_) return false;
+        order_pos_ = song_->loop_point();
+        if (order_pos_ < 0 || order_pos_ >= static_cast<int>(ord.size())) order_pos_ = 0;
+    }
+    TrackerDocument* doc = song_->pattern(ord[static_cast<size_t>(order_pos_)]);
+    if (!doc) return false;
+    engine_->set_document(doc);
+    engine_->start(0);
+    return true;
+}
+
+void TrackerSequencer::write_outputs() {
+    if (!snd_) return;
+    for (int ch = 0; ch < 4; ++ch) {
+        const bool muted = muted_[static_cast<size_t>(ch)].load(std::memory_order_relaxed);
+        const auto out = engine_->channel_output(ch);
+        if (muted || !out.active) {
+            if (ch < 3) {
+                psg_helpers::DirectSilenceTone(*snd_, ch);
+            } else {
+                psg_helpers::DirectSilenceNoise(*snd_);
+            }
+            continue;
+        }
+        if (ch < 3) {
+            psg_helpers::DirectToneCh(*snd_, ch, out.divider, out.attn);
+        } else {
+            const auto nc = TrackerPlaybackEngine::decode_noise_val(out.noise_val);
+            psg_helpers::DirectNoise(*snd_, nc.rate, nc.type, out.attn);
+        }
+    }
+}
+
+void TrackerSequencer::silence() {
+    if (!snd_) return;
+    for (int ch = 0; ch < 3; ++ch) {
+        psg_helpers::DirectSilenceTone(*snd_, ch);
+    }
+    psg_helpers::DirectSilenceNoise(*snd_);
+}
+
+void TrackerSequencer::post(uint64_t sample_pos, uint8_t flags) {
+    RowEvent ev;
+    ev.sample_pos = sample_pos;
+    ev.row = static_cast<int16_t>(engine_->current_row());
+    ev.ticks_per_row = static_cast<int16_t>(engine_->ticks_per_row());
+    ev.flags = flags;
+    if (mode_ == Mode::Song && song_ && order_pos_ >= 0 && order_pos_ < song_->order_length()) {
+        ev.order_pos = static_cast<int16_t>(order_pos_);
+        ev.pattern = static_cast<int16_t>(song_->order()[static_cast<size_t>(order_pos_)]);
+    }
+    // A full ring drops the event. The next row re-syncs the UI for a row or
+    // a switch; no row follows kEventFinished, so the UI also checks the
+    // latched finished() / finish_sample().
+    events_.push(ev);
+}
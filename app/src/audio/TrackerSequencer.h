@@ -0,0 +1,121 @@
+#pragma once
+
+#include <QMetaObject>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#include "ngpc/spsc_ring.h"
+
+class SongDocument;
+class TrackerDocument;
+class TrackerPlaybackEngine;
+
+namespace ngpc {
+class SoundEngine;
+}
+
+// ============================================================
+// TrackerSequencer
+// Drives TrackerPlaybackEngine from the audio clock: on_frame() is
+// installed as the SoundEngine frame callback, so every tick lands
+// on an exact 1/60 s boundary of RENDERED samples. Owns the song
+// order walk (pattern -> next order entry -> loop point) and the
+// PSG writes, so live playback and WavExporter share one timeline.
+// Row changes go back to the UI through a lock-free ring.
+// ============================================================
+
+class TrackerSequencer
+{
+public:
+    enum class Mode { Pattern, Song };
+
+    // Posted once per row actually started, stamped with the sample the
+    // row's first frame begins at.
+    struct RowEvent {
+        uint64_t sample_pos = 0;
+        int16_t row = 0;
+        int16_t order_pos = -1;   // -1 in pattern mode
+        int16_t pattern = -1;     // pattern index in song mode, -1 otherwise
+        int16_t ticks_per_row = 0;
+        uint8_t flags = 0;
+    };
+    static constexpr uint8_t kEventSpeedChanged = 0x01;
+    static constexpr uint8_t kEventPatternSwitched = 0x02;
+    static constexpr uint8_t kEventFinished = 0x04;
+
+    explicit TrackerSequencer(TrackerPlaybackEngine* engine);
+    ~TrackerSequencer();
+
+    TrackerSequencer(const TrackerSequencer&) = delete;
+    TrackerSequencer& operator=(const TrackerSequencer&) = delete;
+
+    void set_song(SongDocument* song);
+    void set_sound_engine(ngpc::SoundEngine* snd);
+
+    // Arm the sequencer. Nothing is ticked until the first on_frame().
+    // max_passes: how many times the pattern/order plays before finishing
+    // (0 = forever, the live default).
+    void start_pattern(TrackerDocument* doc, int from_row, int max_passes = 0);
+    void start_song(int order_pos = 0, int max_passes = 0);
+    void stop();
+
+    // Frame callback body: one engine tick, order bookkeeping, PSG write.
+    void on_frame(uint64_t sample_pos);
+
+    bool running() const { return running_.load(std::memory_order_acquire); }
+    // Latched when playback ends, so the UI sees the end even if the ring
+    // had no room for kEventFinished.
+    bool finished() const { return finished_.load(std::memory_order_acquire); }
+    // Sample position of the frame boundary where playback ended; valid once
+    // finished() is true.
+    uint64_t finish_sample() const { return finish_sample_; }
+
+    Mode mode() const { return mode_; }
+    int order_pos() const { return order_pos_; }
+    // Times the order list (song) or pattern has wrapped.
+    int passes() const { return passes_; }
+
+    // Takes over `other`'s transport state (order position, passes, finish).
+    // The engine, song and sound engine set here are kept; copy the engine's
+    // own state separately. Offline renders use it to resume from a checkpoint.
+    void copy_state_from(const TrackerSequencer& other);
+
+    // Safe to call from the UI thread while the render loop runs.
+    void set_channel_muted(int ch, bool muted);
+
+    // UI side of the ring.
+    bool poll_event(RowEvent* out) { return events_.pop(out); }
+    // Pops the oldest event only once its sample has reached `audible_pos`,
+    // so the UI shows the row being heard rather than the row being rendered.
+    bool poll_event_until(uint64_t audible_pos, RowEvent* out);
+    bool peek_event(RowEvent* out) const { return events_.peek(out); }
+    void clear_events() { events_.clear(); }
+
+private:
+    bool advance_order();
+    void write_outputs();
+    void silence();
+    void post(uint64_t sample_pos, uint8_t flags);
+
+    TrackerPlaybackEngine* engine_ = nullptr;
+    SongDocument* song_ = nullptr;
+    ngpc::SoundEngine* snd_ = nullptr;
+    QMetaObject::Connection wrap_conn_;
+    QMetaObject::Connection speed_conn_;
+
+    Mode mode_ = Mode::Pattern;
+    int order_pos_ = 0;
+    int max_passes_ = 0;
+    int passes_ = 0;
+    bool first_frame_ = false;
+    bool wrapped_ = false;
+    bool speed_changed_ = false;
+    std::atomic<bool> running_{false};
+    std::atomic<bool> finished_{false};
+    uint64_t finish_sample_ = 0;
+    std::array<std::atomic<bool>, 4> muted_{};
+
+    ngpc::SpscRing<RowEvent, 256> events_;
+};
@@ -2,136 +2,251 @@
 
 #include <QFile>
 
+#include <algorithm>
 #include <cstring>
+#include <memory>
 
-#include "audio/PsgHelpers.h"
 #include "audio/TrackerPlaybackEngine.h"
+#include "audio/TrackerSequencer.h"
 #include "models/InstrumentStore.h"
 #include "models/SongDocument.h"
 #include "models/TrackerDocument.h"
+#include "ngpc/flac.h"
+#include "ngpc/parallel.h"
 #include "ngpc/sound_engine.h"
+#include "ngpc/vgm.h"
 
 // ============================================================
 // Offline render
 // ============================================================
 
-std::vector<int16_t> WavExporter::render_to_pcm(SongDocument* song,
-                                                  InstrumentStore* store,
-                                                  const Settings& settings)
-{
-    if (!song || song->pattern_count() == 0) return {};
+namespace {
 
-    // Create dedicated engine and playback
-    ngpc::SoundEngine snd;
-    snd.init(settings.sample_rate);
+constexpr int kBlockSamples = 4096;
+constexpr int kHeaderBytes = 80;
+constexpr uint64_t kMaxRiffSize = 0xFFFFFFFFull;
+// Checkpoints kept by the fast pass, at least this many and 8 per worker.
+// Each holds a whole engine (PSG ring, Z80), about 100 KB.
+constexpr size_t kMinCheckpoints = 64;
 
-    TrackerPlaybackEngine playback;
-    playback.set_instrument_store(store);
-    playback.set_ticks_per_row(settings.ticks_per_row);
+void PutLe(uint8_t* p, uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; ++i) {
+        p[i] = static_cast<uint8_t>((v >> (8 * i)) & 0xFF);
+    }
+}
 
-    // Samples per tick at 60fps
-    const int samples_per_tick = settings.sample_rate / 60;
+// Engine, playback and sequencer wired like live playback. The frame
+// callback is left to the caller.
+struct RenderSession {
+    ngpc::SoundEngine snd;
+    TrackerPlaybackEngine playback;
+    TrackerSequencer seq{&playback};
+
+    RenderSession(SongDocument* song, InstrumentStore* store, const WavExporter::Settings& settings) {
+        snd.init(settings.sample_rate);
+        playback.set_instrument_store(store);
+        playback.set_ticks_per_row(settings.ticks_per_row);
+        seq.set_song(song);
+        seq.set_sound_engine(&snd);
+    }
 
-    std::vector<int16_t> pcm;
-    // Reserve a rough estimate (avoid too many reallocs)
-    pcm.reserve(static_cast<size_t>(settings.sample_rate * 60)); // ~60 sec
-
-    std::vector<int16_t> tick_buf(static_cast<size_t>(samples_per_tick));
-
-    auto write_outputs_to_psg = [&](TrackerPlaybackEngine& eng, ngpc::SoundEngine& snd_engine) {
-        for (int ch = 0; ch < 4; ++ch) {
-            auto out = eng.channel_output(ch);
-            if (!out.active) {
-                if (ch < 3) {
-                    psg_helpers::DirectSilenceTone(snd_engine, ch);
-                } else {
-                    psg_helpers::DirectSilenceNoise(snd_engine);
-                }
-            } else {
-                if (ch < 3) {
-                    psg_helpers::DirectToneCh(snd_engine, ch, out.divider, out.attn);
-                } else {
-                    auto nc = TrackerPlaybackEngine::decode_noise_val(out.noise_val);
-                    psg_helpers::DirectNoise(snd_engine, nc.rate, nc.type, out.attn);
-                }
-            }
-        }
+    // Install the frame callback first: it resets the frame clock.
+    void copy_state_from(const RenderSession& other) {
+        playback.copy_state_from(other.playback);
+        seq.copy_state_from(other.seq);
+        snd.copy_state_from(other.snd);
+    }
+};
+
+// Samples [begin, end) rendered from the state a checkpoint was taken in.
+struct Segment {
+    const RenderSession* state = nullptr;
+    uint64_t begin = 0;
+    uint64_t end = 0;
+    int step = 0;   // order entries played before it
+};
+
+}  // namespace
+
+bool WavExporter::render(SongDocument* song,
+                         InstrumentStore* store,
+                         const Settings& settings,
+                         const BlockSink& sink,
+                         const Progress& progress,
+                         const std::atomic<bool>* cancel,
+                         QString* error,
+                         ngpc::PsgLog* recorder)
+{
+    if (!song || song->pattern_count() == 0) {
+        if (error) *error = "No audio data generated.";
+        return false;
+    }
+    auto cancelled = [cancel, error]() {
+        if (!cancel || !cancel->load(std::memory_order_relaxed)) return false;
+        if (error) *error = "Cancelled.";
+        return true;
     };
 
-    if (settings.song_mode && song->order_length() > 0) {
-        // Song mode: iterate through order list
-        const auto& order = song->order();
-        int loop_count = 0;
-        int order_pos = 0;
-
-        while (loop_count < settings.max_loops) {
-            int pat_idx = order[static_cast<size_t>(order_pos)];
-            TrackerDocument* pat = song->pattern(pat_idx);
-            if (!pat) break;
-
-            playback.set_document(pat);
-            playback.start(0);
-
-            // Play through entire pattern.
-            // Use had_ticks flag like build_export_streams to handle
-            // edge case of 1-row patterns at tpr=1 correctly.
-            bool pattern_done = false;
-            bool had_ticks = false;
-            while (!pattern_done) {
-                playback.tick();
-                had_ticks = true;
-                write_outputs_to_psg(playback, snd);
-                snd.render(tick_buf.data(), samples_per_tick);
-                pcm.insert(pcm.end(), tick_buf.begin(), tick_buf.end());
-
-                if (playback.current_row() == 0 && playback.tick_counter() == 0
-                    && had_ticks) {
-                    pattern_done = true;
-                }
-            }
-
-            playback.stop();
-
-            // Advance to next order entry
-            order_pos++;
-            if (order_pos >= static_cast<int>(order.size())) {
-                loop_count++;
-                if (loop_count < settings.max_loops) {
-                    order_pos = song->loop_point();
-                }
-            }
-        }
+    // Same sequencer and frame clock as live playback: ticks land on the
+    // 1/60 s sample boundaries of the rendered stream, so WAV and speakers
+    // share one timeline.
+    RenderSession first(song, store, settings);
+    if (recorder) first.snd.psg().set_recorder(recorder);
+    const int passes = std::max(1, settings.max_loops);
+    const bool song_mode = settings.song_mode && song->order_length() > 0;
+    if (song_mode) {
+        first.seq.start_song(0, passes);
     } else {
-        // Single pattern mode: play active pattern once
         TrackerDocument* pat = song->active_pattern();
-        if (!pat) return {};
+        if (pat) first.seq.start_pattern(pat, 0, 1);
+    }
+    if (!first.seq.running()) {
+        if (error) *error = "No audio data generated.";
+        return false;
+    }
 
-        playback.set_document(pat);
-        playback.start(0);
+    const uint64_t tail_samples = static_cast<uint64_t>(settings.sample_rate / 10);
+    const unsigned workers = ngpc::DefaultWorkerCount();
+    if (!song_mode || workers < 2 || recorder) {
+        // Nothing to split (or one chip's writes to log): render straight
+        // through. Progress counts order entries as they start.
+        int total_steps = 1;
+        if (song_mode) {
+            const int length = song->order_length();
+            const int loop = (song->loop_point() >= 0 && song->loop_point() < length) ? song->loop_point() : 0;
+            total_steps = length + (passes - 1) * (length - loop);
+        }
+        int steps = 0;
+        int last_order = first.seq.order_pos();
+        if (progress) progress(0, total_steps);
+        // Render in fixed blocks until the sequencer reports the end. It
+        // silences the PSG at the exact frame boundary where playback ended, so
+        // everything after finish_sample() is already the silent tail (100ms,
+        // avoids a click).
+        first.snd.set_frame_callback([&first](uint64_t sample_pos) { first.seq.on_frame(sample_pos); });
+        std::vector<int16_t> block(static_cast<size_t>(kBlockSamples));
+        uint64_t written = 0;
+        while (!first.seq.finished() || written < first.seq.finish_sample() + tail_samples) {
+            if (cancelled()) return false;
+            first.snd.render(block.data(), kBlockSamples);
+            int count = kBlockSamples;
+            if (first.seq.finished()) {
+                count = static_cast<int>(std::min<uint64_t>(kBlockSamples, first.seq.finish_sample() + tail_samples - written));
+            }
+            if (!sink(block.data(), count)) return false;
+            written += static_cast<uint64_t>(count);
+            if (progress && song_mode && first.seq.order_pos() != last_order) {
+                last_order = first.seq.order_pos();
+                steps = std::min(steps + 1, total_steps - 1);
+                progress(steps, total_steps);
+            }
+        }
+        first.snd.set_frame_callback({});
+        if (recorder) first.snd.psg().set_recorder(nullptr);
+        if (progress) progress(total_steps, total_steps);
+        return true;
+    }
 
-        int total_ticks = pat->length() * settings.ticks_per_row;
-        for (int t = 0; t < total_ticks; ++t) {
-            playback.tick();
-            write_outputs_to_psg(playback, snd);
-            snd.render(tick_buf.data(), samples_per_tick);
-            pcm.insert(pcm.end(), tick_buf.begin(), tick_buf.end());
+    // Pass 1, no mixing (SoundEngine::skip): run the song to its end and copy
+    // the whole render state at order boundaries, before the frame that plays
+    // the new entry. Past the checkpoint budget every other one is dropped and
+    // only every `stride`-th boundary is kept from then on.
+    const size_t max_checkpoints = std::max<size_t>(kMinCheckpoints, size_t(workers) * 8);
+    std::vector<std::unique_ptr<RenderSession>> checkpoints;
+    std::vector<Segment> segments;
+    auto capture = [&](uint64_t sample_pos, int step) {
+        checkpoints.push_back(std::make_unique<RenderSession>(song, store, settings));
+        checkpoints.back()->copy_state_from(first);
+        segments.push_back({checkpoints.back().get(), sample_pos, 0, step});
+    };
+    int step = 0;
+    int stride = 1;
+    int last_order = first.seq.order_pos();
+    int last_pass = first.seq.passes();
+    first.snd.set_frame_callback([&](uint64_t sample_pos) {
+        if (song_mode && !first.seq.finished() &&
+            (first.seq.order_pos() != last_order || first.seq.passes() != last_pass)) {
+            last_order = first.seq.order_pos();
+            last_pass = first.seq.passes();
+            ++step;
+            if (step % stride == 0) capture(sample_pos, step);
+            if (checkpoints.size() > max_checkpoints) {
+                size_t kept = 0;
+                for (size_t i = 0; i < checkpoints.size(); ++i) {
+                    if (segments[i].step % (stride * 2) != 0) continue;
+                    checkpoints[kept] = std::move(checkpoints[i]);
+                    segments[kept] = segments[i];
+                    ++kept;
+                }
+                checkpoints.resize(kept);
+                segments.resize(kept);
+                stride *= 2;
+            }
         }
+        first.seq.on_frame(sample_pos);
+    });
+    capture(0, 0);
 
-        playback.stop();
+    while (!first.seq.finished() || first.snd.samples_rendered() < first.seq.finish_sample() + tail_samples) {
+        if (cancelled()) return false;
+        first.snd.skip(kBlockSamples);
     }
-
-    // Silence tail (short fade to avoid click)
-    // Silence the PSG and render a short tail
-    for (int ch = 0; ch < 3; ++ch) {
-        psg_helpers::DirectSilenceTone(snd, ch);
+    first.snd.set_frame_callback({});
+    const uint64_t end = first.seq.finish_sample() + tail_samples;
+    const int total_steps = step + 1;
+    for (size_t i = 0; i < segments.size(); ++i) {
+        segments[i].end = (i + 1 < segments.size()) ? segments[i + 1].begin : end;
     }
-    psg_helpers::DirectSilenceNoise(snd);
-
-    int tail_samples = settings.sample_rate / 10; // 100ms silence
-    std::vector<int16_t> tail(static_cast<size_t>(tail_samples), 0);
-    snd.render(tail.data(), tail_samples);
-    pcm.insert(pcm.end(), tail.begin(), tail.end());
+    if (progress) progress(0, total_steps);
+
+    // Pass 2: render the segments on all cores, a batch at a time so memory
+    // stays bounded, and hand them to the sink in order. Blocks stay on the
+    // grid of a serial render from sample 0: where render() calls are cut
+    // decides which samples the chip has already queued when a frame's writes
+    // land, so this is what makes the stitched result bit-exact.
+    std::vector<std::vector<int16_t>> pcm(workers);
+    for (size_t first_seg = 0; first_seg < segments.size(); first_seg += workers) {
+        const size_t count = std::min<size_t>(workers, segments.size() - first_seg);
+        ngpc::ParallelFor(count, workers, [&](size_t i) {
+            const Segment& seg = segments[first_seg + i];
+            std::vector<int16_t>& out = pcm[i];
+            out.resize(static_cast<size_t>(seg.end - seg.begin));
+            RenderSession session(song, store, settings);
+            session.snd.set_frame_callback([&session](uint64_t sample_pos) { session.seq.on_frame(sample_pos); });
+            session.copy_state_from(*seg.state);
+            for (uint64_t pos = seg.begin; pos < seg.end;) {
+                if (cancel && cancel->load(std::memory_order_relaxed)) return;
+                const uint64_t block_end = std::min<uint64_t>((pos / kBlockSamples + 1) * kBlockSamples, seg.end);
+                session.snd.render(out.data() + (pos - seg.begin), static_cast<int>(block_end - pos));
+                pos = block_end;
+            }
+            session.snd.set_frame_callback({});
+        }, cancel);
+        if (cancelled()) return false;
+
+        for (size_t i = 0; i < count; ++i) {
+            const std::vector<int16_t>& out = pcm[i];
+            for (size_t pos = 0; pos < out.size(); pos += kBlockSamples) {
+                const int n = static_cast<int>(std::min<size_t>(kBlockSamples, out.size() - pos));
+                if (!sink(out.data() + pos, n)) return false;
+            }
+            const size_t next = first_seg + i + 1;
+            if (progress) progress(next < segments.size() ? segments[next].step : total_steps, total_steps);
+        }
+    }
+    return true;
+}
 
+std::vector<int16_t> WavExporter::render_to_pcm(SongDocument* song,
+                                                  InstrumentStore* store,
+                                                  const Settings& settings)
+{
+    std::vector<int16_t> pcm;
+    const bool ok = render(song, store, settings, [&pcm](const int16_t* samples, int count) {
+        pcm.insert(pcm.end(), samples, samples + count);
+        return true;
+    }, {}, nullptr, nullptr);
+    if (!ok) return {};
     return pcm;
 }
 
@@ -139,50 +254,44 @@ std::vector<int16_t> WavExporter::render_to_pcm(SongDocument* song,
 // WAV file writing
 // ============================================================
 
-QByteArray WavExporter::build_wav_header(int sample_rate, int num_samples) {
-    // WAV header: 44 bytes, PCM mono 16-bit
-    QByteArray header(44, '\0');
+QByteArray WavExporter::build_wav_header(int sample_rate, uint64_t num_samples) {
+    // PCM mono 16-bit. The JUNK chunk reserves room for the RF64 ds64 chunk
+    // (EBU Tech 3306), so a file that outgrows RIFF only needs its header
+    // patched.
+    QByteArray header(kHeaderBytes, '\0');
     auto* h = reinterpret_cast<uint8_t*>(header.data());
 
-    int data_size = num_samples * 2;  // 16-bit = 2 bytes per sample
-    int file_size = 36 + data_size;
+    const uint64_t data_size = num_samples * 2;  // 16-bit = 2 bytes per sample
+    const uint64_t riff_size = kHeaderBytes - 8 + data_size;
+    const bool rf64 = riff_size > kMaxRiffSize;
 
     // RIFF chunk
-    std::memcpy(h + 0, "RIFF", 4);
-    h[4] = static_cast<uint8_t>(file_size & 0xFF);
-    h[5] = static_cast<uint8_t>((file_size >> 8) & 0xFF);
-    h[6] = static_cast<uint8_t>((file_size >> 16) & 0xFF);
-    h[7] = static_cast<uint8_t>((file_size >> 24) & 0xFF);
+    std::memcpy(h + 0, rf64 ? "RF64" : "RIFF", 4);
+    PutLe(h + 4, rf64 ? kMaxRiffSize : riff_size, 4);
     std::memcpy(h + 8, "WAVE", 4);
 
+    // JUNK / ds64 chunk: RIFF size, data size, sample count, table length
+    std::memcpy(h + 12, rf64 ? "ds64" : "JUNK", 4);
+    PutLe(h + 16, 28, 4);
+    if (rf64) {
+        PutLe(h + 20, riff_size, 8);
+        PutLe(h + 28, data_size, 8);
+        PutLe(h + 36, num_samples, 8);
+    }
+
     // fmt sub-chunk
-    std::memcpy(h + 12, "fmt ", 4);
-    h[16] = 16; h[17] = 0; h[18] = 0; h[19] = 0; // chunk size = 16
-    h[20] = 1; h[21] = 0; // PCM format
-    h[22] = 1; h[23] = 0; // mono
-
-    // sample rate
-    h[24] = static_cast<uint8_t>(sample_rate & 0xFF);
-    h[25] = static_cast<uint8_t>((sample_rate >> 8) & 0xFF);
-    h[26] = static_cast<uint8_t>((sample_rate >> 16) & 0xFF);
-    h[27] = static_cast<uint8_t>((sample_rate >> 24) & 0xFF);
-
-    // byte rate = sample_rate * 2
-    int byte_rate = sample_rate * 2;
-    h[28] = static_cast<uint8_t>(byte_rate & 0xFF);
-    h[29] = static_cast<uint8_t>((byte_rate >> 8) & 0xFF);
-    h[30] = static_cast<uint8_t>((byte_rate >> 16) & 0xFF);
-    h[31] = static_cast<uint8_t>((byte_rate >> 24) & 0xFF);
-
-    h[32] = 2; h[33] = 0; // block align = 2
-    h[34] = 16; h[35] = 0; // bits per sample = 16
+    std::memcpy(h + 48, "fmt ", 4);
+    PutLe(h + 52, 16, 4);                                   // chunk size
+    PutLe(h + 56, 1, 2);                                    // PCM format
+    PutLe(h + 58, 1, 2);                                    // mono
+    PutLe(h + 60, static_cast<uint32_t>(sample_rate), 4);
+    PutLe(h + 64, static_cast<uint32_t>(sample_rate) * 2, 4);  // byte rate
+    PutLe(h + 68, 2, 2);                                    // block align
+    PutLe(h + 70, 16, 2);                                   // bits per sample
 
     // data sub-chunk
-    std::memcpy(h + 36, "data", 4);
-    h[40] = static_cast<uint8_t>(data_size & 0xFF);
-    h[41] = static_cast<uint8_t>((data_size >> 8) & 0xFF);
-    h[42] = static_cast<uint8_t>((data_size >> 16) & 0xFF);
-    h[43] = static_cast<uint8_t>((data_size >> 24) & 0xFF);
+    std::memcpy(h + 72, "data", 4);
+    PutLe(h + 76, rf64 ? kMaxRiffSize : data_size, 4);
 
     return header;
 }
@@ -191,25 +300,158 @@ bool WavExporter::render_to_file(const QString& path,
                                   SongDocument* song,
                                   InstrumentStore* store,
                                   const Settings& settings,
-                                  QString* error)
+                                  QString* error,
+                                  const Progress& progress,
+                                  const std::atomic<bool>* cancel)
 {
-    auto pcm = render_to_pcm(song, store, settings);
-    if (pcm.empty()) {
-        if (error) *error = "No audio data generated.";
+    return write_file(path, settings.sample_rate, [&](const BlockSink& sink, ngpc::PsgLog* recorder) {
+        return render(song, store, settings, sink, progress, cancel, error, recorder);
+    }, error);
+}
+
+bool WavExporter::render_vgm_to_file(const QString& vgm_path,
+                                      const QString& path,
+                                      const Settings& settings,
+                                      QString* error,
+                                      const Progress& progress,
+                                      const std::atomic<bool>* cancel)
+{
+    return write_file(path, settings.sample_rate, [&](const BlockSink& sink, ngpc::PsgLog* recorder) {
+        return render_vgm(vgm_path, settings, sink, progress, cancel, error, recorder);
+    }, error);
+}
+
+bool WavExporter::render_vgm(const QString& vgm_path,
+                             const Settings& settings,
+                             const BlockSink& sink,
+                             const Progress& progress,
+                             const std::atomic<bool>* cancel,
+                             QString* error,
+                             ngpc::PsgLog* recorder)
+{
+    ngpc::VgmPlayer player;
+    std::string open_error;
+    if (!player.open(vgm_path.toStdString(), settings.max_loops, &open_error)) {
+        if (error) *error = QString::fromStdString(open_error);
         return false;
     }
 
+    // The writes go straight to the chip, each on its own sample; no
+    // sequencer or driver is involved.
+    ngpc::SoundEngine snd;
+    snd.init(settings.sample_rate);
+    if (recorder) snd.psg().set_recorder(recorder);
+    player.start(&snd.psg(), settings.sample_rate);
+    snd.set_timed_callback([&player](uint64_t sample_pos) { return player.on_sample(sample_pos); });
+
+    // Progress counts seconds of the file, from its header.
+    const uint64_t rate = static_cast<uint64_t>(settings.sample_rate);
+    const int total_seconds = static_cast<int>(
+        std::max<uint64_t>(1, player.reader().expected_samples() / ngpc::VgmReader::kSampleRate));
+    const uint64_t tail_samples = rate / 10;
+    if (progress) progress(0, total_seconds);
+    std::vector<int16_t> block(static_cast<size_t>(kBlockSamples));
+    uint64_t written = 0;
+    while (!player.finished() || written < player.end_sample() + tail_samples) {
+        if (cancel && cancel->load(std::memory_order_relaxed)) {
+            if (error) *error = "Cancelled.";
+            return false;
+        }
+        snd.render(block.data(), kBlockSamples);
+        int count = kBlockSamples;
+        if (player.finished()) {
+            count = static_cast<int>(std::min<uint64_t>(kBlockSamples, player.end_sample() + tail_samples - written));
+        }
+        if (!sink(block.data(), count)) return false;
+        written += static_cast<uint64_t>(count);
+        if (progress) progress(static_cast<int>(std::min<uint64_t>(written / rate, total_seconds - 1)), total_seconds);
+    }
+    if (recorder) snd.psg().set_recorder(nullptr);
+    if (!player.reader().error().empty()) {
+        if (error) *error = QString::fromStdString(player.reader().error());
+        return false;
+    }
+    if (progress) progress(total_seconds, total_seconds);
+    return true;
+}
+
+bool WavExporter::write_file(const QString& path, int sample_rate, const Producer& produce, QString* error)
+{
     QFile f(path);
     if (!f.open(QIODevice::WriteOnly)) {
         if (error) *error = QString("Could not open file: %1").arg(path);
         return false;
     }
 
-    QByteArray header = build_wav_header(settings.sample_rate, static_cast<int>(pcm.size()));
-    f.write(header);
-    f.write(reinterpret_cast<const char*>(pcm.data()),
-            static_cast<qint64>(pcm.size() * sizeof(int16_t)));
-    f.close();
+    auto write_bytes = [&](const void* data, qint64 size) {
+        if (f.write(static_cast<const char*>(data), size) != size) {
+            if (error) *error = QString("Write failed: %1").arg(f.errorString());
+            return false;
+        }
+        return true;
+    };
 
-    return true;
+    // Sizes are unknown until the end: write a placeholder header, stream the
+    // blocks behind it, then patch it. Both headers keep their size. A VGM
+    // holds the chip writes instead of the samples and is written at the end.
+    const bool flac = path.endsWith(".flac", Qt::CaseInsensitive);
+    const bool vgm = path.endsWith(".vgm", Qt::CaseInsensitive);
+    std::unique_ptr<ngpc::FlacEncoder> encoder;
+    std::unique_ptr<ngpc::PsgLog> log;
+    std::vector<uint8_t> frames;
+    uint64_t num_samples = 0;
+    bool ok = true;
+    if (vgm) {
+        log = std::make_unique<ngpc::PsgLog>(sample_rate);
+    } else if (flac) {
+        encoder = std::make_unique<ngpc::FlacEncoder>(sample_rate);
+        const auto header = encoder->header();
+        ok = write_bytes(header.data(), static_cast<qint64>(header.size()));
+    } else {
+        const QByteArray header = build_wav_header(sample_rate, 0);
+        ok = write_bytes(header.constData(), header.size());
+    }
+    if (ok) {
+        ok = produce([&](const int16_t* samples, int count) {
+            num_samples += static_cast<uint64_t>(count);
+            if (log) {
+                return true;
+            }
+            if (!encoder) {
+                return write_bytes(samples, static_cast<qint64>(count) * static_cast<qint64>(sizeof(int16_t)));
+            }
+            frames.clear();
+            encoder->write(samples, static_cast<size_t>(count), &frames);
+            return frames.empty() || write_bytes(frames.data(), static_cast<qint64>(frames.size()));
+        }, log.get());
+    }
+    if (ok && num_samples == 0) {
+        if (error) *error = "No audio data generated.";
+        ok = false;
+    }
+    if (ok && log) {
+        const std::vector<uint8_t> bytes = ngpc::FormatVgm(*log, num_samples);
+        ok = write_bytes(bytes.data(), static_cast<qint64>(bytes.size()));
+    } else if (ok && encoder) {
+        frames.clear();
+        encoder->finish(&frames);
+        ok = write_bytes(frames.data(), static_cast<qint64>(frames.size()));
+    }
+    if (ok && !log) {
+        if (!f.seek(0)) {
+            if (error) *error = QString("Write failed: %1").arg(f.errorString());
+            ok = false;
+        } else if (encoder) {
+            const auto header = encoder->header();
+            ok = write_bytes(header.data(), static_cast<qint64>(header.size()));
+        } else {
+            const QByteArray header = build_wav_header(sample_rate, num_samples);
+            ok = write_bytes(header.constData(), header.size());
+        }
+    }
+    f.close();
+    if (!ok) {
+        f.remove();
+    }
+    return ok;
 }
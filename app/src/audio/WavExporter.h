@@ -3,12 +3,18 @@
 #include <QByteArray>
 #include <QString>
 
+#include <atomic>
 #include <cstdint>
+#include <functional>
 #include <vector>
 
 class SongDocument;
 class InstrumentStore;
 
+namespace ngpc {
+class PsgLog;
+}
+
 // ============================================================
 // WavExporter — Offline render of song/pattern to WAV file
 // ============================================================
@@ -23,12 +29,33 @@ public:
         int max_loops = 1;       // how many times to play through order before stopping
     };
 
-    // Render to WAV file. Returns true on success.
+    // `progress(done, total)` counts order entries played (0/1 then 1/1 for a
+    // pattern) and is called from the rendering thread. Setting `*cancel`
+    // stops the render at the next block.
+    using Progress = std::function<void(int done, int total)>;
+
+    // Render to a WAV file, or to FLAC when `path` ends in ".flac", one block
+    // at a time: memory use does not depend on the song length. WAV files past
+    // 4 GB are written as RF64. A ".vgm" path gets the PSG register log of the
+    // same render instead, for external players. A cancelled or failed render removes the
+    // partial file. Returns true on success.
     static bool render_to_file(const QString& path,
                                SongDocument* song,
                                InstrumentStore* store,
                                const Settings& settings,
-                               QString* error = nullptr);
+                               QString* error = nullptr,
+                               const Progress& progress = {},
+                               const std::atomic<bool>* cancel = nullptr);
+
+    // Render the PSG writes of a VGM file (T6W28 or SN76489) the same way,
+    // straight into the chip: same output formats, `settings.max_loops`
+    // passes through its loop, progress counted in seconds of the file.
+    static bool render_vgm_to_file(const QString& vgm_path,
+                                   const QString& path,
+                                   const Settings& settings,
+                                   QString* error = nullptr,
+                                   const Progress& progress = {},
+                                   const std::atomic<bool>* cancel = nullptr);
 
     // Render to raw PCM (mono int16). Returns sample count.
     static std::vector<int16_t> render_to_pcm(SongDocument* song,
@@ -36,5 +63,36 @@ public:
                                                const Settings& settings);
 
 private:
-    static QByteArray build_wav_header(int sample_rate, int num_samples);
+    // Receives each rendered block; returning false stops the render.
+    using BlockSink = std::function<bool(const int16_t* samples, int count)>;
+
+    // Shared render loop. Returns false when nothing could be rendered or the
+    // sink / cancel flag stopped it (see *error). A `recorder` receives the
+    // PSG writes and keeps the render on one engine.
+    static bool render(SongDocument* song,
+                       InstrumentStore* store,
+                       const Settings& settings,
+                       const BlockSink& sink,
+                       const Progress& progress,
+                       const std::atomic<bool>* cancel,
+                       QString* error,
+                       ngpc::PsgLog* recorder = nullptr);
+
+    static bool render_vgm(const QString& vgm_path,
+                           const Settings& settings,
+                           const BlockSink& sink,
+                           const Progress& progress,
+                           const std::atomic<bool>* cancel,
+                           QString* error,
+                           ngpc::PsgLog* recorder);
+
+    // Feeds its blocks (and PSG writes, for a VGM) to the sink it is given.
+    using Producer = std::function<bool(const BlockSink& sink, ngpc::PsgLog* recorder)>;
+
+    // Writes `path` as WAV, FLAC or VGM by its extension from what `produce`
+    // renders; removes it on failure.
+    static bool write_file(const QString& path, int sample_rate, const Producer& produce, QString* error);
+
+    // RIFF header with a JUNK chunk sized to become the RF64 ds64 chunk.
+    static QByteArray build_wav_header(int sample_rate, uint64_t num_samples);
 };
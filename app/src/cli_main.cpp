@@ -0,0 +1,819 @@
+// ngpc_sound_cli — headless export / render / MIDI tools for build systems.
+//
+// Every command prints one JSON object on stdout and exits with:
+//   0  success
+//   1  the command ran and failed (or audit --strict found warnings, or
+//      pressure found a frame dropping PSG commands outside --lag-every, or
+//      cycles a frame over --budget with measured --costs)
+//   2  bad usage
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QStringList>
+
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "audio/MidiImporter.h"
+#include "audio/ProjectExporter.h"
+#include "audio/SongExporter.h"
+#include "audio/WavExporter.h"
+#include "models/InstrumentStore.h"
+#include "models/ProjectDocument.h"
+#include "models/SongDocument.h"
+#include "ngpc/buffer_pressure.h"
+#include "ngpc/cycle_budget.h"
+#include "ngpc/midi.h"
+
+namespace {
+
+constexpr int kExitOk = 0;
+constexpr int kExitFailed = 1;
+constexpr int kExitUsage = 2;
+
+const char* kUsage =
+    "usage: ngpc_sound_cli <command> [options]\n"
+    "\n"
+    "  export <project_dir|song.ngps> [--out FILE] [--asm] [--prebaked] [--tpr N]\n"
+    "         [--prefix NAME] [--instruments FILE] [--depfile FILE] [--no-compress] [--binary]\n"
+    "  render <song.ngps|log.vgm> --out FILE.wav|.flac|.vgm [--rate HZ] [--tpr N] [--loops N] [--instruments FILE]\n"
+    "  import-midi <file.mid> --out FILE.ngps [--rows-per-beat N] [--pattern-length N] [--no-velocity]\n"
+    "  inspect-midi <file.mid>\n"
+    "  audit <project_dir|song.ngps> [--prebaked] [--strict] [--instruments FILE]\n"
+    "  pressure <project_dir|song.ngps> [--prebaked] [--tpr N] [--passes N] [--sfx-every N]\n"
+    "           [--game-send-every N [--game-send-at STATES]] [--lag-every N] [--timeline]\n"
+    "           [--instruments FILE]\n"
+    "  cycles <project_dir|song.ngps> [--prebaked] [--tpr N] [--passes N] [--budget CYCLES]\n"
+    "         [--costs FILE] [--timeline] [--instruments FILE]\n"
+    "\n"
+    "A project is a folder with ngpc_project.json. A song inside a project uses\n"
+    "the project's instruments.json unless --instruments is given; other songs\n"
+    "use the factory presets.\n"
+    "\n"
+    "pressure plays each song through the shipping driver and exits 1 when a frame\n"
+    "drops PSG commands. --sfx-every fires the project's SFX, one after the other,\n"
+    "every N frames on top of the song. The Z80 takes each commit in its stub's\n"
+    "worst-case time (66 + 130 Z80 states per command) and refuses commits meanwhile.\n"
+    "--game-send-every N makes the game send one command every N frames, STATES\n"
+    "main-CPU states after Sounds_Update() returns. --lag-every N makes the game miss\n"
+    "a VBlank every N frames; the driver's own code is not timed, so the second\n"
+    "commit always finds the Z80 busy: a worst-case stress bound, reported with\n"
+    "\"stress\": true, whose drops never fail the run.\n"
+    "\n"
+    "cycles estimates the TLCS-900H states Sounds_Update() spends per frame on each\n"
+    "song (mean, p99, max) and per instrument. Its built-in per-path costs are read\n"
+    "off the driver's C, not measured, so the report says \"calibrated\": false and\n"
+    "--budget only counts the frames over. --costs FILE supplies measured costs (a\n"
+    "JSON object with every ngpc::BgmCycleCosts field); then --budget exits 1 when\n"
+    "a frame goes over.\n";
+
+int print_result(const QJsonObject& result, int code) {
+    const QByteArray json = QJsonDocument(result).toJson(QJsonDocument::Compact);
+    std::fwrite(json.constData(), 1, static_cast<size_t>(json.size()), stdout);
+    std::fputc('\n', stdout);
+    return code;
+}
+
+int fail(QJsonObject result, const QString& error, int code = kExitFailed) {
+    result["ok"] = false;
+    result["error"] = error;
+    return print_result(result, code);
+}
+
+// Parses `args` (command name first) and checks the positional count. On
+// error the JSON reply is already printed and `*code` holds the exit code.
+bool parse(QCommandLineParser* parser, const QStringList& args, int positionals,
+           const QJsonObject& result, int* code) {
+    if (!parser->parse(args)) {
+        *code = fail(result, parser->errorText(), kExitUsage);
+        return false;
+    }
+    if (parser->positionalArguments().size() != positionals) {
+        *code = fail(result, QString("Expected %1 input path(s)").arg(positionals), kExitUsage);
+        return false;
+    }
+    return true;
+}
+
+bool parse_int(const QCommandLineParser& parser, const QString& name, int lo, int hi, int* out,
+               QString* error) {
+    if (!parser.isSet(name)) return true;
+    bool ok = false;
+    const int value = parser.value(name).toInt(&ok);
+    if (!ok || value < lo || value > hi) {
+        *error = QString("--%1 must be in %2..%3").arg(name).arg(lo).arg(hi);
+        return false;
+    }
+    *out = value;
+    return true;
+}
+
+QJsonArray to_json_array(const QStringList& list) {
+    QJsonArray out;
+    for (const QString& s : list) out.append(s);
+    return out;
+}
+
+bool is_project_dir(const QString& path) {
+    return QFileInfo(path).isDir() && QFile::exists(QDir(path).filePath("ngpc_project.json"));
+}
+
+// --instruments, else the instruments.json of the project holding `song_path`
+// (songs/<id>.ngps), else the factory presets the store starts with.
+bool load_instruments(const QCommandLineParser& parser, const QString& song_path,
+                      InstrumentStore* store, QStringList* inputs, QString* error) {
+    QString path = parser.value("instruments");
+    if (path.isEmpty() && !song_path.isEmpty()) {
+        const QDir project(QFileInfo(song_path).absoluteDir().filePath(".."));
+        if (QFile::exists(project.filePath("ngpc_project.json")) &&
+            QFile::exists(project.filePath("instruments.json"))) {
+            path = QDir::cleanPath(project.filePath("instruments.json"));
+        }
+    }
+    if (path.isEmpty()) return true;
+    if (!store->load_json(path)) {
+        *error = QString("Cannot load instruments from %1").arg(path);
+        return false;
+    }
+    if (inputs) inputs->push_back(path);
+    return true;
+}
+
+bool load_project(const QString& root, ProjectDocument* project, InstrumentStore* store,
+                  QStringList* inputs, QString* error) {
+    const QDir dir(root);
+    const QString project_path = dir.filePath("ngpc_project.json");
+    if (!project->load_from_file(project_path, error)) return false;
+    if (project->songs.isEmpty()) {
+        *error = "Project contains no songs";
+        return false;
+    }
+    if (inputs) inputs->push_back(project_path);
+
+    const QString instr_path = dir.filePath("instruments.json");
+    if (QFile::exists(instr_path)) {
+        if (!store->load_json(instr_path)) {
+            *error = QString("Cannot load instruments from %1").arg(instr_path);
+            return false;
+        }
+        if (inputs) inputs->push_back(instr_path);
+    }
+    if (inputs) {
+        for (const auto& song : project->songs) inputs->push_back(dir.filePath(song.file));
+    }
+    return true;
+}
+
+// (label, path) of every song of a project, or the one song given. A
+// project also fills `project`, when not null, and its instruments.
+bool collect_songs(const QCommandLineParser& parser, const QString& input, ProjectDocument* project,
+                   InstrumentStore* store, std::vector<std::pair<QString, QString>>* songs, QString* error) {
+    if (is_project_dir(input)) {
+        ProjectDocument local;
+        if (!project) project = &local;
+        if (!load_project(input, project, store, nullptr, error)) return false;
+        for (const auto& entry : project->songs) {
+            songs->emplace_back(entry.id, QDir(input).filePath(entry.file));
+        }
+        return true;
+    }
+    if (!load_instruments(parser, input, store, nullptr, error)) return false;
+    songs->emplace_back(QFileInfo(input).completeBaseName(), input);
+    return true;
+}
+
+// A project SFX as the Sfx_Play(id) of the exported bank fires it.
+ngpc::NativeSfx to_native_sfx(const ProjectSfxEntry& e) {
+    ngpc::NativeSfx sfx;
+    sfx.tone_on = e.tone_on != 0;
+    sfx.tone_ch = static_cast<uint8_t>(e.tone_ch);
+    sfx.tone_div = static_cast<uint16_t>(e.tone_div);
+    sfx.tone_attn = static_cast<uint8_t>(e.tone_attn);
+    sfx.tone_frames = static_cast<uint8_t>(e.tone_frames);
+    sfx.tone_sw_on = e.tone_sw_on != 0;
+    sfx.tone_sw_end = static_cast<uint16_t>(e.tone_sw_end);
+    sfx.tone_sw_step = static_cast<int16_t>(e.tone_sw_step);
+    sfx.tone_sw_speed = static_cast<uint8_t>(e.tone_sw_speed);
+    sfx.tone_sw_ping = e.tone_sw_ping != 0;
+    sfx.tone_env_on = e.tone_env_on != 0;
+    sfx.tone_env_step = static_cast<uint8_t>(e.tone_env_step);
+    sfx.tone_env_spd = static_cast<uint8_t>(e.tone_env_spd);
+    sfx.noise_on = e.noise_on != 0;
+    sfx.noise_rate = static_cast<uint8_t>(e.noise_rate);
+    sfx.noise_type = static_cast<uint8_t>(e.noise_type);
+    sfx.noise_attn = static_cast<uint8_t>(e.noise_attn);
+    sfx.noise_frames = static_cast<uint8_t>(e.noise_frames);
+    sfx.noise_burst = static_cast<uint8_t>(e.noise_burst);
+    sfx.noise_burst_dur = static_cast<uint8_t>(e.noise_burst_dur);
+    sfx.noise_env_on = e.noise_env_on != 0;
+    sfx.noise_env_step = static_cast<uint8_t>(e.noise_env_step);
+    sfx.noise_env_spd = static_cast<uint8_t>(e.noise_env_spd);
+    return sfx;
+}
+
+QJsonObject pressure_json(const ngpc::BufferPressureReport& r, bool timeline) {
+    QJsonObject o;
+    o["frames"] = static_cast<int>(r.timeline.size());
+    o["peak"] = r.peak;
+    o["peak_frame"] = static_cast<qint64>(r.peak_frame);
+    o["full_frames"] = static_cast<qint64>(r.full_frames);
+    o["overflow_frames"] = static_cast<qint64>(r.overflow_frames);
+    o["dropped"] = static_cast<qint64>(r.dropped);
+    o["refused_commits"] = static_cast<qint64>(r.refused_commits);
+    o["game_sends"] = static_cast<qint64>(r.game_sends);
+    QJsonArray bursts;
+    for (const ngpc::PressureBurst& b : r.bursts) {
+        bursts.append(QJsonObject{{"frame", static_cast<qint64>(b.first_frame)},
+                                  {"frames", static_cast<qint64>(b.frames)},
+                                  {"dropped", static_cast<qint64>(b.dropped)},
+                                  {"peak", b.peak}});
+    }
+    o["bursts"] = bursts;
+    if (timeline) {
+        QJsonArray queued;
+        QJsonArray drop_frames;
+        for (size_t i = 0; i < r.timeline.size(); ++i) {
+            queued.append(r.timeline[i].queued);
+            if (r.timeline[i].dropped) drop_frames.append(static_cast<qint64>(i + 1));
+        }
+        o["timeline"] = queued;
+        o["drop_frames"] = drop_frames;
+    }
+    return o;
+}
+
+// Measured BgmCycleCosts: one key per field, in TLCS-900H states. Every field
+// must be given, since a file that falls back to an estimate anywhere would
+// not make the report calibrated; unknown keys are refused as typos.
+bool load_cycle_costs(const QString& path, ngpc::BgmCycleCosts* costs, QString* error) {
+    using Costs = ngpc::BgmCycleCosts;
+    static const struct {
+        const char* key;
+        uint32_t Costs::*field;
+    } kFields[] = {
+        {"frame", &Costs::frame},
+        {"voice", &Costs::voice},
+        {"event", &Costs::event},
+        {"opcode", &Costs::opcode},
+        {"operand_byte", &Costs::operand_byte},
+        {"fx", &Costs::fx},
+        {"macro", &Costs::macro},
+        {"pitch_curve", &Costs::pitch_curve},
+        {"env", &Costs::env},
+        {"adsr", &Costs::adsr},
+        {"sweep", &Costs::sweep},
+        {"vibrato", &Costs::vibrato},
+        {"lfo", &Costs::lfo},
+        {"lfo_resolve", &Costs::lfo_resolve},
+        {"command", &Costs::command},
+        {"push", &Costs::push},
+    };
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        *error = QString("Cannot read %1").arg(path);
+        return false;
+    }
+    const QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
+    if (!doc.isObject()) {
+        *error = QString("%1 is not a JSON object").arg(path);
+        return false;
+    }
+    const QJsonObject root = doc.object();
+    QStringList known;
+    for (const auto& f : kFields) {
+        const int states = root.value(f.key).toInt(-1);
+        if (states < 0 || states > static_cast<int>(ngpc::kMainCpuFrameCycles)) {
+            *error = QString("%1: \"%2\" must be a state count").arg(path, QString::fromLatin1(f.key));
+            return false;
+        }
+        costs->*f.field = static_cast<uint32_t>(states);
+        known.append(f.key);
+    }
+    for (const QString& key : root.keys()) {
+        if (!known.contains(key)) {
+            *error = QString("%1: unknown cost \"%2\"").arg(path, key);
+            return false;
+        }
+    }
+    return true;
+}
+
+QJsonObject cycles_json(const ngpc::BgmCycleReport& r, const InstrumentStore& store, bool timeline) {
+    QJsonObject o;
+    o["frames"] = static_cast<int>(r.timeline.size());
+    o["mean"] = r.mean;
+    o["p99"] = static_cast<qint64>(r.p99);
+    o["max"] = static_cast<qint64>(r.max);
+    o["max_frame"] = static_cast<qint64>(r.max_frame);
+    o["over_budget"] = static_cast<qint64>(r.over_budget);
+    QJsonArray instruments;
+    for (const ngpc::InstrumentCycles& i : r.instruments) {
+        QJsonObject inst;
+        if (i.inst == ngpc::BgmStreamPlayer::kNoInstrument) {
+            inst["id"] = QJsonValue();
+        } else {
+            inst["id"] = i.inst;
+            if (i.inst < store.count()) inst["name"] = QString::fromStdString(store.at(i.inst).name);
+        }
+        inst["voice_frames"] = static_cast<qint64>(i.voice_frames);
+        inst["cycles"] = static_cast<qint64>(i.cycles);
+        inst["mean"] = static_cast<double>(i.cycles) / i.voice_frames;
+        inst["peak"] = static_cast<qint64>(i.peak);
+        inst["features"] = i.features;
+        instruments.append(inst);
+    }
+    o["instruments"] = instruments;
+    if (timeline) {
+        QJsonArray frames;
+        for (uint32_t c : r.timeline) frames.append(static_cast<qint64>(c));
+        o["timeline"] = frames;
+    }
+    return o;
+}
+
+QJsonObject song_result_json(const SongExporter::Result& r) {
+    QJsonObject o;
+    o["ok"] = r.ok;
+    if (!r.ok) o["error"] = r.error;
+    o["note_count"] = r.note_count;
+    o["stream_bytes"] = r.stream_bytes;
+    o["raw_stream_bytes"] = r.raw_stream_bytes;
+    o["cached"] = r.cached;
+    o["warnings"] = to_json_array(r.warnings);
+    return o;
+}
+
+// Make-style dependency file: every output depends on every input.
+bool write_depfile(const QString& path, const QStringList& outputs, const QStringList& inputs,
+                   QString* error) {
+    const auto escape = [](QString p) { return p.replace(' ', "\\ "); };
+    QString text;
+    for (const QString& out : outputs) {
+        if (!text.isEmpty()) text += ' ';
+        text += escape(out);
+    }
+    text += ':';
+    for (const QString& in : inputs) text += " \\\n  " + escape(in);
+    text += '\n';
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        *error = QString("Cannot write %1").arg(path);
+        return false;
+    }
+    file.write(text.toUtf8());
+    if (!file.commit()) {
+        *error = QString("Cannot commit %1").arg(path);
+        return false;
+    }
+    return true;
+}
+
+// ============================================================
+// Commands
+// ============================================================
+
+int cmd_export(const QStringList& args) {
+    QJsonObject result{{"command", "export"}};
+    QCommandLineParser parser;
+    parser.addOptions({
+        {"out", "Output .c/.inc (song)", "file"},
+        {"asm", "ASM (.inc) instead of C"},
+        {"prebaked", "Pre-baked streams instead of hybrid"},
+        {"tpr", "Ticks per row", "n"},
+        {"prefix", "Symbol prefix (song)", "name"},
+        {"instruments", "instruments.json", "file"},
+        {"depfile", "Make-style dependency file", "file"},
+        {"no-compress", "Keep repeated events inline (no EXT CALL subroutines)"},
+        {"binary", "Also write a .ngpb binary container per song"},
+    });
+    int code = kExitOk;
+    if (!parse(&parser, args, 1, result, &code)) return code;
+
+    const QString input = parser.positionalArguments().first();
+    SongExporter::Settings settings;
+    settings.hybrid = !parser.isSet("prebaked");
+    settings.asm_export = parser.isSet("asm");
+    settings.compress = !parser.isSet("no-compress");
+    settings.write_binary = parser.isSet("binary");
+    QString error;
+    if (!parse_int(parser, "tpr", 1, 32, &settings.ticks_per_row, &error)) {
+        return fail(result, error, kExitUsage);
+    }
+    result["mode"] = settings.hybrid ? "hybrid" : "prebaked";
+    result["format"] = settings.asm_export ? "asm" : "c";
+
+    InstrumentStore store;
+    QStringList inputs;
+    QStringList outputs;
+
+    if (is_project_dir(input)) {
+        ProjectDocument project;
+        if (!load_project(input, &project, &store, &inputs, &error)) return fail(result, error);
+
+        std::vector<SongExporter::Result> songs;
+        const bool ok = ProjectExporter::export_all(input, project, store, settings, &songs, &error);
+        const QDir root(input);
+        const QString ext = settings.asm_export ? ".inc" : ".c";
+        QJsonArray song_array;
+        for (size_t i = 0; i < songs.size(); ++i) {
+            const ProjectSongEntry& entry = project.songs[static_cast<int>(i)];
+            QJsonObject o = song_result_json(songs[i]);
+            o["id"] = entry.id;
+            o["output"] = root.filePath(QString("exports/%1%2").arg(entry.id, ext));
+            o["symbol_prefix"] = ProjectExporter::song_symbol_prefix(entry.id);
+            song_array.append(o);
+            outputs.push_back(o["output"].toString());
+            if (settings.write_binary) {
+                outputs.push_back(root.filePath(QString("exports/%1.ngpb").arg(entry.id)));
+            }
+        }
+        result["project"] = project.name;
+        result["songs"] = song_array;
+        if (!ok) return fail(result, error);
+
+        outputs.push_back(root.filePath("exports/project_instruments.c"));
+        outputs.push_back(root.filePath("exports/project_sfx.c"));
+        outputs.push_back(root.filePath("exports/project_audio_manifest.txt"));
+        if (!settings.asm_export) {
+            outputs.push_back(root.filePath("exports/project_audio_api.h"));
+            outputs.push_back(root.filePath("exports/project_audio_api.c"));
+        }
+    } else {
+        const QString out_path = parser.value("out");
+        if (out_path.isEmpty()) return fail(result, "--out is required for a song", kExitUsage);
+        if (!parser.isSet("asm") && out_path.endsWith(".inc", Qt::CaseInsensitive)) {
+            settings.asm_export = true;
+            result["format"] = "asm";
+        }
+        settings.symbol_prefix = parser.value("prefix");
+
+        SongDocument song;
+        if (!SongExporter::load_song_file(input, &song, &error)) return fail(result, error);
+        inputs.push_back(input);
+        if (!load_instruments(parser, input, &store, &inputs, &error)) return fail(result, error);
+
+        const SongExporter::Result r = SongExporter::export_to_path(out_path, song, &store, settings);
+        QJsonObject o = song_result_json(r);
+        o["output"] = out_path;
+        result["songs"] = QJsonArray{o};
+        if (!r.ok) return fail(result, r.error);
+        outputs.push_back(out_path);
+        if (settings.write_binary) {
+            const QFileInfo info(out_path);
+            outputs.push_back(info.dir().filePath(info.completeBaseName() + ".ngpb"));
+        }
+    }
+
+    result["outputs"] = to_json_array(outputs);
+    result["inputs"] = to_json_array(inputs);
+    if (parser.isSet("depfile") && !write_depfile(parser.value("depfile"), outputs, inputs, &error)) {
+        return fail(result, error);
+    }
+    result["ok"] = true;
+    return print_result(result, kExitOk);
+}
+
+int cmd_render(const QStringList& args) {
+    QJsonObject result{{"command", "render"}};
+    QCommandLineParser parser;
+    parser.addOptions({
+        {"out", "Output .wav, .flac or .vgm", "file"},
+        {"rate", "Sample rate", "hz"},
+        {"tpr", "Ticks per row", "n"},
+        {"loops", "Passes through the order list (or the VGM loop)", "n"},
+        {"instruments", "instruments.json", "file"},
+    });
+    int code = kExitOk;
+    if (!parse(&parser, args, 1, result, &code)) return code;
+
+    const QString input = parser.positionalArguments().first();
+    const QString out_path = parser.value("out");
+    if (out_path.isEmpty()) return fail(result, "--out is required", kExitUsage);
+
+    WavExporter::Settings settings;
+    QString error;
+    if (!parse_int(parser, "rate", 8000, 192000, &settings.sample_rate, &error) ||
+        !parse_int(parser, "tpr", 1, 32, &settings.ticks_per_row, &error) ||
+        !parse_int(parser, "loops", 1, 64, &settings.max_loops, &error)) {
+        return fail(result, error, kExitUsage);
+    }
+
+    if (input.endsWith(".vgm", Qt::CaseInsensitive)) {
+        // A register log plays straight into the chip; --tpr/--instruments do not apply.
+        if (!WavExporter::render_vgm_to_file(input, out_path, settings, &error)) {
+            return fail(result, error);
+        }
+    } else {
+        SongDocument song;
+        InstrumentStore store;
+        if (!SongExporter::load_song_file(input, &song, &error) ||
+            !load_instruments(parser, input, &store, nullptr, &error)) {
+            return fail(result, error);
+        }
+        if (!WavExporter::render_to_file(out_path, &song, &store, settings, &error)) {
+            return fail(result, error);
+        }
+    }
+
+    result["ok"] = true;
+    result["output"] = out_path;
+    result["sample_rate"] = settings.sample_rate;
+    return print_result(result, kExitOk);
+}
+
+int cmd_import_midi(const QStringList& args) {
+    QJsonObject result{{"command", "import-midi"}};
+    QCommandLineParser parser;
+    parser.addOptions({
+        {"out", "Output .ngps", "file"},
+        {"rows-per-beat", "Quantization grid", "n"},
+        {"pattern-length", "Rows per pattern", "n"},
+        {"no-velocity", "Ignore note velocities"},
+    });
+    int code = kExitOk;
+    if (!parse(&parser, args, 1, result, &code)) return code;
+
+    const QString out_path = parser.value("out");
+    if (out_path.isEmpty()) return fail(result, "--out is required", kExitUsage);
+
+    MidiImportSettings settings;
+    settings.import_velocity = !parser.isSet("no-velocity");
+    QString error;
+    if (!parse_int(parser, "rows-per-beat", 1, 16, &settings.rows_per_beat, &error) ||
+        !parse_int(parser, "pattern-length", 1, 256, &settings.pattern_length, &error)) {
+        return fail(result, error, kExitUsage);
+    }
+
+    SongDocument song;
+    const MidiImportResult r = ImportMidi(parser.positionalArguments().first(), &song, settings);
+    if (!r.success) return fail(result, r.error);
+
+    QSaveFile file(out_path);
+    if (!file.open(QIODevice::WriteOnly)) return fail(result, QString("Cannot write %1").arg(out_path));
+    file.write(song.to_json());
+    if (!file.commit()) return fail(result, QString("Cannot commit %1").arg(out_path));
+
+    result["ok"] = true;
+    result["output"] = out_path;
+    result["patterns_created"] = r.patterns_created;
+    result["patterns_reused"] = r.patterns_reused;
+    result["truncated"] = r.truncated;
+    result["notes_imported"] = r.notes_imported;
+    result["notes_dropped"] = r.notes_dropped;
+    result["suggested_tpr"] = r.suggested_tpr;
+    return print_result(result, kExitOk);
+}
+
+int cmd_inspect_midi(const QStringList& args) {
+    QJsonObject result{{"command", "inspect-midi"}};
+    QCommandLineParser parser;
+    int code = kExitOk;
+    if (!parse(&parser, args, 1, result, &code)) return code;
+
+    const ngpc::MidiInfo info = ngpc::InspectMidi(parser.positionalArguments().first().toStdString());
+    result["tracks"] = info.tracks;
+    result["ticks_per_beat"] = info.ticks_per_beat;
+    result["tempo_events"] = info.tempo_events;
+    result["tempo_events_outside_track0"] = info.tempo_events_outside_track0;
+    result["normalized_ticks_per_beat"] = info.normalized_ticks_per_beat;
+    result["downscale_divisor"] = info.downscale_divisor;
+    if (!info.warning.empty()) result["warning"] = QString::fromStdString(info.warning);
+    if (!info.valid) return fail(result, QString::fromStdString(info.error));
+    result["ok"] = true;
+    return print_result(result, kExitOk);
+}
+
+int cmd_audit(const QStringList& args) {
+    QJsonObject result{{"command", "audit"}};
+    QCommandLineParser parser;
+    parser.addOptions({
+        {"prebaked", "Audit for pre-baked export"},
+        {"strict", "Exit 1 when there are warnings"},
+        {"instruments", "instruments.json", "file"},
+    });
+    int code = kExitOk;
+    if (!parse(&parser, args, 1, result, &code)) return code;
+
+    const QString input = parser.positionalArguments().first();
+    const bool hybrid = !parser.isSet("prebaked");
+    InstrumentStore store;
+    QString error;
+
+    std::vector<std::pair<QString, QString>> songs;
+    if (!collect_songs(parser, input, nullptr, &store, &songs, &error)) return fail(result, error);
+
+    int warning_count = 0;
+    QJsonArray song_array;
+    for (const auto& [id, path] : songs) {
+        SongDocument song;
+        if (!SongExporter::load_song_file(path, &song, &error)) return fail(result, error);
+        const QStringList warnings = SongExporter::audit(&song, &store, hybrid);
+        warning_count += warnings.size();
+        song_array.append(QJsonObject{{"id", id}, {"path", path}, {"warnings", to_json_array(warnings)}});
+    }
+
+    result["songs"] = song_array;
+    result["warning_count"] = warning_count;
+    result["ok"] = (warning_count == 0 || !parser.isSet("strict"));
+    return print_result(result, result["ok"].toBool() ? kExitOk : kExitFailed);
+}
+
+int cmd_pressure(const QStringList& args) {
+    QJsonObject result{{"command", "pressure"}};
+    QCommandLineParser parser;
+    parser.addOptions({
+        {"prebaked", "Pre-baked streams instead of hybrid"},
+        {"tpr", "Ticks per row", "n"},
+        {"passes", "Passes through the song", "n"},
+        {"sfx-every", "Fire the project SFX every N frames", "n"},
+        {"game-send-every", "The game sends one command every N frames", "n"},
+        {"game-send-at", "Main-CPU states after Sounds_Update() the game sends at", "states"},
+        {"lag-every", "The game misses a VBlank every N frames (stress bound)", "n"},
+        {"timeline", "Per-frame command counts and dropping frames"},
+        {"instruments", "instruments.json", "file"},
+    });
+    int code = kExitOk;
+    if (!parse(&parser, args, 1, result, &code)) return code;
+
+    const QString input = parser.positionalArguments().first();
+    const bool hybrid = !parser.isSet("prebaked");
+    int tpr = 8;
+    int sfx_every = 0;
+    int game_send_every = 0;
+    int game_send_at = 0;
+    int lag_every = 0;
+    ngpc::BufferPressureOptions options;
+    QString error;
+    if (!parse_int(parser, "tpr", 1, 32, &tpr, &error) ||
+        !parse_int(parser, "passes", 1, 64, &options.passes, &error) ||
+        !parse_int(parser, "sfx-every", 1, 3600, &sfx_every, &error) ||
+        !parse_int(parser, "game-send-every", 1, 3600, &game_send_every, &error) ||
+        !parse_int(parser, "game-send-at", 0, static_cast<int>(ngpc::NativeSounds::kMainCpuFrameStates),
+                   &game_send_at, &error) ||
+        !parse_int(parser, "lag-every", 1, 3600, &lag_every, &error)) {
+        return fail(result, error, kExitUsage);
+    }
+    if (parser.isSet("game-send-at") && game_send_every == 0) {
+        return fail(result, "--game-send-at needs --game-send-every", kExitUsage);
+    }
+    options.game_send_interval = static_cast<uint32_t>(game_send_every);
+    options.game_send_delay = static_cast<uint32_t>(game_send_at);
+    options.lag_interval = static_cast<uint32_t>(lag_every);
+    // A lagging game is timed as a worst case: report its drops, never fail.
+    const bool stress = lag_every > 0;
+    result["mode"] = hybrid ? "hybrid" : "prebaked";
+    result["game_send_every"] = game_send_every;
+    result["game_send_at"] = game_send_at;
+    result["lag_every"] = lag_every;
+    result["stress"] = stress;
+
+    ProjectDocument project;
+    InstrumentStore store;
+    std::vector<std::pair<QString, QString>> songs;
+    if (!collect_songs(parser, input, &project, &store, &songs, &error)) return fail(result, error);
+    if (sfx_every > 0) {
+        for (const ProjectSfxEntry& e : project.sfx) options.sfx.push_back(to_native_sfx(e));
+        if (options.sfx.empty()) return fail(result, "--sfx-every needs a project with SFX", kExitUsage);
+        options.sfx_interval = static_cast<uint32_t>(sfx_every);
+        result["sfx_count"] = static_cast<int>(options.sfx.size());
+    }
+
+    qint64 overflow_frames = 0;
+    QJsonArray song_array;
+    for (const auto& [id, path] : songs) {
+        SongDocument song;
+        if (!SongExporter::load_song_file(path, &song, &error)) return fail(result, error);
+        const ngpc::BgmExportStreams streams = hybrid ? SongExporter::build_streams_hybrid(song, &store, tpr)
+                                                      : SongExporter::build_streams_prebaked(song, &store, tpr);
+        ngpc::BufferPressureReport report;
+        std::string core_error;
+        if (!ngpc::AnalyzeBufferPressure(streams, options, &report, &core_error)) {
+            return fail(result, QString("%1: %2").arg(id, QString::fromStdString(core_error)));
+        }
+        overflow_frames += report.overflow_frames;
+        QJsonObject o = pressure_json(report, parser.isSet("timeline"));
+        o["id"] = id;
+        o["path"] = path;
+        song_array.append(o);
+    }
+
+    result["songs"] = song_array;
+    result["overflow_frames"] = overflow_frames;
+    result["ok"] = stress || overflow_frames == 0;
+    return print_result(result, result["ok"].toBool() ? kExitOk : kExitFailed);
+}
+
+int cmd_cycles(const QStringList& args) {
+    QJsonObject result{{"command", "cycles"}};
+    QCommandLineParser parser;
+    parser.addOptions({
+        {"prebaked", "Pre-baked streams instead of hybrid"},
+        {"tpr", "Ticks per row", "n"},
+        {"passes", "Passes through the song", "n"},
+        {"budget", "TLCS-900H states per frame the sound code may take", "cycles"},
+        {"costs", "Measured per-path costs (JSON); without it --budget does not fail", "file"},
+        {"timeline", "Estimated cycles of every frame"},
+        {"instruments", "instruments.json", "file"},
+    });
+    int code = kExitOk;
+    if (!parse(&parser, args, 1, result, &code)) return code;
+
+    const QString input = parser.positionalArguments().first();
+    const bool hybrid = !parser.isSet("prebaked");
+    int tpr = 8;
+    int budget = 0;
+    ngpc::BgmCycleOptions options;
+    QString error;
+    if (!parse_int(parser, "tpr", 1, 32, &tpr, &error) ||
+        !parse_int(parser, "passes", 1, 64, &options.passes, &error) ||
+        !parse_int(parser, "budget", 1, static_cast<int>(ngpc::kMainCpuFrameCycles), &budget, &error)) {
+        return fail(result, error, kExitUsage);
+    }
+    options.budget = static_cast<uint32_t>(budget);
+    // Only measured costs may fail a build; the built-in ones are estimates.
+    const bool calibrated = parser.isSet("costs");
+    if (calibrated && !load_cycle_costs(parser.value("costs"), &options.costs, &error)) {
+        return fail(result, error, kExitUsage);
+    }
+    result["mode"] = hybrid ? "hybrid" : "prebaked";
+    result["calibrated"] = calibrated;
+    result["frame_cycles"] = static_cast<qint64>(ngpc::kMainCpuFrameCycles);
+    if (budget > 0) result["budget"] = budget;
+
+    InstrumentStore store;
+    std::vector<std::pair<QString, QString>> songs;
+    if (!collect_songs(parser, input, nullptr, &store, &songs, &error)) return fail(result, error);
+
+    // Played as the preview plays them: the store's instruments and FX tables.
+    const std::shared_ptr<const ngpc::BgmFxTables> tables = store.fx_tables();
+    const std::vector<ngpc::InstrumentPreset> factory = ngpc::FactoryInstrumentPresets();
+    ngpc::BgmStreamPlayer player;
+    player.set_tables(tables.get());
+    player.set_instrument_resolver([&store, &factory](uint8_t inst_id) {
+        if (inst_id < store.count()) return store.at(inst_id).def;
+        return inst_id < factory.size() ? factory[inst_id].def : ngpc::BgmInstrumentDef{};
+    });
+
+    qint64 over_budget = 0;
+    QJsonArray song_array;
+    for (const auto& [id, path] : songs) {
+        SongDocument song;
+        if (!SongExporter::load_song_file(path, &song, &error)) return fail(result, error);
+        const ngpc::BgmExportStreams streams = hybrid ? SongExporter::build_streams_hybrid(song, &store, tpr)
+                                                      : SongExporter::build_streams_prebaked(song, &store, tpr);
+        ngpc::BgmCycleReport report;
+        std::string core_error;
+        if (!player.load(ngpc::NoteTableBytes(streams.note_table), streams.streams, streams.loop_offsets,
+                         &core_error) ||
+            !ngpc::EstimateBgmCycles(&player, options, &report, &core_error)) {
+            return fail(result, QString("%1: %2").arg(id, QString::fromStdString(core_error)));
+        }
+        over_budget += report.over_budget;
+        QJsonObject o = cycles_json(report, store, parser.isSet("timeline"));
+        o["id"] = id;
+        o["path"] = path;
+        song_array.append(o);
+    }
+
+    result["songs"] = song_array;
+    result["over_budget"] = over_budget;
+    const bool ok = !calibrated || over_budget == 0;
+    result["ok"] = ok;
+    return print_result(result, ok ? kExitOk : kExitFailed);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("ngpc_sound_cli");
+
+    QStringList args = QCoreApplication::arguments();
+    const QString command = args.size() > 1 ? args[1] : QString();
+    if (command.isEmpty() || command == "-h" || command == "--help" || command == "help") {
+        std::fputs(kUsage, command.isEmpty() ? stderr : stdout);
+        return command.isEmpty() ? kExitUsage : kExitOk;
+    }
+    args.removeFirst();  // the command stands in for the program name
+
+    if (command == "export") return cmd_export(args);
+    if (command == "render") return cmd_render(args);
+    if (command == "import-midi") return cmd_import_midi(args);
+    if (command == "inspect-midi") return cmd_inspect_midi(args);
+    if (command == "audit") return cmd_audit(args);
+    if (command == "pressure") return cmd_pressure(args);
+    if (command == "cycles") return cmd_cycles(args);
+
+    std::fputs(kUsage, stderr);
+    return fail(QJsonObject{{"command", command}}, QString("Unknown command '%1'").arg(command), kExitUsage);
+}
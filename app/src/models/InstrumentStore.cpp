@@ -8,7 +8,10 @@
 #include <QJsonObject>
 
 InstrumentStore::InstrumentStore(QObject* parent)
-    : QObject(parent)
+    : QObject(parent),
+      fx_tables_(std::make_shared<const ngpc::BgmFxTables>(ngpc::FactoryEnvCurves(),
+                                                           ngpc::FactoryPitchCurves(),
+                                                           ngpc::FactoryMacros()))
 {
     load_factory_presets();
 }
@@ -221,3 +224,7 @@ bool InstrumentStore::load_json(const QString& path) {
 QString InstrumentStore::export_c_array() const {
     return QString::fromStdString(ngpc::InstrumentPresetsToCArray(presets_));
 }
+
+std::shared_ptr<const ngpc::BgmFxTables> InstrumentStore::fx_tables() const {
+    return fx_tables_;
+}
@@ -2,8 +2,10 @@
 
 #include <QObject>
 #include <QString>
+#include <memory>
 #include <vector>
 
+#include "ngpc/bgm_voice.h"
 #include "ngpc/instrument.h"
 
 class QJsonDocument;
@@ -32,10 +34,16 @@ public:
 
     void load_factory_presets();
 
+    // Interned env/pitch curves and macros that voices bind by span: the
+    // factory curves, built once. Curves are not user-editable, so the set
+    // never changes; players bind it when playback starts.
+    std::shared_ptr<const ngpc::BgmFxTables> fx_tables() const;
+
 signals:
     void list_changed();
     void preset_changed(int index);
 
 private:
     std::vector<ngpc::InstrumentPreset> presets_;
+    std::shared_ptr<const ngpc::BgmFxTables> fx_tables_;
 };
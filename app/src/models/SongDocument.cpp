@@ -6,6 +6,8 @@
 #include <QJsonObject>
 
 #include <algorithm>
+#include <cstdint>
+#include <unordered_map>
 
 // ============================================================
 // Constructor
@@ -83,6 +85,47 @@ void SongDocument::remove_pattern(int index) {
     emit active_pattern_changed(active_index_);
 }
 
+int SongDocument::compact_patterns() {
+    // Content hash -> surviving patterns with that hash (new indices).
+    std::unordered_map<uint64_t, std::vector<int>> by_hash;
+    std::vector<int> remap(patterns_.size(), 0);
+    std::vector<TrackerDocument*> kept;
+    kept.reserve(patterns_.size());
+
+    for (size_t i = 0; i < patterns_.size(); ++i) {
+        TrackerDocument* pat = patterns_[i];
+        auto& bucket = by_hash[pat->content_hash()];
+        int target = -1;
+        for (int k : bucket) {
+            if (kept[static_cast<size_t>(k)]->same_content(*pat)) {
+                target = k;
+                break;
+            }
+        }
+        if (target < 0) {
+            target = static_cast<int>(kept.size());
+            kept.push_back(pat);
+            bucket.push_back(target);
+        } else {
+            delete pat;
+        }
+        remap[i] = target;
+    }
+
+    const int removed = pattern_count() - static_cast<int>(kept.size());
+    if (removed == 0) return 0;
+
+    patterns_ = std::move(kept);
+    for (int& idx : order_)
+        idx = remap[static_cast<size_t>(idx)];
+    active_index_ = remap[static_cast<size_t>(active_index_)];
+
+    emit pattern_list_changed();
+    emit order_changed();
+    emit active_pattern_changed(active_index_);
+    return removed;
+}
+
 // ============================================================
 // Active pattern
 // ============================================================
@@ -23,6 +23,9 @@ public:
     int add_pattern();                       // returns new pattern index
     int clone_pattern(int source_index);     // returns new pattern index
     void remove_pattern(int index);          // refuses if last pattern
+    // Merge patterns with identical cells into the lowest-numbered copy and
+    // point the order list at it. Returns the number of patterns removed.
+    int compact_patterns();
 
     // --- Active pattern (for editing) ---
     int active_pattern_index() const { return active_index_; }
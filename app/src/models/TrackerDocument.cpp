@@ -6,430 +6,6 @@
 
 #include <algorithm>
 
-namespace {
-const std::vector<ngpc::MacroDef>& MacroDefs() {
-    static const std::vector<ngpc::MacroDef> kMacros = ngpc::FactoryMacros();
-    return kMacros;
-}
-
-int16_t LfoStepWave(uint8_t wave, int16_t cur, int8_t& sign, int16_t depth) {
-    if (depth <= 0) return 0;
-    switch (wave) {
-    case 0: {
-        int16_t next = static_cast<int16_t>(cur + sign);
-        if (next >= depth) {
-            next = depth;
-            sign = -1;
-        } else if (next <= -depth) {
-            next = static_cast<int16_t>(-depth);
-            sign = 1;
-        }
-        return next;
-    }
-    case 1:
-        sign = (sign < 0) ? static_cast<int8_t>(1) : static_cast<int8_t>(-1);
-        return static_cast<int16_t>(depth * sign);
-    case 2: {
-        int16_t next = static_cast<int16_t>(cur + 1);
-        if (next > depth) next = static_cast<int16_t>(-depth);
-        return next;
-    }
-    case 3:
-        if (cur < depth) return static_cast<int16_t>(cur + 1);
-        return depth;
-    case 4:
-        if (cur > -depth) return static_cast<int16_t>(cur - 1);
-        return static_cast<int16_t>(-depth);
-    default:
-        return cur;
-    }
-}
-
-bool LfoTick(bool on, uint8_t wave, uint8_t rate, uint8_t depth,
-             uint8_t& hold_counter, uint8_t& counter, int8_t& sign, int16_t& delta) {
-    if (!on || depth == 0 || rate == 0) {
-        if (delta != 0) {
-            delta = 0;
-            return true;
-        }
-        return false;
-    }
-    if (hold_counter > 0) {
-        hold_counter--;
-        if (delta != 0) {
-            delta = 0;
-            return true;
-        }
-        return false;
-    }
-    if (counter == 0) {
-        counter = rate;
-        const int16_t next = LfoStepWave(static_cast<uint8_t>(std::min<int>(wave, 4)),
-                                         delta, sign, static_cast<int16_t>(depth));
-        if (next != delta) {
-            delta = next;
-            return true;
-        }
-    } else {
-        counter--;
-    }
-    return false;
-}
-
-int8_t LfoToAttnDelta(int16_t mod) {
-    int16_t d = static_cast<int16_t>(mod / 16);
-    d = std::clamp<int16_t>(d, -15, 15);
-    return static_cast<int8_t>(-d);
-}
-
-void ResolveLfoAlgo(uint8_t algo,
-                    int16_t l1,
-                    int16_t l2,
-                    int16_t& pitch_delta,
-                    int8_t& attn_delta) {
-    const int16_t mix = std::clamp<int16_t>(static_cast<int16_t>(l1 + l2), -255, 255);
-    switch (algo & 0x07) {
-    default:
-    case 0:
-        pitch_delta = 0;
-        attn_delta = 0;
-        break;
-    case 1:
-        pitch_delta = l2;
-        attn_delta = LfoToAttnDelta(l1);
-        break;
-    case 2:
-        pitch_delta = mix;
-        attn_delta = LfoToAttnDelta(mix);
-        break;
-    case 3:
-        pitch_delta = l2;
-        attn_delta = LfoToAttnDelta(mix);
-        break;
-    case 4:
-        pitch_delta = mix;
-        attn_delta = LfoToAttnDelta(l1);
-        break;
-    case 5:
-        pitch_delta = 0;
-        attn_delta = LfoToAttnDelta(mix);
-        break;
-    case 6:
-        pitch_delta = mix;
-        attn_delta = 0;
-        break;
-    case 7:
-        pitch_delta = static_cast<int16_t>(mix / 2);
-        attn_delta = 0;
-        break;
-    }
-}
-}
-
-// ============================================================
-// TrackerVoice
-// ============================================================
-
-void TrackerVoice::note_on(const ngpc::BgmInstrumentDef& def,
-                           const std::vector<int8_t>& env_curve,
-                           const std::vector<int16_t>& pitch_curve,
-                           uint16_t divider, uint8_t attn_override) {
-    active_ = true;
-    def_ = def;
-    env_curve_ = env_curve;
-    pitch_curve_ = pitch_curve;
-    base_div_ = divider;
-    base_attn_ = (attn_override != 0xFF) ? attn_override : def.attn;
-    if (def.adsr_on) {
-        attn_cur_ = 15;
-        adsr_phase_ = 1; // ATK
-        adsr_counter_ = def.adsr_attack;
-    } else {
-        attn_cur_ = base_attn_;
-        adsr_phase_ = 0;
-        adsr_counter_ = 0;
-    }
-    env_counter_ = std::max<uint8_t>(def.env_speed, 1);
-    env_index_ = 0;
-    pitch_counter_ = std::max<uint8_t>(def.env_speed, 1);
-    pitch_index_ = 0;
-    pitch_offset_ = 0;
-    macro_step_ = 0;
-    macro_counter_ = 0;
-    macro_active_ = false;
-    macro_pitch_ = 0;
-    {
-        const auto& macros = MacroDefs();
-        if (def.macro_id < static_cast<uint8_t>(macros.size()) &&
-            !macros[def.macro_id].steps.empty()) {
-            const auto& step0 = macros[def.macro_id].steps[0];
-            if (step0.frames > 0) {
-                macro_active_ = true;
-                macro_counter_ = step0.frames;
-                macro_pitch_ = step0.pitch_delta;
-                if (!def.adsr_on) {
-                    int16_t attn = static_cast<int16_t>(base_attn_) +
-                                   static_cast<int16_t>(step0.attn_delta);
-                    attn = std::clamp<int16_t>(attn, 0, 15);
-                    attn_cur_ = static_cast<uint8_t>(attn);
-                }
-            }
-        }
-    }
-    vib_delay_counter_ = def.vib_delay;
-    vib_counter_ = std::max<uint8_t>(def.vib_speed, 1);
-    vib_dir_ = 1;
-    lfo_hold_counter_ = def.lfo_hold;
-    lfo_counter_ = def.lfo_rate;
-    lfo_sign_ = 1;
-    lfo_delta_ = 0;
-    lfo2_hold_counter_ = def.lfo2_hold;
-    lfo2_counter_ = def.lfo2_rate;
-    lfo2_sign_ = 1;
-    lfo2_delta_ = 0;
-    lfo_pitch_delta_ = 0;
-    lfo_attn_delta_ = 0;
-    tone_div_ = base_div_;
-    sweep_counter_ = std::max<uint8_t>(def.sweep_speed, 1);
-    sweep_active_ = (def.sweep_on != 0 && def.sweep_step != 0);
-}
-
-void TrackerVoice::note_off() {
-    if (def_.adsr_on && def_.adsr_release > 0 && active_) {
-        adsr_phase_ = 4; // REL
-        adsr_counter_ = def_.adsr_release;
-        // Stay active — tick() will deactivate when release completes
-    } else {
-        active_ = false;
-        adsr_phase_ = 0;
-    }
-}
-
-void TrackerVoice::tick() {
-    if (!active_) return;
-
-    if (macro_active_) {
-        if (macro_counter_ == 0) {
-            const auto& macros = MacroDefs();
-            macro_step_++;
-            if (def_.macro_id >= static_cast<uint8_t>(macros.size()) ||
-                macro_step_ >= static_cast<uint8_t>(macros[def_.macro_id].steps.size())) {
-                macro_active_ = false;
-            } else {
-                const auto& step = macros[def_.macro_id].steps[macro_step_];
-                if (step.frames == 0) {
-                    macro_active_ = false;
-                } else {
-                    macro_counter_ = step.frames;
-                    macro_pitch_ = step.pitch_delta;
-                    if (!def_.adsr_on) {
-                        int16_t attn = static_cast<int16_t>(base_attn_) +
-                                       static_cast<int16_t>(step.attn_delta);
-                        attn = std::clamp<int16_t>(attn, 0, 15);
-                        attn_cur_ = static_cast<uint8_t>(attn);
-                    }
-                }
-            }
-        }
-        if (macro_active_ && macro_counter_ > 0) {
-            macro_counter_--;
-        }
-    }
-
-    // Use !empty() to match driver check (count > 0). A single-step
-    // curve is valid and must be applied, not skipped.
-    if (!pitch_curve_.empty()) {
-        if (pitch_counter_ == 0) {
-            uint8_t idx = pitch_index_;
-            if (idx >= static_cast<uint8_t>(pitch_curve_.size())) {
-                idx = static_cast<uint8_t>(pitch_curve_.size() - 1);
-            } else {
-                pitch_index_++;
-            }
-            pitch_offset_ = pitch_curve_[idx];
-            pitch_counter_ = std::max<uint8_t>(def_.env_speed, 1);
-        } else {
-            pitch_counter_--;
-        }
-    }
-
-    // ADSR state machine (replaces legacy env when active)
-    if (def_.adsr_on && adsr_phase_ > 0) {
-        switch (adsr_phase_) {
-        case 1: // ATK: ramp 15 → base_attn_ (louder)
-            if (def_.adsr_attack == 0) {
-                attn_cur_ = base_attn_;
-                adsr_phase_ = 2;
-                adsr_counter_ = def_.adsr_decay;
-            } else if (adsr_counter_ == 0) {
-                if (attn_cur_ > base_attn_) attn_cur_--;
-                if (attn_cur_ <= base_attn_) {
-                    attn_cur_ = base_attn_;
-                    adsr_phase_ = 2;
-                    adsr_counter_ = def_.adsr_decay;
-                } else {
-                    adsr_counter_ = def_.adsr_attack;
-                }
-            } else {
-                adsr_counter_--;
-            }
-            break;
-        case 2: { // DEC: ramp base_attn_ → sustain (quieter)
-            uint8_t sus = std::max(def_.adsr_sustain, base_attn_);
-            if (def_.adsr_decay == 0 || sus <= base_attn_) {
-                attn_cur_ = sus;
-                adsr_phase_ = 3;
-                adsr_counter_ = def_.adsr_sustain_rate;
-            } else if (adsr_counter_ == 0) {
-                if (attn_cur_ < sus) attn_cur_++;
-                if (attn_cur_ >= sus) {
-                    attn_cur_ = sus;
-                    adsr_phase_ = 3;
-                    adsr_counter_ = def_.adsr_sustain_rate;
-                } else {
-                    adsr_counter_ = def_.adsr_decay;
-                }
-            } else {
-                adsr_counter_--;
-            }
-            break;
-        }
-        case 3: // SUS: optional sustain-rate fade
-            if (def_.adsr_sustain_rate > 0) {
-                if (adsr_counter_ == 0) {
-                    if (attn_cur_ < 15) attn_cur_++;
-                    if (attn_cur_ >= 15) {
-                        adsr_phase_ = 0;
-                        active_ = false;
-                    } else {
-                        adsr_counter_ = def_.adsr_sustain_rate;
-                    }
-                } else {
-                    adsr_counter_--;
-                }
-            }
-            break;
-        case 4: // REL: ramp cur → 15 (silent)
-            if (def_.adsr_release == 0) {
-                attn_cur_ = 15;
-                adsr_phase_ = 0;
-                active_ = false;
-            } else if (adsr_counter_ == 0) {
-                if (attn_cur_ < 15) attn_cur_++;
-                if (attn_cur_ >= 15) {
-                    adsr_phase_ = 0;
-                    active_ = false;
-                } else {
-                    adsr_counter_ = def_.adsr_release;
-                }
-            } else {
-                adsr_counter_--;
-            }
-            break;
-        }
-    } else if (def_.env_on) {
-        if (env_counter_ == 0) {
-            // Use !empty() to match driver check (count > 0). A single-step
-            // curve is valid and must be applied, not skipped.
-            if (!env_curve_.empty()) {
-                uint8_t idx = env_index_;
-                if (idx >= static_cast<uint8_t>(env_curve_.size())) {
-                    idx = static_cast<uint8_t>(env_curve_.size() - 1);
-                } else {
-                    env_index_++;
-                }
-                int16_t attn = static_cast<int16_t>(base_attn_) + static_cast<int16_t>(env_curve_[idx]);
-                attn = std::clamp<int16_t>(attn, 0, 15);
-                attn_cur_ = static_cast<uint8_t>(attn);
-            } else {
-                if (attn_cur_ < 15) {
-                    uint8_t next = static_cast<uint8_t>(attn_cur_ + std::max<uint8_t>(def_.env_step, 1));
-                    if (next > 15) next = 15;
-                    attn_cur_ = next;
-                }
-            }
-            env_counter_ = std::max<uint8_t>(def_.env_speed, 1);
-        } else {
-            env_counter_--;
-        }
-    }
-
-    if (def_.mode == 0 && sweep_active_) {
-        if (sweep_counter_ == 0) {
-            int32_t nd = static_cast<int32_t>(tone_div_) + static_cast<int32_t>(def_.sweep_step);
-            nd = std::clamp<int32_t>(nd, 1, 1023);
-            tone_div_ = static_cast<uint16_t>(nd);
-            sweep_counter_ = std::max<uint8_t>(def_.sweep_speed, 1);
-            if (def_.sweep_step > 0) {
-                if (tone_div_ >= def_.sweep_end) sweep_active_ = false;
-            } else {
-                if (tone_div_ <= def_.sweep_end) sweep_active_ = false;
-            }
-        } else {
-            sweep_counter_--;
-        }
-    }
-
-    if (def_.mode == 0 && def_.vib_on && def_.vib_depth > 0) {
-        if (vib_delay_counter_ > 0) {
-            vib_delay_counter_--;
-            if (vib_delay_counter_ == 0) {
-                vib_counter_ = std::max<uint8_t>(def_.vib_speed, 1);
-                vib_dir_ = 1;
-            }
-        } else {
-            if (vib_counter_ == 0) {
-                vib_dir_ = (vib_dir_ < 0) ? 1 : -1;
-                vib_counter_ = std::max<uint8_t>(def_.vib_speed, 1);
-            } else {
-                vib_counter_--;
-            }
-        }
-    }
-
-    if (def_.mode == 0) {
-        LfoTick(def_.lfo_on != 0, def_.lfo_wave, def_.lfo_rate, def_.lfo_depth,
-                lfo_hold_counter_, lfo_counter_, lfo_sign_, lfo_delta_);
-        LfoTick(def_.lfo2_on != 0, def_.lfo2_wave, def_.lfo2_rate, def_.lfo2_depth,
-                lfo2_hold_counter_, lfo2_counter_, lfo2_sign_, lfo2_delta_);
-        ResolveLfoAlgo(def_.lfo_algo, lfo_delta_, lfo2_delta_, lfo_pitch_delta_, lfo_attn_delta_);
-    } else {
-        lfo_pitch_delta_ = 0;
-        lfo_attn_delta_ = 0;
-    }
-}
-
-uint16_t TrackerVoice::final_divider() const {
-    uint16_t div = tone_div_;
-    // Batch non-vibrato pitch modifiers into a single delta then clamp once.
-    // Matches driver BgmVoice_CommandFromState (sounds.c:878-901).
-    {
-        int16_t delta = 0;
-        if (macro_pitch_ != 0)
-            delta = static_cast<int16_t>(delta + macro_pitch_);
-        if (pitch_offset_ != 0)
-            delta = static_cast<int16_t>(delta + pitch_offset_);
-        if (lfo_pitch_delta_ != 0)
-            delta = static_cast<int16_t>(delta + lfo_pitch_delta_);
-        if (delta != 0) {
-            int32_t md = static_cast<int32_t>(div) + static_cast<int32_t>(delta);
-            div = static_cast<uint16_t>(std::clamp<int32_t>(md, 1, 1023));
-        }
-    }
-    // Vibrato applied separately (matches driver, sounds.c:903-911).
-    if (def_.vib_on && def_.vib_depth > 0 && vib_delay_counter_ == 0) {
-        int16_t vib_delta = static_cast<int16_t>(def_.vib_depth) * static_cast<int16_t>(vib_dir_);
-        int32_t vd = static_cast<int32_t>(div) + static_cast<int32_t>(vib_delta);
-        div = static_cast<uint16_t>(std::clamp<int32_t>(vd, 1, 1023));
-    }
-    return div;
-}
-
-uint8_t TrackerVoice::final_attn() const {
-    int attn = static_cast<int>(attn_cur_) + static_cast<int>(lfo_attn_delta_);
-    return static_cast<uint8_t>(std::clamp(attn, 0, 15));
-}
-
 // ============================================================
 // TrackerDocument
 // ============================================================
@@ -508,6 +84,53 @@ void TrackerDocument::ensure_size() {
         ch.resize(static_cast<size_t>(length_));
 }
 
+// ============================================================
+// Content identity
+// ============================================================
+
+uint64_t TrackerDocument::content_hash() const {
+    // FNV-1a over the length and the five bytes of every cell.
+    uint64_t h = 1469598103934665603ull;
+    auto mix = [&h](uint8_t b) {
+        h ^= b;
+        h *= 1099511628211ull;
+    };
+    mix(static_cast<uint8_t>(length_));
+    for (const auto& ch : channels_) {
+        for (const TrackerCell& c : ch) {
+            mix(c.note);
+            mix(c.instrument);
+            mix(c.attn);
+            mix(c.fx);
+            mix(c.fx_param);
+        }
+    }
+    return h;
+}
+
+bool TrackerDocument::same_content(const TrackerDocument& other) const {
+    if (length_ != other.length_) return false;
+    for (size_t ch = 0; ch < channels_.size(); ++ch) {
+        const auto& a = channels_[ch];
+        const auto& b = other.channels_[ch];
+        for (size_t row = 0; row < a.size(); ++row) {
+            if (a[row].note != b[row].note || a[row].instrument != b[row].instrument ||
+                a[row].attn != b[row].attn || a[row].fx != b[row].fx ||
+                a[row].fx_param != b[row].fx_param)
+                return false;
+        }
+    }
+    return true;
+}
+
+void TrackerDocument::copy_content(const TrackerDocument& other) {
+    const bool length_differs = (length_ != other.length_);
+    length_ = other.length_;
+    channels_ = other.channels_;
+    if (length_differs) emit length_changed(length_);
+    emit document_reset();
+}
+
 // ============================================================
 // Undo / Redo
 // ============================================================
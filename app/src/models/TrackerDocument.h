@@ -24,57 +24,6 @@ struct TrackerCell {
     bool has_fx() const      { return fx != 0; }
 };
 
-// --- TrackerVoice ---
-struct TrackerVoice {
-    void note_on(const ngpc::BgmInstrumentDef& def,
-                 const std::vector<int8_t>& env_curve,
-                 const std::vector<int16_t>& pitch_curve,
-                 uint16_t divider, uint8_t attn_override);
-    void note_off();
-    void tick();
-
-    uint16_t final_divider() const;
-    uint8_t  final_attn() const;
-    bool     active() const { return active_; }
-
-private:
-    bool active_ = false;
-    ngpc::BgmInstrumentDef def_;
-    std::vector<int8_t>  env_curve_;
-    std::vector<int16_t> pitch_curve_;
-    uint16_t base_div_  = 0;
-    uint8_t  base_attn_ = 0;
-    uint8_t  env_counter_ = 0;
-    uint8_t  env_index_   = 0;
-    uint8_t  attn_cur_    = 0;
-    uint8_t  pitch_counter_ = 0;
-    uint8_t  pitch_index_   = 0;
-    int16_t  pitch_offset_  = 0;
-    uint8_t  macro_step_    = 0;
-    uint8_t  macro_counter_ = 0;
-    bool     macro_active_  = false;
-    int16_t  macro_pitch_   = 0;
-    uint8_t  vib_delay_counter_ = 0;
-    uint8_t  vib_counter_       = 0;
-    int8_t   vib_dir_           = 1;
-    uint8_t  lfo_hold_counter_  = 0;
-    uint8_t  lfo_counter_       = 0;
-    int8_t   lfo_sign_          = 1;
-    int16_t  lfo_delta_         = 0;
-    uint8_t  lfo2_hold_counter_ = 0;
-    uint8_t  lfo2_counter_      = 0;
-    int8_t   lfo2_sign_         = 1;
-    int16_t  lfo2_delta_        = 0;
-    int16_t  lfo_pitch_delta_   = 0;
-    int8_t   lfo_attn_delta_    = 0;
-    uint16_t tone_div_      = 0;
-    uint8_t  sweep_counter_ = 0;
-    bool     sweep_active_  = false;
-    // ADSR
-    uint8_t  adsr_phase_    = 0;  // 0=off, 1=ATK, 2=DEC, 3=SUS, 4=REL
-    uint8_t  adsr_counter_  = 0;
-};
-
 // --- Clipboard ---
 struct TrackerClipboard {
     int num_channels = 0;     // 1=single channel, 4=all
@@ -142,6 +91,13 @@ public:
     // --- Interpolation ---
     void interpolate_attn(int ch, int row_start, int row_end);
 
+    // --- Content identity (pattern deduplication) ---
+    // Hash of the length and every cell; equal content gives an equal hash.
+    uint64_t content_hash() const;
+    bool same_content(const TrackerDocument& other) const;
+    // Take length and cells from `other` (undo history is kept).
+    void copy_content(const TrackerDocument& other);
+
     // --- Serialization ---
     QByteArray to_json() const;
     bool from_json(const QByteArray& data);
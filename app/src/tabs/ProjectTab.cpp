@@ -59,12 +59,16 @@ ProjectTab::ProjectTab(AppLanguage language, QWidget* parent)
     open_btn_ = new QPushButton(ui("Ouvrir morceau", "Open song"), this);
     new_btn_ = new QPushButton(ui("Nouveau", "New"), this);
     import_btn_ = new QPushButton(ui("Nouveau depuis MIDI", "New from MIDI"), this);
+    import_folder_btn_ = new QPushButton(ui("Dossier MIDI...", "MIDI folder..."), this);
+    import_folder_btn_->setToolTip(ui("Importer tous les MIDI d'un dossier (un morceau par fichier)",
+                                      "Import every MIDI in a folder (one song per file)"));
     import_ngps_btn_ = new QPushButton(ui("Importer .ngps...", "Import .ngps..."), this);
     rename_btn_ = new QPushButton(ui("Renommer", "Rename"), this);
     delete_btn_ = new QPushButton(ui("Supprimer", "Delete"), this);
     actions->addWidget(open_btn_);
     actions->addWidget(new_btn_);
     actions->addWidget(import_btn_);
+    actions->addWidget(import_folder_btn_);
     actions->addWidget(import_ngps_btn_);
     actions->addWidget(rename_btn_);
     actions->addWidget(delete_btn_);
@@ -190,6 +194,14 @@ ProjectTab::ProjectTab(AppLanguage language, QWidget* parent)
         emit import_midi_song_requested(trimmed, midi_path);
     });
 
+    connect(import_folder_btn_, &QPushButton::clicked, this, [this]() {
+        const QString folder = QFileDialog::getExistingDirectory(
+            this,
+            ui("Choisir un dossier de MIDI", "Choose a MIDI folder"));
+        if (folder.isEmpty()) return;
+        emit import_midi_folder_requested(folder);
+    });
+
     connect(import_ngps_btn_, &QPushButton::clicked, this, [this]() {
         const QString ngps_path = QFileDialog::getOpenFileName(
             this,
@@ -370,6 +382,7 @@ void ProjectTab::set_project_mode(bool enabled, const QString& mode_label) {
     open_btn_->setEnabled(enabled && song_list_->currentRow() >= 0);
     new_btn_->setEnabled(enabled);
     import_btn_->setEnabled(enabled);
+    import_folder_btn_->setEnabled(enabled);
     import_ngps_btn_->setEnabled(enabled);
     rename_btn_->setEnabled(enabled && song_list_->currentRow() >= 0);
     delete_btn_->setEnabled(enabled && song_list_->currentRow() >= 0);
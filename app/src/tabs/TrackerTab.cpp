@@ -1,6 +1,7 @@
 #include "tabs/TrackerTab.h"
 
 #include <QClipboard>
+#include <QCoreApplication>
 #include <QComboBox>
 #include <QFile>
 #include <QFileDialog>
@@ -12,6 +13,7 @@
 #include <QLabel>
 #include <QMessageBox>
 #include <QPlainTextEdit>
+#include <QProgressDialog>
 #include <QPushButton>
 #include <QKeySequence>
 #include <QSaveFile>
@@ -23,16 +25,20 @@
 #include <QVBoxLayout>
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstdio>
 #include <cmath>
 #include <random>
-#include <sstream>
+#include <thread>
 
 #include "audio/EngineHub.h"
 #include "audio/InstrumentPlayer.h"
 #include "audio/PsgHelpers.h"
 #include "audio/TrackerPlaybackEngine.h"
+#include "audio/TrackerSequencer.h"
 #include "audio/MidiImporter.h"
+#include "audio/SongExporter.h"
 #include "audio/WavExporter.h"
 #include "i18n/AppLanguage.h"
 #include "models/InstrumentStore.h"
@@ -46,16 +52,6 @@
 #include "ngpc/instrument.h"
 
 namespace {
-constexpr int kMaxExportWarnings = 20;
-
-void append_export_warning(QStringList& warnings, int& hidden_count, const QString& message) {
-    if (warnings.size() < kMaxExportWarnings) {
-        warnings.push_back(message);
-    } else {
-        hidden_count++;
-    }
-}
-
 QString tracker_note_to_text(uint8_t note) {
     if (note == 0) return "---";
     if (note == 0xFF) return "OFF";
@@ -157,174 +153,6 @@ std::vector<EditCell> current_edit_cells(const TrackerGridWidget* grid, int ch,
     return cells;
 }
 
-QStringList audit_song_for_export(const SongDocument* song,
-                                  const InstrumentStore* store,
-                                  bool hybrid_mode) {
-    QStringList warnings;
-    int hidden_count = 0;
-
-    if (!song) {
-        warnings.push_back("No song loaded.");
-        return warnings;
-    }
-
-    const auto& order = song->order();
-    if (order.empty()) {
-        warnings.push_back("Order list is empty; export will contain no music.");
-        return warnings;
-    }
-
-    const int store_count = store ? store->count() : 0;
-    std::array<bool, 128> warned_missing_instrument{};
-    warned_missing_instrument.fill(false);
-    std::array<bool, 16> warned_unsupported_fx{};
-    warned_unsupported_fx.fill(false);
-    std::array<bool, 1024> divider_seen{};
-    divider_seen.fill(false);
-
-    bool warned_invalid_note = false;
-    bool warned_invalid_attn = false;
-    bool warned_b00 = false;
-    int hybrid_bxx_off_ch0 = 0;
-    int hybrid_exx_off_ch0 = 0;
-    QString first_bxx_off_ch0;
-    QString first_exx_off_ch0;
-
-    for (int ord_pos = 0; ord_pos < static_cast<int>(order.size()); ++ord_pos) {
-        const int pat_idx = order[static_cast<size_t>(ord_pos)];
-        const TrackerDocument* pat = song->pattern(pat_idx);
-        if (!pat) {
-            append_export_warning(
-                warnings, hidden_count,
-                QString("Order %1 references missing pattern %2.").arg(ord_pos).arg(pat_idx));
-            continue;
-        }
-
-        for (int row = 0; row < pat->length(); ++row) {
-            for (int ch = 0; ch < 4; ++ch) {
-                const TrackerCell& c = pat->cell(ch, row);
-                const QString loc = QString("ord %1 pat %2 row %3 ch%4")
-                                        .arg(ord_pos).arg(pat_idx).arg(row).arg(ch);
-
-                if (c.note != 0 && c.note != 0xFF && !c.is_note_on() && !warned_invalid_note) {
-                    append_export_warning(
-                        warnings, hidden_count,
-                        QString("Invalid note value %1 at %2 (expected 1..127, OFF or empty).")
-                            .arg(c.note).arg(loc));
-                    warned_invalid_note = true;
-                }
-
-                if (c.attn != 0xFF && c.attn > 15 && !warned_invalid_attn) {
-                    append_export_warning(
-                        warnings, hidden_count,
-                        QString("Invalid attenuation %1 at %2 (expected 0..15 or AUTO).")
-                            .arg(c.attn).arg(loc));
-                    warned_invalid_attn = true;
-                }
-
-                const uint8_t fx_nibble = static_cast<uint8_t>(c.fx & 0x0F);
-                if (c.has_fx()) {
-                    switch (fx_nibble) {
-                    case 0x0:
-                    case 0x1:
-                    case 0x2:
-                    case 0x3:
-                    case 0x4:
-                    case 0xA:
-                    case 0xB:
-                    case 0xC:
-                    case 0xD:
-                    case 0xE:
-                    case 0xF:
-                        break;
-                    default:
-                        if (!warned_unsupported_fx[fx_nibble]) {
-                            append_export_warning(
-                                warnings, hidden_count,
-                                QString("FX %1 is not supported at runtime (first seen at %2).")
-                                    .arg(fx_nibble, 1, 16, QChar('0')).toUpper()
-                                    .arg(loc));
-                            warned_unsupported_fx[fx_nibble] = true;
-                        }
-                        break;
-                    }
-
-                    if (fx_nibble == 0xB && c.fx_param == 0 && !warned_b00) {
-                        append_export_warning(
-                            warnings, hidden_count,
-                            QString("B00 has no effect (first seen at %1).").arg(loc));
-                        warned_b00 = true;
-                    }
-                    if (hybrid_mode && fx_nibble == 0xB && ch != 0) {
-                        hybrid_bxx_off_ch0++;
-                        if (first_bxx_off_ch0.isEmpty()) first_bxx_off_ch0 = loc;
-                    }
-                    if (hybrid_mode && fx_nibble == 0xE && ch != 0) {
-                        hybrid_exx_off_ch0++;
-                        if (first_exx_off_ch0.isEmpty()) first_exx_off_ch0 = loc;
-                    }
-                }
-
-                if (!c.is_note_on()) continue;
-
-                if (store_count <= 0) {
-                    if (c.instrument != 0 && !warned_missing_instrument[c.instrument]) {
-                        append_export_warning(
-                            warnings, hidden_count,
-                            QString("Instrument %1 used at %2 but instrument bank is empty.")
-                                .arg(c.instrument).arg(loc));
-                        warned_missing_instrument[c.instrument] = true;
-                    }
-                } else if (c.instrument >= store_count && !warned_missing_instrument[c.instrument]) {
-                    append_export_warning(
-                        warnings, hidden_count,
-                        QString("Instrument %1 used at %2 but only 0..%3 exist. Fallback to default.")
-                            .arg(c.instrument).arg(loc).arg(store_count - 1));
-                    warned_missing_instrument[c.instrument] = true;
-                }
-
-                if (ch < 3) {
-                    const uint16_t div = TrackerPlaybackEngine::midi_to_divider(c.note);
-                    divider_seen[std::clamp<int>(div, 1, 1023)] = true;
-                }
-            }
-        }
-    }
-
-    int unique_dividers = 0;
-    for (int div = 1; div <= 1023; ++div) {
-        if (divider_seen[static_cast<size_t>(div)]) unique_dividers++;
-    }
-    if (unique_dividers > 51) {
-        append_export_warning(
-            warnings, hidden_count,
-            QString("Tone note table uses %1 unique dividers; driver limit is 51 (closest match fallback).")
-                .arg(unique_dividers));
-    }
-
-    if (hybrid_mode && hybrid_bxx_off_ch0 > 0) {
-        append_export_warning(
-            warnings, hidden_count,
-            QString("Hybrid export found %1 Bxx command(s) outside CH0 (first: %2). "
-                    "Prefer putting global speed changes on CH0 for deterministic timing.")
-                .arg(hybrid_bxx_off_ch0).arg(first_bxx_off_ch0));
-    }
-
-    if (hybrid_mode && hybrid_exx_off_ch0 > 0) {
-        append_export_warning(
-            warnings, hidden_count,
-            QString("Hybrid export found %1 Exx host command(s) outside CH0 (first: %2). "
-                    "Prefer CH0 for global host commands.")
-                .arg(hybrid_exx_off_ch0).arg(first_exx_off_ch0));
-    }
-
-    if (hidden_count > 0) {
-        warnings.push_back(QString("%1 additional warning(s) hidden.").arg(hidden_count));
-    }
-
-    return warnings;
-}
-
 ngpc::BgmInstrumentDef resolve_preview_instrument(const InstrumentStore* store, uint8_t inst_id) {
     if (store && inst_id < static_cast<uint8_t>(store->count())) {
         return store->at(inst_id).def;
@@ -357,7 +185,10 @@ TrackerTab::TrackerTab(EngineHub* hub, InstrumentStore* store, QWidget* parent)
     engine_ = new TrackerPlaybackEngine(this);
     engine_->set_document(doc_);
     engine_->set_instrument_store(store_);
+    sequencer_ = std::make_shared<TrackerSequencer>(engine_);
+    sequencer_->set_song(song_);
     preview_player_ = new InstrumentPlayer(hub_, this);
+    preview_player_->set_instrument_store(store_);
 
     auto* root = new QVBoxLayout(this);
     root->setContentsMargins(4, 4, 4, 4);
@@ -528,6 +359,12 @@ TrackerTab::TrackerTab(EngineHub* hub, InstrumentStore* store, QWidget* parent)
     pat_del_btn_->setToolTip(ui("Supprimer le pattern courant", "Delete current pattern"));
     pat_order_row->addWidget(pat_del_btn_);
 
+    pat_compact_btn_ = new QPushButton("Cmp", this);
+    pat_compact_btn_->setFixedWidth(36);
+    pat_compact_btn_->setToolTip(ui("Fusionner les patterns identiques (ordre mis a jour)",
+                                    "Merge identical patterns (order list updated)"));
+    pat_order_row->addWidget(pat_compact_btn_);
+
     pat_order_row->addSpacing(12);
 
     pat_order_row->addWidget(new QLabel("Order:", this));
@@ -771,29 +608,8 @@ TrackerTab::TrackerTab(EngineHub* hub, InstrumentStore* store, QWidget* parent)
         update_bpm_label();
     });
 
-    // Engine speed_changed (from Bxx effect) -> sync TPR spin
-    connect(engine_, &TrackerPlaybackEngine::speed_changed, this, [this](int tpr) {
-        tpr_spin_->blockSignals(true);
-        tpr_spin_->setValue(tpr);
-        tpr_spin_->blockSignals(false);
-        update_bpm_label();
-    });
-
-    // Engine row_changed -> update grid playback row + follow mode
-    connect(engine_, &TrackerPlaybackEngine::row_changed, this, [this](int row) {
-        grid_->set_playback_row(row);
-        if (follow_mode_) {
-            grid_->set_cursor(grid_->cursor_ch(), row, grid_->cursor_sub());
-            grid_->ensure_row_visible(row);
-        }
-        if (runtime_debug_enabled_) {
-            append_runtime_debug_row(row);
-        }
-    });
-
-    // Engine pattern_finished -> song mode or loop
-    connect(engine_, &TrackerPlaybackEngine::pattern_finished, this,
-            &TrackerTab::on_pattern_finished);
+    // Engine row/speed/pattern changes are posted by the sequencer from the
+    // render loop and applied in on_tick() (play_timer_), never synchronously.
 
     connect(runtime_dbg_btn_, &QPushButton::toggled, this, [this](bool enabled) {
         runtime_debug_enabled_ = enabled;
@@ -849,6 +665,21 @@ TrackerTab::TrackerTab(EngineHub* hub, InstrumentStore* store, QWidget* parent)
         append_log(QString("Deleted pattern %1").arg(old));
     });
 
+    connect(pat_compact_btn_, &QPushButton::clicked, this, [this]() {
+        stop_playback();
+        const int before = song_->pattern_count();
+        const int removed = song_->compact_patterns();
+        if (removed == 0) {
+            append_log("Compact: no duplicate patterns.");
+            return;
+        }
+        refresh_pattern_ui();
+        switch_to_pattern(song_->active_pattern_index());
+        refresh_order_list();
+        append_log(QString("Compact: %1 -> %2 patterns (%3 duplicates merged)")
+            .arg(before).arg(song_->pattern_count()).arg(removed));
+    });
+
     // Order list: double-click to jump to that pattern
     connect(order_list_, &QListWidget::itemDoubleClicked, this, [this](QListWidgetItem*) {
         int row = order_list_->currentRow();
@@ -1520,10 +1351,10 @@ TrackerTab::TrackerTab(EngineHub* hub, InstrumentStore* store, QWidget* parent)
     connect(export_btn_, &QPushButton::clicked, this, &TrackerTab::on_export);
     connect(export_asm_btn_, &QPushButton::clicked, this, &TrackerTab::on_export_asm);
 
-    // WAV export
+    // WAV / FLAC / VGM export (the extension picks the format)
     connect(wav_btn, &QPushButton::clicked, this, [this]() {
         QString path = QFileDialog::getSaveFileName(this, "Export WAV",
-                                                     QString(), "WAV Audio (*.wav)");
+                                                     QString(), "WAV Audio (*.wav);;FLAC Audio (*.flac);;VGM Log (*.vgm)");
         if (path.isEmpty()) return;
 
         WavExporter::Settings ws;
@@ -1533,9 +1364,46 @@ TrackerTab::TrackerTab(EngineHub* hub, InstrumentStore* store, QWidget* parent)
         ws.max_loops = 1;
 
         append_log("Exporting WAV...");
+        // The render works on a copy of the song, on its own thread; the GUI
+        // thread pumps the modal progress dialog, so store_ is not edited
+        // meanwhile.
+        const QByteArray song_json = song_->to_json();
+        const int active_pattern = song_->active_pattern_index();
+        std::atomic<bool> cancel{false};
+        std::atomic<int> done{0};
+        std::atomic<int> total{1};
+        std::atomic<bool> finished{false};
+        bool ok = false;
         QString err;
-        if (WavExporter::render_to_file(path, song_, store_, ws, &err)) {
-            append_log(QString("WAV exported to %1").arg(path));
+        std::thread render([&]() {
+            SongDocument copy;
+            if (!copy.from_json(song_json)) {
+                err = "Could not copy the song";
+            } else {
+                copy.set_active_pattern(active_pattern);
+                ok = WavExporter::render_to_file(path, &copy, store_, ws, &err,
+                                                 [&](int n, int t) { total.store(t); done.store(n); },
+                                                 &cancel);
+            }
+            finished.store(true);
+        });
+
+        QProgressDialog progress(ui("Export WAV en cours...", "Exporting WAV..."),
+                                 ui("Annuler", "Cancel"), 0, 1, this);
+        progress.setWindowModality(Qt::WindowModal);
+        progress.setMinimumDuration(500);
+        while (!finished.load()) {
+            progress.setMaximum(total.load());
+            progress.setValue(done.load());
+            if (progress.wasCanceled()) cancel.store(true);
+            QCoreApplication::processEvents(QEventLoop::AllEvents, 50);
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        render.join();
+        progress.setValue(progress.maximum());
+
+        if (ok) {
+            append_log(QString("Audio exported to %1").arg(path));
         } else {
             append_log(QString("ERROR WAV export: %1").arg(err));
         }
@@ -2084,9 +1952,9 @@ void TrackerTab::start_playback() {
 
     song_mode_ = false;
     playing_ = true;
-    engine_->set_document(doc_);
     engine_->set_ticks_per_row(tpr_spin_->value());
-    engine_->start(grid_->cursor_row());
+    sequencer_->start_pattern(doc_, grid_->cursor_row());
+    attach_sequencer();
     grid_->set_playback_row(engine_->current_row());
 
     play_btn_->setText("Pause [Space]");
@@ -2105,9 +1973,9 @@ void TrackerTab::start_playback_from_start() {
 
     song_mode_ = false;
     playing_ = true;
-    engine_->set_document(doc_);
     engine_->set_ticks_per_row(tpr_spin_->value());
-    engine_->start(0);
+    sequencer_->start_pattern(doc_, 0);
+    attach_sequencer();
     grid_->set_playback_row(0);
 
     play_btn_->setText("Pause [Space]");
@@ -2133,10 +2001,10 @@ void TrackerTab::start_loop_selection() {
 
     song_mode_ = false;
     playing_ = true;
-    engine_->set_document(doc_);
     engine_->set_ticks_per_row(tpr_spin_->value());
     engine_->set_loop_range(sel_start, sel_end);
-    engine_->start(sel_start);
+    sequencer_->start_pattern(doc_, sel_start);
+    attach_sequencer();
     grid_->set_playback_row(sel_start);
 
     play_btn_->setText("Pause [Space]");
@@ -2149,8 +2017,11 @@ void TrackerTab::stop_playback() {
     play_timer_->stop();
     playing_ = false;
     song_mode_ = false;
+    // Detach first: after this the render loop no longer touches engine_.
+    if (hub_) hub_->engine().set_frame_callback({});
+    sequencer_->stop();
+    sequencer_->clear_events();
     engine_->clear_loop_range();
-    engine_->stop();
     silence_all();
     grid_->set_playback_row(-1);
     play_btn_->setText("Play [Space]");
@@ -2162,45 +2033,70 @@ void TrackerTab::stop_playback() {
     }
 }
 
+void TrackerTab::attach_sequencer() {
+    if (!hub_) return;
+    update_mute_state();
+    sequencer_->clear_events();
+    sequencer_->set_sound_engine(&hub_->engine());
+    // Weak: the hub outlives this tab at shutdown, and a stale callback must
+    // find nothing to tick rather than a dead sequencer.
+    std::weak_ptr<TrackerSequencer> weak = sequencer_;
+    hub_->engine().set_frame_callback([weak](uint64_t sample_pos) {
+        if (auto seq = weak.lock()) seq->on_frame(sample_pos);
+    });
+}
+
 void TrackerTab::on_tick() {
-    if (!playing_ || !hub_ || !hub_->engine_ready()) {
+    if (!playing_ || !hub_ || !hub_->engine_ready() || !hub_->audio_running()) {
         stop_playback();
         return;
     }
 
-    engine_->tick();
-    write_voices_to_psg();
-}
-
-void TrackerTab::write_voices_to_psg() {
-    if (!hub_ || !hub_->engine_ready()) return;
-
-    for (int ch = 0; ch < 4; ++ch) {
-        bool muted = false;
-        if (solo_channel_ >= 0) {
-            muted = (ch != solo_channel_);
-        } else {
-            muted = mute_btns_[ch]->isChecked() || grid_->is_channel_muted(ch);
-        }
-
-        auto out = engine_->channel_output(ch);
-
-        if (muted || !out.active) {
-            if (ch < 3) {
-                psg_helpers::DirectSilenceTone(hub_->engine(), ch);
-            } else {
-                psg_helpers::DirectSilenceNoise(hub_->engine());
-            }
+    // Apply what the render loop has posted, but only up to the sample that is
+    // audible right now: rows are rendered one sink buffer ahead of the
+    // speaker. Only the newest row is drawn; pattern switches and speed
+    // changes are all applied.
+    const uint64_t audible = hub_->audio_audible_sample_pos();
+    TrackerSequencer::RowEvent ev;
+    bool have_row = false;
+    int last_row = -1;
+    bool finished = false;
+    while (sequencer_->poll_event_until(audible, &ev)) {
+        if (ev.flags & TrackerSequencer::kEventFinished) {
+            finished = true;
             continue;
         }
+        if ((ev.flags & TrackerSequencer::kEventPatternSwitched) && ev.order_pos >= 0) {
+            on_song_pattern_switched(ev.order_pos, ev.pattern);
+        }
+        if (ev.flags & TrackerSequencer::kEventSpeedChanged) {
+            tpr_spin_->blockSignals(true);
+            tpr_spin_->setValue(ev.ticks_per_row);
+            tpr_spin_->blockSignals(false);
+            update_bpm_label();
+        }
+        if (runtime_debug_enabled_) {
+            append_runtime_debug_row(ev.row);
+        }
+        have_row = true;
+        last_row = ev.row;
+    }
 
-        if (ch < 3) {
-            psg_helpers::DirectToneCh(hub_->engine(), ch, out.divider, out.attn);
-        } else {
-            auto nc = TrackerPlaybackEngine::decode_noise_val(out.noise_val);
-            psg_helpers::DirectNoise(hub_->engine(), nc.rate, nc.type, out.attn);
+    if (have_row) {
+        grid_->set_playback_row(last_row);
+        if (follow_mode_) {
+            grid_->set_cursor(grid_->cursor_ch(), last_row, grid_->cursor_sub());
+            grid_->ensure_row_visible(last_row);
         }
     }
+    // kEventFinished is the one event no later row repairs, and a full ring
+    // drops it; the sequencer's latched finish covers that case.
+    if (!finished && sequencer_->finished() && sequencer_->finish_sample() <= audible) {
+        finished = true;
+    }
+    if (finished) {
+        stop_playback();
+    }
 }
 
 void TrackerTab::silence_all() {
@@ -2226,6 +2122,7 @@ void TrackerTab::update_mute_state() {
 
     for (int i = 0; i < 4; ++i) {
         grid_->set_channel_muted(i, channel_muted[i]);
+        sequencer_->set_channel_muted(i, channel_muted[i]);
     }
 }
 
@@ -2513,574 +2410,22 @@ bool TrackerTab::load_song_from_path(const QString& path, QString* error) {
 }
 
 std::array<bool, 128> TrackerTab::collect_used_instruments() const {
-    std::array<bool, 128> used{};
-    used.fill(false);
     if (!song_) {
+        std::array<bool, 128> used{};
+        used.fill(false);
         return used;
     }
-
-    auto collect_from_pattern = [&](const TrackerDocument* pat) {
-        if (!pat) return;
-        for (int row = 0; row < pat->length(); ++row) {
-            for (int ch = 0; ch < 4; ++ch) {
-                const TrackerCell& c = pat->cell(ch, row);
-                if (c.is_note_on()) {
-                    used[static_cast<uint8_t>(c.instrument)] = true;
-                }
-            }
-        }
-    };
-
-    const auto& order = song_->order();
-    if (!order.empty()) {
-        for (int ord_pos = 0; ord_pos < order.size(); ++ord_pos) {
-            collect_from_pattern(song_->pattern(order[ord_pos]));
-        }
-        return used;
-    }
-
-    for (int i = 0; i < song_->pattern_count(); ++i) {
-        collect_from_pattern(song_->pattern(i));
-    }
-    return used;
+    return SongExporter::collect_used_instruments(*song_);
 }
 
-// ============================================================
-// Export — pre-baked (tick-by-tick with effects + instruments)
-// ============================================================
-
-TrackerTab::ExportStreams TrackerTab::build_export_streams() const
-{
-    ExportStreams result;
-    result.loop_offsets.fill(0);
-
-    if (!song_ || song_->pattern_count() == 0) return result;
-
-    static constexpr int kMaxDriverNotes = 51;
-
-    // --- Phase 1: Tick-by-tick simulation (like WavExporter) ---
-
-    struct TickSnapshot {
-        bool active;
-        uint16_t divider;
-        uint8_t attn;
-        uint8_t noise_val;
-    };
-    // snapshots[tick_index][channel]
-    std::vector<std::array<TickSnapshot, 4>> snapshots;
-    int loop_tick = -1; // tick index where loop point starts
-
-    TrackerPlaybackEngine engine;
-    engine.set_instrument_store(const_cast<InstrumentStore*>(store_));
-    engine.set_ticks_per_row(tpr_spin_->value());
-
-    const auto& order = song_->order();
-    if (order.empty()) return result;
-
-    for (int ord_pos = 0; ord_pos < static_cast<int>(order.size()); ++ord_pos) {
-        // Record loop point
-        if (ord_pos == song_->loop_point()) {
-            loop_tick = static_cast<int>(snapshots.size());
-        }
-
-        int pat_idx = order[static_cast<size_t>(ord_pos)];
-        TrackerDocument* pat = song_->pattern(pat_idx);
-        if (!pat) continue;
-
-        engine.set_document(pat);
-        engine.start(0);
-
-        bool pattern_done = false;
-        bool had_ticks = false;
-        while (!pattern_done) {
-            engine.tick();
-            had_ticks = true;
-
-            std::array<TickSnapshot, 4> snap;
-            for (int ch = 0; ch < 4; ++ch) {
-                auto out = engine.channel_output(ch);
-                snap[static_cast<size_t>(ch)] = {out.active, out.divider, out.attn, out.noise_val};
-            }
-            snapshots.push_back(snap);
-
-            // Pattern finished detection (same as WavExporter)
-            if (engine.current_row() == 0 && engine.tick_counter() == 0 && had_ticks) {
-                pattern_done = true;
-            }
-        }
-        engine.stop();
-    }
-
-    if (snapshots.empty()) return result;
-
-    // --- Phase 2: Build NOTE_TABLE from unique dividers ---
-
-    std::vector<uint16_t>& note_table = result.note_table;
-    bool note_table_capped = false;
-
-    auto find_or_add_divider = [&](uint16_t div) -> int {
-        for (size_t i = 0; i < note_table.size(); ++i) {
-            if (note_table[i] == div) return static_cast<int>(i);
-        }
-        if (static_cast<int>(note_table.size()) < kMaxDriverNotes) {
-            note_table.push_back(div);
-            return static_cast<int>(note_table.size() - 1);
-        }
-        // Table full — find closest divider
-        note_table_capped = true;
-        int best_idx = 0;
-        int best_diff = std::abs(static_cast<int>(note_table[0]) - static_cast<int>(div));
-        for (size_t i = 1; i < note_table.size(); ++i) {
-            int diff = std::abs(static_cast<int>(note_table[i]) - static_cast<int>(div));
-            if (diff < best_diff) { best_diff = diff; best_idx = static_cast<int>(i); }
-        }
-        return best_idx;
-    };
-
-    // Pre-collect all unique dividers from tone channels
-    for (const auto& snap : snapshots) {
-        for (int ch = 0; ch < 3; ++ch) {
-            if (snap[static_cast<size_t>(ch)].active && snap[static_cast<size_t>(ch)].divider > 0) {
-                find_or_add_divider(snap[static_cast<size_t>(ch)].divider);
-            }
-        }
-    }
-    if (note_table.empty()) note_table.push_back(1);
-
-    // --- Phase 3: Build streams from snapshots ---
-
-    auto append_event = [](std::vector<uint8_t>& dst, uint8_t opcode, int duration) {
-        int remaining = std::max(duration, 1);
-        while (remaining > 0) {
-            int chunk = std::min(remaining, 255);
-            dst.push_back(opcode);
-            dst.push_back(static_cast<uint8_t>(chunk));
-            remaining -= chunk;
-        }
-    };
-
-    const int total_ticks = static_cast<int>(snapshots.size());
-
-    for (int ch = 0; ch < 4; ++ch) {
-        auto& stream = result.streams[static_cast<size_t>(ch)];
-        const bool is_noise = (ch == 3);
-
-        // Track current state
-        bool cur_active = false;
-        uint16_t cur_divider = 0;
-        uint8_t cur_attn = 15;
-        uint8_t cur_noise = 0;
-        uint8_t cur_note_idx = 0; // 0 = no note playing
-        int pending_dur = 0;
-
-        for (int t = 0; t < total_ticks; ++t) {
-            // Record loop offset
-            if (t == loop_tick) {
-                result.loop_offsets[static_cast<size_t>(ch)] = static_cast<uint16_t>(stream.size());
-            }
-
-            const auto& s = snapshots[static_cast<size_t>(t)][static_cast<size_t>(ch)];
-
-            if (!s.active) {
-                // Channel silent
-                if (cur_active && cur_note_idx != 0) {
-                    // Was playing a note → flush it, then start rest
-                    append_event(stream, cur_note_idx, pending_dur);
-                    pending_dur = 0;
-                    cur_note_idx = 0;
-                }
-                cur_active = false;
-                // Accumulate rest duration (0xFF)
-                if (cur_note_idx == 0) {
-                    pending_dur++;
-                }
-                continue;
-            }
-
-            // Channel is active
-            uint8_t new_note_idx;
-            if (is_noise) {
-                new_note_idx = static_cast<uint8_t>((s.noise_val & 0x07) + 1);
-            } else {
-                new_note_idx = static_cast<uint8_t>(find_or_add_divider(s.divider) + 1);
-            }
-
-            bool note_changed = (new_note_idx != cur_note_idx) || !cur_active;
-            bool attn_changed = (s.attn != cur_attn);
-
-            if (note_changed || attn_changed) {
-                // Flush pending duration
-                if (pending_dur > 0) {
-                    if (cur_note_idx == 0) {
-                        // Was a rest
-                        append_event(stream, 0xFF, pending_dur);
-                    } else {
-                        // Was a note
-                        append_event(stream, cur_note_idx, pending_dur);
-                    }
-                    pending_dur = 0;
-                }
-
-                // Emit attenuation change if needed
-                if (attn_changed) {
-                    stream.push_back(0xF0);
-                    stream.push_back(static_cast<uint8_t>(s.attn & 0x0F));
-                    cur_attn = s.attn;
-                }
-
-                cur_note_idx = new_note_idx;
-                cur_active = true;
-                cur_divider = s.divider;
-                cur_noise = s.noise_val;
-            }
-
-            pending_dur++;
-        }
-
-        // Flush remaining
-        if (pending_dur > 0) {
-            if (cur_note_idx == 0) {
-                append_event(stream, 0xFF, pending_dur);
-            } else {
-                append_event(stream, cur_note_idx, pending_dur);
-            }
-        }
-
-        // End marker
-        stream.push_back(0x00);
-    }
-
-    return result;
+int TrackerTab::ticks_per_row() const {
+    return tpr_spin_->value();
 }
 
 // ============================================================
-// Export — hybrid (row-based with instrument opcodes)
+// Export
 // ============================================================
 
-TrackerTab::ExportStreams TrackerTab::build_export_streams_hybrid(
-    const std::array<uint8_t, 128>* instrument_remap) const
-{
-    ExportStreams result;
-    result.loop_offsets.fill(0);
-
-    if (!song_ || song_->pattern_count() == 0) return result;
-
-    static constexpr int kMaxDriverNotes = 51;
-
-    // --- Collect all unique MIDI notes to build NOTE_TABLE ---
-
-    std::vector<uint16_t>& note_table = result.note_table;
-
-    auto find_or_add_divider = [&](uint16_t div) -> int {
-        for (size_t i = 0; i < note_table.size(); ++i) {
-            if (note_table[i] == div) return static_cast<int>(i);
-        }
-        if (static_cast<int>(note_table.size()) < kMaxDriverNotes) {
-            note_table.push_back(div);
-            return static_cast<int>(note_table.size() - 1);
-        }
-        // Table full — find closest divider
-        int best_idx = 0;
-        int best_diff = std::abs(static_cast<int>(note_table[0]) - static_cast<int>(div));
-        for (size_t i = 1; i < note_table.size(); ++i) {
-            int diff = std::abs(static_cast<int>(note_table[i]) - static_cast<int>(div));
-            if (diff < best_diff) { best_diff = diff; best_idx = static_cast<int>(i); }
-        }
-        return best_idx;
-    };
-
-    auto append_event = [](std::vector<uint8_t>& dst, uint8_t opcode, int duration) {
-        int remaining = std::max(duration, 1);
-        while (remaining > 0) {
-            int chunk = std::min(remaining, 255);
-            dst.push_back(opcode);
-            dst.push_back(static_cast<uint8_t>(chunk));
-            remaining -= chunk;
-        }
-    };
-
-    // Helper: emit instrument inline opcodes (0xF4 + 0xF0-0xF3)
-    auto emit_instrument = [&](std::vector<uint8_t>& stream, int inst_idx) {
-        const uint8_t src_inst = static_cast<uint8_t>(inst_idx & 0x7F);
-        const uint8_t driver_inst = instrument_remap ? (*instrument_remap)[src_inst] : src_inst;
-        ngpc::BgmInstrumentDef def;
-        if (store_ && src_inst < store_->count()) {
-            def = store_->at(src_inst).def;
-        }
-        // 0xF4 SET_INST (for real driver)
-        stream.push_back(0xF4);
-        stream.push_back(driver_inst);
-        // 0xF0 SET_ATTN (for PlayerTab preview)
-        stream.push_back(0xF0);
-        stream.push_back(static_cast<uint8_t>(def.attn & 0x0F));
-        // 0xF1 SET_ENV
-        if (def.env_on) {
-            stream.push_back(0xF1);
-            stream.push_back(def.env_step);
-            stream.push_back(def.env_speed);
-        } else {
-            stream.push_back(0xF1);
-            stream.push_back(0); // step=0 → env off
-            stream.push_back(1);
-        }
-        // 0xF2 SET_VIB
-        stream.push_back(0xF2);
-        stream.push_back(def.vib_depth);
-        stream.push_back(def.vib_speed > 0 ? def.vib_speed : static_cast<uint8_t>(1));
-        stream.push_back(def.vib_delay);
-        // 0xF3 SET_SWEEP
-        if (def.sweep_on) {
-            stream.push_back(0xF3);
-            stream.push_back(static_cast<uint8_t>(def.sweep_end & 0xFF));
-            stream.push_back(static_cast<uint8_t>((def.sweep_end >> 8) & 0xFF));
-            stream.push_back(static_cast<uint8_t>(def.sweep_step & 0xFF));
-            stream.push_back(def.sweep_speed > 0 ? def.sweep_speed : static_cast<uint8_t>(1));
-        }
-        // 0xF9 SET_ADSR (legacy 4 params, kept for fallback)
-        if (def.adsr_on) {
-            stream.push_back(0xF9);
-            stream.push_back(def.adsr_attack);
-            stream.push_back(def.adsr_decay);
-            stream.push_back(def.adsr_sustain);
-            stream.push_back(def.adsr_release);
-        }
-        // 0xFA SET_LFO (legacy LFO1 shorthand, kept for fallback)
-        stream.push_back(0xFA);
-        stream.push_back(static_cast<uint8_t>(std::clamp<int>(def.lfo_wave, 0, 4)));
-        stream.push_back(def.lfo_rate);
-        stream.push_back(def.lfo_on ? def.lfo_depth : static_cast<uint8_t>(0));
-        // 0xFE EXT 0x01: ADSR5 (A,D,SL,SR,RR)
-        if (def.adsr_on) {
-            stream.push_back(0xFE);
-            stream.push_back(0x01);
-            stream.push_back(def.adsr_attack);
-            stream.push_back(def.adsr_decay);
-            stream.push_back(def.adsr_sustain);
-            stream.push_back(def.adsr_sustain_rate);
-            stream.push_back(def.adsr_release);
-        }
-        // 0xFE EXT 0x02: MOD2 (algo + LFO1 + LFO2)
-        stream.push_back(0xFE);
-        stream.push_back(0x02);
-        stream.push_back(static_cast<uint8_t>(std::clamp<int>(def.lfo_algo, 0, 7)));
-        stream.push_back(def.lfo_on ? static_cast<uint8_t>(1) : static_cast<uint8_t>(0));
-        stream.push_back(static_cast<uint8_t>(std::clamp<int>(def.lfo_wave, 0, 4)));
-        stream.push_back(def.lfo_hold);
-        stream.push_back(def.lfo_rate);
-        stream.push_back(def.lfo_depth);
-        stream.push_back(def.lfo2_on ? static_cast<uint8_t>(1) : static_cast<uint8_t>(0));
-        stream.push_back(static_cast<uint8_t>(std::clamp<int>(def.lfo2_wave, 0, 4)));
-        stream.push_back(def.lfo2_hold);
-        stream.push_back(def.lfo2_rate);
-        stream.push_back(def.lfo2_depth);
-        // 0xFB SET_ENV_CURVE (curve_id)
-        stream.push_back(0xFB);
-        stream.push_back(def.env_curve_id);
-        // 0xFC SET_PITCH_CURVE (curve_id)
-        stream.push_back(0xFC);
-        stream.push_back(def.pitch_curve_id);
-        // 0xFD SET_MACRO (macro_id)
-        stream.push_back(0xFD);
-        stream.push_back(def.macro_id);
-    };
-
-    const auto& order = song_->order();
-    if (order.empty()) return result;
-
-    int ticks_per_row = tpr_spin_->value();
-
-    // --- Build streams row by row ---
-
-    for (int ch = 0; ch < 4; ++ch) {
-        auto& stream = result.streams[static_cast<size_t>(ch)];
-        const bool is_noise = (ch == 3);
-
-        int cur_instrument = -1;
-        uint8_t cur_attn = 0xFF; // no override yet
-
-        // Pending state: accumulate durations for same note/silence
-        enum PendingType { PEND_NONE, PEND_NOTE, PEND_SILENCE };
-        PendingType pending = PEND_NONE;
-        uint8_t pending_note_idx = 0;
-        int pending_dur = 0;
-
-        auto flush_pending = [&]() {
-            if (pending_dur <= 0) return;
-            if (pending == PEND_NOTE && pending_note_idx > 0) {
-                append_event(stream, pending_note_idx, pending_dur);
-            } else if (pending == PEND_SILENCE) {
-                append_event(stream, 0xFF, pending_dur);
-            }
-            pending = PEND_NONE;
-            pending_dur = 0;
-        };
-
-        int local_tpr = ticks_per_row;
-
-        for (int ord_pos = 0; ord_pos < static_cast<int>(order.size()); ++ord_pos) {
-            // Record loop point
-            if (ch == 0 || true) { // all channels
-                if (ord_pos == song_->loop_point()) {
-                    flush_pending();
-                    result.loop_offsets[static_cast<size_t>(ch)] = static_cast<uint16_t>(stream.size());
-                }
-            }
-
-            int pat_idx = order[static_cast<size_t>(ord_pos)];
-            TrackerDocument* pat = song_->pattern(pat_idx);
-            if (!pat) continue;
-
-            for (int row = 0; row < pat->length(); ++row) {
-                const TrackerCell& c = pat->cell(ch, row);
-                int dur = local_tpr;
-                PendingType resume_pending = PEND_NONE;
-                uint8_t resume_note_idx = 0;
-                bool resume_after_inline = false;
-                auto flush_pending_inline = [&]() {
-                    if (pending_dur <= 0) {
-                        return;
-                    }
-                    resume_pending = pending;
-                    resume_note_idx = pending_note_idx;
-                    resume_after_inline = true;
-                    flush_pending();
-                };
-
-                // Bxx: speed change
-                if (c.fx == 0xB && c.fx_param > 0) {
-                    local_tpr = c.fx_param;
-                    dur = local_tpr;
-                }
-
-                // Exx: host commands (emit on channel 0 only)
-                if (c.fx == 0xE && ch == 0) {
-                    flush_pending_inline();
-                    uint8_t sub = (c.fx_param >> 4) & 0x0F;
-                    uint8_t val = c.fx_param & 0x0F;
-                    stream.push_back(0xF6); // HOST_CMD
-                    stream.push_back(sub);  // type: 0=fade, 1=tempo
-                    stream.push_back(val);  // data
-                }
-
-                // Fxx: expression (per-channel)
-                if (c.fx == 0xF) {
-                    flush_pending_inline();
-                    uint8_t expr = c.fx_param;
-                    if (expr > 15) expr = 15;
-                    stream.push_back(0xF7); // SET_EXPR
-                    stream.push_back(expr);
-                }
-
-                // 4xx: pitch bend (per-channel, signed byte -> s16 LE)
-                if (c.fx == 0x4) {
-                    flush_pending_inline();
-                    int8_t sb = static_cast<int8_t>(c.fx_param);
-                    int16_t bend = static_cast<int16_t>(sb);
-                    stream.push_back(0xF8); // PITCH_BEND
-                    stream.push_back(static_cast<uint8_t>(bend & 0xFF));
-                    stream.push_back(static_cast<uint8_t>((bend >> 8) & 0xFF));
-                }
-
-                if (c.is_note_on()) {
-                    // Flush any pending note/silence
-                    flush_pending();
-
-                    // Instrument change?
-                    if (static_cast<int>(c.instrument) != cur_instrument) {
-                        cur_instrument = c.instrument;
-                        emit_instrument(stream, cur_instrument);
-                    }
-
-                    // Attn override?
-                    if (c.attn != 0xFF) {
-                        stream.push_back(0xF0);
-                        stream.push_back(static_cast<uint8_t>(c.attn & 0x0F));
-                        cur_attn = c.attn;
-                    }
-
-                    // Compute note index
-                    uint8_t note_idx;
-                    if (is_noise) {
-                        note_idx = static_cast<uint8_t>((TrackerPlaybackEngine::midi_note_to_noise_val(c.note) & 0x07) + 1);
-                    } else {
-                        uint16_t div = TrackerPlaybackEngine::midi_to_divider(c.note);
-                        note_idx = static_cast<uint8_t>(find_or_add_divider(div) + 1);
-                    }
-
-                    // Handle Cxx (note cut)
-                    if (c.fx == 0xC) {
-                        int cut = std::min(static_cast<int>(c.fx_param), dur);
-                        if (cut > 0) {
-                            append_event(stream, note_idx, cut);
-                        }
-                        int rest = dur - cut;
-                        if (rest > 0) {
-                            pending = PEND_SILENCE;
-                            pending_dur = rest;
-                        }
-                    }
-                    // Handle Dxx (note delay)
-                    else if (c.fx == 0xD) {
-                        int delay = std::min(static_cast<int>(c.fx_param), dur);
-                        if (delay > 0) {
-                            append_event(stream, 0xFF, delay);
-                        }
-                        int rest = dur - delay;
-                        if (rest > 0) {
-                            pending = PEND_NOTE;
-                            pending_note_idx = note_idx;
-                            pending_dur = rest;
-                        }
-                    }
-                    else {
-                        pending = PEND_NOTE;
-                        pending_note_idx = note_idx;
-                        pending_dur = dur;
-                    }
-                }
-                else if (c.is_note_off()) {
-                    flush_pending();
-                    pending = PEND_SILENCE;
-                    pending_dur = dur;
-                }
-                else {
-                    // Empty row or effect-only row
-                    // Attn change on empty row: emit inline
-                    if (c.attn != 0xFF && c.attn != cur_attn) {
-                        flush_pending_inline();
-                        stream.push_back(0xF0);
-                        stream.push_back(static_cast<uint8_t>(c.attn & 0x0F));
-                        cur_attn = c.attn;
-                        // Restart same state (the note/silence continues)
-                    }
-                    if (resume_after_inline && pending == PEND_NONE) {
-                        pending = resume_pending;
-                        pending_note_idx = resume_note_idx;
-                    }
-                    // Accumulate duration
-                    if (pending == PEND_NONE) {
-                        // No note was playing → silence
-                        pending = PEND_SILENCE;
-                        pending_dur = dur;
-                    } else {
-                        pending_dur += dur;
-                    }
-                }
-            }
-        }
-
-        // Flush remaining
-        flush_pending();
-
-        // End marker
-        stream.push_back(0x00);
-    }
-
-    if (note_table.empty()) note_table.push_back(1);
-
-    return result;
-}
-
 bool TrackerTab::export_song_to_path(const QString& path,
                                      bool asm_export,
                                      bool include_instrument_export,
@@ -3096,121 +2441,24 @@ bool TrackerTab::export_song_to_path(const QString& path,
         return false;
     }
 
-    const int mode_index = (forced_export_mode >= 0)
-                               ? forced_export_mode
-                               : (export_mode_combo_ ? export_mode_combo_->currentIndex() : 0);
-    const bool hybrid = (mode_index == 1);
-    const auto es = hybrid ? build_export_streams_hybrid(instrument_remap) : build_export_streams();
-    if (es.note_table.empty()) {
+    if (!song_) {
         if (error) *error = "Nothing to export";
         return false;
     }
 
-    const QStringList warnings = audit_song_for_export(song_, store_, hybrid);
-    const char* mode_label = hybrid ? "Hybrid" : "Pre-baked";
-    std::ostringstream out;
-
-    if (!asm_export) {
-        out << "/* Generated by NGPC Sound Creator - " << mode_label << " Export */\n";
-        out << "/* BGM_CHN noise format: val = stream_byte - 1 (0-7)        */\n";
-        out << "/*   rate = val & 0x03 (0=H,1=M,2=L,3=Tone2)               */\n";
-        out << "/*   type = (val >> 2) & 0x01 (0=Periodic,1=White)          */\n";
-        for (const QString& w : warnings) {
-            const QByteArray wb = w.toUtf8();
-            out << "/* WARN export: " << wb.constData() << " */\n";
-        }
-        out << "\n";
-
-        auto write_u8_array = [&](const char* name, const std::vector<uint8_t>& values) {
-            out << "const unsigned char " << name << "[] = {\n";
-            if (values.empty()) {
-                out << "    0x00\n";
-            } else {
-                for (size_t i = 0; i < values.size(); ++i) {
-                    if ((i % 12) == 0) out << "    ";
-                    out << static_cast<int>(values[i]);
-                    if (i + 1 < values.size()) out << ", ";
-                    if ((i % 12) == 11 || i + 1 == values.size()) out << "\n";
-                }
-            }
-            out << "};\n\n";
-        };
-
-        std::vector<uint8_t> note_table_bytes;
-        note_table_bytes.reserve(es.note_table.size() * 2);
-        for (uint16_t d : es.note_table) {
-            note_table_bytes.push_back(static_cast<uint8_t>(d & 0x0F));
-            note_table_bytes.push_back(static_cast<uint8_t>((d >> 4) & 0x3F));
-        }
-        write_u8_array("NOTE_TABLE", note_table_bytes);
-        out << "const unsigned short BGM_CH0_LOOP = " << es.loop_offsets[0] << ";\n";
-        out << "const unsigned short BGM_CH1_LOOP = " << es.loop_offsets[1] << ";\n";
-        out << "const unsigned short BGM_CH2_LOOP = " << es.loop_offsets[2] << ";\n";
-        out << "const unsigned short BGM_CHN_LOOP = " << es.loop_offsets[3] << ";\n\n";
-        write_u8_array("BGM_CH0", es.streams[0]);
-        write_u8_array("BGM_CH1", es.streams[1]);
-        write_u8_array("BGM_CH2", es.streams[2]);
-        write_u8_array("BGM_CHN", es.streams[3]);
-        out << "const unsigned char BGM_MONO[] = { 0x00 };\n";
-    } else {
-        out << "; Generated by NGPC Sound Creator - " << mode_label << " ASM Export\n";
-        out << "; Format: TLCS-900H / SNK NGPC toolchain (.inc)\n";
-        out << "; BGM_CHN noise: val = byte - 1 (0-7)\n";
-        out << ";   rate = val & 0x03 (0=H,1=M,2=L,3=Tone2)\n";
-        out << ";   type = (val >> 2) & 0x01 (0=Periodic,1=White)\n";
-        for (const QString& w : warnings) {
-            const QByteArray wb = w.toUtf8();
-            out << "; WARN export: " << wb.constData() << "\n";
-        }
-        out << "\n";
-
-        auto write_db_array = [&](const char* label, const std::vector<uint8_t>& values) {
-            out << label << ":\n";
-            for (size_t i = 0; i < values.size(); ++i) {
-                if ((i % 12) == 0) out << "        .db     ";
-                char hex[8];
-                std::snprintf(hex, sizeof(hex), "0x%02X", values[i]);
-                out << hex;
-                if ((i % 12) == 11 || i + 1 == values.size()) {
-                    out << "\n";
-                } else {
-                    out << ", ";
-                }
-            }
-            out << "\n";
-        };
-
-        auto write_dw = [&](const char* label, uint16_t value) {
-            char hex[8];
-            std::snprintf(hex, sizeof(hex), "0x%04X", value);
-            out << label << ":\n        .dw     " << hex << "\n\n";
-        };
-
-        std::vector<uint8_t> note_table_bytes;
-        note_table_bytes.reserve(es.note_table.size() * 2);
-        for (uint16_t d : es.note_table) {
-            note_table_bytes.push_back(static_cast<uint8_t>(d & 0x0F));
-            note_table_bytes.push_back(static_cast<uint8_t>((d >> 4) & 0x3F));
-        }
-        write_db_array("NOTE_TABLE", note_table_bytes);
-        write_dw("BGM_CH0_LOOP", es.loop_offsets[0]);
-        write_dw("BGM_CH1_LOOP", es.loop_offsets[1]);
-        write_dw("BGM_CH2_LOOP", es.loop_offsets[2]);
-        write_dw("BGM_CHN_LOOP", es.loop_offsets[3]);
-        write_db_array("BGM_CH0", es.streams[0]);
-        write_db_array("BGM_CH1", es.streams[1]);
-        write_db_array("BGM_CH2", es.streams[2]);
-        write_db_array("BGM_CHN", es.streams[3]);
-        out << "BGM_MONO:\n        .db     0x00\n";
-    }
-
-    QFile file(path);
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        if (error) *error = QString("Could not write %1").arg(path);
+    const int mode_index = (forced_export_mode >= 0)
+                               ? forced_export_mode
+                               : (export_mode_combo_ ? export_mode_combo_->currentIndex() : 0);
+    SongExporter::Settings settings;
+    settings.hybrid = (mode_index == 1);
+    settings.ticks_per_row = tpr_spin_->value();
+    settings.asm_export = asm_export;
+    settings.instrument_remap = instrument_remap;
+    const SongExporter::Result res = SongExporter::export_to_path(path, *song_, store_, settings);
+    if (!res.ok) {
+        if (error) *error = res.error;
         return false;
     }
-    file.write(QString::fromStdString(out.str()).toUtf8());
-    file.close();
 
     QString inst_path;
     if (include_instrument_export && store_) {
@@ -3233,17 +2481,14 @@ bool TrackerTab::export_song_to_path(const QString& path,
         *instrument_export_path = inst_path;
     }
 
-    int total_bytes = 0;
-    for (int ch = 0; ch < 4; ++ch) {
-        total_bytes += static_cast<int>(es.streams[static_cast<size_t>(ch)].size());
-    }
-    append_log(QString("%1 %2 export: %3 notes, %4 stream bytes, saved to %5.")
-                   .arg(mode_label)
+    append_log(QString("%1 %2 export: %3 notes, %4 stream bytes (%5 before compression), saved to %6.")
+                   .arg(settings.hybrid ? "Hybrid" : "Pre-baked")
                    .arg(asm_export ? "ASM" : "C")
-                   .arg(es.note_table.size())
-                   .arg(total_bytes)
+                   .arg(res.note_count)
+                   .arg(res.stream_bytes)
+                   .arg(res.raw_stream_bytes)
                    .arg(QFileInfo(path).fileName()));
-    for (const QString& w : warnings) {
+    for (const QString& w : res.warnings) {
         append_log(QString("WARN export: %1").arg(w));
     }
     if (!inst_path.isEmpty()) {
@@ -3289,7 +2534,10 @@ void TrackerTab::switch_to_pattern(int index) {
     song_->set_active_pattern(index);
     doc_ = song_->active_pattern();
     grid_->set_document(doc_);
-    engine_->set_document(doc_);
+    if (!playing_) {
+        // While playing, the sequencer owns the engine's document.
+        engine_->set_document(doc_);
+    }
     length_spin_->blockSignals(true);
     length_spin_->setValue(doc_->length());
     length_spin_->blockSignals(false);
@@ -3328,33 +2576,10 @@ void TrackerTab::refresh_order_list() {
     order_list_->blockSignals(false);
 }
 
-void TrackerTab::on_pattern_finished() {
-    if (!song_mode_) {
-        // Single-pattern mode: engine already wrapped to row 0
-        return;
-    }
-
-    // Song mode: advance to next order entry
-    song_order_pos_++;
-    if (song_order_pos_ >= song_->order_length()) {
-        // Reached end of order list: loop back to loop_point
-        song_order_pos_ = song_->loop_point();
-    }
-
-    const auto& ord = song_->order();
-    int pat_idx = ord[static_cast<size_t>(song_order_pos_)];
-
-    // Switch the engine to the new pattern
-    TrackerDocument* new_doc = song_->pattern(pat_idx);
-    if (!new_doc) {
-        stop_playback();
-        return;
-    }
-
-    engine_->set_document(new_doc);
-    engine_->start(0);  // start from row 0 of new pattern
-
-    // Update grid to show current playback pattern
+void TrackerTab::on_song_pattern_switched(int order_pos, int pat_idx) {
+    // The sequencer already moved the engine to the new pattern; this is the UI
+    // catching up once the switch has been posted from the render loop.
+    song_order_pos_ = order_pos;
     if (follow_mode_) {
         switch_to_pattern(pat_idx);
     }
@@ -3379,22 +2604,20 @@ void TrackerTab::start_song_playback() {
         return;
     }
 
-    song_mode_ = true;
-    song_order_pos_ = 0;
-    playing_ = true;
-
     // Start with the first pattern in the order
     const auto& ord = song_->order();
     int pat_idx = ord[0];
-    TrackerDocument* start_doc = song_->pattern(pat_idx);
-    if (!start_doc) {
-        stop_playback();
+    if (!song_->pattern(pat_idx)) {
         return;
     }
 
-    engine_->set_document(start_doc);
+    song_mode_ = true;
+    song_order_pos_ = 0;
+    playing_ = true;
+
     engine_->set_ticks_per_row(tpr_spin_->value());
-    engine_->start(0);
+    sequencer_->start_song(0);
+    attach_sequencer();
 
     if (follow_mode_) {
         switch_to_pattern(pat_idx);
@@ -3535,5 +2758,13 @@ bool TrackerTab::import_midi_from_path(const QString& path, QString* error) {
 
     append_log(QString("MIDI imported: %1 patterns, %2 notes (%3 dropped due to polyphony)")
         .arg(res.patterns_created).arg(res.notes_imported).arg(res.notes_dropped));
+    if (res.patterns_reused > 0) {
+        append_log(QString("Order: %1 entries, %2 reuse an identical pattern")
+            .arg(song_->order_length()).arg(res.patterns_reused));
+    }
+    if (res.truncated) {
+        append_log(QString("Warning: MIDI truncated (max %1 patterns / %2 order entries)")
+            .arg(SongDocument::kMaxPatterns).arg(SongDocument::kMaxOrderLength));
+    }
     return true;
 }
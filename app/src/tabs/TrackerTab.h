@@ -3,6 +3,7 @@
 #include <QWidget>
 
 #include <array>
+#include <memory>
 #include <vector>
 
 #include "models/TrackerDocument.h"
@@ -20,6 +21,7 @@ class InstrumentStore;
 class SongDocument;
 class TrackerGridWidget;
 class TrackerPlaybackEngine;
+class TrackerSequencer;
 class InstrumentPlayer;
 
 class TrackerTab : public QWidget
@@ -33,6 +35,7 @@ public:
     bool load_song_from_path(const QString& path, QString* error = nullptr);
     bool import_midi_from_path(const QString& path, QString* error = nullptr);
     std::array<bool, 128> collect_used_instruments() const;
+    int ticks_per_row() const;
     bool export_song_to_path(const QString& path,
                              bool asm_export,
                              bool include_instrument_export,
@@ -54,6 +57,7 @@ private:
     TrackerDocument* doc_ = nullptr;        // convenience: song_->active_pattern()
     TrackerGridWidget* grid_ = nullptr;
     TrackerPlaybackEngine* engine_ = nullptr;
+    std::shared_ptr<TrackerSequencer> sequencer_;   // ticks engine_ from the audio clock
     InstrumentPlayer* preview_player_ = nullptr;
     QPlainTextEdit* log_ = nullptr;
 
@@ -74,6 +78,7 @@ private:
     QPushButton* pat_add_btn_ = nullptr;
     QPushButton* pat_clone_btn_ = nullptr;
     QPushButton* pat_del_btn_ = nullptr;
+    QPushButton* pat_compact_btn_ = nullptr;
     QListWidget* order_list_ = nullptr;
     QPushButton* ord_add_btn_ = nullptr;
     QPushButton* ord_del_btn_ = nullptr;
@@ -109,7 +114,7 @@ private:
     std::array<QPushButton*, 4> solo_btns_{};
     int solo_channel_ = -1;
 
-    // Playback state
+    // Playback state (play_timer_ only drains sequencer events for the UI)
     QTimer* play_timer_ = nullptr;
     bool playing_ = false;
     int preview_note_token_ = 0;
@@ -127,8 +132,8 @@ private:
     void start_loop_selection();
     void start_song_playback();
     void stop_playback();
+    void attach_sequencer();
     void on_tick();
-    void write_voices_to_psg();
     void silence_all();
     void update_mute_state();
     void append_log(const QString& text);
@@ -141,7 +146,7 @@ private:
     void switch_to_pattern(int index);
     void refresh_pattern_ui();
     void refresh_order_list();
-    void on_pattern_finished();
+    void on_song_pattern_switched(int order_pos, int pat_idx);
 
     // Signal handlers
     void on_note_entered(int ch, int row, uint8_t note);
@@ -158,14 +163,4 @@ private:
 
     // Helpers
     void preview_note(uint8_t midi_note, int ch);
-
-    // Pre-baked export (tick-by-tick simulation with effects + instruments)
-    struct ExportStreams {
-        std::vector<uint16_t> note_table;            // divider values
-        std::array<std::vector<uint8_t>, 4> streams;  // 4 channel streams
-        std::array<uint16_t, 4> loop_offsets;         // byte offset of loop point per channel
-    };
-    ExportStreams build_export_streams() const;         // pre-baked (tick-by-tick)
-    ExportStreams build_export_streams_hybrid(
-        const std::array<uint8_t, 128>* instrument_remap = nullptr) const;  // hybrid (row-based + instrument opcodes)
 };
@@ -0,0 +1,84 @@
+#pragma once
+
+// Deterministic synthetic type-1 MIDI file for the converter and parser
+// benchmarks: a tempo track with a few tempo changes, three melodic tracks
+// with occasional chords (so voice stealing happens) and a channel-10 drum
+// track.
+
+#include <cstdint>
+#include <vector>
+
+#include "bench_song.h"
+
+namespace bench {
+
+inline void PutVlq(std::vector<uint8_t>& out, uint32_t v) {
+    uint8_t buf[5];
+    int n = 0;
+    buf[n++] = static_cast<uint8_t>(v & 0x7F);
+    while (v >>= 7) {
+        buf[n++] = static_cast<uint8_t>(0x80 | (v & 0x7F));
+    }
+    while (n > 0) {
+        out.push_back(buf[--n]);
+    }
+}
+
+inline void PutTrack(std::vector<uint8_t>& file, const std::vector<uint8_t>& body) {
+    const uint32_t len = static_cast<uint32_t>(body.size());
+    file.insert(file.end(), {'M', 'T', 'r', 'k', static_cast<uint8_t>(len >> 24), static_cast<uint8_t>(len >> 16),
+                             static_cast<uint8_t>(len >> 8), static_cast<uint8_t>(len)});
+    file.insert(file.end(), body.begin(), body.end());
+}
+
+// `beats` beats at 480 ticks per beat.
+inline std::vector<uint8_t> MakeMidi(uint32_t seed, int beats) {
+    constexpr uint32_t kTpb = 480;
+    Lcg rng(seed);
+    std::vector<uint8_t> file = {'M', 'T', 'h', 'd', 0, 0, 0, 6, 0, 1, 0, 5,
+                                 static_cast<uint8_t>(kTpb >> 8), static_cast<uint8_t>(kTpb & 0xFF)};
+
+    std::vector<uint8_t> tempo;
+    for (int b = 0; b < beats; b += 64) {
+        const uint32_t us = static_cast<uint32_t>(rng.range(350000, 650000));
+        PutVlq(tempo, b == 0 ? 0 : 64 * kTpb);
+        tempo.insert(tempo.end(), {0xFF, 0x51, 0x03, static_cast<uint8_t>(us >> 16),
+                                   static_cast<uint8_t>(us >> 8), static_cast<uint8_t>(us)});
+    }
+    tempo.insert(tempo.end(), {0x00, 0xFF, 0x2F, 0x00});
+    PutTrack(file, tempo);
+
+    for (int t = 0; t < 4; ++t) {
+        const bool drums = (t == 3);
+        const uint8_t ch = drums ? 9 : static_cast<uint8_t>(t);
+        std::vector<uint8_t> body;
+        PutVlq(body, 0);
+        body.insert(body.end(), {static_cast<uint8_t>(0xC0 | ch), static_cast<uint8_t>(rng.range(0, 80))});
+        uint32_t pending = 0;
+        for (uint32_t tick = 0; tick < static_cast<uint32_t>(beats) * kTpb;) {
+            const uint32_t len = kTpb / 4 * static_cast<uint32_t>(rng.range(1, drums ? 2 : 6));
+            // Melodic tracks play two-note chords now and then, so the three
+            // tracks overrun the three tone voices.
+            const int keys = (!drums && rng.range(0, 2) == 0) ? 2 : 1;
+            uint8_t key[2];
+            for (int k = 0; k < keys; ++k) {
+                key[k] = static_cast<uint8_t>(drums ? rng.range(35, 59) : rng.range(40 + t * 8, 64 + t * 8));
+                PutVlq(body, k == 0 ? pending : 0);
+                body.insert(body.end(), {static_cast<uint8_t>(0x90 | ch), key[k],
+                                         static_cast<uint8_t>(rng.range(30, 127))});
+            }
+            const uint32_t gate = drums ? len / 2 : len;
+            for (int k = 0; k < keys; ++k) {
+                PutVlq(body, k == 0 ? gate : 0);
+                body.insert(body.end(), {static_cast<uint8_t>(0x80 | ch), key[k], 0x40});
+            }
+            pending = len - gate;
+            tick += len;
+        }
+        body.insert(body.end(), {0x00, 0xFF, 0x2F, 0x00});
+        PutTrack(file, body);
+    }
+    return file;
+}
+
+}  // namespace bench
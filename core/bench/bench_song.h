@@ -0,0 +1,136 @@
+#pragma once
+
+// Deterministic synthetic BGM song for the native driver benchmarks: four
+// looping streams in the sounds.c stream format that exercise notes, rests
+// and every effect opcode the driver and BgmVoiceBank both implement.
+// Instrument, curve and macro opcodes are left out on purpose: their ids index
+// tables that are compiled into sounds.c and edited per project.
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace bench {
+
+struct Song {
+    std::vector<uint8_t> note_table;  // NOTE_TABLE (lo, hi) pairs
+    std::array<std::vector<uint8_t>, 4> streams;
+    std::array<uint16_t, 4> loops{};
+};
+
+class Lcg {
+public:
+    explicit Lcg(uint32_t seed) : state_(seed ? seed : 1u) {}
+    uint32_t next() {
+        state_ = state_ * 1664525u + 1013904223u;
+        return state_ >> 8;
+    }
+    int range(int lo, int hi) { return lo + static_cast<int>(next() % static_cast<uint32_t>(hi - lo + 1)); }
+
+private:
+    uint32_t state_;
+};
+
+inline std::vector<uint8_t> MakeNoteTable() {
+    // Note 1 = A2, semitone steps, divider = 3072000 / (32 * f).
+    std::vector<uint8_t> table;
+    for (int i = 0; i < 51; ++i) {
+        const double freq = 110.0 * std::pow(2.0, i / 12.0);
+        int div = static_cast<int>(std::lround(96000.0 / freq));
+        if (div < 1) div = 1;
+        if (div > 1023) div = 1023;
+        table.push_back(static_cast<uint8_t>(div & 0x0F));
+        table.push_back(static_cast<uint8_t>((div >> 4) & 0x3F));
+    }
+    return table;
+}
+
+inline void EmitOpcode(Lcg& rng, bool noise, std::vector<uint8_t>& out) {
+    switch (rng.range(0, noise ? 3 : 10)) {
+    case 0:  // SET_ATTN
+        out.insert(out.end(), {0xF0, static_cast<uint8_t>(rng.range(0, 15))});
+        break;
+    case 1:  // SET_ENV
+        out.insert(out.end(), {0xF1, static_cast<uint8_t>(rng.range(0, 4)),
+                               static_cast<uint8_t>(rng.range(1, 10))});
+        break;
+    case 2:  // SET_ADSR
+        out.insert(out.end(), {0xF9, static_cast<uint8_t>(rng.range(0, 3)),
+                               static_cast<uint8_t>(rng.range(0, 4)),
+                               static_cast<uint8_t>(rng.range(0, 15)),
+                               static_cast<uint8_t>(rng.range(0, 6))});
+        break;
+    case 3:  // SET_EXPR
+        out.insert(out.end(), {0xF7, static_cast<uint8_t>(rng.range(0, 6))});
+        break;
+    case 4:  // SET_VIB
+        out.insert(out.end(), {0xF2, static_cast<uint8_t>(rng.range(0, 6)),
+                               static_cast<uint8_t>(rng.range(1, 8)),
+                               static_cast<uint8_t>(rng.range(0, 12))});
+        break;
+    case 5: {  // SET_SWEEP
+        const int end = rng.range(1, 1023);
+        out.insert(out.end(), {0xF3, static_cast<uint8_t>(end & 0xFF), static_cast<uint8_t>(end >> 8),
+                               static_cast<uint8_t>(static_cast<int8_t>(rng.range(-8, 8))),
+                               static_cast<uint8_t>(rng.range(1, 6))});
+        break;
+    }
+    case 6: {  // PITCH_BEND
+        const int bend = rng.range(-40, 40);
+        out.insert(out.end(), {0xF8, static_cast<uint8_t>(bend & 0xFF),
+                               static_cast<uint8_t>((bend >> 8) & 0xFF)});
+        break;
+    }
+    case 7:  // SET_LFO
+        out.insert(out.end(), {0xFA, static_cast<uint8_t>(rng.range(0, 4)),
+                               static_cast<uint8_t>(rng.range(0, 6)),
+                               static_cast<uint8_t>(rng.range(0, 12))});
+        break;
+    case 8:  // EXT ADSR5
+        out.insert(out.end(), {0xFE, 0x01, static_cast<uint8_t>(rng.range(0, 3)),
+                               static_cast<uint8_t>(rng.range(0, 4)),
+                               static_cast<uint8_t>(rng.range(0, 15)),
+                               static_cast<uint8_t>(rng.range(0, 8)),
+                               static_cast<uint8_t>(rng.range(0, 6))});
+        break;
+    default:  // EXT MOD2
+        out.insert(out.end(), {0xFE, 0x02, static_cast<uint8_t>(rng.range(0, 7)),
+                               static_cast<uint8_t>(rng.range(0, 1)),
+                               static_cast<uint8_t>(rng.range(0, 4)),
+                               static_cast<uint8_t>(rng.range(0, 10)),
+                               static_cast<uint8_t>(rng.range(0, 6)),
+                               static_cast<uint8_t>(rng.range(0, 12)),
+                               static_cast<uint8_t>(rng.range(0, 1)),
+                               static_cast<uint8_t>(rng.range(0, 4)),
+                               static_cast<uint8_t>(rng.range(0, 10)),
+                               static_cast<uint8_t>(rng.range(0, 6)),
+                               static_cast<uint8_t>(rng.range(0, 12))});
+        break;
+    }
+}
+
+inline Song MakeSong(uint32_t seed, int events_per_voice) {
+    Song song;
+    song.note_table = MakeNoteTable();
+    Lcg rng(seed);
+    for (int v = 0; v < 4; ++v) {
+        const bool noise = (v == 3);
+        auto& s = song.streams[static_cast<size_t>(v)];
+        for (int e = 0; e < events_per_voice; ++e) {
+            if (rng.range(0, 3) == 0) {
+                EmitOpcode(rng, noise, s);
+            }
+            if (rng.range(0, 5) == 0) {
+                s.insert(s.end(), {0xFF, static_cast<uint8_t>(rng.range(1, 12))});
+            } else {
+                const int note = noise ? rng.range(1, 8) : rng.range(1, 51);
+                s.insert(s.end(), {static_cast<uint8_t>(note), static_cast<uint8_t>(rng.range(1, 24))});
+            }
+        }
+        s.push_back(0x00);
+    }
+    return song;
+}
+
+}  // namespace bench
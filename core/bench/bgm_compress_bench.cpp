@@ -0,0 +1,200 @@
+// Stream subroutines: a song built from repeated phrases is compressed with
+// CompressBgmStreams(), then both versions are played through BgmStreamPlayer
+// and through the shipping driver (NativeSounds). Voice output and PSG bytes
+// must match frame for frame. The packed song is also played from an .ngpb
+// container (FormatBgmBinary / ParseBgmBinary) without copying it.
+//
+// usage: ngpc_bgm_compress_bench [phrases_per_voice] [frames]
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "bench_song.h"
+#include "ngpc/bgm_binary.h"
+#include "ngpc/bgm_compress.h"
+#include "ngpc/bgm_stream.h"
+#include "ngpc/native_sounds.h"
+
+namespace {
+
+constexpr int kPhrases = 6;
+
+// Tracker-like voice: a few short phrases, replayed in a pattern order with
+// back-to-back repeats. The loop point sits at the start of the third phrase.
+bench::Song MakePhraseSong(uint32_t seed, int phrases_per_voice) {
+    bench::Song song;
+    song.note_table = bench::MakeNoteTable();
+    bench::Lcg rng(seed);
+    for (int v = 0; v < 4; ++v) {
+        const bool noise = (v == 3);
+        std::array<std::vector<uint8_t>, kPhrases> phrases;
+        for (auto& p : phrases) {
+            const int events = rng.range(4, 16);
+            for (int e = 0; e < events; ++e) {
+                if (rng.range(0, 5) == 0) {
+                    bench::EmitOpcode(rng, noise, p);
+                }
+                if (rng.range(0, 5) == 0) {
+                    p.insert(p.end(), {0xFF, static_cast<uint8_t>(rng.range(1, 12))});
+                } else {
+                    const int note = noise ? rng.range(1, 8) : rng.range(1, 51);
+                    p.insert(p.end(), {static_cast<uint8_t>(note), static_cast<uint8_t>(rng.range(1, 12))});
+                }
+            }
+        }
+        auto& s = song.streams[static_cast<size_t>(v)];
+        for (int i = 0; i < phrases_per_voice; ++i) {
+            if (i == 2) {
+                song.loops[static_cast<size_t>(v)] = static_cast<uint16_t>(s.size());
+            }
+            const auto& p = phrases[static_cast<size_t>(rng.range(0, kPhrases - 1))];
+            const int repeats = rng.range(0, 2) == 0 ? rng.range(2, 4) : 1;
+            for (int r = 0; r < repeats; ++r) {
+                s.insert(s.end(), p.begin(), p.end());
+            }
+        }
+        s.push_back(0x00);
+    }
+    return song;
+}
+
+using Snapshot = std::array<uint16_t, 9>;
+
+std::vector<Snapshot> Play(ngpc::BgmStreamPlayer& player, int frames) {
+    std::vector<Snapshot> out;
+    for (int f = 0; f < frames; ++f) {
+        player.step();
+        Snapshot s{};
+        const ngpc::BgmVoiceBank& voices = player.voices();
+        for (int v = 0; v < 4; ++v) {
+            const bool on = voices.active(v);
+            s[static_cast<size_t>(v * 2)] = on ? voices.output_divider(v) : 0;
+            s[static_cast<size_t>(v * 2 + 1)] = on ? voices.output_attn(v, player.fade_attn()) : 0x10;
+        }
+        s[8] = player.fade_attn();
+        out.push_back(s);
+    }
+    return out;
+}
+
+std::vector<Snapshot> PlayTool(const bench::Song& song, int frames) {
+    ngpc::BgmStreamPlayer player;
+    std::string error;
+    if (!player.load(song.note_table, song.streams, song.loops, &error)) {
+        std::fprintf(stderr, "load: %s\n", error.c_str());
+        return {};
+    }
+    return Play(player, frames);
+}
+
+std::vector<Snapshot> PlayBinary(const std::vector<uint8_t>& file, int frames) {
+    ngpc::BgmBinaryView view;
+    ngpc::BgmStreamPlayer player;
+    std::string error;
+    if (!ngpc::ParseBgmBinary(file.data(), file.size(), &view, &error) ||
+        !player.load(view.note_table, view.streams, view.loop_offsets, &error)) {
+        std::fprintf(stderr, "binary: %s\n", error.c_str());
+        return {};
+    }
+    return Play(player, frames);
+}
+
+std::vector<std::vector<uint8_t>> PlayDriver(const bench::Song& song, int frames) {
+    ngpc::NativeSounds& snd = ngpc::NativeSounds::instance();
+    std::vector<std::vector<uint8_t>> out;
+    snd.init();
+    std::string error;
+    if (!snd.start_bgm(song.note_table, song.streams, song.loops, &error)) {
+        std::fprintf(stderr, "start_bgm: %s\n", error.c_str());
+        return out;
+    }
+    for (int f = 0; f < frames; ++f) {
+        snd.clear_psg_writes();
+        snd.update();
+        out.push_back(snd.psg_writes());
+    }
+    snd.stop_bgm();
+    return out;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const int phrases = (argc > 1) ? std::atoi(argv[1]) : 64;
+    const int frames = (argc > 2) ? std::atoi(argv[2]) : 20000;
+    const bench::Song song = MakePhraseSong(11u, phrases);
+
+    ngpc::BgmExportStreams es;
+    es.streams = song.streams;
+    es.loop_offsets = song.loops;
+    const auto start = std::chrono::steady_clock::now();
+    const ngpc::BgmCompressStats stats = ngpc::CompressBgmStreams(&es);
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    bench::Song packed = song;
+    packed.streams = es.streams;
+    packed.loops = es.loop_offsets;
+    for (size_t v = 0; v < 4; ++v) {
+        std::printf("ch%zu: %5zu -> %5zu bytes (loop %u -> %u)\n", v, stats.bytes_before[v], stats.bytes_after[v],
+                    song.loops[v], packed.loops[v]);
+    }
+    std::printf("total %zu -> %zu bytes (%.1f%%), %d subroutines, %d calls, %.2f ms\n", stats.total_before(),
+                stats.total_after(), 100.0 * static_cast<double>(stats.total_after()) /
+                                         static_cast<double>(std::max<size_t>(stats.total_before(), 1)),
+                stats.subroutines, stats.calls, ms);
+
+    ngpc::BgmExportStreams es_bin = es;
+    es_bin.note_table.clear();
+    for (size_t i = 0; i + 1 < song.note_table.size(); i += 2) {
+        es_bin.note_table.push_back(static_cast<uint16_t>(song.note_table[i] | (song.note_table[i + 1] << 4)));
+    }
+    const std::vector<uint8_t> file = ngpc::FormatBgmBinary(es_bin);
+    std::printf("ngpb container: %zu bytes\n", file.size());
+
+    const auto tool_ref = PlayTool(song, frames);
+    const auto tool_packed = PlayTool(packed, frames);
+    const auto tool_binary = PlayBinary(file, frames);
+    int tool_mismatch = -1;
+    for (size_t f = 0; f < tool_ref.size() && f < tool_packed.size(); ++f) {
+        if (tool_ref[f] != tool_packed[f]) {
+            tool_mismatch = static_cast<int>(f);
+            break;
+        }
+    }
+    const bool binary_ok = tool_binary == tool_packed;
+    const auto driver_ref = PlayDriver(song, frames);
+    const auto driver_packed = PlayDriver(packed, frames);
+    int driver_mismatch = -1;
+    for (size_t f = 0; f < driver_ref.size() && f < driver_packed.size(); ++f) {
+        if (driver_ref[f] != driver_packed[f]) {
+            driver_mismatch = static_cast<int>(f);
+            break;
+        }
+    }
+    const bool sizes_ok = tool_ref.size() == static_cast<size_t>(frames) &&
+                          tool_packed.size() == tool_ref.size() &&
+                          driver_ref.size() == static_cast<size_t>(frames) &&
+                          driver_packed.size() == driver_ref.size() &&
+                          tool_binary.size() == tool_ref.size();
+    if (!sizes_ok) {
+        std::printf("FAIL: playback did not start\n");
+        return 1;
+    }
+    if (tool_mismatch >= 0 || driver_mismatch >= 0) {
+        std::printf("FAIL: BgmStreamPlayer first differs at frame %d, driver at frame %d\n", tool_mismatch,
+                    driver_mismatch);
+        return 1;
+    }
+    if (!binary_ok) {
+        std::printf("FAIL: .ngpb playback differs from the packed song\n");
+        return 1;
+    }
+    std::printf("OK: %d frames identical in BgmStreamPlayer, .ngpb and sounds.c\n", frames);
+    return 0;
+}
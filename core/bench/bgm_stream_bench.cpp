@@ -0,0 +1,124 @@
+// BgmStreamPlayer seek index: random seeks against a straight replay from
+// frame 0, checked for identical voice output and timed. Streams whose loop
+// never reaches a note or rest must make load() fail rather than hang.
+//
+// usage: ngpc_bgm_stream_bench [seeks] [events_per_voice]
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "bench_song.h"
+#include "ngpc/bgm_stream.h"
+
+namespace {
+
+// Divider and attenuation of every voice plus the fade level, as step() would
+// write them.
+using Snapshot = std::array<uint16_t, 9>;
+
+Snapshot Capture(const ngpc::BgmStreamPlayer& player) {
+    Snapshot s{};
+    const ngpc::BgmVoiceBank& voices = player.voices();
+    for (int v = 0; v < 4; ++v) {
+        const bool on = voices.active(v);
+        s[static_cast<size_t>(v * 2)] = on ? voices.output_divider(v) : 0;
+        s[static_cast<size_t>(v * 2 + 1)] = on ? voices.output_attn(v, player.fade_attn()) : 0x10;
+    }
+    s[8] = player.fade_attn();
+    return s;
+}
+
+}  // namespace
+
+// Loops of opcodes only, or of a bare end marker: the driver spins on them.
+bool RefusesRunawayLoops(const std::vector<uint8_t>& note_table) {
+    const struct {
+        std::vector<uint8_t> stream;
+        uint16_t loop;
+    } cases[] = {
+        {{0x01, 0x04, 0xF0, 0x05}, 2},
+        {{0x01, 0x04, 0x00}, 2},
+        {{0x01, 0x04, 0xF0, 0x05, 0xF0, 0x06}, 2},
+    };
+    for (const auto& c : cases) {
+        ngpc::BgmStreamPlayer player;
+        std::array<std::vector<uint8_t>, ngpc::BgmStreamPlayer::kVoices> streams{};
+        std::array<uint16_t, ngpc::BgmStreamPlayer::kVoices> loops{};
+        streams[0] = c.stream;
+        loops[0] = c.loop;
+        std::string error;
+        if (player.load(note_table, streams, loops, &error) || error.empty()) {
+            std::printf("FAIL: a stream looping without a note loaded\n");
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    const int seeks = (argc > 1) ? std::atoi(argv[1]) : 2000;
+    const int events = (argc > 2) ? std::atoi(argv[2]) : 2000;
+    const bench::Song song = bench::MakeSong(7u, events);
+    if (!RefusesRunawayLoops(song.note_table)) {
+        return 1;
+    }
+
+    ngpc::BgmStreamPlayer player;
+    std::string error;
+    auto start = std::chrono::steady_clock::now();
+    if (!player.load(song.note_table, song.streams, song.loops, &error)) {
+        std::fprintf(stderr, "load: %s\n", error.c_str());
+        return 2;
+    }
+    const double load_ms =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    // Twice the first pass, so half the seeks land in the lazily extended index.
+    const uint32_t span = player.pass_frames() * 2;
+    std::printf("first pass %u frames (%.1f min at 60 Hz), %zu checkpoints, load %.2f ms\n",
+                player.pass_frames(), player.pass_frames() / 3600.0, player.checkpoint_count(), load_ms);
+
+    std::vector<Snapshot> reference;
+    reference.reserve(span + 1);
+    player.reset();
+    for (uint32_t f = 0; f <= span; ++f) {
+        reference.push_back(Capture(player));
+        player.step();
+    }
+
+    bench::Lcg rng(99u);
+    std::vector<uint32_t> targets;
+    for (int i = 0; i < seeks; ++i) {
+        targets.push_back(static_cast<uint32_t>(rng.next() % (span + 1)));
+    }
+
+    int mismatches = 0;
+    start = std::chrono::steady_clock::now();
+    for (uint32_t target : targets) {
+        player.seek(target);
+        if (player.frame() != target || Capture(player) != reference[target]) {
+            if (mismatches++ == 0) {
+                std::printf("seek to frame %u disagrees with replay\n", target);
+            }
+        }
+    }
+    const double seek_us =
+        std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / seeks;
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < seeks / 20 + 1; ++i) {
+        player.reset();
+        player.run(targets[static_cast<size_t>(i)]);
+    }
+    const double replay_us =
+        std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() /
+        (seeks / 20 + 1);
+
+    std::printf("seek: %.2f us, replay from 0: %.2f us (%.0fx), %d / %d mismatches\n",
+                seek_us, replay_us, replay_us / seek_us, mismatches, seeks);
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,115 @@
+// Per-preset cost of BgmVoiceBank::tick(): specialised UpdateFx kernels
+// versus the kFxAll kernel every voice used before.
+//
+// Each preset is played as a loop of short notes on all four voices (voice 3
+// in noise mode, as the driver does) and the PSG output of both runs is
+// compared frame by frame, so a kernel that drops a stage it needs shows up
+// as a mismatch rather than as a suspiciously good number.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "ngpc/bgm_voice.h"
+#include "ngpc/instrument.h"
+
+namespace {
+
+constexpr int kNotes = 2000;
+constexpr int kHoldFrames = 48;
+constexpr int kReleaseFrames = 16;
+
+struct RunResult {
+    double ns_per_tick = 0.0;
+    uint64_t checksum = 0;
+};
+
+RunResult Run(const ngpc::BgmInstrumentDef& def, bool full_kernel) {
+    ngpc::BgmVoiceBank bank;
+    bank.set_force_full_kernel(full_kernel);
+    uint64_t checksum = 1469598103934665603ull;
+    uint64_t ticks = 0;
+
+    const auto start = std::chrono::steady_clock::now();
+    for (int n = 0; n < kNotes; ++n) {
+        for (int v = 0; v < ngpc::BgmVoiceBank::kVoices; ++v) {
+            bank.apply_instrument(v, def, v == 3);
+            bank.note_on(v, static_cast<uint16_t>(200 + ((n * 7 + v * 31) % 600)));
+        }
+        for (int f = 0; f < kHoldFrames + kReleaseFrames; ++f) {
+            if (f == kHoldFrames) {
+                for (int v = 0; v < ngpc::BgmVoiceBank::kVoices; ++v) {
+                    bank.note_off(v);
+                }
+            }
+            const uint8_t dirty = bank.tick();
+            ++ticks;
+            for (int v = 0; v < ngpc::BgmVoiceBank::kVoices; ++v) {
+                if (dirty & (1u << v)) {
+                    const uint64_t word = (static_cast<uint64_t>(bank.output_divider(v)) << 8) |
+                                          bank.output_attn(v);
+                    checksum = (checksum ^ word) * 1099511628211ull;
+                }
+            }
+        }
+    }
+    const auto end = std::chrono::steady_clock::now();
+
+    RunResult r;
+    r.ns_per_tick = std::chrono::duration<double, std::nano>(end - start).count() /
+                    static_cast<double>(ticks);
+    r.checksum = checksum;
+    return r;
+}
+
+std::string FeatureString(uint8_t fx) {
+    std::string s;
+    s += (fx & ngpc::BgmVoiceBank::kFxMacro) ? 'M' : '-';
+    s += (fx & ngpc::BgmVoiceBank::kFxPitchCurve) ? 'P' : '-';
+    s += (fx & ngpc::BgmVoiceBank::kFxEnv) ? 'E' : '-';
+    s += (fx & ngpc::BgmVoiceBank::kFxAdsr) ? 'A' : '-';
+    s += (fx & ngpc::BgmVoiceBank::kFxSweep) ? 'S' : '-';
+    s += (fx & ngpc::BgmVoiceBank::kFxVibrato) ? 'V' : '-';
+    s += (fx & ngpc::BgmVoiceBank::kFxLfo) ? 'L' : '-';
+    return s;
+}
+
+}  // namespace
+
+int main() {
+    const std::vector<ngpc::InstrumentPreset> presets = ngpc::FactoryInstrumentPresets();
+    std::printf("%-24s %-8s %12s %12s %8s\n", "preset", "features", "full ns/tick",
+                "spec ns/tick", "speedup");
+
+    double total_full = 0.0;
+    double total_spec = 0.0;
+    int mismatches = 0;
+    for (const auto& preset : presets) {
+        ngpc::BgmVoiceBank probe;
+        probe.apply_instrument(0, preset.def, false);
+
+        // Warm up once so the first preset does not pay for page faults.
+        Run(preset.def, true);
+        const RunResult full = Run(preset.def, true);
+        const RunResult spec = Run(preset.def, false);
+        total_full += full.ns_per_tick;
+        total_spec += spec.ns_per_tick;
+
+        const bool same = full.checksum == spec.checksum;
+        if (!same) {
+            ++mismatches;
+        }
+        std::printf("%-24s %-8s %12.2f %12.2f %7.2fx%s\n", preset.name.c_str(),
+                    FeatureString(probe.features(0)).c_str(), full.ns_per_tick,
+                    spec.ns_per_tick, full.ns_per_tick / spec.ns_per_tick,
+                    same ? "" : "  OUTPUT MISMATCH");
+    }
+    if (!presets.empty()) {
+        std::printf("%-24s %-8s %12.2f %12.2f %7.2fx\n", "mean", "",
+                    total_full / presets.size(), total_spec / presets.size(),
+                    total_full / total_spec);
+    }
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,208 @@
+// Driver command-buffer pressure: how long AnalyzeBufferPressure() takes to
+// play a synthetic song through the shipping driver against a timed Z80,
+// alone, under an SFX load, with game-side sends and with a lagging game,
+// and whether its timeline holds together: no frame sends more than
+// SND_BUF_MAX commands, the per-frame drops add up to the total, commits a
+// frame apart never find the Z80 busy, a game send right after
+// Sounds_Update is refused and one sent after the drain is not, a lagging game does drop
+// commands and the bursts match the dropping frames, and a run after it
+// reports the same frames as the first (no Z80 state leaks across runs).
+//
+// usage: ngpc_buffer_pressure_bench [events_per_voice] [sfx_interval]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "bench_song.h"
+#include "ngpc/buffer_pressure.h"
+
+namespace {
+
+ngpc::BgmExportStreams ToExport(const bench::Song& song) {
+    ngpc::BgmExportStreams es;
+    for (size_t i = 0; i + 1 < song.note_table.size(); i += 2) {
+        es.note_table.push_back(static_cast<uint16_t>(song.note_table[i] | (song.note_table[i + 1] << 4)));
+    }
+    es.streams = song.streams;
+    es.loop_offsets = song.loops;
+    return es;
+}
+
+// A jump (tone sweep) and a hit (noise burst), as a game fires them.
+std::vector<ngpc::NativeSfx> SfxLoad() {
+    ngpc::NativeSfx jump;
+    jump.tone_on = true;
+    jump.tone_ch = 2;
+    jump.tone_div = 320;
+    jump.tone_attn = 2;
+    jump.tone_frames = 12;
+    jump.tone_sw_on = true;
+    jump.tone_sw_end = 120;
+    jump.tone_sw_step = -20;
+    jump.tone_sw_speed = 1;
+    jump.tone_env_on = true;
+    jump.tone_env_step = 1;
+    jump.tone_env_spd = 2;
+
+    ngpc::NativeSfx hit;
+    hit.noise_on = true;
+    hit.noise_rate = 1;
+    hit.noise_type = 1;
+    hit.noise_attn = 1;
+    hit.noise_frames = 10;
+    hit.noise_burst = 1;
+    hit.noise_burst_dur = 2;
+    hit.noise_env_on = true;
+    hit.noise_env_step = 2;
+    hit.noise_env_spd = 1;
+    return {jump, hit};
+}
+
+bool Run(const char* label, const ngpc::BgmExportStreams& song, const ngpc::BufferPressureOptions& options,
+         ngpc::BufferPressureReport* report) {
+    std::string error;
+    const auto start = std::chrono::steady_clock::now();
+    if (!ngpc::AnalyzeBufferPressure(song, options, report, &error)) {
+        std::printf("FAIL: %s\n", error.c_str());
+        return false;
+    }
+    const double ms =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    const double seconds = report->timeline.size() / 60.0;
+    std::printf("%s: %zu frames (%.0f s) in %.1f ms (%.0fx real time)\n", label, report->timeline.size(), seconds,
+                ms, seconds * 1000.0 / std::max(ms, 0.001));
+    std::printf("  peak %u commands at frame %u, %u full frames, %u overflowing, %u dropped, %u commits refused\n",
+                report->peak, report->peak_frame, report->full_frames, report->overflow_frames, report->dropped,
+                report->refused_commits);
+    for (const ngpc::PressureBurst& b : report->bursts) {
+        std::printf("  burst at frame %u: %u frames, %u dropped, peak %u\n", b.first_frame, b.frames, b.dropped,
+                    b.peak);
+    }
+
+    uint32_t dropped = 0;
+    for (size_t i = 0; i < report->timeline.size(); ++i) {
+        const ngpc::FramePressure& f = report->timeline[i];
+        if (f.queued - f.dropped > ngpc::kDriverBufferCommands || f.refused > f.dropped) {
+            std::printf("FAIL: frame %zu sent %d commands, %d refused\n", i + 1, f.queued - f.dropped, f.refused);
+            return false;
+        }
+        dropped += f.dropped;
+    }
+    if (dropped != report->dropped) {
+        std::printf("FAIL: timeline drops %u, report %u\n", dropped, report->dropped);
+        return false;
+    }
+    return true;
+}
+
+// Every burst is a run of dropping frames bounded by clean ones, and adds up.
+bool CheckBursts(const ngpc::BufferPressureReport& report) {
+    for (const ngpc::PressureBurst& b : report.bursts) {
+        const auto& t = report.timeline;
+        if (b.first_frame < 1 || b.frames == 0 || b.first_frame - 1 + b.frames > t.size()) {
+            std::printf("FAIL: burst at frame %u runs past the timeline\n", b.first_frame);
+            return false;
+        }
+        uint32_t dropped = 0;
+        uint8_t peak = 0;
+        for (uint32_t i = b.first_frame - 1; i < b.first_frame - 1 + b.frames; ++i) {
+            if (t[i].dropped == 0) {
+                std::printf("FAIL: burst at frame %u holds clean frame %u\n", b.first_frame, i + 1);
+                return false;
+            }
+            dropped += t[i].dropped;
+            peak = std::max(peak, t[i].queued);
+        }
+        const bool open_before = b.first_frame > 1 && t[b.first_frame - 2].dropped != 0;
+        const bool open_after = b.first_frame - 1 + b.frames < t.size() && t[b.first_frame - 1 + b.frames].dropped != 0;
+        if (dropped != b.dropped || peak != b.peak || open_before || open_after) {
+            std::printf("FAIL: burst at frame %u does not match the timeline\n", b.first_frame);
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const int events = (argc > 1) ? std::max(1, std::atoi(argv[1])) : 4000;
+    const uint32_t interval = (argc > 2) ? static_cast<uint32_t>(std::max(1, std::atoi(argv[2]))) : 20;
+    const ngpc::BgmExportStreams song = ToExport(bench::MakeSong(1, events));
+
+    ngpc::BufferPressureOptions options;
+    ngpc::BufferPressureReport plain;
+    if (!Run("song", song, options, &plain)) {
+        return 1;
+    }
+
+    options.sfx = SfxLoad();
+    options.sfx_interval = interval;
+    ngpc::BufferPressureReport loaded;
+    char label[64];
+    std::snprintf(label, sizeof(label), "song + SFX every %u frames", interval);
+    if (!Run(label, song, options, &loaded)) {
+        return 1;
+    }
+
+    // Commits a frame apart never find the Z80 busy.
+    if (plain.refused_commits != 0 || loaded.refused_commits != 0) {
+        std::printf("FAIL: the Z80 refused %u + %u commits a frame apart\n", plain.refused_commits,
+                    loaded.refused_commits);
+        return 1;
+    }
+
+    // A send right after Sounds_Update lands while the frame's commit is
+    // still being written out; 2000 states later (past the 1432-state worst
+    // case for five commands) it does not.
+    options = ngpc::BufferPressureOptions{};
+    options.game_send_interval = 4;
+    ngpc::BufferPressureReport early;
+    if (!Run("song + game send at 0 states", song, options, &early) || !CheckBursts(early)) {
+        return 1;
+    }
+    options.game_send_delay = 2000;
+    ngpc::BufferPressureReport late;
+    if (!Run("song + game send at 2000 states", song, options, &late)) {
+        return 1;
+    }
+    if (early.game_sends == 0 || early.refused_commits == 0 || late.refused_commits != 0) {
+        std::printf("FAIL: game sends refused %u early, %u late\n", early.refused_commits, late.refused_commits);
+        return 1;
+    }
+
+    // A lagging game steps two driver frames back to back: the second
+    // commit finds the Z80 busy, and the analysis has to see those drops.
+    options = ngpc::BufferPressureOptions{};
+    options.lag_interval = 8;
+    ngpc::BufferPressureReport lag;
+    if (!Run("song, lagging every 8 frames", song, options, &lag) || !CheckBursts(lag)) {
+        return 1;
+    }
+    uint32_t refused = 0;
+    for (const ngpc::FramePressure& f : lag.timeline) {
+        refused += f.refused;
+    }
+    if (lag.refused_commits == 0 || refused == 0 || lag.overflow_frames == 0 || lag.bursts.empty()) {
+        std::printf("FAIL: the lagging game lost %u commits, %u commands\n", lag.refused_commits, refused);
+        return 1;
+    }
+
+    options = ngpc::BufferPressureOptions{};
+    ngpc::BufferPressureReport again;
+    if (!Run("song again", song, options, &again) || !CheckBursts(plain)) {
+        return 1;
+    }
+    for (size_t i = 0; i < plain.timeline.size(); ++i) {
+        if (plain.timeline[i].queued != again.timeline[i].queued ||
+            plain.timeline[i].dropped != again.timeline[i].dropped) {
+            std::printf("FAIL: runs differ at frame %zu\n", i + 1);
+            return 1;
+        }
+    }
+    std::printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,114 @@
+// FLAC encoder throughput and ratio on rendered PSG audio: three tone
+// channels and noise, with rests and silent stretches, driven frame by frame
+// like a song. Writes the stream when given a path, so it can be checked with
+// any FLAC decoder (`flac -t`).
+//
+// usage: ngpc_flac_bench [seconds] [out.flac]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "ngpc/flac.h"
+#include "ngpc/sound_engine.h"
+
+namespace {
+
+constexpr int kRate = 44100;
+constexpr int kFrameSamples = kRate / 60;
+constexpr int kBlock = 4096;
+
+uint32_t Hash(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7FEB352Du;
+    x ^= x >> 15;
+    x *= 0x846CA68Bu;
+    x ^= x >> 16;
+    return x;
+}
+
+void Write(ngpc::PsgMixer& psg, uint8_t data) {
+    psg.write_tone(data);
+    psg.write_noise(data);
+}
+
+void DriveFrame(ngpc::SoundEngine& snd, uint64_t sample_pos) {
+    const uint32_t frame = static_cast<uint32_t>(sample_pos / kFrameSamples);
+    ngpc::PsgMixer& psg = snd.psg();
+    // One second in eight is silent, as between songs or sections.
+    const bool rest = (frame / 60) % 8 == 7;
+    for (uint32_t ch = 0; ch < 3; ++ch) {
+        const uint32_t h = Hash((frame / (8 + ch * 4)) * 4 + ch);
+        const uint8_t attn = (rest || h % 4 == 0) ? 15 : static_cast<uint8_t>(h % 8);
+        const uint16_t div = static_cast<uint16_t>(60 + (h >> 8) % 700);
+        Write(psg, static_cast<uint8_t>(0x80 | (ch << 5) | (div & 0x0F)));
+        Write(psg, static_cast<uint8_t>((div >> 4) & 0x3F));
+        Write(psg, static_cast<uint8_t>(0x90 | (ch << 5) | attn));
+    }
+    const uint32_t h = Hash(frame / 12 + 0x1000);
+    if (rest || h % 3 == 0) {
+        Write(psg, 0xFF);
+    } else if ((frame % 12) == 0) {
+        Write(psg, static_cast<uint8_t>(0xE0 | (h >> 4) % 8));
+        Write(psg, static_cast<uint8_t>(0xF0 | (h >> 12) % 12));
+    }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const int seconds = (argc > 1) ? std::max(1, std::atoi(argv[1])) : 300;
+    const char* out_path = (argc > 2) ? argv[2] : nullptr;
+    const uint64_t total = static_cast<uint64_t>(seconds) * kRate;
+
+    std::vector<int16_t> pcm(total);
+    {
+        ngpc::SoundEngine snd;
+        snd.init(kRate);
+        snd.set_frame_callback([&snd](uint64_t pos) { DriveFrame(snd, pos); });
+        for (uint64_t pos = 0; pos < total; pos += kBlock) {
+            snd.render(pcm.data() + pos, static_cast<int>(std::min<uint64_t>(kBlock, total - pos)));
+        }
+    }
+
+    // Fed in uneven slices, as a render loop would.
+    std::vector<uint8_t> frames;
+    ngpc::FlacEncoder enc(kRate);
+    const auto start = std::chrono::steady_clock::now();
+    for (uint64_t pos = 0; pos < total;) {
+        const uint64_t n = std::min<uint64_t>(735 + (pos / 735) % 4000, total - pos);
+        enc.write(pcm.data() + pos, static_cast<size_t>(n), &frames);
+        pos += n;
+    }
+    enc.finish(&frames);
+    const double ms =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    const auto header = enc.header();
+    const double flac_bytes = static_cast<double>(frames.size() + header.size());
+    const double wav_bytes = static_cast<double>(total) * 2.0 + 44.0;
+    std::printf("%d s at %d Hz: WAV %.0f KB, FLAC %.0f KB (%.1f%%)\n", seconds, kRate, wav_bytes / 1024.0,
+                flac_bytes / 1024.0, 100.0 * flac_bytes / wav_bytes);
+    std::printf("encode %.1f ms (%.0fx real time)\n", ms, seconds * 1000.0 / std::max(ms, 0.001));
+
+    if (enc.total_samples() != total) {
+        std::printf("FAIL: encoded %llu samples, expected %llu\n",
+                    static_cast<unsigned long long>(enc.total_samples()), static_cast<unsigned long long>(total));
+        return 1;
+    }
+    if (out_path) {
+        FILE* f = std::fopen(out_path, "wb");
+        if (!f) {
+            std::printf("FAIL: cannot write %s\n", out_path);
+            return 1;
+        }
+        std::fwrite(header.data(), 1, header.size(), f);
+        std::fwrite(frames.data(), 1, frames.size(), f);
+        std::fclose(f);
+        std::printf("wrote %s\n", out_path);
+    }
+    return 0;
+}
@@ -0,0 +1,69 @@
+// In-process MIDI -> NGPC conversion time on a synthetic type-1 file, and a
+// sanity pass of the result through BgmStreamPlayer.
+//
+// usage: ngpc_midi_convert_bench [beats] [runs]
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+
+#include "bench_midi.h"
+#include "ngpc/bgm_stream.h"
+#include "ngpc/midi_convert.h"
+
+int main(int argc, char** argv) {
+    const int beats = (argc > 1) ? std::atoi(argv[1]) : 600;
+    const int runs = (argc > 2) ? std::atoi(argv[2]) : 20;
+
+    const std::vector<uint8_t> midi = bench::MakeMidi(3u, beats);
+    const std::string path = "ngpc_midi_convert_bench.mid";
+    {
+        std::ofstream f(path, std::ios::binary);
+        f.write(reinterpret_cast<const char*>(midi.data()), static_cast<std::streamsize>(midi.size()));
+    }
+
+    ngpc::MidiConvertOptions options;
+    options.force_tone_streams = true;
+    options.force_noise_stream = true;
+    options.c_array = true;
+
+    ngpc::MidiConversion conv;
+    std::string error;
+    std::string source;
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < runs; ++i) {
+        if (!ngpc::ConvertMidiFile(path, options, &conv, &error)) {
+            std::fprintf(stderr, "convert: %s\n", error.c_str());
+            return 2;
+        }
+        source = ngpc::FormatMidiConversion(conv, options);
+    }
+    const double ms =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / runs;
+    std::remove(path.c_str());
+
+    size_t bytes = 0;
+    for (const auto& s : conv.streams.streams) {
+        bytes += s.size();
+    }
+    std::printf("%zu byte MIDI: %d notes (%d stolen), %zu pitches, %zu stream bytes, %u frames\n",
+                midi.size(), conv.notes, conv.notes_dropped, conv.streams.note_table.size(), bytes, conv.frames);
+    std::printf("convert + format: %.3f ms (%zu bytes of C)\n", ms, source.size());
+    for (const std::string& w : conv.warnings) {
+        std::printf("warning: %s\n", w.c_str());
+    }
+
+    // Every stream must reach its end marker on the frame after the song's
+    // last note ends.
+    ngpc::BgmStreamPlayer player;
+    const std::vector<uint8_t> note_table = ngpc::NoteTableBytes(conv.streams.note_table);
+    if (!player.load(note_table, conv.streams.streams, conv.streams.loop_offsets, &error)) {
+        std::fprintf(stderr, "load: %s\n", error.c_str());
+        return 2;
+    }
+    std::printf("player: first pass %u frames, converter %u frames\n", player.pass_frames(), conv.frames);
+    return player.pass_frames() == conv.frames + 1 ? 0 : 1;
+}
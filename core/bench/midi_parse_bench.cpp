@@ -0,0 +1,66 @@
+// Single-pass MIDI reader on a large synthetic type-1 file: mapped read +
+// decode + sort, then InspectMidi on the parsed song.
+//
+// usage: ngpc_midi_parse_bench [beats] [runs]
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+
+#include "bench_midi.h"
+#include "ngpc/midi.h"
+
+int main(int argc, char** argv) {
+    // About 12 MB with the default arguments.
+    const int beats = (argc > 1) ? std::atoi(argv[1]) : 200000;
+    const int runs = (argc > 2) ? std::atoi(argv[2]) : 5;
+
+    const std::vector<uint8_t> midi = bench::MakeMidi(5u, beats);
+    const std::string path = "ngpc_midi_parse_bench.mid";
+    {
+        std::ofstream f(path, std::ios::binary);
+        f.write(reinterpret_cast<const char*>(midi.data()), static_cast<std::streamsize>(midi.size()));
+    }
+
+    ngpc::MidiSong song;
+    ngpc::MidiInfo info;
+    std::string error;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < runs; ++i) {
+        if (!ngpc::ReadMidiSong(path, &song, &error)) {
+            std::fprintf(stderr, "read: %s\n", error.c_str());
+            std::remove(path.c_str());
+            return 2;
+        }
+    }
+    const double read_ms =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / runs;
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < runs; ++i) {
+        info = ngpc::InspectMidi(song);
+    }
+    const double inspect_ms =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / runs;
+    std::remove(path.c_str());
+
+    size_t notes = 0;
+    uint32_t last_tick = 0;
+    bool sorted = true;
+    for (const ngpc::MidiEvent& ev : song.events) {
+        notes += (ev.type == ngpc::kMidiNoteOn) ? 1 : 0;
+        sorted = sorted && ev.tick >= last_tick;
+        last_tick = ev.tick;
+    }
+    std::printf("%.1f MB MIDI: %zu events (%zu note-ons), %zu bytes per event\n",
+                midi.size() / (1024.0 * 1024.0), song.events.size(), notes, sizeof(ngpc::MidiEvent));
+    std::printf("read + parse: %.2f ms (%.0f MB/s), inspect: %.3f ms\n",
+                read_ms, midi.size() / (1024.0 * 1024.0) / (read_ms / 1000.0), inspect_ms);
+    if (!info.valid || !song.damage.empty()) {
+        std::printf("inspect: %s\n", info.error.c_str());
+    }
+    return (info.valid && sorted) ? 0 : 1;
+}
@@ -0,0 +1,42 @@
+// Sounds_Update() throughput of the host-built shipping driver, on the
+// synthetic four-voice song from bench_song.h.
+//
+// usage: ngpc_native_sounds_bench [frames]
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "bench_song.h"
+#include "ngpc/native_sounds.h"
+
+int main(int argc, char** argv) {
+    const int frames = (argc > 1) ? std::atoi(argv[1]) : 2000000;
+    const bench::Song song = bench::MakeSong(1u, 400);
+
+    ngpc::NativeSounds& native = ngpc::NativeSounds::instance();
+    native.init();
+    std::string error;
+    if (!native.start_bgm(song.note_table, song.streams, song.loops, &error)) {
+        std::fprintf(stderr, "start_bgm: %s\n", error.c_str());
+        return 2;
+    }
+
+    uint64_t bytes = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (int f = 0; f < frames; ++f) {
+        native.clear_psg_writes();
+        native.update();
+        bytes += native.psg_writes().size();
+    }
+    const auto end = std::chrono::steady_clock::now();
+
+    const double secs = std::chrono::duration<double>(end - start).count();
+    std::printf("%d frames in %.3f s: %.0f frames/s (%.0fx real time at 60 Hz)\n",
+                frames, secs, frames / secs, frames / secs / 60.0);
+    std::printf("%.2f PSG bytes/frame, %u drops\n",
+                static_cast<double>(bytes) / frames, native.drops());
+    return 0;
+}
@@ -0,0 +1,263 @@
+// Differential check: the shipping driver (NativeSounds) against the tool's
+// BgmVoiceBank, the voice engine TrackerPlaybackEngine, the instrument
+// preview and the player all render through.
+//
+// A synthetic song is played through sounds.c, and the same stream is walked
+// here the way BgmVoice_Step does, driving BgmVoiceBank. Both sides' PSG
+// writes go through a T6W28 register model and the resulting divider and
+// attenuation of every channel are compared after each frame.
+//
+// usage: ngpc_native_sounds_diff [frames] [seed]
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "bench_song.h"
+#include "ngpc/bgm_voice.h"
+#include "ngpc/native_sounds.h"
+
+namespace {
+
+// Register file as the PSG sees it: tone dividers / noise control and
+// attenuations, indexed by the 3-bit register number of the latch byte.
+struct PsgRegs {
+    std::array<uint16_t, 8> reg{};
+    uint8_t latched = 0;
+
+    void write(uint8_t b) {
+        if (b & 0x80) {
+            latched = static_cast<uint8_t>((b >> 4) & 0x07);
+            reg[latched] = static_cast<uint16_t>((reg[latched] & ~0x0Fu) | (b & 0x0F));
+        } else if ((latched & 1) == 0 && latched != 6) {
+            reg[latched] = static_cast<uint16_t>((reg[latched] & 0x0F) | ((b & 0x3F) << 4));
+        } else {
+            reg[latched] = static_cast<uint16_t>((reg[latched] & ~0x0Fu) | (b & 0x0F));
+        }
+    }
+    void write(const std::vector<uint8_t>& bytes) {
+        for (uint8_t b : bytes) write(b);
+    }
+    uint16_t tone(int ch) const { return reg[static_cast<size_t>(ch * 2)]; }
+    uint8_t attn(int ch) const { return static_cast<uint8_t>(reg[static_cast<size_t>(ch * 2 + 1)] & 0x0F); }
+};
+
+// BgmVoice_Step, opcode subset emitted by bench::MakeSong, on top of
+// BgmVoiceBank. Gate 100% and tempo 1, as the song never changes them.
+class StreamWalker {
+public:
+    explicit StreamWalker(const bench::Song& song) : song_(song) {
+        ngpc::BgmInstrumentDef noise_default;  // s_bgm_instruments[1]
+        noise_default.adsr_on = 1;
+        noise_default.adsr_decay = 1;
+        noise_default.adsr_sustain = 13;
+        noise_default.adsr_release = 2;
+        for (int v = 0; v < 4; ++v) {
+            bank_.apply_instrument(v, v == 3 ? noise_default : ngpc::BgmInstrumentDef{}, v == 3);
+            pos_[static_cast<size_t>(v)] = 0;
+            next_frame_[static_cast<size_t>(v)] = 0;
+            enabled_[static_cast<size_t>(v)] = !song.streams[static_cast<size_t>(v)].empty();
+        }
+    }
+
+    // One driver frame. Returns the PSG bytes this frame writes.
+    std::vector<uint8_t> frame() {
+        ++song_frame_;
+        std::vector<uint8_t> out;
+        for (int v = 0; v < 4; ++v) {
+            step(v, out);
+        }
+        return out;
+    }
+
+private:
+    void emit_state(int v, std::vector<uint8_t>& out) {
+        const uint8_t base = static_cast<uint8_t>(0x80 | (v << 5));
+        const uint8_t attn = static_cast<uint8_t>(base | 0x10 | bank_.output_attn(v));
+        if (v == 3) {
+            out.insert(out.end(), {static_cast<uint8_t>(0xE0 | noise_val_), attn, attn});
+        } else {
+            const uint16_t div = bank_.output_divider(v);
+            out.insert(out.end(), {static_cast<uint8_t>(base | (div & 0x0F)),
+                                   static_cast<uint8_t>((div >> 4) & 0x3F), attn});
+        }
+    }
+
+    void emit_silence(int v, std::vector<uint8_t>& out) {
+        const uint8_t off = static_cast<uint8_t>(0x80 | (v << 5) | 0x1F);
+        out.insert(out.end(), {off, off, off});
+    }
+
+    uint16_t note_to_div(uint8_t note) const {
+        const size_t idx = static_cast<size_t>(std::min<int>(std::max<int>(note, 1), 51) - 1);
+        const uint8_t lo = song_.note_table[idx * 2] & 0x0F;
+        const uint8_t hi = song_.note_table[idx * 2 + 1] & 0x3F;
+        return static_cast<uint16_t>((hi << 4) | lo);
+    }
+
+    void step(int v, std::vector<uint8_t>& out) {
+        const size_t vi = static_cast<size_t>(v);
+        if (!enabled_[vi]) {
+            return;
+        }
+        if (song_frame_ < next_frame_[vi]) {
+            if (bank_.tick_voice(v) && bank_.active(v)) {
+                emit_state(v, out);
+            }
+            return;
+        }
+        const std::vector<uint8_t>& s = song_.streams[vi];
+        size_t& p = pos_[vi];
+        for (;;) {
+            const uint8_t op = s[p++];
+            if (op == 0x00) {
+                p = song_.loops[vi];
+                continue;
+            }
+            if (op == 0xFF) {
+                next_frame_[vi] += std::max<uint8_t>(s[p++], 1);
+                bank_.note_off(v);
+                if (bank_.active(v)) {
+                    emit_state(v, out);
+                } else {
+                    emit_silence(v, out);
+                }
+                return;
+            }
+            if (op >= 0xF0) {
+                opcode(v, op, s, p);
+                continue;
+            }
+            next_frame_[vi] += std::max<uint8_t>(s[p++], 1);
+            if (op > 51) {
+                bank_.cut(v);
+                emit_silence(v, out);
+                return;
+            }
+            if (v == 3) {
+                noise_val_ = static_cast<uint8_t>((op - 1) & 0x07);
+            }
+            bank_.note_on(v, note_to_div(op));
+            emit_state(v, out);
+            return;
+        }
+    }
+
+    void opcode(int v, uint8_t op, const std::vector<uint8_t>& s, size_t& p) {
+        switch (op) {
+        case 0xF0:
+            bank_.set_attn(v, s[p]);
+            p += 1;
+            break;
+        case 0xF1:
+            bank_.set_env(v, s[p], s[p + 1]);
+            p += 2;
+            break;
+        case 0xF2:
+            bank_.set_vibrato(v, s[p], s[p + 1], s[p + 2]);
+            p += 3;
+            break;
+        case 0xF3:
+            bank_.set_sweep(v, static_cast<uint16_t>(s[p] | (s[p + 1] << 8)),
+                            static_cast<int8_t>(s[p + 2]), s[p + 3]);
+            p += 4;
+            break;
+        case 0xF7:
+            bank_.set_expression(v, s[p]);
+            p += 1;
+            break;
+        case 0xF8:
+            bank_.set_pitch_bend(v, static_cast<int16_t>(s[p] | (s[p + 1] << 8)));
+            p += 2;
+            break;
+        case 0xF9:
+            bank_.set_adsr(v, s[p], s[p + 1], s[p + 2], 0, s[p + 3]);
+            p += 4;
+            break;
+        case 0xFA:
+            bank_.set_lfo(v, s[p], s[p + 1], s[p + 2]);
+            p += 3;
+            break;
+        case 0xFE:
+            if (s[p] == 0x01) {
+                bank_.set_adsr(v, s[p + 1], s[p + 2], s[p + 3], s[p + 4], s[p + 5]);
+                p += 6;
+            } else {
+                bank_.set_mod2(v, s[p + 1],
+                               s[p + 2] != 0, s[p + 3], s[p + 4], s[p + 5], s[p + 6],
+                               s[p + 7] != 0, s[p + 8], s[p + 9], s[p + 10], s[p + 11]);
+                p += 12;
+            }
+            break;
+        default:
+            std::fprintf(stderr, "unexpected opcode 0x%02X\n", op);
+            std::exit(2);
+        }
+    }
+
+    const bench::Song& song_;
+    ngpc::BgmVoiceBank bank_;
+    uint32_t song_frame_ = 0;
+    std::array<size_t, 4> pos_{};
+    std::array<uint32_t, 4> next_frame_{};
+    std::array<bool, 4> enabled_{};
+    uint8_t noise_val_ = 0;
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const int frames = (argc > 1) ? std::atoi(argv[1]) : 20000;
+    const uint32_t seed = (argc > 2) ? static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10)) : 1u;
+    const bench::Song song = bench::MakeSong(seed, 400);
+
+    ngpc::NativeSounds& native = ngpc::NativeSounds::instance();
+    native.init();
+    native.clear_psg_writes();
+    std::string error;
+    if (!native.start_bgm(song.note_table, song.streams, song.loops, &error)) {
+        std::fprintf(stderr, "start_bgm: %s\n", error.c_str());
+        return 2;
+    }
+
+    PsgRegs native_regs;
+    native_regs.write(native.psg_writes());
+    PsgRegs tool_regs = native_regs;
+    StreamWalker walker(song);
+
+    std::array<int, 4> mismatches{};
+    std::array<int, 4> first{-1, -1, -1, -1};
+    for (int f = 1; f <= frames; ++f) {
+        native.clear_psg_writes();
+        native.update();
+        native_regs.write(native.psg_writes());
+        tool_regs.write(walker.frame());
+
+        for (int ch = 0; ch < 4; ++ch) {
+            const bool same = native_regs.tone(ch) == tool_regs.tone(ch) &&
+                              native_regs.attn(ch) == tool_regs.attn(ch);
+            if (same) {
+                continue;
+            }
+            if (first[static_cast<size_t>(ch)] < 0) {
+                first[static_cast<size_t>(ch)] = f;
+                std::printf("ch%d first diverges at frame %d: driver div=%u attn=%u, tool div=%u attn=%u\n",
+                            ch, f, native_regs.tone(ch), native_regs.attn(ch),
+                            tool_regs.tone(ch), tool_regs.attn(ch));
+            }
+            ++mismatches[static_cast<size_t>(ch)];
+        }
+    }
+
+    int total = 0;
+    for (int ch = 0; ch < 4; ++ch) {
+        std::printf("ch%d: %d / %d frames differ\n", ch, mismatches[static_cast<size_t>(ch)], frames);
+        total += mismatches[static_cast<size_t>(ch)];
+    }
+    std::printf("driver drops: %u\n", native.drops());
+    return total == 0 ? 0 : 1;
+}
@@ -0,0 +1,152 @@
+// Segmented offline render: one SoundEngine skip()s through the song and
+// copies its state at regular frame boundaries, then the segments between
+// those checkpoints are rendered on all cores. The stitched output must match
+// a plain serial render() sample for sample.
+//
+// The PSG is driven by a frame callback that derives its writes from the frame
+// number alone (held notes, rests, noise on and off), so a segment needs no
+// state beyond the engine's own.
+//
+// usage: ngpc_segmented_render_bench [seconds] [segment_seconds]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include "ngpc/parallel.h"
+#include "ngpc/sound_engine.h"
+
+namespace {
+
+constexpr int kRate = 44100;
+constexpr int kFrameSamples = kRate / 60;
+constexpr int kBlock = 4096;
+
+uint32_t Hash(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7FEB352Du;
+    x ^= x >> 15;
+    x *= 0x846CA68Bu;
+    x ^= x >> 16;
+    return x;
+}
+
+// Mirrors every byte to both ports, like the shipped driver.
+void Write(ngpc::PsgMixer& psg, uint8_t data) {
+    psg.write_tone(data);
+    psg.write_noise(data);
+}
+
+void DriveFrame(ngpc::SoundEngine& snd, uint64_t sample_pos) {
+    const uint32_t frame = static_cast<uint32_t>(sample_pos / kFrameSamples);
+    ngpc::PsgMixer& psg = snd.psg();
+    for (uint32_t ch = 0; ch < 3; ++ch) {
+        const uint32_t h = Hash((frame / (6 + ch * 3)) * 4 + ch);
+        const uint8_t attn = (h % 5 == 0) ? 15 : static_cast<uint8_t>(h % 10);
+        const uint16_t div = static_cast<uint16_t>(40 + (h >> 8) % 900);
+        Write(psg, static_cast<uint8_t>(0x80 | (ch << 5) | (div & 0x0F)));
+        Write(psg, static_cast<uint8_t>((div >> 4) & 0x3F));
+        Write(psg, static_cast<uint8_t>(0x90 | (ch << 5) | attn));
+    }
+    const uint32_t h = Hash(frame / 10 + 0x1000);
+    if (h % 3 == 0) {
+        Write(psg, 0xFF);  // noise silent
+    } else if ((frame % 10) == 0) {
+        Write(psg, static_cast<uint8_t>(0xE0 | (h >> 4) % 8));
+        Write(psg, static_cast<uint8_t>(0xF0 | (h >> 12) % 12));
+    }
+}
+
+void InitEngine(ngpc::SoundEngine& snd) {
+    snd.init(kRate);
+    snd.set_frame_callback([&snd](uint64_t pos) { DriveFrame(snd, pos); });
+}
+
+double MsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const int seconds = (argc > 1) ? std::max(1, std::atoi(argv[1])) : 600;
+    const int segment_seconds = (argc > 2) ? std::max(1, std::atoi(argv[2])) : 10;
+    const uint64_t total = static_cast<uint64_t>(seconds) * kRate;
+    const uint64_t segment_frames = static_cast<uint64_t>(segment_seconds) * 60;
+
+    // Serial reference.
+    std::vector<int16_t> ref(total);
+    auto start = std::chrono::steady_clock::now();
+    {
+        ngpc::SoundEngine snd;
+        InitEngine(snd);
+        for (uint64_t pos = 0; pos < total; pos += kBlock) {
+            snd.render(ref.data() + pos, static_cast<int>(std::min<uint64_t>(kBlock, total - pos)));
+        }
+    }
+    const double serial_ms = MsSince(start);
+
+    // Fast pass: skip() and copy the engine every segment_frames frames, before
+    // that frame's writes.
+    struct Checkpoint {
+        uint64_t sample = 0;
+        std::unique_ptr<ngpc::SoundEngine> state;
+    };
+    std::vector<Checkpoint> checkpoints;
+    start = std::chrono::steady_clock::now();
+    {
+        ngpc::SoundEngine snd;
+        snd.init(kRate);
+        snd.set_frame_callback([&](uint64_t pos) {
+            if ((pos / kFrameSamples) % segment_frames == 0) {
+                Checkpoint cp{pos, std::make_unique<ngpc::SoundEngine>()};
+                cp.state->init(kRate);
+                cp.state->copy_state_from(snd);
+                checkpoints.push_back(std::move(cp));
+            }
+            DriveFrame(snd, pos);
+        });
+        for (uint64_t pos = 0; pos < total; pos += kBlock) {
+            snd.skip(static_cast<int>(std::min<uint64_t>(kBlock, total - pos)));
+        }
+    }
+    const double skip_ms = MsSince(start);
+
+    std::vector<int16_t> out(total);
+    start = std::chrono::steady_clock::now();
+    ngpc::ParallelFor(checkpoints.size(), 0, [&](size_t i) {
+        const uint64_t begin = checkpoints[i].sample;
+        const uint64_t end = (i + 1 < checkpoints.size()) ? checkpoints[i + 1].sample : total;
+        ngpc::SoundEngine snd;
+        InitEngine(snd);
+        snd.copy_state_from(*checkpoints[i].state);
+        // Blocks stay on the serial render's grid: where render() calls are cut
+        // decides which samples the chip has already queued when a frame's
+        // writes land.
+        for (uint64_t pos = begin; pos < end;) {
+            const uint64_t block_end = std::min<uint64_t>((pos / kBlock + 1) * kBlock, end);
+            snd.render(out.data() + pos, static_cast<int>(block_end - pos));
+            pos = block_end;
+        }
+    });
+    const double parallel_ms = MsSince(start);
+
+    std::printf("%d s at %d Hz, %zu segments, %u workers\n", seconds, kRate, checkpoints.size(),
+                ngpc::DefaultWorkerCount());
+    std::printf("serial %.1f ms | skip pass %.1f ms + segments %.1f ms = %.1f ms (%.2fx)\n", serial_ms, skip_ms,
+                parallel_ms, skip_ms + parallel_ms, serial_ms / std::max(skip_ms + parallel_ms, 0.001));
+
+    for (uint64_t i = 0; i < total; ++i) {
+        if (out[i] != ref[i]) {
+            std::printf("FAIL: first difference at sample %llu\n", static_cast<unsigned long long>(i));
+            return 1;
+        }
+    }
+    std::printf("OK: segmented render identical to the serial render\n");
+    return 0;
+}
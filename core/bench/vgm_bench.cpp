@@ -0,0 +1,173 @@
+// PSG write recorder: what logging every port write costs during a render,
+// how big the log gets, and whether PsgMixer::replay() rebuilds the recorded
+// audio sample for sample without the frame callback that made it. The log is
+// then written as a VGM file and streamed back through VgmPlayer on a
+// SoundEngine timed callback, which must play every write, at speed, and
+// match the render sample for sample as well.
+//
+// usage: ngpc_vgm_bench [seconds] [out.vgm]   (default ngpc_vgm_bench.vgm)
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "ngpc/sound_engine.h"
+#include "ngpc/vgm.h"
+
+namespace {
+
+constexpr int kRate = 44100;
+constexpr int kFrameSamples = kRate / 60;
+constexpr int kBlock = 4096;
+
+uint32_t Hash(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7FEB352Du;
+    x ^= x >> 15;
+    x *= 0x846CA68Bu;
+    x ^= x >> 16;
+    return x;
+}
+
+// Rewrites every register each frame, like a driver refreshing its voices.
+// The ports carry different data, so a write logged, formatted or replayed
+// on the wrong port shows up as a difference: the tone periods go to port
+// 0x4001 (LEFT) only, the attenuations, noise control and noise period to
+// port 0x4000 (RIGHT) only.
+void DriveFrame(ngpc::SoundEngine& snd, uint64_t sample_pos) {
+    const uint32_t frame = static_cast<uint32_t>(sample_pos / kFrameSamples);
+    ngpc::PsgMixer& psg = snd.psg();
+    for (uint32_t ch = 0; ch < 3; ++ch) {
+        const uint32_t h = Hash((frame / (6 + ch * 3)) * 4 + ch);
+        const uint8_t attn = (h % 5 == 0) ? 15 : static_cast<uint8_t>((h + frame) % 10);
+        const uint16_t div = static_cast<uint16_t>(40 + (h >> 8) % 900);
+        psg.write_tone(static_cast<uint8_t>(0x80 | (ch << 5) | (div & 0x0F)));
+        psg.write_tone(static_cast<uint8_t>((div >> 4) & 0x3F));
+        psg.write_noise(static_cast<uint8_t>(0x90 | (ch << 5) | attn));
+    }
+    const uint32_t h = Hash(frame / 10 + 0x1000);
+    if (h % 3 == 0) {
+        psg.write_noise(0xFF);
+    } else if ((frame % 10) == 0) {
+        const uint16_t div = static_cast<uint16_t>(20 + (h >> 16) % 300);
+        psg.write_noise(static_cast<uint8_t>(0xC0 | (div & 0x0F)));
+        psg.write_noise(static_cast<uint8_t>((div >> 4) & 0x3F));
+        psg.write_noise(static_cast<uint8_t>(0xE0 | (h >> 4) % 8));
+        psg.write_noise(static_cast<uint8_t>(0xF0 | (h >> 12) % 12));
+    }
+}
+
+double Render(std::vector<int16_t>* out, ngpc::PsgLog* log) {
+    ngpc::SoundEngine snd;
+    snd.init(kRate);
+    snd.set_frame_callback([&snd](uint64_t pos) { DriveFrame(snd, pos); });
+    if (log) {
+        snd.psg().set_recorder(log);
+    }
+    const uint64_t total = out->size();
+    const auto start = std::chrono::steady_clock::now();
+    for (uint64_t pos = 0; pos < total; pos += kBlock) {
+        snd.render(out->data() + pos, static_cast<int>(std::min<uint64_t>(kBlock, total - pos)));
+    }
+    const double ms =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    snd.psg().set_recorder(nullptr);
+    return ms;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const int seconds = (argc > 1) ? std::max(1, std::atoi(argv[1])) : 300;
+    const char* out_path = (argc > 2) ? argv[2] : "ngpc_vgm_bench.vgm";
+    const uint64_t total = static_cast<uint64_t>(seconds) * kRate;
+
+    std::vector<int16_t> plain(total);
+    std::vector<int16_t> recorded(total);
+    ngpc::PsgLog log;
+    log.reserve(static_cast<size_t>(seconds) * 60 * 24 * 2);
+    const double plain_ms = Render(&plain, nullptr);
+    const double recorded_ms = Render(&recorded, &log);
+
+    std::printf("%d s at %d Hz: %zu writes, log %.1f KB (%.2f bytes/write)\n", seconds, kRate, log.size(),
+                log.bytes() / 1024.0, static_cast<double>(log.bytes()) / std::max<size_t>(log.size(), 1));
+    std::printf("render %.1f ms, with recorder %.1f ms (%+.1f%%)\n", plain_ms, recorded_ms,
+                100.0 * (recorded_ms - plain_ms) / std::max(plain_ms, 0.001));
+
+    std::vector<int16_t> replayed(total);
+    const auto start = std::chrono::steady_clock::now();
+    ngpc::PsgMixer psg;
+    psg.replay(log, replayed.data(), total);
+    const double replay_ms =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::printf("replay %.1f ms\n", replay_ms);
+
+    const std::vector<uint8_t> vgm = ngpc::FormatVgm(log, total);
+    FILE* f = std::fopen(out_path, "wb");
+    if (!f) {
+        std::printf("FAIL: cannot write %s\n", out_path);
+        return 1;
+    }
+    std::fwrite(vgm.data(), 1, vgm.size(), f);
+    std::fclose(f);
+    std::printf("wrote %s (%.1f KB)\n", out_path, vgm.size() / 1024.0);
+
+    // Stream it back. Each write lands on the sample it was recorded at, so the
+    // stream must match the render exactly too.
+    ngpc::VgmPlayer player;
+    std::string error;
+    if (!player.open(out_path, 1, &error)) {
+        std::printf("FAIL: %s\n", error.c_str());
+        return 1;
+    }
+    size_t writes = 0;
+    {
+        ngpc::VgmReader reader;
+        reader.open(out_path, nullptr);
+        while (reader.next(nullptr)) {
+            ++writes;
+        }
+    }
+    std::vector<int16_t> streamed(total);
+    ngpc::SoundEngine snd;
+    snd.init(kRate);
+    player.start(&snd.psg(), kRate);
+    snd.set_timed_callback([&player](uint64_t pos) { return player.on_sample(pos); });
+    const auto vgm_start = std::chrono::steady_clock::now();
+    for (uint64_t pos = 0; pos < total; pos += kBlock) {
+        snd.render(streamed.data() + pos, static_cast<int>(std::min<uint64_t>(kBlock, total - pos)));
+    }
+    const double vgm_ms =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - vgm_start).count();
+    size_t differ = 0;
+    for (uint64_t i = 0; i < total; ++i) {
+        differ += (streamed[i] != plain[i]) ? 1 : 0;
+    }
+    std::printf("VGM playback %.1f ms (%.0fx real time), %zu writes, %zu samples differ from the render\n", vgm_ms,
+                seconds * 1000.0 / std::max(vgm_ms, 0.001), writes, differ);
+    if (writes != log.size() || !player.reader().error().empty()) {
+        std::printf("FAIL: VGM holds %zu writes, log %zu\n", writes, log.size());
+        return 1;
+    }
+    if (differ != 0) {
+        std::printf("FAIL: VGM playback differs from the render\n");
+        return 1;
+    }
+
+    for (uint64_t i = 0; i < total; ++i) {
+        if (recorded[i] != plain[i]) {
+            std::printf("FAIL: recording changed the output at sample %llu\n", static_cast<unsigned long long>(i));
+            return 1;
+        }
+        if (replayed[i] != plain[i]) {
+            std::printf("FAIL: replay differs at sample %llu\n", static_cast<unsigned long long>(i));
+            return 1;
+        }
+    }
+    std::printf("OK: replay and VGM playback identical to the recorded render\n");
+    return 0;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ngpc/bgm_export.h"
+#include "ngpc/bgm_stream.h"
+
+namespace ngpc {
+
+// Binary song container (.ngpb), the data FormatBgmC() writes as source,
+// laid out so a loader can use it in place. All fields little-endian:
+//   0  "NGPB"
+//   4  u16 version (kBgmBinaryVersion), u16 header size (kBgmBinaryHeaderSize)
+//   8  u32 NOTE_TABLE offset, u32 NOTE_TABLE size (NoteTableBytes() pairs)
+//  16  4 x { u32 stream offset, u32 stream size, u16 loop offset, u16 0 }
+// Sections follow the header in that order.
+constexpr uint16_t kBgmBinaryVersion = 1;
+constexpr size_t kBgmBinaryHeaderSize = 64;
+
+std::vector<uint8_t> FormatBgmBinary(const BgmExportStreams& es);
+
+// Spans into the container bytes passed to ParseBgmBinary(); valid while
+// those bytes are.
+struct BgmBinaryView {
+    BgmByteSpan note_table;
+    std::array<BgmByteSpan, 4> streams;
+    std::array<uint16_t, 4> loop_offsets{};
+};
+
+// Checks the header and section bounds only; nothing is copied or decoded.
+bool ParseBgmBinary(const uint8_t* data, size_t size, BgmBinaryView* out, std::string* error);
+
+}  // namespace ngpc
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "ngpc/bgm_export.h"
+
+namespace ngpc {
+
+// BGM_OP_EXT (0xFE) sub-commands for stream subroutines (sounds.h):
+//   FE 03 count lo hi   play the subroutine at stream offset hi:lo `count`
+//                       times (1-255), then continue after the call
+//   FE 04               end of a subroutine
+// Subroutines sit after the stream's 0x00 end marker and never call others.
+constexpr uint8_t kBgmExtCall = 0x03;
+constexpr uint8_t kBgmExtReturn = 0x04;
+constexpr size_t kBgmCallBytes = 5;
+constexpr size_t kBgmReturnBytes = 2;
+
+// Bytes of the stream event at `pos`: a note or rest with its duration, or
+// an opcode with its operands, as the driver consumes them. 1 for the 0x00
+// end marker, 0 when the event runs past `size`.
+size_t BgmEventLength(const uint8_t* data, size_t size, size_t pos);
+
+struct BgmCompressStats {
+    std::array<size_t, 4> bytes_before{};
+    std::array<size_t, 4> bytes_after{};
+    int subroutines = 0;
+    int calls = 0;
+
+    size_t total_before() const;
+    size_t total_after() const;
+};
+
+// Moves repeated runs of events (pattern repeats, repeated phrases) into
+// subroutines and replaces every occurrence with a call; back-to-back
+// repeats become one call with a count. Loop offsets are remapped and never
+// land inside a call, so playback is unchanged. Streams that do not parse,
+// or that already contain calls, are left as they are.
+BgmCompressStats CompressBgmStreams(BgmExportStreams* es);
+
+}  // namespace ngpc
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ngpc {
+
+// A song in the driver's stream format, ready to be written as source.
+struct BgmExportStreams {
+    std::vector<uint16_t> note_table;            // divider values
+    std::array<std::vector<uint8_t>, 4> streams;  // 4 channel streams
+    std::array<uint16_t, 4> loop_offsets{};       // byte offset of loop point per channel
+};
+
+struct BgmSourceOptions {
+    std::string mode_label;             // "Pre-baked", "Hybrid", ... for the header comment
+    std::vector<std::string> warnings;  // emitted as "WARN export:" comments
+    std::vector<std::string> notes;     // emitted as plain comments
+    bool mono = false;                  // write streams[0] as BGM_MONO, no BGM_CHx
+};
+
+// NOTE_TABLE bytes: (lo nibble, hi 6 bits) per divider.
+std::vector<uint8_t> NoteTableBytes(const std::vector<uint16_t>& dividers);
+
+// Append `opcode` (note index or 0xFF rest) for `duration` frames, split into
+// 255-frame events.
+void AppendBgmEvent(std::vector<uint8_t>& dst, uint8_t opcode, int duration);
+
+// Source the driver builds against: NOTE_TABLE, BGM_CHx / BGM_CHx_LOOP and
+// BGM_MONO, as C arrays or TLCS-900H .inc data.
+std::string FormatBgmC(const BgmExportStreams& es, const BgmSourceOptions& options);
+std::string FormatBgmAsm(const BgmExportStreams& es, const BgmSourceOptions& options);
+
+}  // namespace ngpc
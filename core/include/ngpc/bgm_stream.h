@@ -0,0 +1,173 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "ngpc/bgm_voice.h"
+#include "ngpc/instrument.h"
+
+namespace ngpc {
+
+class PsgMixer;
+
+// Read-only bytes owned by someone else (a mapped file, a loaded song).
+struct BgmByteSpan {
+    const uint8_t* ptr = nullptr;
+    size_t len = 0;
+
+    const uint8_t* data() const { return ptr; }
+    size_t size() const { return len; }
+    bool empty() const { return len == 0; }
+    uint8_t operator[](size_t i) const { return ptr[i]; }
+};
+
+// Host-side interpreter for exported BGM streams (BGM_CH0..2 / BGM_CHN): note
+// indices, 0xFF rests and the BGM_OP_* opcodes of sounds.h, one frame per
+// step(), with the voice effects run by a BgmVoiceBank.
+//
+// load() plays the song through once without a PSG and keeps a checkpoint of
+// every stream cursor, the voice bank and the fade state each
+// seek_interval() frames, so seek() restores the nearest checkpoint and
+// replays fewer than seek_interval() frames whatever the target. Seeking past
+// the indexed range extends the index on the way.
+class BgmStreamPlayer {
+public:
+    static constexpr int kVoices = 4;
+    static constexpr uint32_t kDefaultSeekInterval = 64;
+    // Cap for the load-time pass; a stream that never reaches its end or loop
+    // point (all rests, say) would otherwise index forever.
+    static constexpr uint32_t kMaxIndexFrames = 60u * 60u * 60u;
+
+    // SET_INST lookup. The default resolves against FactoryInstrumentPresets().
+    using InstrumentResolver = std::function<BgmInstrumentDef(uint8_t inst_id)>;
+    // instrument() of a voice no SET_INST has reached yet.
+    static constexpr uint8_t kNoInstrument = 0xFF;
+
+    // What the last frame advanced did on each voice, for cost models
+    // (cycle_budget.h). Cleared at the start of every frame.
+    struct StepTrace {
+        std::array<uint8_t, kVoices> events{};         // notes, rests and stream ends read
+        std::array<uint8_t, kVoices> opcodes{};        // opcodes read, EXT CALL / RET included
+        std::array<uint8_t, kVoices> operand_bytes{};  // their parameter bytes
+        uint8_t fx_dirty = 0;                          // bit v: the effect pass changed voice v
+    };
+
+    explicit BgmStreamPlayer(PsgMixer* psg = nullptr);
+
+    // `psg` receives the writes of step(); nullptr runs silent.
+    void set_psg(PsgMixer* psg);
+    // `trace`, when set, is filled by every frame step(), run() and seek()
+    // advance. nullptr (the default) turns tracing off.
+    void set_trace(StepTrace* trace) { trace_ = trace; }
+    // Both drop the seek index; load() or the next seek() rebuilds it.
+    // `tables` must outlive the player; nullptr selects FactoryFxTables().
+    void set_instrument_resolver(InstrumentResolver resolver);
+    void set_tables(const BgmFxTables* tables);
+    void set_seek_interval(uint32_t frames);
+    uint32_t seek_interval() const { return seek_interval_; }
+
+    // `note_table` holds NOTE_TABLE's (lo, hi) byte pairs; an empty stream
+    // leaves its voice off. Rewinds to frame 0 and builds the seek index.
+    bool load(const std::vector<uint8_t>& note_table,
+              const std::array<std::vector<uint8_t>, kVoices>& streams,
+              const std::array<uint16_t, kVoices>& loop_offsets,
+              std::string* error = nullptr);
+    // Same without copying: the player reads the spans in place (a mapped
+    // ParseBgmBinary() container, say), so they must stay valid until the
+    // next load() or the player's destruction.
+    bool load(BgmByteSpan note_table,
+              const std::array<BgmByteSpan, kVoices>& streams,
+              const std::array<uint16_t, kVoices>& loop_offsets,
+              std::string* error = nullptr);
+    bool loaded() const { return loaded_; }
+    // Set when a voice was stopped on a stream that loops without ever
+    // reaching a note or rest; load() fails with it when its first pass
+    // runs into one.
+    const std::string& error() const { return fault_; }
+    BgmByteSpan stream(int v) const { return streams_[static_cast<size_t>(v)]; }
+
+    // Back to frame 0. Does not touch the PSG.
+    void reset();
+    // One 60 Hz frame: stream events, fade, then voice effects.
+    void step();
+    // `frames` steps without writing the PSG; write_state() resyncs it.
+    void run(uint32_t frames);
+    // Jump to absolute `frame` through the seek index. Does not touch the PSG.
+    void seek(uint32_t frame);
+    // Write every voice's current tone / noise and attenuation, silencing the
+    // idle ones. Used after seek() or run().
+    void write_state() const;
+
+    uint32_t frame() const { return state_.frame; }
+    // Frames until the last stream ends or first wraps to its loop point
+    // (kMaxIndexFrames if it never does).
+    uint32_t pass_frames() const { return pass_frames_; }
+    // Every stream ran off its end without a loop point.
+    bool finished() const;
+    size_t checkpoint_count() const { return checkpoints_.size(); }
+
+    const BgmVoiceBank& voices() const { return state_.voices; }
+    // Voice `v` still reads its stream (the driver's BgmVoice.enabled).
+    bool stream_active(int v) const { return state_.cursors[static_cast<size_t>(v)].active; }
+    // Last SET_INST id read by voice `v`, or kNoInstrument.
+    uint8_t instrument(int v) const { return state_.cursors[static_cast<size_t>(v)].inst; }
+    uint8_t fade_attn() const { return state_.fade_attn; }
+
+private:
+    // Per-voice stream position; the effect state lives in State::voices.
+    struct Cursor {
+        uint32_t pos = 0;
+        uint8_t remaining = 0;
+        bool active = false;
+        bool pending_write = false;  // force a PSG write on the next effect pass
+        bool wrapped = false;        // reached its end or loop point at least once
+        // Subroutine call in progress (EXT CALL, see bgm_compress.h)
+        uint32_t call_start = 0;
+        uint32_t call_ret = 0;
+        uint8_t call_count = 0;
+        uint8_t inst = kNoInstrument;
+    };
+
+    // Everything step() mutates; a checkpoint is a copy of it.
+    struct State {
+        uint32_t frame = 0;
+        std::array<Cursor, kVoices> cursors{};
+        BgmVoiceBank voices;
+        uint8_t noise_val = 0;
+        uint8_t fade_speed = 0;
+        uint8_t fade_counter = 0;
+        uint8_t fade_attn = 0;
+    };
+
+    void advance(PsgMixer* psg);
+    bool step_stream(int ch, PsgMixer* psg);
+    void opcode(int ch, uint8_t op, bool* fade_dirty);
+    void tick_fx(int ch, bool force_write, PsgMixer* psg);
+    bool end_of_stream(int ch);
+    void build_index();
+
+    PsgMixer* psg_ = nullptr;
+    StepTrace* trace_ = nullptr;
+    InstrumentResolver resolver_;
+    const BgmFxTables* tables_ = nullptr;
+    uint32_t seek_interval_ = kDefaultSeekInterval;
+
+    bool loaded_ = false;
+    // Copies made by the vector load(); the spans point here or at the
+    // caller's memory.
+    std::vector<uint8_t> owned_note_table_;
+    std::array<std::vector<uint8_t>, kVoices> owned_streams_;
+    BgmByteSpan note_table_;
+    std::array<BgmByteSpan, kVoices> streams_;
+    std::array<uint16_t, kVoices> loops_{};
+    std::string fault_;
+
+    State state_;
+    std::vector<State> checkpoints_;  // checkpoints_[i].frame == i * seek_interval_
+    uint32_t pass_frames_ = 0;
+};
+
+}  // namespace ngpc
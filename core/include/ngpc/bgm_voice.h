@@ -0,0 +1,271 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "ngpc/instrument.h"
+
+namespace ngpc {
+
+// Position of one curve or macro inside a BgmFxTables step pool.
+struct BgmFxSpan {
+    uint16_t offset = 0;
+    uint8_t count = 0;
+};
+
+// Curve / macro tables a BgmVoiceBank reads, the host-side equivalent of
+// s_bgm_env_curves / s_bgm_pitch_curves / s_bgm_macros in sounds.c.
+//
+// Steps are interned back to back in one pool per kind and addressed by
+// BgmFxSpan, so binding a curve to a voice copies two integers. A table is
+// immutable once built; to change curves, build a new one.
+class BgmFxTables {
+public:
+    BgmFxTables() = default;
+    // Curves longer than 255 steps are truncated, like the driver's u8 count.
+    BgmFxTables(const std::vector<EnvCurveDef>& env_curves,
+                const std::vector<PitchCurveDef>& pitch_curves,
+                const std::vector<MacroDef>& macros);
+
+    // Span of curve / macro `id`; empty when the id is out of range.
+    BgmFxSpan env_curve(uint8_t id) const;
+    BgmFxSpan pitch_curve(uint8_t id) const;
+    BgmFxSpan macro(uint8_t id) const;
+
+    size_t env_curve_count() const { return env_curves_.size(); }
+    size_t pitch_curve_count() const { return pitch_curves_.size(); }
+    size_t macro_count() const { return macros_.size(); }
+    // FNV-1a over every curve and macro; equal tables hash equal.
+    uint64_t content_hash() const;
+
+    int8_t env_step(BgmFxSpan span, uint8_t index) const { return env_steps_[span.offset + index]; }
+    int16_t pitch_step(BgmFxSpan span, uint8_t index) const { return pitch_steps_[span.offset + index]; }
+    const MacroStepDef& macro_step(BgmFxSpan span, uint8_t index) const {
+        return macro_steps_[span.offset + index];
+    }
+
+private:
+    std::vector<int8_t> env_steps_;
+    std::vector<int16_t> pitch_steps_;
+    std::vector<MacroStepDef> macro_steps_;
+    std::vector<BgmFxSpan> env_curves_;
+    std::vector<BgmFxSpan> pitch_curves_;
+    std::vector<BgmFxSpan> macros_;
+};
+
+// Factory curves and macros, built once.
+const BgmFxTables& FactoryFxTables();
+
+// The driver's per-voice effect engine (BgmVoice_ApplyInstrument,
+// BgmVoice_SetNote, BgmVoice_UpdateFx, BgmVoice_CommandFromState) for the
+// four BGM voices: tone 0-2 and noise.
+//
+// State is kept as structure-of-arrays, one lane per voice, and tick() runs
+// UpdateFx over every voice in a single pass. Curves and macros are resolved
+// to spans of the bound BgmFxTables when an instrument is applied, so a note
+// never copies or allocates.
+//
+// UpdateFx is compiled once per feature set (FxFeature) and each voice picks
+// its kernel from a dispatch table whenever its instrument or effect
+// parameters change, so a plain square voice does not walk the LFO, sweep
+// and ADSR code every frame. Callers own the PSG: the bank only reports
+// which voices changed and what divider / attenuation they should output.
+class BgmVoiceBank {
+public:
+    static constexpr int kVoices = 4;
+
+    enum AdsrPhase : uint8_t {
+        kAdsrOff = 0,
+        kAdsrAttack = 1,
+        kAdsrDecay = 2,
+        kAdsrSustain = 3,
+        kAdsrRelease = 4,
+    };
+
+    // Effect stages a voice may need; selects its UpdateFx kernel.
+    enum FxFeature : uint8_t {
+        kFxMacro = 1 << 0,
+        kFxPitchCurve = 1 << 1,
+        kFxEnv = 1 << 2,
+        kFxAdsr = 1 << 3,
+        kFxSweep = 1 << 4,
+        kFxVibrato = 1 << 5,
+        kFxLfo = 1 << 6,
+        kFxAll = 0x7F,
+    };
+
+    // `tables` must outlive the bank; nullptr selects FactoryFxTables().
+    explicit BgmVoiceBank(const BgmFxTables* tables = nullptr);
+
+    // Rebinding resets every voice, since their spans point into the old
+    // tables. Binding the tables already in use is a no-op.
+    void set_tables(const BgmFxTables* tables);
+    const BgmFxTables& tables() const { return *tables_; }
+
+    // Every voice idle with all effects off (attn 2, no curve, no macro).
+    void reset();
+    void reset_voice(int v);
+
+    // BgmVoice_ApplyInstrument. `noise_mode` disables sweep/vibrato/LFO, as
+    // the driver does for the noise voice.
+    void apply_instrument(int v, const BgmInstrumentDef& def, bool noise_mode);
+    // BgmVoice_SetNote + BgmVoice_MacroReset: restart envelopes for a new note.
+    void note_on(int v, uint16_t divider);
+    // Key release: enter the ADSR release phase when the instrument has one,
+    // otherwise stop the voice.
+    void note_off(int v);
+    // Stop the voice immediately.
+    void cut(int v);
+
+    // Stream opcodes that patch single parameter groups.
+    void set_attn(int v, uint8_t attn);                                          // SET_ATTN
+    void set_env(int v, uint8_t step, uint8_t speed);                            // SET_ENV
+    void set_vibrato(int v, uint8_t depth, uint8_t speed, uint8_t delay);        // SET_VIB
+    void set_sweep(int v, uint16_t end, int16_t step, uint8_t speed);            // SET_SWEEP
+    void set_adsr(int v, uint8_t attack, uint8_t decay, uint8_t sustain,
+                  uint8_t sustain_rate, uint8_t release);                        // SET_ADSR / ADSR5
+    void set_lfo(int v, uint8_t wave, uint8_t rate, uint8_t depth);              // SET_LFO
+    void set_mod2(int v, uint8_t algo,
+                  bool on1, uint8_t wave1, uint8_t hold1, uint8_t rate1, uint8_t depth1,
+                  bool on2, uint8_t wave2, uint8_t hold2, uint8_t rate2, uint8_t depth2);  // EXT MOD2
+    void set_expression(int v, uint8_t expression);                              // SET_EXPR
+    void set_pitch_bend(int v, int16_t bend);                                    // PITCH_BEND
+
+    // BgmVoice_UpdateFx on every active voice. Returns a bitmask (bit v) of
+    // the voices whose PSG output changed.
+    uint8_t tick();
+    // Single-voice variant, for callers that only drive one lane.
+    bool tick_voice(int v);
+
+    // Run every voice through the kFxAll kernel instead of its specialised
+    // one. Output is identical; this only exists to measure the difference.
+    void set_force_full_kernel(bool enabled);
+    uint8_t features(int v) const { return fx_[static_cast<size_t>(v)]; }
+
+    // BgmVoice_CommandFromState: final divider (macro + pitch curve + bend +
+    // LFO batched into one clamp, then vibrato) and final attenuation
+    // (envelope + LFO, then expression and the song-wide fade).
+    uint16_t output_divider(int v) const;
+    uint8_t output_attn(int v, uint8_t fade_attn = 0) const;
+
+    bool active(int v) const { return note_active_[static_cast<size_t>(v)] != 0; }
+    bool noise_mode(int v) const { return mode_[static_cast<size_t>(v)] != 0; }
+    uint8_t attn_cur(int v) const { return attn_cur_[static_cast<size_t>(v)]; }
+    uint8_t adsr_phase(int v) const { return adsr_phase_[static_cast<size_t>(v)]; }
+    bool adsr_on(int v) const { return adsr_on_[static_cast<size_t>(v)] != 0; }
+    uint8_t adsr_release(int v) const { return adsr_release_[static_cast<size_t>(v)]; }
+    uint16_t tone_div(int v) const { return tone_div_[static_cast<size_t>(v)]; }
+    // LFOs running on the voice (0-2) and the lfo_algo routing their deltas.
+    int lfo_count(int v) const {
+        return (lfo_on_[static_cast<size_t>(v)] ? 1 : 0) + (lfo2_on_[static_cast<size_t>(v)] ? 1 : 0);
+    }
+    uint8_t lfo_algo(int v) const { return lfo_algo_[static_cast<size_t>(v)]; }
+
+private:
+    template <typename T>
+    using Lane = std::array<T, kVoices>;
+
+    using Kernel = bool (BgmVoiceBank::*)(size_t);
+
+    template <uint8_t Fx>
+    bool update_fx(size_t v);
+    template <size_t... Fx>
+    static constexpr std::array<Kernel, sizeof...(Fx)> make_kernels(std::index_sequence<Fx...>);
+    static const std::array<Kernel, kFxAll + 1> kKernels;
+
+    void select_kernel(size_t v);
+    bool pitch_curve_tick(size_t v);
+    bool adsr_tick(size_t v);
+    bool env_tick(size_t v);
+    bool sweep_tick(size_t v);
+    bool vibrato_tick(size_t v);
+    bool lfo_tick(size_t v);
+    bool macro_tick(size_t v);
+    void macro_reset(size_t v);
+
+    const BgmFxTables* tables_ = nullptr;
+    bool force_full_kernel_ = false;
+
+    Lane<uint8_t> note_active_{};
+    Lane<uint8_t> fx_{};  // FxFeature mask, index into kKernels
+    Lane<uint8_t> mode_{};
+    Lane<uint8_t> attn_{};
+    Lane<uint8_t> attn_cur_{};
+    Lane<uint16_t> base_div_{};
+    Lane<uint16_t> tone_div_{};
+    Lane<uint8_t> expression_{};
+    Lane<int16_t> pitch_bend_{};
+
+    // Legacy envelope + curves
+    Lane<uint8_t> env_on_{};
+    Lane<uint8_t> env_step_{};
+    Lane<uint8_t> env_speed_{};
+    Lane<uint8_t> env_counter_{};
+    Lane<BgmFxSpan> env_curve_{};
+    Lane<uint8_t> env_index_{};
+    Lane<BgmFxSpan> pitch_curve_{};
+    Lane<uint8_t> pitch_index_{};
+    Lane<uint8_t> pitch_counter_{};
+    Lane<int16_t> pitch_offset_{};
+
+    // Vibrato
+    Lane<uint8_t> vib_on_{};
+    Lane<uint8_t> vib_depth_{};
+    Lane<uint8_t> vib_speed_{};
+    Lane<uint8_t> vib_delay_{};
+    Lane<uint8_t> vib_delay_counter_{};
+    Lane<uint8_t> vib_counter_{};
+    Lane<int8_t> vib_dir_{};
+
+    // LFO1 / LFO2
+    Lane<uint8_t> lfo_on_{};
+    Lane<uint8_t> lfo_wave_{};
+    Lane<uint8_t> lfo_hold_{};
+    Lane<uint8_t> lfo_rate_{};
+    Lane<uint8_t> lfo_depth_{};
+    Lane<uint8_t> lfo_hold_counter_{};
+    Lane<uint8_t> lfo_counter_{};
+    Lane<int8_t> lfo_sign_{};
+    Lane<int16_t> lfo_delta_{};
+    Lane<uint8_t> lfo2_on_{};
+    Lane<uint8_t> lfo2_wave_{};
+    Lane<uint8_t> lfo2_hold_{};
+    Lane<uint8_t> lfo2_rate_{};
+    Lane<uint8_t> lfo2_depth_{};
+    Lane<uint8_t> lfo2_hold_counter_{};
+    Lane<uint8_t> lfo2_counter_{};
+    Lane<int8_t> lfo2_sign_{};
+    Lane<int16_t> lfo2_delta_{};
+    Lane<uint8_t> lfo_algo_{};
+    Lane<int16_t> lfo_pitch_delta_{};
+    Lane<int8_t> lfo_attn_delta_{};
+
+    // Sweep
+    Lane<uint8_t> sweep_on_{};
+    Lane<uint16_t> sweep_end_{};
+    Lane<int16_t> sweep_step_{};
+    Lane<uint8_t> sweep_speed_{};
+    Lane<uint8_t> sweep_counter_{};
+
+    // Macro
+    Lane<BgmFxSpan> macro_{};
+    Lane<uint8_t> macro_step_{};
+    Lane<uint8_t> macro_counter_{};
+    Lane<uint8_t> macro_active_{};
+    Lane<int16_t> macro_pitch_{};
+
+    // ADSR
+    Lane<uint8_t> adsr_on_{};
+    Lane<uint8_t> adsr_attack_{};
+    Lane<uint8_t> adsr_decay_{};
+    Lane<uint8_t> adsr_sustain_{};
+    Lane<uint8_t> adsr_sustain_rate_{};
+    Lane<uint8_t> adsr_release_{};
+    Lane<uint8_t> adsr_phase_{};
+    Lane<uint8_t> adsr_counter_{};
+};
+
+}  // namespace ngpc
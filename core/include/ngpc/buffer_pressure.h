@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ngpc/bgm_export.h"
+#include "ngpc/native_sounds.h"
+
+namespace ngpc {
+
+// SND_BUF_MAX: PSG commands one driver frame can hand to the Z80.
+constexpr int kDriverBufferCommands = 5;
+
+struct BufferPressureOptions {
+    // Frames to play; 0 plays `passes` times through the song (the loop, or
+    // the end of the longest stream, as BgmStreamPlayer::pass_frames() finds it).
+    uint32_t frames = 0;
+    int passes = 1;
+    // Game SFX load: from frame `sfx_offset` on, every `sfx_interval` frames
+    // (0 = none) the next entry of `sfx` fires, round robin.
+    uint32_t sfx_interval = 0;
+    uint32_t sfx_offset = 1;
+    std::vector<NativeSfx> sfx;
+    // Game-side commits: every `game_send_interval` frames (0 = none) the
+    // game sends one command with Sfx_SendBytes (a noise silence, FF FF FF)
+    // `game_send_delay` main-CPU states after Sounds_Update returns. It is
+    // refused while the Z80 is still writing out the frame's commit.
+    uint32_t game_send_interval = 0;
+    uint32_t game_send_delay = 0;
+    // Every `lag_interval` frames (0 = none) the game misses a VBlank, and
+    // Sounds_Update steps two driver frames back to back. The driver's code
+    // takes no time in the model, so the second commit always finds the Z80
+    // busy with the first: a worst-case bound, not a hardware prediction.
+    uint32_t lag_interval = 0;
+    // Bursts kept in the report, worst first.
+    size_t max_bursts = 8;
+};
+
+// One VBlank (two driver frames when the game lagged). `queued` counts the commands the frame tried to buffer,
+// retries of earlier drops included; `dropped` those that did not reach the
+// Z80: found the buffer full, or sat in a commit WaitBufferFree refused
+// (`refused`) because the Z80 still held the last one. Dropped channels are
+// retried by the driver on the next frame.
+struct FramePressure {
+    uint8_t queued = 0;
+    uint8_t dropped = 0;
+    uint8_t refused = 0;
+};
+
+// A run of consecutive frames that dropped commands.
+struct PressureBurst {
+    uint32_t first_frame = 0;
+    uint32_t frames = 0;
+    uint32_t dropped = 0;
+    uint8_t peak = 0;  // most commands queued by one of its frames
+};
+
+struct BufferPressureReport {
+    // timeline[i] is frame i + 1: the first update after Bgm_StartLoop4Ex.
+    std::vector<FramePressure> timeline;
+    uint32_t full_frames = 0;      // queued exactly kDriverBufferCommands
+    uint32_t overflow_frames = 0;  // dropped at least one command
+    uint32_t dropped = 0;          // commands, the sum of the timeline
+    uint32_t refused_commits = 0;  // commits refused by a busy Z80
+    uint32_t game_sends = 0;       // game-side commits attempted
+    uint8_t peak = 0;
+    uint32_t peak_frame = 0;       // first frame reaching `peak`
+    std::vector<PressureBurst> bursts;
+};
+
+// Plays `song` through the shipping driver (NativeSounds), so the change
+// detection of BufferPushIfChanged, the retries of dropped channels and the
+// SFX priority are the cartridge's own, and records what each frame asked of
+// the 5-command buffer and what the Z80 took of it. The Z80 is timed (see
+// NativeSounds::set_z80_timed): each commit keeps SND_COUNT set for the
+// stub's worst-case drain time, 66 + 130 Z80 T-states per command, and a
+// frame apart it is always out. Without game load, drops then come only
+// from a full buffer or from commits the driver makes back to back within
+// one update (Bgm_Stop silencing the voices, say). Uses the NativeSounds
+// singleton: not thread-safe, and it leaves the driver stopped and untimed.
+bool AnalyzeBufferPressure(const BgmExportStreams& song,
+                           const BufferPressureOptions& options,
+                           BufferPressureReport* report,
+                           std::string* error = nullptr);
+
+}  // namespace ngpc
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ngpc/bgm_stream.h"
+
+namespace ngpc {
+
+// TLCS-900H states in one 60 Hz frame at 6.144 MHz.
+constexpr uint32_t kMainCpuFrameCycles = 6144000 / 60;
+
+// Main-CPU cost of each code path of Sounds_Update(), in TLCS-900H states.
+// The defaults are estimates read off the driver's C for a non-optimising
+// compiler (loads, compares and calls counted per path), not measurements;
+// replace them with timer readings from hardware to calibrate the model.
+struct BgmCycleCosts {
+    uint32_t frame = 620;         // Sounds_Update, idle Sfx_Update, Bgm_Update prologue, BufferBegin/Commit
+    uint32_t voice = 90;          // BgmVoice_Step entry on an enabled voice
+    uint32_t event = 260;         // note / rest / end: read, duration scaling, SetNote and gate
+    uint32_t opcode = 110;        // opcode dispatch
+    uint32_t operand_byte = 14;   // each opcode parameter byte
+    uint32_t fx = 70;             // BgmVoice_UpdateFx entry and feature tests
+    uint32_t macro = 150;         // BgmVoice_MacroTick
+    uint32_t pitch_curve = 120;
+    uint32_t env = 90;            // legacy envelope or envelope curve
+    uint32_t adsr = 140;          // ADSR state machine
+    uint32_t sweep = 130;
+    uint32_t vibrato = 120;
+    uint32_t lfo = 210;           // each running LFO (BgmLfoTick)
+    uint32_t lfo_resolve = 160;   // BgmLfoResolve: lfo_algo routing of the deltas
+    uint32_t command = 240;       // BgmVoice_CommandFromState: divider / attn composition and clamps
+    uint32_t push = 150;          // BufferPushIfChanged: compare and queue 3 bytes
+};
+
+struct BgmCycleOptions {
+    // Frames to walk; 0 walks `passes` times through the song.
+    uint32_t frames = 0;
+    int passes = 1;
+    BgmCycleCosts costs;
+    // Cycles per frame the sound code may take; 0 = no budget check.
+    uint32_t budget = 0;
+};
+
+// Cost of the voices playing one instrument (kNoInstrument: voices before
+// any SET_INST, as in pre-baked streams).
+struct InstrumentCycles {
+    uint8_t inst = BgmStreamPlayer::kNoInstrument;
+    uint32_t voice_frames = 0;  // frames x voices it was on
+    uint64_t cycles = 0;
+    uint32_t peak = 0;          // most cycles one of its voices took in a frame
+    uint8_t features = 0;       // BgmVoiceBank::FxFeature seen on its voices
+};
+
+struct BgmCycleReport {
+    std::vector<uint32_t> timeline;  // estimated cycles of frame i + 1
+    double mean = 0.0;
+    uint32_t p99 = 0;
+    uint32_t max = 0;
+    uint32_t max_frame = 0;
+    uint32_t over_budget = 0;        // frames above options.budget
+    // Most expensive first (by total cycles).
+    std::vector<InstrumentCycles> instruments;
+};
+
+// Walks the song loaded in `player` frame by frame (it is rewound first and
+// left at the end) and prices what each frame did on each voice: stream
+// events and opcodes, then on the other frames the UpdateFx stages the
+// voice's instrument runs, plus a command and a buffer push whenever its
+// output changes. `player` carries the instrument resolver and FX tables
+// the streams need.
+bool EstimateBgmCycles(BgmStreamPlayer* player,
+                       const BgmCycleOptions& options,
+                       BgmCycleReport* report,
+                       std::string* error = nullptr);
+
+}  // namespace ngpc
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <string>
 #include <vector>
@@ -8,4 +9,28 @@ namespace ngpc {
 
 bool ReadBinaryFile(const std::string& path, std::vector<uint8_t>* out, std::string* error);
 
+// Read-only view of a whole file. Memory-mapped where the platform allows it,
+// so large files are paged in on demand instead of copied; read into memory
+// otherwise. The view is valid until close() or destruction.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path, std::string* error);
+    void close();
+
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    void* mapping_ = nullptr;  // platform mapping, nullptr when data_ points into fallback_
+    std::vector<uint8_t> fallback_;
+};
+
 }  // namespace ngpc
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ngpc {
+
+// Streaming FLAC encoder for mono 16-bit renders. Each 4096-sample block
+// becomes one frame, encoded as whichever subframe is smallest: CONSTANT
+// (silence, held levels), FIXED orders 0-4, quantised LPC up to order 8, or
+// VERBATIM. Trailing zero bits shared by the whole block (the PSG mixes
+// volumes in steps of 64) are stripped first, and residuals are Rice coded
+// with a searched partition order.
+//
+// The stream starts with header(); its STREAMINFO holds the sizes and MD5
+// only once finish() has run, so write it first and rewrite it at the end
+// (it never changes size).
+class FlacEncoder {
+public:
+    static constexpr int kBlockSize = 4096;
+    static constexpr size_t kHeaderBytes = 42;  // "fLaC" + STREAMINFO
+
+    explicit FlacEncoder(int sample_rate);
+
+    std::array<uint8_t, kHeaderBytes> header() const;
+
+    // Appends the frames of every complete block to *out and keeps the rest
+    // for the next call.
+    void write(const int16_t* samples, size_t count, std::vector<uint8_t>* out);
+
+    // Encodes the last, possibly shorter, block and completes STREAMINFO.
+    void finish(std::vector<uint8_t>* out);
+
+    uint64_t total_samples() const { return total_samples_; }
+
+private:
+    void encode_block(const int32_t* samples, int count, std::vector<uint8_t>* out);
+
+    int sample_rate_ = 44100;
+    std::vector<int32_t> pending_;
+    uint64_t total_samples_ = 0;
+    uint32_t frame_number_ = 0;
+    uint32_t min_frame_bytes_ = 0;
+    uint32_t max_frame_bytes_ = 0;
+    std::array<uint32_t, 4> md5_state_{};
+    std::array<uint8_t, 64> md5_buffer_{};
+    uint64_t md5_bytes_ = 0;
+    std::array<uint8_t, 16> md5_{};
+    bool finished_ = false;
+};
+
+}  // namespace ngpc
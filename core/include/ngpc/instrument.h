@@ -70,6 +70,12 @@ struct InstrumentPreset {
     BgmInstrumentDef def;
 };
 
+// Field-by-field; two presets with equal definitions play identically.
+bool InstrumentDefEquals(const BgmInstrumentDef& a, const BgmInstrumentDef& b);
+// FNV-1a over the same fields, continuing from `h`: equal definitions hash
+// equal, so a hash can stand in for the definition in cache keys.
+uint64_t InstrumentDefHash(const BgmInstrumentDef& def, uint64_t h = 1469598103934665603ull);
+
 std::vector<InstrumentPreset> FactoryInstrumentPresets();
 std::vector<EnvCurveDef> FactoryEnvCurves();
 std::vector<PitchCurveDef> FactoryPitchCurves();
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <vector>
 
 namespace ngpc {
 
@@ -16,6 +19,49 @@ struct MidiInfo {
     std::string warning;
 };
 
+enum MidiEventType : uint8_t {
+    kMidiNoteOff = 0,
+    kMidiNoteOn = 1,  // velocity > 0; a zero-velocity note-on reads as kMidiNoteOff
+    kMidiProgram = 2,
+    kMidiTempo = 3,
+};
+
+struct MidiEvent {
+    uint32_t tick = 0;  // absolute, in the file's division
+    uint8_t type = kMidiNoteOff;
+    uint8_t channel = 0;
+    uint8_t key = 0;    // note number, or program
+    uint8_t velocity = 0;
+
+    // kMidiTempo keeps the 24-bit microseconds per beat in channel:key:velocity.
+    uint32_t tempo_us() const {
+        return (static_cast<uint32_t>(channel) << 16) | (static_cast<uint32_t>(key) << 8) | velocity;
+    }
+};
+
+// A type 0/1 file decoded in one pass: notes, program changes and tempo
+// changes of every track, merged and sorted by tick. Events on the same tick
+// come tempo, program, note-off, note-on, otherwise in file order.
+struct MidiSong {
+    int format = 0;
+    int tracks = 0;
+    int ticks_per_beat = 0;
+    int tempo_events_outside_track0 = 0;
+    uint32_t delta_gcd = 0;  // of every non-zero delta time
+    // First malformed-track problem, if any. Decoding of that track stopped
+    // there; the events before it are kept.
+    std::string damage;
+    std::vector<MidiEvent> events;
+};
+
+// Header problems fail; track problems land in MidiSong::damage.
+bool ParseMidi(const uint8_t* data, size_t size, MidiSong* out, std::string* error);
+// Memory-maps `path` and parses it.
+bool ReadMidiSong(const std::string& path, MidiSong* out, std::string* error);
+
+// Whether the converter can take the file as is (type 1, tempo in track 1,
+// division reducible to 48), from an already decoded song or from a file.
+MidiInfo InspectMidi(const MidiSong& song);
 MidiInfo InspectMidi(const std::string& path);
 
 }  // namespace ngpc
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ngpc/bgm_export.h"
+#include "ngpc/midi.h"
+
+namespace ngpc {
+
+// Profile switches, named after the midi_to_ngpc command-line flags.
+struct MidiConvertOptions {
+    bool force_tone_streams = false;  // --force-tone-streams: BGM_CH0..2 even for a one-voice song
+    bool force_noise_stream = false;  // --force-noise-stream: BGM_CHN even without drums
+    bool opcodes = true;              // cleared by --no-opcodes: notes and rests only
+    bool c_array = false;             // --c-array: C arrays instead of a TLCS-900H .inc
+};
+
+struct MidiConversion {
+    BgmExportStreams streams;
+    bool mono = false;           // single tone voice, no drums: streams[0] is BGM_MONO
+    int notes = 0;
+    int notes_dropped = 0;       // stolen by the three tone voices running out
+    uint32_t frames = 0;         // song length at 60 Hz
+    std::vector<std::string> warnings;
+};
+
+// MIDI -> driver streams, in process. Ticks are quantized to a 48-tick beat
+// and the tempo map is baked into 60 Hz durations; channel 10 drums go to the
+// noise voice and everything else is spread over three tone voices, oldest
+// note stolen first. With opcodes on, velocity becomes SET_ATTN.
+bool ConvertMidi(const MidiSong& song, const MidiConvertOptions& options,
+                 MidiConversion* out, std::string* error);
+bool ConvertMidiFile(const std::string& path, const MidiConvertOptions& options,
+                     MidiConversion* out, std::string* error);
+
+// The source file for a conversion: FormatBgmC or FormatBgmAsm per
+// options.c_array.
+std::string FormatMidiConversion(const MidiConversion& conversion, const MidiConvertOptions& options);
+
+}  // namespace ngpc
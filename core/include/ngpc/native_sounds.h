@@ -0,0 +1,136 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ngpc {
+
+class PollingDriverHost;
+class PsgMixer;
+
+// One project SFX as a game's Sfx_Play(id) fires it: the tone part through
+// Sfx_PlayToneEx and the noise part through Sfx_PlayNoiseEx, each when on.
+// Out-of-range values are clamped by the driver.
+struct NativeSfx {
+    bool tone_on = false;
+    uint8_t tone_ch = 0;
+    uint16_t tone_div = 1;
+    uint8_t tone_attn = 0;
+    uint8_t tone_frames = 0;
+    bool tone_sw_on = false;
+    uint16_t tone_sw_end = 1;
+    int16_t tone_sw_step = 1;
+    uint8_t tone_sw_speed = 1;
+    bool tone_sw_ping = false;
+    bool tone_env_on = false;
+    uint8_t tone_env_step = 1;
+    uint8_t tone_env_spd = 1;
+
+    bool noise_on = false;
+    uint8_t noise_rate = 0;
+    uint8_t noise_type = 0;
+    uint8_t noise_attn = 0;
+    uint8_t noise_frames = 0;
+    uint8_t noise_burst = 0;
+    uint8_t noise_burst_dur = 1;
+    bool noise_env_on = false;
+    uint8_t noise_env_step = 1;
+    uint8_t noise_env_spd = 1;
+};
+
+// driver_custom_latest/sounds.c compiled for the host (ngpc_sounds_native):
+// the exact BGM/SFX logic that ships on cartridges, running at native speed.
+//
+// The driver keeps its state in file-scope statics, so there is exactly one
+// of it per process and it is not thread-safe; instance() hands out that one.
+// The Z80 side is modelled as infinitely fast by default: every committed
+// command buffer is drained before the driver can see SND_COUNT busy, so a
+// commit is never refused and drops() only counts commands that found a
+// frame's buffer full. set_z80_timed() gives each commit the time the Z80
+// stub takes to write it out, against a main-CPU clock that update() and
+// advance_main_cpu() move; WaitBufferFree then refuses a commit made before
+// the last one is out. The driver's own code takes no time on that clock.
+class NativeSounds {
+public:
+    static constexpr int kVoices = 4;
+    static constexpr int kNoteTableEntries = 51;  // NOTE_MAX_INDEX + 1
+
+    static NativeSounds& instance();
+
+    NativeSounds(const NativeSounds&) = delete;
+    NativeSounds& operator=(const NativeSounds&) = delete;
+
+    // Sounds_Init: upload the Z80 stub into shared RAM and reset every voice.
+    void init();
+
+    // Bgm_SetNoteTable + Bgm_StartLoop4Ex on private copies of the song.
+    // `note_table` holds NOTE_TABLE's (lo, hi) byte pairs; an empty stream
+    // leaves its voice off.
+    bool start_bgm(const std::vector<uint8_t>& note_table,
+                   const std::array<std::vector<uint8_t>, kVoices>& streams,
+                   const std::array<uint16_t, kVoices>& loop_offsets,
+                   std::string* error = nullptr);
+    void stop_bgm();                  // Bgm_Stop
+    void set_tempo(uint8_t speed);    // Bgm_SetTempo
+    void set_gate(uint8_t percent);   // Bgm_SetGate
+    void fade_out(uint8_t speed);     // Bgm_FadeOut
+    bool bgm_playing() const;
+
+    // Queues `sfx` for the next update(), which sends it with the BGM.
+    void play_sfx(const NativeSfx& sfx);
+
+    // TLCS-900H states in one 60 Hz frame at 6.144 MHz.
+    static constexpr uint32_t kMainCpuFrameStates = 6144000 / 60;
+
+    // The VBlank interrupt: advance VBCounter and run Sounds_Update(). With
+    // `vblanks` > 1 the game missed some, and the driver steps that many
+    // frames in one call, committing once per frame.
+    void update(uint8_t vblanks = 1);
+
+    // Game code between VBlanks, for the timed Z80: `states` of main-CPU time
+    // pass, then send_bytes() commits one command as Sfx_SendBytes does.
+    void advance_main_cpu(uint32_t states);
+    void send_bytes(uint8_t b1, uint8_t b2, uint8_t b3);
+
+    // Time the Z80's drain of each commit (off by default). Only update(),
+    // advance_main_cpu() and send_bytes() are timed: init(), start_bgm() and
+    // stop_bgm() are drained as they commit.
+    void set_z80_timed(bool timed);
+    bool z80_timed() const { return z80_timed_; }
+
+    // What the driver handed the Z80 since the last reset_z80_stats().
+    struct Z80Stats {
+        uint32_t pushed = 0;     // commands written into SND_BUF
+        uint32_t committed = 0;  // of those, commands in commits SND_COUNT took
+        uint32_t refused = 0;    // commits that found SND_COUNT still set
+    };
+    Z80Stats z80_stats() const;
+    void reset_z80_stats();
+
+    // PSG bytes the Z80 stub has written since the last clear, in order. The
+    // stub writes every byte to both 0x4001 and 0x4000.
+    const std::vector<uint8_t>& psg_writes() const { return psg_writes_; }
+    void clear_psg_writes() { psg_writes_.clear(); }
+    // Replay psg_writes() straight into a PSG, or through the polling driver
+    // of an emulated Z80 (5 commands per commit, like SND_BUF). forward_to()
+    // fails when that Z80 has not consumed the previous commit yet.
+    void write_to(PsgMixer& psg) const;
+    bool forward_to(PollingDriverHost& host) const;
+
+    uint16_t drops() const;  // Sounds_DebugDrops
+
+private:
+    NativeSounds();
+
+    static void OnPsgCommands(void* user, const uint8_t* cmds, uint8_t count);
+
+    std::vector<uint8_t> note_table_;
+    std::array<std::vector<uint8_t>, kVoices> streams_;
+    std::vector<uint8_t> psg_writes_;
+    bool z80_timed_ = false;
+    uint32_t game_states_ = 0;  // advance_main_cpu() time since the last VBlank
+};
+
+}  // namespace ngpc
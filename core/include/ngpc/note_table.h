@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace ngpc {
+
+// NOTE_TABLE entries the driver can index (notes 1..51).
+constexpr int kMaxDriverNotes = 51;
+
+// Pitch error of playing divider `played` for divider `wanted`, in cents.
+// Positive when it plays sharp (smaller divider = higher pitch).
+double DividerCents(uint16_t wanted, uint16_t played);
+
+// Two-pass NOTE_TABLE builder. Pass 1 add()s every divider a song plays,
+// build() picks the table, pass 2 asks index_of() for each note.
+class NoteTablePlanner {
+public:
+    struct Detune {
+        uint16_t divider = 0;  // wanted
+        uint16_t entry = 0;    // NOTE_TABLE divider it plays as
+        double cents = 0.0;    // DividerCents(divider, entry)
+        uint64_t uses = 0;
+    };
+
+    // One use of `divider`; `weight` is whatever usage means to the caller
+    // (notes, frames...).
+    void add(uint16_t divider, uint64_t weight = 1);
+
+    // Every divider when they fit, in first-seen order. Otherwise the
+    // `capacity` entries minimising the usage-weighted cents error: optimal
+    // 1-D k-medians over the sorted dividers by dynamic programming, each
+    // entry the weighted median of its cluster.
+    void build(int capacity = kMaxDriverNotes);
+
+    // 0-based NOTE_TABLE index `divider` plays as, after build(). Dividers
+    // never add()ed fall back to the closest entry.
+    int index_of(uint16_t divider) const;
+
+    const std::vector<uint16_t>& table() const { return table_; }
+    size_t distinct() const { return first_seen_.size(); }
+    bool capped() const { return capped_; }
+
+    // Dividers that play off-pitch, largest |cents| first.
+    std::vector<Detune> worst_detunings(size_t max_count) const;
+
+private:
+    std::unordered_map<uint16_t, uint64_t> uses_;
+    std::vector<uint16_t> first_seen_;
+    std::vector<uint16_t> table_;
+    std::unordered_map<uint16_t, int> index_;
+    bool capped_ = false;
+};
+
+}  // namespace ngpc
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+
+namespace ngpc {
+
+// Worker count for ParallelFor when the caller passes 0: the hardware thread
+// count, at least 1.
+unsigned DefaultWorkerCount();
+
+// Runs fn(i) for every i in [0, count) on up to `workers` threads (0 selects
+// DefaultWorkerCount()) and returns when all of them are done. Indices are
+// handed out one at a time, so uneven jobs balance themselves; the calling
+// thread works too. Once `*cancel` is set no new index is started, and jobs
+// already running finish normally.
+//
+// `fn` must not throw and must not share mutable state across indices
+// without its own synchronisation.
+void ParallelFor(size_t count,
+                 unsigned workers,
+                 const std::function<void(size_t index)>& fn,
+                 const std::atomic<bool>* cancel = nullptr);
+
+}  // namespace ngpc
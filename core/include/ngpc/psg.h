@@ -5,6 +5,8 @@
 
 namespace ngpc {
 
+class PsgLog;
+
 // The T6W28, driven from the Z80's two sound ports.
 //
 // ⚡ ONE CHIP, TWO PORTS -- NOT TWO CHIPS. This used to run a pair of SN76489-style
@@ -39,6 +41,25 @@ public:
     // mirroring driver the two sides are equal, so nothing is lost.
     void render(int16_t* out, int frames);
 
+    // Advances the chip exactly as render(frames) would, without producing the
+    // samples: an offline render fast-forwards to its checkpoints with this.
+    void skip(int frames);
+
+    // Takes over `other`'s chip state (oscillators, latches, queued samples).
+    void copy_state_from(const PsgMixer& other);
+
+    // Logs every port write from now on, stamped with the samples the chip has
+    // produced since this call. reset() starts the log over. The cost is two
+    // or three bytes appended under the lock the write already holds; reserve()
+    // the log before going live so the audio thread does not have to grow it.
+    // Pass nullptr to stop, and read the log only once detached.
+    void set_recorder(PsgLog* log);
+
+    // Resets the chip to the log's rate and plays the log back into `out`:
+    // each write lands on exactly the sample it was recorded at, so a log
+    // recorded from reset() reproduces the original render sample for sample.
+    void replay(const PsgLog& log, int16_t* out, uint64_t frames);
+
 private:
     struct Impl;
     std::unique_ptr<Impl> impl_;
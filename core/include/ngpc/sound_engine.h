@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <functional>
 #include <string>
 
 #include "ngpc/psg.h"
@@ -10,6 +11,17 @@ namespace ngpc {
 
 class SoundEngine {
 public:
+    // Invoked from inside render() at the exact sample where each driver frame
+    // begins, with that sample's position on the engine's output timeline. It runs
+    // on whichever thread renders audio, between two PSG slices, so it may write
+    // the chip freely but must not block.
+    using FrameCallback = std::function<void(uint64_t sample_pos)>;
+
+    // A frame callback that sets its own frame length: it returns how many
+    // samples to render before it is called again (at least 1). For sources
+    // timed to the sample rather than to a driver frame, such as a VGM log.
+    using TimedCallback = std::function<int(uint64_t sample_pos)>;
+
     bool init(int sample_rate_hz);
     void reset();
 
@@ -22,12 +34,46 @@ public:
 
     void render(int16_t* out, int frames);
 
+    // render() without the samples: the frame callback still fires at every
+    // boundary and the PSG advances exactly as render() would move it. Lets an
+    // offline render run ahead to its checkpoints cheaply.
+    void skip(int frames);
+
+    // Takes over `other`'s PSG and frame-clock state, so rendering here carries
+    // on from where `other` stopped. The frame callback and the Z80 are not
+    // copied; install the callback first (set_frame_callback() resets the clock).
+    void copy_state_from(const SoundEngine& other);
+
+    // Frame clock. With a callback installed, render() cuts its buffer at every
+    // 1/frame_rate_hz s of OUTPUT samples and calls it there, so sequencing follows
+    // the audio clock instead of whatever timer happens to call render(). The
+    // first boundary is the next sample rendered. Pass an empty callback to remove.
+    void set_frame_callback(FrameCallback callback, int frame_rate_hz = 60);
+    bool has_frame_callback() const;
+
+    // Installs a TimedCallback in place of the frame callback (and the other
+    // way round: set_frame_callback() removes it). It is first called before
+    // the next sample rendered. Pass an empty callback to remove.
+    void set_timed_callback(TimedCallback callback);
+
+    // Samples produced by render() since init()/reset().
+    uint64_t samples_rendered() const;
+
     int sample_rate() const;
     PsgMixer& psg();
     Z80Machine& z80();
 
 private:
+    int next_frame_length();
+    void run(int16_t* out, int frames);  // render(), or skip() when out is null
+
     int sample_rate_hz_ = 0;
+    FrameCallback frame_callback_;
+    TimedCallback timed_callback_;
+    int frame_rate_hz_ = 60;
+    int frame_samples_left_ = 0;    // 0 = a boundary is due before the next sample
+    int frame_phase_ = 0;           // remainder carried so fractional frames add up
+    uint64_t samples_rendered_ = 0;
     PsgMixer psg_;
     Z80Machine z80_;
 };
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+namespace ngpc {
+
+// Fixed-capacity single-producer / single-consumer queue.
+//
+// Built for the one hand-off this tool has between the render loop and the UI:
+// the audio side pushes small POD events (row started, pattern switched...) and
+// the UI drains them on its own timer. Neither side ever blocks or allocates;
+// when the UI falls behind, push() reports failure and the event is dropped
+// rather than stalling audio. `Capacity` must be a power of two.
+template <typename T, size_t Capacity>
+class SpscRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "SpscRing capacity must be a power of two");
+
+public:
+    // Producer side only.
+    bool push(const T& value) {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        const size_t tail = tail_.load(std::memory_order_acquire);
+        if (head - tail >= Capacity) {
+            return false;
+        }
+        slots_[head & (Capacity - 1)] = value;
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side only.
+    bool pop(T* out) {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        const size_t head = head_.load(std::memory_order_acquire);
+        if (tail == head) {
+            return false;
+        }
+        if (out) {
+            *out = slots_[tail & (Capacity - 1)];
+        }
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side only: look at the oldest event without taking it.
+    bool peek(T* out) const {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        const size_t head = head_.load(std::memory_order_acquire);
+        if (tail == head) {
+            return false;
+        }
+        if (out) {
+            *out = slots_[tail & (Capacity - 1)];
+        }
+        return true;
+    }
+
+    // Consumer side only. Safe while the producer is idle.
+    void clear() {
+        tail_.store(head_.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+private:
+    std::array<T, Capacity> slots_{};
+    std::atomic<size_t> head_{0};
+    std::atomic<size_t> tail_{0};
+};
+
+}  // namespace ngpc
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ngpc/file.h"
+
+namespace ngpc {
+
+class PsgMixer;
+
+// Z80 sound ports, as PsgLog records them: the address's low bit.
+constexpr uint8_t kPsgPortRight = 0;  // 0x4000, PsgMixer::write_noise()
+constexpr uint8_t kPsgPortLeft = 1;   // 0x4001, PsgMixer::write_tone()
+
+// One chip write. `sample` counts the samples the chip had produced (rendered
+// or skipped) when it landed, at the log's sample rate.
+struct PsgWrite {
+    uint64_t sample = 0;
+    uint8_t port = kPsgPortRight;
+    uint8_t data = 0;
+};
+
+// Register writes of one chip session, as PsgMixer::set_recorder() captures
+// them. Each write costs two bytes: (delta << 1 | port) and the data, with the
+// sample delta spilling into a varint past 126. A driver writing a few dozen
+// bytes per frame logs well under 1 KB per second.
+class PsgLog {
+public:
+    explicit PsgLog(int sample_rate = 44100) { clear(sample_rate); }
+
+    void clear(int sample_rate);
+    void reserve(size_t bytes) { bytes_.reserve(bytes); }
+
+    // `sample` must not go backwards.
+    void append(uint64_t sample, uint8_t port, uint8_t data);
+
+    int sample_rate() const { return sample_rate_; }
+    size_t size() const { return count_; }
+    size_t bytes() const { return bytes_.size(); }
+    bool empty() const { return count_ == 0; }
+    uint64_t last_sample() const { return last_sample_; }
+
+    // Walks the writes in order.
+    class Reader {
+    public:
+        explicit Reader(const PsgLog& log) : log_(&log) {}
+        bool next(PsgWrite* out);
+
+    private:
+        const PsgLog* log_;
+        size_t pos_ = 0;
+        uint64_t sample_ = 0;
+    };
+
+private:
+    int sample_rate_ = 44100;
+    std::vector<uint8_t> bytes_;
+    size_t count_ = 0;
+    uint64_t last_sample_ = 0;
+};
+
+// VGM 1.51 file of the log for external players: the T6W28 entry (SN76489
+// clock with the dual-chip and T6W28 bits), 0x50 for port 0x4001 (the tone
+// chip) and 0x30 for port 0x4000 (the noise chip), and waits rescaled to
+// VGM's 44100 Hz. `total_samples` (log rate) sets the length; it is raised
+// to the last write if shorter.
+std::vector<uint8_t> FormatVgm(const PsgLog& log, uint64_t total_samples);
+
+// Streaming reader of the SN76489 / T6W28 writes in a VGM file. The file is
+// mapped, not loaded: commands are decoded in place as next() reaches them,
+// and other chips' commands and data blocks are stepped over. Gzipped files
+// (.vgz) are refused.
+//
+// Write times are VGM samples (44100 Hz) from the start of the data. In a
+// T6W28 file 0x50 is port 0x4001 and 0x30 port 0x4000, as FormatVgm() writes
+// them; a plain SN76489 file has its 0x50 writes sent to both ports, like a
+// mirroring driver.
+class VgmReader {
+public:
+    static constexpr uint32_t kSampleRate = 44100;
+
+    bool open(const std::string& path, std::string* error);
+    void close();
+    bool is_open() const { return data_ != nullptr; }
+
+    // Passes through the file: the loop section (if any) plays passes - 1
+    // more times. Takes effect at rewind().
+    void set_passes(int passes) { passes_ = passes > 0 ? passes : 1; }
+    void rewind();
+
+    // The next write, or false at the end of the data (see error()).
+    bool next(PsgWrite* out);
+
+    // VGM samples read so far; the whole length once next() returned false.
+    uint64_t time() const { return time_; }
+
+    uint32_t version() const { return version_; }
+    bool is_t6w28() const { return t6w28_; }
+    uint64_t total_samples() const { return total_samples_; }
+    uint64_t loop_samples() const { return loop_ ? loop_samples_ : 0; }
+    // Length with every pass, from the header.
+    uint64_t expected_samples() const;
+
+    // Set when decoding stopped on a command this reader cannot size.
+    const std::string& error() const { return error_; }
+
+private:
+    MappedFile file_;
+    const uint8_t* data_ = nullptr;
+    size_t end_ = 0;
+    size_t start_ = 0;
+    size_t loop_ = 0;  // 0 = no loop
+    uint32_t version_ = 0;
+    bool t6w28_ = false;
+    uint64_t total_samples_ = 0;
+    uint64_t loop_samples_ = 0;
+    int passes_ = 1;
+
+    size_t pos_ = 0;
+    uint64_t time_ = 0;
+    int loops_left_ = 0;
+    bool mirror_pending_ = false;
+    uint8_t mirror_data_ = 0;
+    std::string error_;
+};
+
+// Plays a VGM file into a PsgMixer as a SoundEngine timed callback: each
+// write lands on its own sample (VGM time rescaled to the engine rate)
+// instead of on a 1/60 s frame. The engine renders exactly up to each
+// callback, so at 44100 Hz a FormatVgm() file plays back sample for sample
+// like the render it was logged from. Everything runs on the rendering thread.
+class VgmPlayer {
+public:
+    bool open(const std::string& path, int passes, std::string* error);
+    const VgmReader& reader() const { return reader_; }
+
+    // Rewinds and plays from the next on_sample() call, at `sample_rate`.
+    void start(PsgMixer* psg, int sample_rate);
+
+    // The SoundEngine::TimedCallback: applies the writes due at `sample_pos`
+    // and returns the samples until the next one.
+    int on_sample(uint64_t sample_pos);
+
+    bool finished() const { return finished_; }
+    // Engine sample where the data ends; valid once finished().
+    uint64_t end_sample() const { return end_sample_; }
+    // Engine samples since start(), as of the last on_sample() call.
+    uint64_t position() const { return position_; }
+
+private:
+    uint64_t to_engine(uint64_t vgm_samples) const;
+
+    VgmReader reader_;
+    PsgMixer* psg_ = nullptr;
+    int sample_rate_ = 44100;
+    bool started_ = false;
+    bool finished_ = true;
+    bool have_pending_ = false;
+    PsgWrite pending_;
+    uint64_t origin_ = 0;
+    uint64_t position_ = 0;
+    uint64_t end_sample_ = 0;
+};
+
+}  // namespace ngpc
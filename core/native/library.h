@@ -0,0 +1 @@
+/* Host stand-in for the cartridge SDK's library.h: sounds.c uses nothing from it. */
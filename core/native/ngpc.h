@@ -0,0 +1,67 @@
+/*
+ * Host stand-in for the cartridge SDK's ngpc.h, used only to compile
+ * driver_custom_latest/sounds.c into ngpc_sounds_native.
+ *
+ * The shared RAM the main CPU and the Z80 talk through (0x7000 on hardware)
+ * becomes a host array. By default the Z80 side is modelled as infinitely
+ * fast: every time the driver looks at SND_COUNT, a committed buffer has been
+ * handed to the PSG sink and the count cleared, as the polling loop would
+ * have done. NgpcHost_SetZ80Timed(1) gives each commit the Z80 time the
+ * polling loop takes to write it out, against a main-CPU clock the host
+ * advances with NgpcHost_AdvanceMainCpu(); a commit before that finds
+ * SND_COUNT still set. The driver's own code takes no time in this clock.
+ */
+#ifndef NGPC_HOST_SHIM_H
+#define NGPC_HOST_SHIM_H
+
+#include <stdint.h>
+
+typedef uint8_t u8;
+typedef int8_t s8;
+typedef uint16_t u16;
+typedef int16_t s16;
+typedef uint32_t u32;
+typedef int32_t s32;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define NGPC_HOST_SHARED_RAM_SIZE 0x1000
+
+/* Receives each committed command buffer: `count` PSG commands of 3 bytes. */
+typedef void (*NgpcHostPsgSink)(void *user, const u8 *cmds, u8 count);
+
+extern volatile u8 g_ngpc_host_shared_ram[NGPC_HOST_SHARED_RAM_SIZE];
+extern volatile u8 VBCounter;
+extern volatile u16 g_ngpc_host_soundcpu_ctrl;
+
+/* What the driver handed the Z80 since the last NgpcHost_ResetZ80Stats(). */
+typedef struct {
+    u32 pushed_bytes;  /* bytes written into SND_BUF, 3 per command */
+    u32 committed;     /* commands in commits stored into SND_COUNT */
+    u32 refused;       /* commits that found SND_COUNT still set */
+} NgpcHostZ80Stats;
+
+void NgpcHost_SetPsgSink(NgpcHostPsgSink sink, void *user);
+/* Let the Z80 finish the committed buffer, if any, whatever the time. */
+void NgpcHost_RunZ80(void);
+/* Time the Z80's drain (1) or not (0, the default). */
+void NgpcHost_SetZ80Timed(u8 timed);
+/* Main-CPU time passing outside the driver, in TLCS-900H states. */
+void NgpcHost_AdvanceMainCpu(u32 states);
+void NgpcHost_Z80Stats(NgpcHostZ80Stats *out);
+void NgpcHost_ResetZ80Stats(void);
+volatile u8 *NgpcHost_SndCount(void);
+volatile u8 *NgpcHost_SndBuf(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define SOUNDCPU_CTRL g_ngpc_host_soundcpu_ctrl
+#define SND_RAM       ((u8 *)g_ngpc_host_shared_ram)
+#define SND_COUNT     (*NgpcHost_SndCount())
+#define SND_BUF       (NgpcHost_SndBuf())
+
+#endif
@@ -0,0 +1,126 @@
+#include "ngpc.h"
+#include "sounds.h"
+
+volatile u8 g_ngpc_host_shared_ram[NGPC_HOST_SHARED_RAM_SIZE];
+volatile u8 VBCounter;
+volatile u16 g_ngpc_host_soundcpu_ctrl;
+
+/* Songs hand their own table to Bgm_SetNoteTable(); this only keeps the
+ * driver's fallback pointer valid. */
+const u8 NOTE_TABLE[(NOTE_MAX_INDEX + 1) * 2];
+
+static NgpcHostPsgSink s_sink;
+static void *s_sink_user;
+
+/* Z80 T-states from a commit to SND_COUNT back at 0, worst case, read off
+ * the s_z80drv stub in sounds.c: up to one poll iteration (29) to see the
+ * count, 25 to set up, 117 per command (three ld a,(hl) / two port stores /
+ * inc hl) plus 13 per djnz taken (8 for the last), then 17 to clear the
+ * count: 66 + 130 per command. The main CPU runs at twice the Z80's clock. */
+#define Z80_DRAIN_BASE      66u
+#define Z80_DRAIN_PER_CMD   130u
+#define MAIN_STATES_PER_Z80 2u
+
+static u8 s_timed;         /* 0: the Z80 clears each commit at once */
+static u32 s_now;          /* main-CPU states since start-up */
+static u32 s_z80_done;     /* when the Z80 clears the current commit */
+static u8 s_commit_seen;   /* the commit in SND_COUNT went to the sink */
+static u16 s_open_bytes;   /* SND_BUF bytes no commit has covered yet */
+static NgpcHostZ80Stats s_stats;
+
+void NgpcHost_SetPsgSink(NgpcHostPsgSink sink, void *user)
+{
+    s_sink = sink;
+    s_sink_user = user;
+}
+
+/* The driver stores SND_COUNT through the pointer NgpcHost_SndCount() hands
+ * out, so a commit is only seen on the next look at the shared RAM; no
+ * main-CPU time passes in between. The Z80 reads the bytes as it sees the
+ * count, so they go to the sink at once. */
+static void NoteCommit(void)
+{
+    u8 cmds[15];
+    u8 count = g_ngpc_host_shared_ram[0x0003];
+    u8 i;
+    if (count == 0 || s_commit_seen) {
+        return;
+    }
+    /* The shared buffer only holds SND_BUF_MAX (5) commands. */
+    if (count > 5) {
+        count = 5;
+    }
+    for (i = 0; i < (u8)(count * 3); i++) {
+        cmds[i] = g_ngpc_host_shared_ram[0x0004 + i];
+    }
+    if (s_sink) {
+        s_sink(s_sink_user, cmds, count);
+    }
+    s_commit_seen = 1;
+    s_z80_done = s_now + (Z80_DRAIN_BASE + Z80_DRAIN_PER_CMD * count) * MAIN_STATES_PER_Z80;
+    s_open_bytes = (s_open_bytes > (u16)(count * 3)) ? (u16)(s_open_bytes - count * 3) : 0;
+    s_stats.committed += count;
+}
+
+/* Clears SND_COUNT once the Z80 has written the commit out. */
+static void Z80Catchup(u8 force)
+{
+    NoteCommit();
+    if (s_commit_seen && (force || !s_timed || (s32)(s_now - s_z80_done) >= 0)) {
+        g_ngpc_host_shared_ram[0x0003] = 0;
+        s_commit_seen = 0;
+    }
+}
+
+void NgpcHost_RunZ80(void)
+{
+    Z80Catchup(1);
+}
+
+void NgpcHost_SetZ80Timed(u8 timed)
+{
+    Z80Catchup(1);
+    s_timed = timed;
+}
+
+void NgpcHost_AdvanceMainCpu(u32 states)
+{
+    NoteCommit();
+    s_now += states;
+    Z80Catchup(0);
+}
+
+void NgpcHost_Z80Stats(NgpcHostZ80Stats *out)
+{
+    *out = s_stats;
+}
+
+void NgpcHost_ResetZ80Stats(void)
+{
+    s_stats.pushed_bytes = 0;
+    s_stats.committed = 0;
+    s_stats.refused = 0;
+    s_open_bytes = 0;
+}
+
+volatile u8 *NgpcHost_SndCount(void)
+{
+    Z80Catchup(0);
+    /* Only WaitBufferFree reads a non-zero count: the batch it guards is
+     * refused. Its spinning variant polls on, so count each batch once. */
+    if (g_ngpc_host_shared_ram[0x0003] != 0 && s_open_bytes != 0) {
+        s_open_bytes = 0;
+        s_stats.refused++;
+    }
+    return &g_ngpc_host_shared_ram[0x0003];
+}
+
+/* BufferPush stores each command byte through its own SND_BUF access. */
+volatile u8 *NgpcHost_SndBuf(void)
+{
+    s_stats.pushed_bytes++;
+    if (s_open_bytes < 0xFFFF) {
+        s_open_bytes++;
+    }
+    return &g_ngpc_host_shared_ram[0x0004];
+}
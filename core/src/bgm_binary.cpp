@@ -0,0 +1,110 @@
+#include "ngpc/bgm_binary.h"
+
+namespace ngpc {
+
+namespace {
+
+constexpr uint8_t kMagic[4] = {'N', 'G', 'P', 'B'};
+constexpr size_t kNoteTableField = 8;
+constexpr size_t kStreamFields = 16;
+constexpr size_t kStreamFieldSize = 12;
+
+void PutU16(std::vector<uint8_t>& out, size_t pos, uint16_t v) {
+    out[pos] = static_cast<uint8_t>(v & 0xFF);
+    out[pos + 1] = static_cast<uint8_t>(v >> 8);
+}
+
+void PutU32(std::vector<uint8_t>& out, size_t pos, uint32_t v) {
+    for (size_t i = 0; i < 4; ++i) {
+        out[pos + i] = static_cast<uint8_t>((v >> (8 * i)) & 0xFF);
+    }
+}
+
+uint16_t GetU16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+uint32_t GetU32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+// Appends `bytes` and records where they went in the header field at `field`.
+void PutSection(std::vector<uint8_t>& out, size_t field, const std::vector<uint8_t>& bytes) {
+    PutU32(out, field, static_cast<uint32_t>(out.size()));
+    PutU32(out, field + 4, static_cast<uint32_t>(bytes.size()));
+    out.insert(out.end(), bytes.begin(), bytes.end());
+}
+
+bool GetSection(const uint8_t* data, size_t size, size_t field, BgmByteSpan* out, std::string* error) {
+    const uint32_t offset = GetU32(data + field);
+    const uint32_t length = GetU32(data + field + 4);
+    if (offset < kBgmBinaryHeaderSize || offset > size || length > size - offset) {
+        if (error) {
+            *error = "section out of bounds";
+        }
+        return false;
+    }
+    *out = {data + offset, length};
+    return true;
+}
+
+}  // namespace
+
+std::vector<uint8_t> FormatBgmBinary(const BgmExportStreams& es) {
+    std::vector<uint8_t> out(kBgmBinaryHeaderSize, 0);
+    for (size_t i = 0; i < 4; ++i) {
+        out[i] = kMagic[i];
+    }
+    PutU16(out, 4, kBgmBinaryVersion);
+    PutU16(out, 6, static_cast<uint16_t>(kBgmBinaryHeaderSize));
+    PutSection(out, kNoteTableField, NoteTableBytes(es.note_table));
+    for (size_t v = 0; v < 4; ++v) {
+        const size_t field = kStreamFields + v * kStreamFieldSize;
+        PutSection(out, field, es.streams[v]);
+        PutU16(out, field + 8, es.loop_offsets[v]);
+    }
+    return out;
+}
+
+bool ParseBgmBinary(const uint8_t* data, size_t size, BgmBinaryView* out, std::string* error) {
+    if (!data || size < kBgmBinaryHeaderSize) {
+        if (error) {
+            *error = "file too small for an NGPB header";
+        }
+        return false;
+    }
+    for (size_t i = 0; i < 4; ++i) {
+        if (data[i] != kMagic[i]) {
+            if (error) {
+                *error = "not an NGPB file";
+            }
+            return false;
+        }
+    }
+    const uint16_t version = GetU16(data + 4);
+    if (version != kBgmBinaryVersion || GetU16(data + 6) != kBgmBinaryHeaderSize) {
+        if (error) {
+            *error = "unsupported NGPB version " + std::to_string(version);
+        }
+        return false;
+    }
+
+    BgmBinaryView view;
+    if (!GetSection(data, size, kNoteTableField, &view.note_table, error)) {
+        return false;
+    }
+    for (size_t v = 0; v < 4; ++v) {
+        const size_t field = kStreamFields + v * kStreamFieldSize;
+        if (!GetSection(data, size, field, &view.streams[v], error)) {
+            return false;
+        }
+        view.loop_offsets[v] = GetU16(data + field + 8);
+    }
+    if (out) {
+        *out = view;
+    }
+    return true;
+}
+
+}  // namespace ngpc
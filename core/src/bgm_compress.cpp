@@ -0,0 +1,385 @@
+#include "ngpc/bgm_compress.h"
+
+#include <algorithm>
+#include <numeric>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace ngpc {
+
+namespace {
+
+constexpr int kMaxCallCount = 255;
+
+// Suffix array of `s` by prefix doubling.
+std::vector<int> SuffixArray(const std::vector<int>& s) {
+    const int n = static_cast<int>(s.size());
+    std::vector<int> sa(static_cast<size_t>(n));
+    std::vector<int> rank(s.begin(), s.end());
+    std::vector<int> next(static_cast<size_t>(n));
+    std::iota(sa.begin(), sa.end(), 0);
+    if (n < 2) {
+        return sa;
+    }
+    for (int k = 1;; k <<= 1) {
+        const auto key = [&](int i) {
+            return std::make_pair(rank[static_cast<size_t>(i)],
+                                  i + k < n ? rank[static_cast<size_t>(i + k)] : -1);
+        };
+        std::sort(sa.begin(), sa.end(), [&](int a, int b) { return key(a) < key(b); });
+        next[static_cast<size_t>(sa[0])] = 0;
+        for (int i = 1; i < n; ++i) {
+            next[static_cast<size_t>(sa[static_cast<size_t>(i)])] =
+                next[static_cast<size_t>(sa[static_cast<size_t>(i - 1)])] +
+                (key(sa[static_cast<size_t>(i - 1)]) < key(sa[static_cast<size_t>(i)]) ? 1 : 0);
+        }
+        rank.swap(next);
+        if (rank[static_cast<size_t>(sa[static_cast<size_t>(n - 1)])] == n - 1) {
+            break;
+        }
+    }
+    return sa;
+}
+
+// lcp[i] = common prefix of the suffixes at sa[i - 1] and sa[i] (Kasai).
+std::vector<int> LcpArray(const std::vector<int>& s, const std::vector<int>& sa) {
+    const size_t n = s.size();
+    std::vector<int> rank(n);
+    std::vector<int> lcp(n, 0);
+    for (size_t i = 0; i < n; ++i) {
+        rank[static_cast<size_t>(sa[i])] = static_cast<int>(i);
+    }
+    size_t h = 0;
+    for (size_t i = 0; i < n; ++i) {
+        const size_t r = static_cast<size_t>(rank[i]);
+        if (r == 0) {
+            h = 0;
+            continue;
+        }
+        const size_t j = static_cast<size_t>(sa[r - 1]);
+        while (i + h < n && j + h < n && s[i + h] == s[j + h]) {
+            ++h;
+        }
+        lcp[r] = static_cast<int>(h);
+        if (h > 0) {
+            --h;
+        }
+    }
+    return lcp;
+}
+
+// One channel as a sequence of token ids. Equal ids are equal bytes; every
+// call site gets an id of its own, so subroutine bodies never hold calls.
+class StreamCompressor {
+public:
+    bool tokenize(const std::vector<uint8_t>& stream, uint16_t loop_offset) {
+        std::unordered_map<std::string, int> ids;
+        size_t pos = 0;
+        bool ended = false;
+        barrier_ = (loop_offset == 0) ? 0 : -1;
+        while (pos < stream.size()) {
+            const size_t len = BgmEventLength(stream.data(), stream.size(), pos);
+            if (len == 0) {
+                return false;
+            }
+            if (stream[pos] == 0x00) {
+                ended = (pos + 1 == stream.size());
+                if (pos == loop_offset) {
+                    barrier_ = static_cast<int>(seq_.size());
+                }
+                break;
+            }
+            if (stream[pos] == 0xFE &&
+                (stream[pos + 1] == kBgmExtCall || stream[pos + 1] == kBgmExtReturn)) {
+                return false;
+            }
+            if (pos == loop_offset) {
+                barrier_ = static_cast<int>(seq_.size());
+            }
+            std::string key(reinterpret_cast<const char*>(stream.data() + pos), len);
+            auto it = ids.find(key);
+            if (it == ids.end()) {
+                it = ids.emplace(std::move(key), static_cast<int>(tokens_.size())).first;
+                tokens_.push_back({std::vector<uint8_t>(stream.begin() + static_cast<std::ptrdiff_t>(pos),
+                                                        stream.begin() + static_cast<std::ptrdiff_t>(pos + len)),
+                                   -1, 0});
+            }
+            seq_.push_back(it->second);
+            pos += len;
+        }
+        return ended && barrier_ >= 0;
+    }
+
+    // Greedy: take the repeat that saves the most bytes, fold it, repeat.
+    void run() {
+        while (seq_.size() >= 2) {
+            const Candidate best = find_best();
+            if (best.saving <= 0) {
+                break;
+            }
+            apply(best);
+        }
+    }
+
+    int subroutine_count() const { return static_cast<int>(subs_.size()); }
+    int call_count() const { return calls_; }
+
+    // Main events, 0x00, then each subroutine and its return. False when an
+    // offset would not fit the 16-bit call operand.
+    bool emit(std::vector<uint8_t>* out, uint16_t* loop_offset) const {
+        std::vector<uint8_t> bytes;
+        std::vector<std::pair<size_t, int>> patches;  // operand position, subroutine
+        size_t loop = 0;
+        for (size_t i = 0; i <= seq_.size(); ++i) {
+            if (static_cast<int>(i) == barrier_) {
+                loop = bytes.size();
+            }
+            if (i == seq_.size()) {
+                break;
+            }
+            const Token& t = tokens_[static_cast<size_t>(seq_[i])];
+            if (t.sub >= 0) {
+                bytes.insert(bytes.end(), {0xFE, kBgmExtCall, static_cast<uint8_t>(t.count), 0, 0});
+                patches.emplace_back(bytes.size() - 2, t.sub);
+            } else {
+                bytes.insert(bytes.end(), t.bytes.begin(), t.bytes.end());
+            }
+        }
+        bytes.push_back(0x00);
+
+        std::vector<size_t> offsets;
+        for (const std::vector<int>& body : subs_) {
+            offsets.push_back(bytes.size());
+            for (int id : body) {
+                const Token& t = tokens_[static_cast<size_t>(id)];
+                bytes.insert(bytes.end(), t.bytes.begin(), t.bytes.end());
+            }
+            bytes.insert(bytes.end(), {0xFE, kBgmExtReturn});
+        }
+        if (offsets.back() > 0xFFFF || loop > 0xFFFF) {
+            return false;
+        }
+        for (const auto& [at, sub] : patches) {
+            const size_t target = offsets[static_cast<size_t>(sub)];
+            bytes[at] = static_cast<uint8_t>(target & 0xFF);
+            bytes[at + 1] = static_cast<uint8_t>(target >> 8);
+        }
+        out->swap(bytes);
+        *loop_offset = static_cast<uint16_t>(loop);
+        return true;
+    }
+
+private:
+    struct Token {
+        std::vector<uint8_t> bytes;  // plain event
+        int sub;                     // >= 0: call of subs_[sub]
+        int count;
+    };
+
+    struct Run {
+        int start;
+        int count;
+    };
+
+    struct Candidate {
+        int length = 0;
+        std::vector<Run> runs;
+        long saving = 0;
+    };
+
+    size_t token_bytes(int id) const {
+        const Token& t = tokens_[static_cast<size_t>(id)];
+        return t.sub >= 0 ? kBgmCallBytes : t.bytes.size();
+    }
+
+    Candidate find_best() const {
+        const int n = static_cast<int>(seq_.size());
+        std::vector<long> prefix(static_cast<size_t>(n) + 1, 0);
+        for (int i = 0; i < n; ++i) {
+            prefix[static_cast<size_t>(i) + 1] =
+                prefix[static_cast<size_t>(i)] + static_cast<long>(token_bytes(seq_[static_cast<size_t>(i)]));
+        }
+        const std::vector<int> sa = SuffixArray(seq_);
+        const std::vector<int> lcp = LcpArray(seq_, sa);
+
+        Candidate best;
+        std::vector<int> positions;
+        std::vector<Run> runs;
+        // Every internal node of the suffix tree: `length` tokens shared by
+        // the suffixes sa[lb..rb].
+        const auto evaluate = [&](int length, int lb, int rb) {
+            const int first = sa[static_cast<size_t>(lb)];
+            const long bytes = prefix[static_cast<size_t>(first + length)] - prefix[static_cast<size_t>(first)];
+            const long body_cost = bytes + static_cast<long>(kBgmReturnBytes);
+            const long occurrences = rb - lb + 1;
+            if (bytes <= static_cast<long>(kBgmCallBytes) ||
+                occurrences * bytes - static_cast<long>(kBgmCallBytes) - body_cost <= best.saving) {
+                return;
+            }
+            positions.assign(sa.begin() + lb, sa.begin() + rb + 1);
+            std::sort(positions.begin(), positions.end());
+            runs.clear();
+            int covered = 0;
+            for (int p : positions) {
+                if (p < covered || (p < barrier_ && barrier_ < p + length)) {
+                    continue;
+                }
+                Run* last = runs.empty() ? nullptr : &runs.back();
+                if (last && last->start + last->count * length == p && last->count < kMaxCallCount &&
+                    p != barrier_) {
+                    last->count++;
+                } else {
+                    runs.push_back({p, 1});
+                }
+                covered = p + length;
+            }
+            long saving = -body_cost;
+            for (const Run& r : runs) {
+                saving += r.count * bytes - static_cast<long>(kBgmCallBytes);
+            }
+            if (saving > best.saving) {
+                best.length = length;
+                best.runs = runs;
+                best.saving = saving;
+            }
+        };
+
+        std::vector<std::pair<int, int>> stack = {{0, 0}};  // (lcp, left bound)
+        for (int i = 1; i <= n; ++i) {
+            const int h = (i < n) ? lcp[static_cast<size_t>(i)] : 0;
+            int lb = i - 1;
+            while (stack.back().first > h) {
+                const auto [node_lcp, node_lb] = stack.back();
+                stack.pop_back();
+                evaluate(node_lcp, node_lb, i - 1);
+                lb = node_lb;
+            }
+            if (stack.back().first < h) {
+                stack.emplace_back(h, lb);
+            }
+        }
+        return best;
+    }
+
+    void apply(const Candidate& c) {
+        const int sub = static_cast<int>(subs_.size());
+        const auto body_begin = seq_.begin() + c.runs.front().start;
+        subs_.emplace_back(body_begin, body_begin + c.length);
+
+        std::vector<int> out;
+        out.reserve(seq_.size());
+        int barrier = -1;
+        size_t next_run = 0;
+        const int n = static_cast<int>(seq_.size());
+        for (int i = 0; i <= n;) {
+            if (i == barrier_) {
+                barrier = static_cast<int>(out.size());
+            }
+            if (i == n) {
+                break;
+            }
+            if (next_run < c.runs.size() && c.runs[next_run].start == i) {
+                const Run& r = c.runs[next_run++];
+                out.push_back(static_cast<int>(tokens_.size()));
+                tokens_.push_back({{}, sub, r.count});
+                ++calls_;
+                i += r.count * c.length;
+            } else {
+                out.push_back(seq_[static_cast<size_t>(i++)]);
+            }
+        }
+        seq_.swap(out);
+        barrier_ = barrier;
+    }
+
+    std::vector<Token> tokens_;
+    std::vector<int> seq_;
+    std::vector<std::vector<int>> subs_;
+    int barrier_ = 0;  // token index of the loop point; no call may span it
+    int calls_ = 0;
+};
+
+}  // namespace
+
+size_t BgmEventLength(const uint8_t* data, size_t size, size_t pos) {
+    if (pos >= size) {
+        return 0;
+    }
+    size_t len = 2;
+    switch (data[pos]) {
+    case 0x00:
+        len = 1;
+        break;
+    case 0xF1:  // SET_ENV
+    case 0xF6:  // HOST_CMD
+    case 0xF8:  // PITCH_BEND
+        len = 3;
+        break;
+    case 0xF2:  // SET_VIB
+    case 0xFA:  // SET_LFO
+        len = 4;
+        break;
+    case 0xF3:  // SET_SWEEP
+    case 0xF9:  // SET_ADSR
+        len = 5;
+        break;
+    case 0xFE:  // EXT
+        if (pos + 1 >= size) {
+            return 0;
+        }
+        switch (data[pos + 1]) {
+        case 0x01:  // ADSR5
+            len = 7;
+            break;
+        case 0x02:  // MOD2
+            len = 13;
+            break;
+        case kBgmExtCall:
+            len = kBgmCallBytes;
+            break;
+        case kBgmExtReturn:
+            len = kBgmReturnBytes;
+            break;
+        default:  // unknown: the driver skips one guard byte
+            len = 3;
+            break;
+        }
+        break;
+    default:  // notes, 0xFF rest and the one-operand opcodes
+        break;
+    }
+    return pos + len <= size ? len : 0;
+}
+
+size_t BgmCompressStats::total_before() const {
+    return std::accumulate(bytes_before.begin(), bytes_before.end(), size_t{0});
+}
+
+size_t BgmCompressStats::total_after() const {
+    return std::accumulate(bytes_after.begin(), bytes_after.end(), size_t{0});
+}
+
+BgmCompressStats CompressBgmStreams(BgmExportStreams* es) {
+    BgmCompressStats stats;
+    for (size_t ch = 0; ch < es->streams.size(); ++ch) {
+        std::vector<uint8_t>& stream = es->streams[ch];
+        stats.bytes_before[ch] = stream.size();
+        stats.bytes_after[ch] = stream.size();
+
+        StreamCompressor compressor;
+        if (!compressor.tokenize(stream, es->loop_offsets[ch])) {
+            continue;
+        }
+        compressor.run();
+        if (compressor.subroutine_count() == 0 || !compressor.emit(&stream, &es->loop_offsets[ch])) {
+            continue;
+        }
+        stats.bytes_after[ch] = stream.size();
+        stats.subroutines += compressor.subroutine_count();
+        stats.calls += compressor.call_count();
+    }
+    return stats;
+}
+
+}  // namespace ngpc
@@ -0,0 +1,131 @@
+#include "ngpc/bgm_export.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+
+namespace ngpc {
+
+std::vector<uint8_t> NoteTableBytes(const std::vector<uint16_t>& dividers) {
+    std::vector<uint8_t> bytes;
+    bytes.reserve(dividers.size() * 2);
+    for (uint16_t d : dividers) {
+        bytes.push_back(static_cast<uint8_t>(d & 0x0F));
+        bytes.push_back(static_cast<uint8_t>((d >> 4) & 0x3F));
+    }
+    return bytes;
+}
+
+void AppendBgmEvent(std::vector<uint8_t>& dst, uint8_t opcode, int duration) {
+    int remaining = std::max(duration, 1);
+    while (remaining > 0) {
+        const int chunk = std::min(remaining, 255);
+        dst.push_back(opcode);
+        dst.push_back(static_cast<uint8_t>(chunk));
+        remaining -= chunk;
+    }
+}
+
+std::string FormatBgmC(const BgmExportStreams& es, const BgmSourceOptions& options) {
+    std::ostringstream out;
+    out << "/* Generated by NGPC Sound Creator - " << options.mode_label << " Export */\n";
+    out << "/* BGM_CHN noise format: val = stream_byte - 1 (0-7)        */\n";
+    out << "/*   rate = val & 0x03 (0=H,1=M,2=L,3=Tone2)               */\n";
+    out << "/*   type = (val >> 2) & 0x01 (0=Periodic,1=White)          */\n";
+    for (const std::string& n : options.notes) {
+        out << "/* " << n << " */\n";
+    }
+    for (const std::string& w : options.warnings) {
+        out << "/* WARN export: " << w << " */\n";
+    }
+    out << "\n";
+
+    auto write_u8_array = [&](const char* name, const std::vector<uint8_t>& values) {
+        out << "const unsigned char " << name << "[] = {\n";
+        if (values.empty()) {
+            out << "    0x00\n";
+        } else {
+            for (size_t i = 0; i < values.size(); ++i) {
+                if ((i % 12) == 0) out << "    ";
+                out << static_cast<int>(values[i]);
+                if (i + 1 < values.size()) out << ", ";
+                if ((i % 12) == 11 || i + 1 == values.size()) out << "\n";
+            }
+        }
+        out << "};\n\n";
+    };
+
+    write_u8_array("NOTE_TABLE", NoteTableBytes(es.note_table));
+    if (options.mono) {
+        out << "const unsigned short BGM_MONO_LOOP = " << es.loop_offsets[0] << ";\n\n";
+        write_u8_array("BGM_MONO", es.streams[0]);
+        return out.str();
+    }
+    out << "const unsigned short BGM_CH0_LOOP = " << es.loop_offsets[0] << ";\n";
+    out << "const unsigned short BGM_CH1_LOOP = " << es.loop_offsets[1] << ";\n";
+    out << "const unsigned short BGM_CH2_LOOP = " << es.loop_offsets[2] << ";\n";
+    out << "const unsigned short BGM_CHN_LOOP = " << es.loop_offsets[3] << ";\n\n";
+    write_u8_array("BGM_CH0", es.streams[0]);
+    write_u8_array("BGM_CH1", es.streams[1]);
+    write_u8_array("BGM_CH2", es.streams[2]);
+    write_u8_array("BGM_CHN", es.streams[3]);
+    out << "const unsigned char BGM_MONO[] = { 0x00 };\n";
+    return out.str();
+}
+
+std::string FormatBgmAsm(const BgmExportStreams& es, const BgmSourceOptions& options) {
+    std::ostringstream out;
+    out << "; Generated by NGPC Sound Creator - " << options.mode_label << " ASM Export\n";
+    out << "; Format: TLCS-900H / SNK NGPC toolchain (.inc)\n";
+    out << "; BGM_CHN noise: val = byte - 1 (0-7)\n";
+    out << ";   rate = val & 0x03 (0=H,1=M,2=L,3=Tone2)\n";
+    out << ";   type = (val >> 2) & 0x01 (0=Periodic,1=White)\n";
+    for (const std::string& n : options.notes) {
+        out << "; " << n << "\n";
+    }
+    for (const std::string& w : options.warnings) {
+        out << "; WARN export: " << w << "\n";
+    }
+    out << "\n";
+
+    auto write_db_array = [&](const char* label, const std::vector<uint8_t>& values) {
+        out << label << ":\n";
+        for (size_t i = 0; i < values.size(); ++i) {
+            if ((i % 12) == 0) out << "        .db     ";
+            char hex[8];
+            std::snprintf(hex, sizeof(hex), "0x%02X", values[i]);
+            out << hex;
+            if ((i % 12) == 11 || i + 1 == values.size()) {
+                out << "\n";
+            } else {
+                out << ", ";
+            }
+        }
+        out << "\n";
+    };
+
+    auto write_dw = [&](const char* label, uint16_t value) {
+        char hex[8];
+        std::snprintf(hex, sizeof(hex), "0x%04X", value);
+        out << label << ":\n        .dw     " << hex << "\n\n";
+    };
+
+    write_db_array("NOTE_TABLE", NoteTableBytes(es.note_table));
+    if (options.mono) {
+        write_dw("BGM_MONO_LOOP", es.loop_offsets[0]);
+        write_db_array("BGM_MONO", es.streams[0]);
+        return out.str();
+    }
+    write_dw("BGM_CH0_LOOP", es.loop_offsets[0]);
+    write_dw("BGM_CH1_LOOP", es.loop_offsets[1]);
+    write_dw("BGM_CH2_LOOP", es.loop_offsets[2]);
+    write_dw("BGM_CHN_LOOP", es.loop_offsets[3]);
+    write_db_array("BGM_CH0", es.streams[0]);
+    write_db_array("BGM_CH1", es.streams[1]);
+    write_db_array("BGM_CH2", es.streams[2]);
+    write_db_array("BGM_CHN", es.streams[3]);
+    out << "BGM_MONO:\n        .db     0x00\n";
+    return out.str();
+}
+
+}  // namespace ngpc
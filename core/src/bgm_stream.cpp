@@ -0,0 +1,579 @@
+#include "ngpc/bgm_stream.h"
+
+#include <algorithm>
+
+#include "ngpc/psg.h"
+
+namespace ngpc {
+
+namespace {
+
+constexpr uint8_t kToneBase[3] = {0x80, 0xA0, 0xC0};
+constexpr uint8_t kAttnBase[3] = {0x90, 0xB0, 0xD0};
+
+void PsgTone(PsgMixer* psg, int ch, uint16_t div, uint8_t attn) {
+    if (!psg) {
+        return;
+    }
+    psg->write_tone(static_cast<uint8_t>(kToneBase[ch] | (div & 0x0F)));
+    psg->write_tone(static_cast<uint8_t>((div >> 4) & 0x3F));
+    psg->write_tone(static_cast<uint8_t>(kAttnBase[ch] | (attn & 0x0F)));
+}
+
+void PsgNoise(PsgMixer* psg, uint8_t val, uint8_t attn) {
+    if (!psg) {
+        return;
+    }
+    psg->write_noise(static_cast<uint8_t>(0xE0 | (val & 0x07)));
+    psg->write_noise(static_cast<uint8_t>(0xF0 | (attn & 0x0F)));
+}
+
+void PsgSilence(PsgMixer* psg, int ch) {
+    if (!psg) {
+        return;
+    }
+    if (ch == 3) {
+        psg->write_noise(0xFF);
+    } else {
+        psg->write_tone(static_cast<uint8_t>(kAttnBase[ch] | 0x0F));
+    }
+}
+
+// Frames a note or rest of `dur` waits after the frame that reads it; the
+// driver holds an event for `dur` frames in all (0 counts as 1).
+uint8_t HoldFrames(uint8_t dur) {
+    return static_cast<uint8_t>(dur == 0 ? 0 : dur - 1);
+}
+
+const std::vector<InstrumentPreset>& DefaultInstrumentPresets() {
+    static const std::vector<InstrumentPreset> kPresets = FactoryInstrumentPresets();
+    return kPresets;
+}
+
+BgmInstrumentDef ResolveFactoryInstrument(uint8_t inst_id) {
+    const auto& presets = DefaultInstrumentPresets();
+    if (inst_id < presets.size()) {
+        return presets[inst_id].def;
+    }
+    return BgmInstrumentDef{};
+}
+
+}  // namespace
+
+BgmStreamPlayer::BgmStreamPlayer(PsgMixer* psg) : psg_(psg), resolver_(ResolveFactoryInstrument) {}
+
+void BgmStreamPlayer::set_psg(PsgMixer* psg) {
+    psg_ = psg;
+}
+
+void BgmStreamPlayer::set_instrument_resolver(InstrumentResolver resolver) {
+    resolver_ = resolver ? std::move(resolver) : InstrumentResolver(ResolveFactoryInstrument);
+    checkpoints_.clear();
+}
+
+void BgmStreamPlayer::set_tables(const BgmFxTables* tables) {
+    if (tables == tables_) {
+        return;
+    }
+    tables_ = tables;
+    state_.voices.set_tables(tables_);
+    checkpoints_.clear();
+}
+
+void BgmStreamPlayer::set_seek_interval(uint32_t frames) {
+    frames = std::max<uint32_t>(frames, 1);
+    if (frames == seek_interval_) {
+        return;
+    }
+    seek_interval_ = frames;
+    checkpoints_.clear();
+}
+
+bool BgmStreamPlayer::load(const std::vector<uint8_t>& note_table,
+                           const std::array<std::vector<uint8_t>, kVoices>& streams,
+                           const std::array<uint16_t, kVoices>& loop_offsets,
+                           std::string* error) {
+    owned_note_table_ = note_table;
+    owned_streams_ = streams;
+    std::array<BgmByteSpan, kVoices> spans;
+    for (size_t v = 0; v < kVoices; ++v) {
+        spans[v] = {owned_streams_[v].data(), owned_streams_[v].size()};
+    }
+    return load(BgmByteSpan{owned_note_table_.data(), owned_note_table_.size()}, spans, loop_offsets, error);
+}
+
+bool BgmStreamPlayer::load(BgmByteSpan note_table,
+                           const std::array<BgmByteSpan, kVoices>& streams,
+                           const std::array<uint16_t, kVoices>& loop_offsets,
+                           std::string* error) {
+    loaded_ = false;
+    checkpoints_.clear();
+    fault_.clear();
+    if (note_table.size() < 2) {
+        if (error) {
+            *error = "NOTE_TABLE missing or too small";
+        }
+        return false;
+    }
+    note_table_ = note_table;
+    streams_ = streams;
+    loops_ = loop_offsets;
+    loaded_ = true;
+
+    build_index();
+    if (!fault_.empty()) {
+        loaded_ = false;
+        checkpoints_.clear();
+        if (error) {
+            *error = fault_;
+        }
+        return false;
+    }
+    reset();
+    return true;
+}
+
+void BgmStreamPlayer::reset() {
+    state_.frame = 0;
+    for (size_t v = 0; v < kVoices; ++v) {
+        state_.cursors[v] = Cursor{};
+        state_.cursors[v].active = loaded_ && !streams_[v].empty();
+    }
+    state_.voices.set_tables(tables_);
+    state_.voices.reset();
+    state_.noise_val = 0;
+    state_.fade_speed = 0;
+    state_.fade_counter = 0;
+    state_.fade_attn = 0;
+}
+
+void BgmStreamPlayer::step() {
+    advance(psg_);
+}
+
+void BgmStreamPlayer::run(uint32_t frames) {
+    for (uint32_t i = 0; i < frames; ++i) {
+        advance(nullptr);
+    }
+}
+
+bool BgmStreamPlayer::finished() const {
+    for (const Cursor& c : state_.cursors) {
+        if (c.active) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// ============================================================
+// Seek index
+// ============================================================
+
+void BgmStreamPlayer::build_index() {
+    checkpoints_.clear();
+    pass_frames_ = kMaxIndexFrames;
+    if (!loaded_) {
+        return;
+    }
+    reset();
+    while (state_.frame < kMaxIndexFrames) {
+        if (state_.frame % seek_interval_ == 0) {
+            checkpoints_.push_back(state_);
+        }
+        const bool done = std::all_of(state_.cursors.begin(), state_.cursors.end(),
+                                      [](const Cursor& c) { return c.wrapped || !c.active; });
+        if (done) {
+            pass_frames_ = state_.frame;
+            break;
+        }
+        advance(nullptr);
+    }
+}
+
+void BgmStreamPlayer::seek(uint32_t frame) {
+    if (!loaded_) {
+        return;
+    }
+    if (checkpoints_.empty()) {
+        build_index();
+    }
+    // Close ahead of the current frame: replaying is cheaper than restoring.
+    const bool near = frame >= state_.frame && frame - state_.frame < seek_interval_;
+    if (!near) {
+        const size_t idx = std::min<size_t>(frame / seek_interval_, checkpoints_.size() - 1);
+        state_ = checkpoints_[idx];
+    }
+    while (state_.frame < frame) {
+        advance(nullptr);
+        // Extend the index past the first pass as looping songs get scrubbed.
+        if (state_.frame % seek_interval_ == 0 && state_.frame <= kMaxIndexFrames &&
+            state_.frame / seek_interval_ == checkpoints_.size()) {
+            checkpoints_.push_back(state_);
+        }
+    }
+}
+
+void BgmStreamPlayer::write_state() const {
+    if (!psg_) {
+        return;
+    }
+    const BgmVoiceBank& voices = state_.voices;
+    for (int ch = 0; ch < kVoices; ++ch) {
+        if (!voices.active(ch)) {
+            PsgSilence(psg_, ch);
+            continue;
+        }
+        const uint8_t attn = voices.output_attn(ch, state_.fade_attn);
+        if (ch == 3) {
+            PsgNoise(psg_, state_.noise_val, attn);
+        } else {
+            PsgTone(psg_, ch, voices.output_divider(ch), attn);
+        }
+    }
+}
+
+// ============================================================
+// Frame
+// ============================================================
+
+void BgmStreamPlayer::advance(PsgMixer* psg) {
+    if (!loaded_) {
+        return;
+    }
+    if (trace_) {
+        *trace_ = StepTrace{};
+    }
+    bool fade_attn_dirty = false;
+    for (int ch = 0; ch < kVoices; ++ch) {
+        fade_attn_dirty |= step_stream(ch, psg);
+    }
+
+    // Global fade processing
+    if (state_.fade_speed > 0) {
+        if (state_.fade_counter == 0) {
+            if (state_.fade_attn < 15) {
+                state_.fade_attn++;
+                fade_attn_dirty = true;
+            }
+            state_.fade_counter = state_.fade_speed;
+        } else {
+            state_.fade_counter--;
+        }
+    }
+
+    // Per-tick instrument effect processing (envelope, vibrato, sweep)
+    for (int ch = 0; ch < kVoices; ++ch) {
+        tick_fx(ch, fade_attn_dirty, psg);
+    }
+    ++state_.frame;
+}
+
+// Called with the cursor at or past the end of its data: wrap to the loop
+// point if there is one. Returns false when the stream is done.
+bool BgmStreamPlayer::end_of_stream(int ch) {
+    const size_t v = static_cast<size_t>(ch);
+    Cursor& s = state_.cursors[v];
+    s.wrapped = true;
+    if (loops_[v] > 0 && loops_[v] < streams_[v].size()) {
+        s.pos = loops_[v];
+        return true;
+    }
+    s.active = false;
+    return false;
+}
+
+// Returns true when a HOST_CMD fade cancel needs every voice rewritten.
+bool BgmStreamPlayer::step_stream(int ch, PsgMixer* psg) {
+    const size_t v = static_cast<size_t>(ch);
+    Cursor& s = state_.cursors[v];
+    const BgmByteSpan data = streams_[v];
+    const bool noise = (ch == 3);
+    if (!s.active) {
+        return false;
+    }
+    if (s.remaining > 0) {
+        s.remaining--;
+        return false;
+    }
+
+    const auto silence = [&]() {
+        state_.voices.cut(ch);
+        PsgSilence(psg, ch);
+    };
+
+    // Every pass reads at least one byte, and a well-formed stream reaches a
+    // note, rest or end within one stream length. Past that the data loops
+    // without one (a loop region of opcodes or a bare 00): the driver would
+    // hang there, the player stops the voice instead.
+    bool fade_dirty = false;
+    for (size_t budget = data.size() + 1;; --budget) {
+        if (budget == 0) {
+            s.active = false;
+            s.wrapped = true;
+            silence();
+            if (fault_.empty()) {
+                fault_ = "Voice " + std::to_string(ch) + " stream loops without a note or rest";
+            }
+            return fade_dirty;
+        }
+        if (s.pos >= data.size() && !end_of_stream(ch)) {
+            silence();
+            return fade_dirty;
+        }
+        const uint8_t note = data[s.pos++];
+        if (trace_ && note < 0xF0) {
+            trace_->events[v]++;
+        }
+        if (note == 0x00) {
+            s.pos = static_cast<uint32_t>(data.size());
+            if (end_of_stream(ch)) {
+                continue;
+            }
+            silence();
+            return fade_dirty;
+        }
+        if (note == 0xFF) {
+            if (s.pos >= data.size()) {
+                s.active = false;
+                s.wrapped = true;
+                silence();
+                return fade_dirty;
+            }
+            s.remaining = HoldFrames(data[s.pos++]);
+            // ADSR voices enter release; tick_fx fades them out.
+            state_.voices.note_off(ch);
+            if (!state_.voices.active(ch)) {
+                silence();
+            }
+            return fade_dirty;
+        }
+        if (note >= 0xF0) {
+            opcode(ch, note, &fade_dirty);
+            continue;
+        }
+
+        if (s.pos >= data.size()) {
+            s.active = false;
+            s.wrapped = true;
+            silence();
+            return fade_dirty;
+        }
+        s.remaining = HoldFrames(data[s.pos++]);
+
+        BgmVoiceBank& voices = state_.voices;
+        if (noise) {
+            state_.noise_val = static_cast<uint8_t>((note - 1) & 0x07);
+            // Keep note-on behavior aligned with tone channels and driver:
+            // reset ADSR/envelope state, then emit using current attenuation.
+            voices.note_on(ch, 1);
+            PsgNoise(psg, state_.noise_val, voices.output_attn(ch, state_.fade_attn));
+        } else {
+            const size_t idx = static_cast<size_t>(note - 1);
+            if (idx * 2 + 1 < note_table_.size()) {
+                const uint16_t base = static_cast<uint16_t>(note_table_[idx * 2] & 0x0F) |
+                                      (static_cast<uint16_t>(note_table_[idx * 2 + 1] & 0x3F) << 4);
+                voices.note_on(ch, base);
+                PsgTone(psg, ch, voices.output_divider(ch), voices.output_attn(ch, state_.fade_attn));
+            } else {
+                PsgSilence(psg, ch);
+                voices.cut(ch);
+            }
+        }
+        s.pending_write = false;
+        return fade_dirty;
+    }
+}
+
+void BgmStreamPlayer::opcode(int ch, uint8_t op, bool* fade_dirty) {
+    const size_t v = static_cast<size_t>(ch);
+    Cursor& s = state_.cursors[v];
+    const BgmByteSpan data = streams_[v];
+    const uint32_t end = static_cast<uint32_t>(data.size());
+    const uint32_t operands = s.pos;
+    uint32_t ext_operands = 0;  // EXT CALL / RET jump, so their bytes are counted here
+    BgmVoiceBank& voices = state_.voices;
+    // Whether `n` operand bytes are left; a truncated opcode ends the stream.
+    const auto has = [&](uint32_t n) {
+        if (s.pos + n <= end) {
+            return true;
+        }
+        s.pos = end;
+        return false;
+    };
+
+    switch (op) {
+    case 0xF0:  // SET_ATTN
+        if (s.pos < end) {
+            voices.set_attn(ch, static_cast<uint8_t>(data[s.pos++] & 0x0F));
+        }
+        break;
+    case 0xF1:  // SET_ENV
+        if (has(2)) {
+            voices.set_env(ch, data[s.pos], data[s.pos + 1]);
+            s.pos += 2;
+            s.pending_write = true;
+        }
+        break;
+    case 0xF2:  // SET_VIB
+        if (has(3)) {
+            voices.set_vibrato(ch, data[s.pos], data[s.pos + 1], data[s.pos + 2]);
+            s.pos += 3;
+            s.pending_write = true;
+        }
+        break;
+    case 0xF3:  // SET_SWEEP
+        if (has(4)) {
+            const uint16_t end_val = static_cast<uint16_t>(data[s.pos]) |
+                                     (static_cast<uint16_t>(data[s.pos + 1]) << 8);
+            voices.set_sweep(ch, end_val, static_cast<int8_t>(data[s.pos + 2]), data[s.pos + 3]);
+            s.pos += 4;
+            s.pending_write = true;
+        }
+        break;
+    case 0xF4:  // SET_INST
+        if (s.pos < end) {
+            // Mirror driver behavior: only channel N can run in noise mode.
+            s.inst = data[s.pos];
+            voices.apply_instrument(ch, resolver_(data[s.pos++]), ch == 3);
+            s.pending_write = true;
+        }
+        break;
+    case 0xF6:  // HOST_CMD
+        if (has(2)) {
+            const uint8_t type = data[s.pos];
+            const uint8_t value = data[s.pos + 1];
+            s.pos += 2;
+            if (type == 0) {
+                if (value == 0) {
+                    // Cancel fade and restore baseline attenuation immediately.
+                    state_.fade_speed = 0;
+                    state_.fade_counter = 0;
+                    if (state_.fade_attn != 0) {
+                        state_.fade_attn = 0;
+                        *fade_dirty = true;
+                    }
+                } else {
+                    state_.fade_speed = value;
+                    state_.fade_counter = value;
+                }
+            }
+            // type 1 (tempo): durations are pre-baked in exported streams.
+        }
+        break;
+    case 0xF7:  // SET_EXPR
+        if (s.pos < end) {
+            voices.set_expression(ch, data[s.pos++]);
+            s.pending_write = true;
+        }
+        break;
+    case 0xF8:  // PITCH_BEND
+        if (has(2)) {
+            voices.set_pitch_bend(ch, static_cast<int16_t>(
+                static_cast<uint16_t>(data[s.pos]) | (static_cast<uint16_t>(data[s.pos + 1]) << 8)));
+            s.pos += 2;
+            s.pending_write = true;
+        }
+        break;
+    case 0xF9:  // SET_ADSR
+        if (has(4)) {
+            voices.set_adsr(ch, data[s.pos], data[s.pos + 1], data[s.pos + 2], 0, data[s.pos + 3]);
+            s.pos += 4;
+            s.pending_write = true;
+        }
+        break;
+    case 0xFA:  // SET_LFO
+        if (has(3)) {
+            voices.set_lfo(ch, data[s.pos], data[s.pos + 1], data[s.pos + 2]);
+            s.pos += 3;
+            s.pending_write = true;
+        }
+        break;
+    case 0xFE: {  // EXT (ADSR5 / MOD2 / CALL / RET)
+        if (!has(1)) {
+            break;
+        }
+        const uint8_t sub = data[s.pos++];
+        ext_operands = 1 + (sub == 0x01 ? 5 : sub == 0x02 ? 11 : sub == 0x03 ? 3 : sub == 0x04 ? 0 : 1);
+        if (sub == 0x01) {  // ADSR5
+            if (has(5)) {
+                const uint8_t* p = data.data() + s.pos;
+                voices.set_adsr(ch, p[0], p[1], p[2], p[3], p[4]);
+                s.pos += 5;
+                s.pending_write = true;
+            }
+        } else if (sub == 0x02) {  // MOD2
+            if (has(11)) {
+                const uint8_t* p = data.data() + s.pos;
+                voices.set_mod2(ch, p[0],
+                                p[1] != 0, p[2], p[3], p[4], p[5],
+                                p[6] != 0, p[7], p[8], p[9], p[10]);
+                s.pos += 11;
+                s.pending_write = true;
+            }
+        } else if (sub == 0x03) {  // CALL count, offset lo/hi
+            if (has(3)) {
+                const uint8_t count = data[s.pos];
+                const uint32_t target = static_cast<uint32_t>(data[s.pos + 1]) |
+                                        (static_cast<uint32_t>(data[s.pos + 2]) << 8);
+                s.pos += 3;
+                if (count > 0) {
+                    s.call_count = count;
+                    s.call_ret = s.pos;
+                    s.call_start = std::min(target, end);
+                    s.pos = s.call_start;
+                }
+            }
+        } else if (sub == 0x04) {  // RET
+            if (s.call_count > 0 && --s.call_count > 0) {
+                s.pos = s.call_start;
+            } else if (s.call_ret > 0) {
+                s.pos = s.call_ret;
+                s.call_ret = 0;
+            }
+        } else if (s.pos < end) {
+            // Unknown ext subcommand: consume one guard byte.
+            s.pos++;
+        }
+        break;
+    }
+    default:
+        // SET_PAN and future opcodes: skip one parameter byte.
+        s.pos = std::min(s.pos + 1, end);
+        break;
+    }
+    if (trace_) {
+        trace_->opcodes[v]++;
+        const uint32_t read = (op == 0xFE) ? ext_operands : s.pos - operands;
+        trace_->operand_bytes[v] = static_cast<uint8_t>(std::min<uint32_t>(trace_->operand_bytes[v] + read, 255));
+    }
+}
+
+void BgmStreamPlayer::tick_fx(int ch, bool force_write, PsgMixer* psg) {
+    BgmVoiceBank& voices = state_.voices;
+    if (!voices.active(ch)) {
+        return;
+    }
+    Cursor& s = state_.cursors[static_cast<size_t>(ch)];
+    // tick_voice() also runs on the last frame of an ADSR release, so the
+    // final silent attenuation still gets written.
+    const bool dirty = voices.tick_voice(ch) || s.pending_write;
+    s.pending_write = false;
+    if (trace_ && dirty) {
+        trace_->fx_dirty |= static_cast<uint8_t>(1u << ch);
+    }
+    if (!dirty && !force_write) {
+        return;
+    }
+    if (!psg) {
+        return;
+    }
+    const uint8_t attn = voices.output_attn(ch, state_.fade_attn);
+    if (ch == 3) {
+        psg->write_noise(static_cast<uint8_t>(0xF0 | (attn & 0x0F)));
+    } else {
+        PsgTone(psg, ch, voices.output_divider(ch), attn);
+    }
+}
+
+}  // namespace ngpc
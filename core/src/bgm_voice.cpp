@@ -0,0 +1,952 @@
+#include "ngpc/bgm_voice.h"
+
+#include <algorithm>
+
+namespace ngpc {
+
+namespace {
+
+int16_t LfoStepWave(uint8_t wave, int16_t cur, int8_t& sign, int16_t depth) {
+    if (depth <= 0) return 0;
+    switch (wave) {
+    case 0: {  // triangle
+        int16_t next = static_cast<int16_t>(cur + sign);
+        if (next >= depth) {
+            next = depth;
+            sign = -1;
+        } else if (next <= -depth) {
+            next = static_cast<int16_t>(-depth);
+            sign = 1;
+        }
+        return next;
+    }
+    case 1:  // square
+        sign = (sign < 0) ? static_cast<int8_t>(1) : static_cast<int8_t>(-1);
+        return static_cast<int16_t>(depth * sign);
+    case 2: {  // saw
+        int16_t next = static_cast<int16_t>(cur + 1);
+        if (next > depth) next = static_cast<int16_t>(-depth);
+        return next;
+    }
+    case 3:  // sweep up
+        if (cur < depth) return static_cast<int16_t>(cur + 1);
+        return depth;
+    case 4:  // sweep down
+        if (cur > -depth) return static_cast<int16_t>(cur - 1);
+        return static_cast<int16_t>(-depth);
+    default:
+        return cur;
+    }
+}
+
+bool LfoTick(bool on, uint8_t wave, uint8_t rate, uint8_t depth,
+             uint8_t& hold_counter, uint8_t& counter, int8_t& sign, int16_t& delta) {
+    if (!on || depth == 0 || rate == 0) {
+        if (delta != 0) {
+            delta = 0;
+            return true;
+        }
+        return false;
+    }
+    if (hold_counter > 0) {
+        hold_counter--;
+        if (delta != 0) {
+            delta = 0;
+            return true;
+        }
+        return false;
+    }
+    if (counter == 0) {
+        counter = rate;
+        const int16_t next = LfoStepWave(static_cast<uint8_t>(std::min<int>(wave, 4)),
+                                         delta, sign, static_cast<int16_t>(depth));
+        if (next != delta) {
+            delta = next;
+            return true;
+        }
+    } else {
+        counter--;
+    }
+    return false;
+}
+
+int8_t LfoToAttnDelta(int16_t mod) {
+    int16_t d = static_cast<int16_t>(mod / 16);
+    d = std::clamp<int16_t>(d, -15, 15);
+    return static_cast<int8_t>(-d);
+}
+
+void ResolveLfoAlgo(uint8_t algo, int16_t l1, int16_t l2,
+                    int16_t& pitch_delta, int8_t& attn_delta) {
+    const int16_t mix = std::clamp<int16_t>(static_cast<int16_t>(l1 + l2), -255, 255);
+    switch (algo & 0x07) {
+    default:
+    case 0:  // none
+        pitch_delta = 0;
+        attn_delta = 0;
+        break;
+    case 1:  // LFO1 = tremolo, LFO2 = vibrato
+        pitch_delta = l2;
+        attn_delta = LfoToAttnDelta(l1);
+        break;
+    case 2:  // FM blend on both
+        pitch_delta = mix;
+        attn_delta = LfoToAttnDelta(mix);
+        break;
+    case 3:  // AM blend + vibrato on LFO2
+        pitch_delta = l2;
+        attn_delta = LfoToAttnDelta(mix);
+        break;
+    case 4:  // FM blend + tremolo on LFO1
+        pitch_delta = mix;
+        attn_delta = LfoToAttnDelta(l1);
+        break;
+    case 5:  // AM blend only
+        pitch_delta = 0;
+        attn_delta = LfoToAttnDelta(mix);
+        break;
+    case 6:  // FM blend only
+        pitch_delta = mix;
+        attn_delta = 0;
+        break;
+    case 7:  // AM-shaped vibrato
+        pitch_delta = static_cast<int16_t>(mix / 2);
+        attn_delta = 0;
+        break;
+    }
+}
+
+uint8_t ClampAttn(int attn) {
+    return static_cast<uint8_t>(std::clamp(attn, 0, 15));
+}
+
+template <typename T>
+bool StepEquals(const T& a, const T& b) {
+    return a == b;
+}
+
+template <>
+bool StepEquals<MacroStepDef>(const MacroStepDef& a, const MacroStepDef& b) {
+    return a.frames == b.frames && a.attn_delta == b.attn_delta && a.pitch_delta == b.pitch_delta;
+}
+
+// Append `steps` to `pool` and return where they landed. Identical step
+// runs are stored once.
+template <typename T>
+BgmFxSpan InternSteps(const std::vector<T>& steps, std::vector<T>& pool) {
+    BgmFxSpan span;
+    span.count = static_cast<uint8_t>(std::min<size_t>(steps.size(), 255));
+    if (span.count == 0) {
+        return span;
+    }
+    const auto first = steps.begin();
+    const auto last = first + span.count;
+    const auto hit = std::search(pool.begin(), pool.end(), first, last, StepEquals<T>);
+    if (hit != pool.end()) {
+        span.offset = static_cast<uint16_t>(hit - pool.begin());
+        return span;
+    }
+    span.offset = static_cast<uint16_t>(pool.size());
+    pool.insert(pool.end(), first, last);
+    return span;
+}
+
+}  // namespace
+
+// ============================================================
+// BgmFxTables
+// ============================================================
+
+BgmFxTables::BgmFxTables(const std::vector<EnvCurveDef>& env_curves,
+                         const std::vector<PitchCurveDef>& pitch_curves,
+                         const std::vector<MacroDef>& macros) {
+    env_curves_.reserve(env_curves.size());
+    for (const auto& c : env_curves) {
+        env_curves_.push_back(InternSteps(c.steps, env_steps_));
+    }
+    pitch_curves_.reserve(pitch_curves.size());
+    for (const auto& c : pitch_curves) {
+        pitch_curves_.push_back(InternSteps(c.steps, pitch_steps_));
+    }
+    macros_.reserve(macros.size());
+    for (const auto& m : macros) {
+        macros_.push_back(InternSteps(m.steps, macro_steps_));
+    }
+}
+
+BgmFxSpan BgmFxTables::env_curve(uint8_t id) const {
+    return id < env_curves_.size() ? env_curves_[id] : BgmFxSpan{};
+}
+
+BgmFxSpan BgmFxTables::pitch_curve(uint8_t id) const {
+    return id < pitch_curves_.size() ? pitch_curves_[id] : BgmFxSpan{};
+}
+
+BgmFxSpan BgmFxTables::macro(uint8_t id) const {
+    return id < macros_.size() ? macros_[id] : BgmFxSpan{};
+}
+
+uint64_t BgmFxTables::content_hash() const {
+    uint64_t h = 1469598103934665603ull;
+    auto mix = [&h](auto value) {
+        for (size_t i = 0; i < sizeof(value); ++i) {
+            h ^= static_cast<uint8_t>(static_cast<uint64_t>(value) >> (8 * i));
+            h *= 1099511628211ull;
+        }
+    };
+    auto mix_spans = [&](const std::vector<BgmFxSpan>& spans) {
+        mix(static_cast<uint32_t>(spans.size()));
+        for (const BgmFxSpan& span : spans) {
+            mix(span.offset);
+            mix(span.count);
+        }
+    };
+    mix_spans(env_curves_);
+    mix_spans(pitch_curves_);
+    mix_spans(macros_);
+    for (int8_t step : env_steps_) mix(step);
+    for (int16_t step : pitch_steps_) mix(step);
+    for (const MacroStepDef& step : macro_steps_) {
+        mix(step.frames);
+        mix(step.attn_delta);
+        mix(step.pitch_delta);
+    }
+    return h;
+}
+
+const BgmFxTables& FactoryFxTables() {
+    static const BgmFxTables kTables(FactoryEnvCurves(), FactoryPitchCurves(), FactoryMacros());
+    return kTables;
+}
+
+// ============================================================
+// BgmVoiceBank
+// ============================================================
+
+BgmVoiceBank::BgmVoiceBank(const BgmFxTables* tables)
+    : tables_(tables ? tables : &FactoryFxTables()) {
+    reset();
+}
+
+void BgmVoiceBank::set_tables(const BgmFxTables* tables) {
+    const BgmFxTables* next = tables ? tables : &FactoryFxTables();
+    if (next == tables_) {
+        return;
+    }
+    tables_ = next;
+    reset();
+}
+
+void BgmVoiceBank::reset() {
+    for (int v = 0; v < kVoices; ++v) {
+        reset_voice(v);
+    }
+}
+
+void BgmVoiceBank::reset_voice(int vi) {
+    const size_t v = static_cast<size_t>(vi);
+    note_active_[v] = 0;
+    mode_[v] = 0;
+    attn_[v] = 2;
+    attn_cur_[v] = 2;
+    base_div_[v] = 1;
+    tone_div_[v] = 1;
+    expression_[v] = 0;
+    pitch_bend_[v] = 0;
+
+    env_on_[v] = 0;
+    env_step_[v] = 1;
+    env_speed_[v] = 1;
+    env_counter_[v] = 0;
+    env_curve_[v] = BgmFxSpan{};
+    env_index_[v] = 0;
+    pitch_curve_[v] = BgmFxSpan{};
+    pitch_index_[v] = 0;
+    pitch_counter_[v] = 0;
+    pitch_offset_[v] = 0;
+
+    vib_on_[v] = 0;
+    vib_depth_[v] = 0;
+    vib_speed_[v] = 1;
+    vib_delay_[v] = 0;
+    vib_delay_counter_[v] = 0;
+    vib_counter_[v] = 0;
+    vib_dir_[v] = 1;
+
+    lfo_on_[v] = 0;
+    lfo_wave_[v] = 0;
+    lfo_hold_[v] = 0;
+    lfo_rate_[v] = 1;
+    lfo_depth_[v] = 0;
+    lfo_hold_counter_[v] = 0;
+    lfo_counter_[v] = 0;
+    lfo_sign_[v] = 1;
+    lfo_delta_[v] = 0;
+    lfo2_on_[v] = 0;
+    lfo2_wave_[v] = 0;
+    lfo2_hold_[v] = 0;
+    lfo2_rate_[v] = 1;
+    lfo2_depth_[v] = 0;
+    lfo2_hold_counter_[v] = 0;
+    lfo2_counter_[v] = 0;
+    lfo2_sign_[v] = 1;
+    lfo2_delta_[v] = 0;
+    lfo_algo_[v] = 1;
+    lfo_pitch_delta_[v] = 0;
+    lfo_attn_delta_[v] = 0;
+
+    sweep_on_[v] = 0;
+    sweep_end_[v] = 1;
+    sweep_step_[v] = 0;
+    sweep_speed_[v] = 1;
+    sweep_counter_[v] = 0;
+
+    macro_[v] = BgmFxSpan{};
+    macro_step_[v] = 0;
+    macro_counter_[v] = 0;
+    macro_active_[v] = 0;
+    macro_pitch_[v] = 0;
+
+    adsr_on_[v] = 0;
+    adsr_attack_[v] = 0;
+    adsr_decay_[v] = 0;
+    adsr_sustain_[v] = 0;
+    adsr_sustain_rate_[v] = 0;
+    adsr_release_[v] = 0;
+    adsr_phase_[v] = kAdsrOff;
+    adsr_counter_[v] = 0;
+    select_kernel(v);
+}
+
+// ============================================================
+// Note events
+// ============================================================
+
+void BgmVoiceBank::apply_instrument(int vi, const BgmInstrumentDef& def, bool noise_mode) {
+    const size_t v = static_cast<size_t>(vi);
+    attn_[v] = std::min<uint8_t>(def.attn, 15);
+    attn_cur_[v] = attn_[v];
+
+    env_on_[v] = def.env_on ? 1 : 0;
+    env_step_[v] = def.env_step ? def.env_step : 1;
+    env_speed_[v] = def.env_speed ? def.env_speed : 1;
+    env_counter_[v] = env_speed_[v];
+    env_curve_[v] = tables_->env_curve(def.env_curve_id);
+    env_index_[v] = 0;
+    pitch_curve_[v] = tables_->pitch_curve(def.pitch_curve_id);
+    pitch_index_[v] = 0;
+    pitch_counter_[v] = env_speed_[v];
+    pitch_offset_[v] = 0;
+
+    vib_on_[v] = def.vib_on ? 1 : 0;
+    vib_depth_[v] = def.vib_depth;
+    vib_speed_[v] = def.vib_speed ? def.vib_speed : 1;
+    vib_delay_[v] = def.vib_delay;
+    vib_delay_counter_[v] = vib_delay_[v];
+    vib_counter_[v] = vib_speed_[v];
+    vib_dir_[v] = 1;
+
+    lfo_on_[v] = def.lfo_on ? 1 : 0;
+    lfo_wave_[v] = std::min<uint8_t>(def.lfo_wave, 4);
+    lfo_hold_[v] = def.lfo_hold;
+    lfo_rate_[v] = def.lfo_rate;
+    lfo_depth_[v] = def.lfo_depth;
+    lfo_hold_counter_[v] = lfo_hold_[v];
+    lfo_counter_[v] = lfo_rate_[v];
+    lfo_sign_[v] = 1;
+    lfo_delta_[v] = 0;
+    lfo2_on_[v] = def.lfo2_on ? 1 : 0;
+    lfo2_wave_[v] = std::min<uint8_t>(def.lfo2_wave, 4);
+    lfo2_hold_[v] = def.lfo2_hold;
+    lfo2_rate_[v] = def.lfo2_rate;
+    lfo2_depth_[v] = def.lfo2_depth;
+    lfo2_hold_counter_[v] = lfo2_hold_[v];
+    lfo2_counter_[v] = lfo2_rate_[v];
+    lfo2_sign_[v] = 1;
+    lfo2_delta_[v] = 0;
+    lfo_algo_[v] = std::min<uint8_t>(def.lfo_algo, 7);
+    lfo_pitch_delta_[v] = 0;
+    lfo_attn_delta_[v] = 0;
+    if (lfo_depth_[v] == 0 || lfo_rate_[v] == 0) lfo_on_[v] = 0;
+    if (lfo2_depth_[v] == 0 || lfo2_rate_[v] == 0) lfo2_on_[v] = 0;
+
+    sweep_on_[v] = def.sweep_on ? 1 : 0;
+    sweep_end_[v] = def.sweep_end ? def.sweep_end : 1;
+    sweep_step_[v] = def.sweep_step;
+    sweep_speed_[v] = def.sweep_speed ? def.sweep_speed : 1;
+    sweep_counter_[v] = sweep_speed_[v];
+
+    mode_[v] = noise_mode ? 1 : 0;
+    macro_[v] = tables_->macro(def.macro_id);
+
+    adsr_on_[v] = def.adsr_on ? 1 : 0;
+    adsr_attack_[v] = def.adsr_attack;
+    adsr_decay_[v] = def.adsr_decay;
+    adsr_sustain_[v] = std::min<uint8_t>(def.adsr_sustain, 15);
+    adsr_sustain_rate_[v] = def.adsr_sustain_rate;
+    adsr_release_[v] = def.adsr_release;
+    adsr_phase_[v] = kAdsrOff;
+    adsr_counter_[v] = 0;
+    select_kernel(v);
+}
+
+void BgmVoiceBank::note_on(int vi, uint16_t divider) {
+    const size_t v = static_cast<size_t>(vi);
+    note_active_[v] = 1;
+    if (adsr_on_[v]) {
+        // ADSR starts silent; the attack ramps down to the target.
+        attn_cur_[v] = 15;
+        adsr_phase_[v] = kAdsrAttack;
+        adsr_counter_[v] = adsr_attack_[v];
+    } else {
+        attn_cur_[v] = attn_[v];
+    }
+    env_counter_[v] = env_speed_[v];
+    env_index_[v] = 0;
+    pitch_index_[v] = 0;
+    pitch_counter_[v] = env_speed_[v];
+    pitch_offset_[v] = 0;
+    vib_delay_counter_[v] = vib_delay_[v];
+    vib_counter_[v] = vib_speed_[v];
+    vib_dir_[v] = 1;
+    lfo_counter_[v] = lfo_rate_[v];
+    lfo_sign_[v] = 1;
+    lfo_delta_[v] = 0;
+    sweep_counter_[v] = sweep_speed_[v];
+    macro_reset(v);
+    if (mode_[v] == 0) {
+        base_div_[v] = divider;
+        tone_div_[v] = divider;
+    } else {
+        base_div_[v] = 1;
+        tone_div_[v] = 1;
+    }
+    select_kernel(v);
+}
+
+void BgmVoiceBank::note_off(int vi) {
+    const size_t v = static_cast<size_t>(vi);
+    if (note_active_[v] && adsr_on_[v] && adsr_release_[v] > 0) {
+        // A second release restarts the release counter, as the driver does.
+        adsr_phase_[v] = kAdsrRelease;
+        adsr_counter_[v] = adsr_release_[v];
+        return;
+    }
+    cut(vi);
+}
+
+void BgmVoiceBank::cut(int vi) {
+    const size_t v = static_cast<size_t>(vi);
+    note_active_[v] = 0;
+    adsr_phase_[v] = kAdsrOff;
+}
+
+// ============================================================
+// Stream opcodes
+// ============================================================
+
+void BgmVoiceBank::set_attn(int vi, uint8_t attn) {
+    attn_[static_cast<size_t>(vi)] = std::min<uint8_t>(attn, 15);
+}
+
+void BgmVoiceBank::set_env(int vi, uint8_t step, uint8_t speed) {
+    const size_t v = static_cast<size_t>(vi);
+    step = std::min<uint8_t>(step, 4);
+    speed = std::clamp<uint8_t>(speed, 1, 10);
+    env_on_[v] = (step > 0) ? 1 : 0;
+    env_step_[v] = step ? step : 1;
+    env_speed_[v] = speed;
+    env_counter_[v] = speed;
+    env_index_[v] = 0;
+    pitch_index_[v] = 0;
+    pitch_counter_[v] = speed;
+    pitch_offset_[v] = 0;
+    select_kernel(v);
+}
+
+void BgmVoiceBank::set_vibrato(int vi, uint8_t depth, uint8_t speed, uint8_t delay) {
+    const size_t v = static_cast<size_t>(vi);
+    speed = std::clamp<uint8_t>(speed, 1, 30);
+    vib_on_[v] = (depth > 0) ? 1 : 0;
+    vib_depth_[v] = depth;
+    vib_speed_[v] = speed;
+    vib_delay_[v] = delay;
+    vib_delay_counter_[v] = delay;
+    vib_counter_[v] = speed;
+    vib_dir_[v] = 1;
+    select_kernel(v);
+}
+
+void BgmVoiceBank::set_sweep(int vi, uint16_t end, int16_t step, uint8_t speed) {
+    const size_t v = static_cast<size_t>(vi);
+    sweep_on_[v] = (step != 0) ? 1 : 0;
+    sweep_end_[v] = std::clamp<uint16_t>(end, 1, 1023);
+    sweep_step_[v] = step;
+    sweep_speed_[v] = std::clamp<uint8_t>(speed, 1, 30);
+    sweep_counter_[v] = sweep_speed_[v];
+    select_kernel(v);
+}
+
+void BgmVoiceBank::set_adsr(int vi, uint8_t attack, uint8_t decay, uint8_t sustain,
+                            uint8_t sustain_rate, uint8_t release) {
+    const size_t v = static_cast<size_t>(vi);
+    adsr_on_[v] = 1;
+    adsr_attack_[v] = attack;
+    adsr_decay_[v] = decay;
+    adsr_sustain_[v] = std::min<uint8_t>(sustain, 15);
+    adsr_sustain_rate_[v] = sustain_rate;
+    adsr_release_[v] = release;
+    adsr_phase_[v] = kAdsrOff;
+    adsr_counter_[v] = 0;
+    select_kernel(v);
+}
+
+void BgmVoiceBank::set_lfo(int vi, uint8_t wave, uint8_t rate, uint8_t depth) {
+    const size_t v = static_cast<size_t>(vi);
+    lfo_on_[v] = (depth > 0 && rate > 0) ? 1 : 0;
+    lfo_wave_[v] = std::min<uint8_t>(wave, 4);
+    lfo_hold_[v] = 0;
+    lfo_rate_[v] = rate;
+    lfo_depth_[v] = depth;
+    lfo_hold_counter_[v] = 0;
+    lfo_counter_[v] = rate;
+    lfo_sign_[v] = 1;
+    lfo_delta_[v] = 0;
+    lfo2_on_[v] = 0;
+    lfo2_delta_[v] = 0;
+    lfo_pitch_delta_[v] = 0;
+    lfo_attn_delta_[v] = 0;
+    lfo_algo_[v] = 1;
+    select_kernel(v);
+}
+
+void BgmVoiceBank::set_mod2(int vi, uint8_t algo,
+                            bool on1, uint8_t wave1, uint8_t hold1, uint8_t rate1, uint8_t depth1,
+                            bool on2, uint8_t wave2, uint8_t hold2, uint8_t rate2, uint8_t depth2) {
+    const size_t v = static_cast<size_t>(vi);
+    lfo_algo_[v] = static_cast<uint8_t>(algo & 0x07);
+    lfo_on_[v] = on1 ? 1 : 0;
+    lfo_wave_[v] = std::min<uint8_t>(static_cast<uint8_t>(wave1 & 0x07), 4);
+    lfo_hold_[v] = hold1;
+    lfo_rate_[v] = rate1;
+    lfo_depth_[v] = depth1;
+    lfo2_on_[v] = on2 ? 1 : 0;
+    lfo2_wave_[v] = std::min<uint8_t>(static_cast<uint8_t>(wave2 & 0x07), 4);
+    lfo2_hold_[v] = hold2;
+    lfo2_rate_[v] = rate2;
+    lfo2_depth_[v] = depth2;
+    lfo_hold_counter_[v] = hold1;
+    lfo_counter_[v] = rate1;
+    lfo_sign_[v] = 1;
+    lfo_delta_[v] = 0;
+    lfo2_hold_counter_[v] = hold2;
+    lfo2_counter_[v] = rate2;
+    lfo2_sign_[v] = 1;
+    lfo2_delta_[v] = 0;
+    lfo_pitch_delta_[v] = 0;
+    lfo_attn_delta_[v] = 0;
+    if (depth1 == 0 || rate1 == 0) lfo_on_[v] = 0;
+    if (depth2 == 0 || rate2 == 0) lfo2_on_[v] = 0;
+    select_kernel(v);
+}
+
+void BgmVoiceBank::set_expression(int vi, uint8_t expression) {
+    expression_[static_cast<size_t>(vi)] = std::min<uint8_t>(expression, 15);
+}
+
+void BgmVoiceBank::set_pitch_bend(int vi, int16_t bend) {
+    pitch_bend_[static_cast<size_t>(vi)] = bend;
+}
+
+// ============================================================
+// Per-frame update
+// ============================================================
+
+uint8_t BgmVoiceBank::tick() {
+    uint8_t dirty = 0;
+    for (size_t v = 0; v < static_cast<size_t>(kVoices); ++v) {
+        if (note_active_[v] && (this->*kKernels[fx_[v]])(v)) {
+            dirty = static_cast<uint8_t>(dirty | (1u << v));
+        }
+    }
+    return dirty;
+}
+
+bool BgmVoiceBank::tick_voice(int vi) {
+    const size_t v = static_cast<size_t>(vi);
+    return note_active_[v] && (this->*kKernels[fx_[v]])(v);
+}
+
+void BgmVoiceBank::set_force_full_kernel(bool enabled) {
+    force_full_kernel_ = enabled;
+    for (size_t v = 0; v < static_cast<size_t>(kVoices); ++v) {
+        select_kernel(v);
+    }
+}
+
+void BgmVoiceBank::select_kernel(size_t v) {
+    uint8_t fx = 0;
+    if (macro_[v].count > 0) fx |= kFxMacro;
+    if (pitch_curve_[v].count > 0) fx |= kFxPitchCurve;
+    if (env_on_[v]) fx |= kFxEnv;
+    if (adsr_on_[v]) fx |= kFxAdsr;
+    // Sweep, vibrato and LFO only ever run on tone voices.
+    if (mode_[v] == 0) {
+        if (sweep_on_[v] && sweep_step_[v] != 0) fx |= kFxSweep;
+        if (vib_on_[v] && vib_depth_[v] > 0) fx |= kFxVibrato;
+        if (lfo_on_[v] || lfo2_on_[v]) fx |= kFxLfo;
+    }
+    fx_[v] = force_full_kernel_ ? static_cast<uint8_t>(kFxAll) : fx;
+}
+
+void BgmVoiceBank::macro_reset(size_t v) {
+    macro_step_[v] = 0;
+    macro_counter_[v] = 0;
+    macro_pitch_[v] = 0;
+    macro_active_[v] = 0;
+    if (macro_[v].count == 0) {
+        return;
+    }
+    const MacroStepDef& s = tables_->macro_step(macro_[v], 0);
+    if (s.frames == 0) {
+        return;
+    }
+    macro_active_[v] = 1;
+    macro_counter_[v] = s.frames;
+    macro_pitch_[v] = s.pitch_delta;
+    // ADSR stays the sole attenuation owner when it is active.
+    if (!adsr_on_[v]) {
+        attn_cur_[v] = ClampAttn(static_cast<int>(attn_[v]) + s.attn_delta);
+    }
+}
+
+bool BgmVoiceBank::macro_tick(size_t v) {
+    if (!macro_active_[v]) {
+        return false;
+    }
+    bool dirty = false;
+    if (macro_counter_[v] == 0) {
+        macro_step_[v]++;
+        if (macro_step_[v] >= macro_[v].count) {
+            macro_active_[v] = 0;
+            return false;
+        }
+        const MacroStepDef& s = tables_->macro_step(macro_[v], macro_step_[v]);
+        if (s.frames == 0) {
+            macro_active_[v] = 0;
+            return false;
+        }
+        macro_counter_[v] = s.frames;
+        macro_pitch_[v] = s.pitch_delta;
+        if (!adsr_on_[v]) {
+            const uint8_t attn = ClampAttn(static_cast<int>(attn_[v]) + s.attn_delta);
+            if (attn_cur_[v] != attn) {
+                attn_cur_[v] = attn;
+                dirty = true;
+            }
+        }
+    }
+    if (macro_counter_[v] > 0) {
+        macro_counter_[v]--;
+    }
+    return dirty;
+}
+
+bool BgmVoiceBank::pitch_curve_tick(size_t v) {
+    const BgmFxSpan pitch_curve = pitch_curve_[v];
+    if (pitch_curve.count == 0) {
+        return false;
+    }
+    if (pitch_counter_[v] == 0) {
+        uint8_t idx = pitch_index_[v];
+        if (idx >= pitch_curve.count) {
+            idx = static_cast<uint8_t>(pitch_curve.count - 1);
+        } else {
+            pitch_index_[v]++;
+        }
+        pitch_offset_[v] = tables_->pitch_step(pitch_curve, idx);
+        pitch_counter_[v] = env_speed_[v];
+        return true;
+    }
+    pitch_counter_[v]--;
+    return false;
+}
+
+bool BgmVoiceBank::adsr_tick(size_t v) {
+    const uint8_t base = attn_[v];
+    bool dirty = false;
+    switch (adsr_phase_[v]) {
+    case kAdsrAttack:  // 15 -> attn (louder)
+        if (adsr_attack_[v] == 0) {
+            attn_cur_[v] = base;
+            adsr_phase_[v] = kAdsrDecay;
+            adsr_counter_[v] = adsr_decay_[v];
+            dirty = true;
+        } else if (adsr_counter_[v] == 0) {
+            if (attn_cur_[v] > base) {
+                attn_cur_[v]--;
+                dirty = true;
+            }
+            if (attn_cur_[v] <= base) {
+                attn_cur_[v] = base;
+                adsr_phase_[v] = kAdsrDecay;
+                adsr_counter_[v] = adsr_decay_[v];
+            } else {
+                adsr_counter_[v] = adsr_attack_[v];
+            }
+        } else {
+            adsr_counter_[v]--;
+        }
+        break;
+    case kAdsrDecay: {  // attn -> sustain (quieter)
+        const uint8_t sus = std::max(adsr_sustain_[v], base);
+        if (adsr_decay_[v] == 0 || sus <= base) {
+            attn_cur_[v] = sus;
+            adsr_phase_[v] = kAdsrSustain;
+            adsr_counter_[v] = adsr_sustain_rate_[v];
+            dirty = true;
+        } else if (adsr_counter_[v] == 0) {
+            if (attn_cur_[v] < sus) {
+                attn_cur_[v]++;
+                dirty = true;
+            }
+            if (attn_cur_[v] >= sus) {
+                attn_cur_[v] = sus;
+                adsr_phase_[v] = kAdsrSustain;
+                adsr_counter_[v] = adsr_sustain_rate_[v];
+            } else {
+                adsr_counter_[v] = adsr_decay_[v];
+            }
+        } else {
+            adsr_counter_[v]--;
+        }
+        break;
+    }
+    case kAdsrSustain:  // optional sustain-rate fade while the key is held
+        if (adsr_sustain_rate_[v] > 0) {
+            if (adsr_counter_[v] == 0) {
+                if (attn_cur_[v] < 15) {
+                    attn_cur_[v]++;
+                    dirty = true;
+                }
+                if (attn_cur_[v] >= 15) {
+                    note_active_[v] = 0;
+                    adsr_phase_[v] = kAdsrOff;
+                } else {
+                    adsr_counter_[v] = adsr_sustain_rate_[v];
+                }
+            } else {
+                adsr_counter_[v]--;
+            }
+        }
+        break;
+    case kAdsrRelease:  // current -> 15 (silent)
+        if (adsr_release_[v] == 0) {
+            attn_cur_[v] = 15;
+            adsr_phase_[v] = kAdsrOff;
+            note_active_[v] = 0;
+            dirty = true;
+        } else if (adsr_counter_[v] == 0) {
+            if (attn_cur_[v] < 15) {
+                attn_cur_[v]++;
+                dirty = true;
+            }
+            if (attn_cur_[v] >= 15) {
+                adsr_phase_[v] = kAdsrOff;
+                note_active_[v] = 0;
+            } else {
+                adsr_counter_[v] = adsr_release_[v];
+            }
+        } else {
+            adsr_counter_[v]--;
+        }
+        break;
+    default:
+        break;
+    }
+    return dirty;
+}
+
+bool BgmVoiceBank::env_tick(size_t v) {
+    if (env_counter_[v] != 0) {
+        env_counter_[v]--;
+        return false;
+    }
+    bool dirty = false;
+    const BgmFxSpan env_curve = env_curve_[v];
+    if (env_curve.count > 0) {
+        uint8_t idx = env_index_[v];
+        if (idx >= env_curve.count) {
+            idx = static_cast<uint8_t>(env_curve.count - 1);
+        } else {
+            env_index_[v]++;
+        }
+        const uint8_t attn =
+            ClampAttn(static_cast<int>(attn_[v]) + tables_->env_step(env_curve, idx));
+        if (attn_cur_[v] != attn) {
+            attn_cur_[v] = attn;
+            dirty = true;
+        }
+    } else if (attn_cur_[v] < 15) {
+        attn_cur_[v] = static_cast<uint8_t>(std::min(attn_cur_[v] + env_step_[v], 15));
+        dirty = true;
+    }
+    env_counter_[v] = env_speed_[v];
+    return dirty;
+}
+
+bool BgmVoiceBank::sweep_tick(size_t v) {
+    if (!sweep_on_[v] || sweep_step_[v] == 0) {
+        return false;
+    }
+    if (sweep_counter_[v] != 0) {
+        sweep_counter_[v]--;
+        return false;
+    }
+    const int32_t nd = static_cast<int32_t>(tone_div_[v]) + sweep_step_[v];
+    tone_div_[v] = static_cast<uint16_t>(std::clamp<int32_t>(nd, 1, 1023));
+    sweep_counter_[v] = sweep_speed_[v];
+    if (sweep_step_[v] > 0) {
+        if (tone_div_[v] >= sweep_end_[v]) sweep_on_[v] = 0;
+    } else {
+        if (tone_div_[v] <= sweep_end_[v]) sweep_on_[v] = 0;
+    }
+    return true;
+}
+
+bool BgmVoiceBank::vibrato_tick(size_t v) {
+    if (!vib_on_[v] || vib_depth_[v] == 0) {
+        return false;
+    }
+    if (vib_delay_counter_[v] > 0) {
+        vib_delay_counter_[v]--;
+        if (vib_delay_counter_[v] == 0) {
+            vib_counter_[v] = vib_speed_[v];
+            vib_dir_[v] = 1;
+            return true;
+        }
+        return false;
+    }
+    if (vib_counter_[v] == 0) {
+        vib_dir_[v] = (vib_dir_[v] < 0) ? static_cast<int8_t>(1) : static_cast<int8_t>(-1);
+        vib_counter_[v] = vib_speed_[v];
+        return true;
+    }
+    vib_counter_[v]--;
+    return false;
+}
+
+bool BgmVoiceBank::lfo_tick(size_t v) {
+    const int16_t prev_pitch = lfo_pitch_delta_[v];
+    const int8_t prev_attn = lfo_attn_delta_[v];
+    bool dirty = LfoTick(lfo_on_[v] != 0, lfo_wave_[v], lfo_rate_[v], lfo_depth_[v],
+                         lfo_hold_counter_[v], lfo_counter_[v], lfo_sign_[v], lfo_delta_[v]);
+    if (LfoTick(lfo2_on_[v] != 0, lfo2_wave_[v], lfo2_rate_[v], lfo2_depth_[v],
+                lfo2_hold_counter_[v], lfo2_counter_[v], lfo2_sign_[v], lfo2_delta_[v])) {
+        dirty = true;
+    }
+    ResolveLfoAlgo(lfo_algo_[v], lfo_delta_[v], lfo2_delta_[v],
+                   lfo_pitch_delta_[v], lfo_attn_delta_[v]);
+    return dirty || lfo_pitch_delta_[v] != prev_pitch || lfo_attn_delta_[v] != prev_attn;
+}
+
+// BgmVoice_UpdateFx specialised on the voice's feature set: stages whose bit
+// is clear compile out. A stage's bit only says it may run; each stage still
+// checks its runtime state, so kFxAll is the driver's unspecialised path.
+template <uint8_t Fx>
+bool BgmVoiceBank::update_fx(size_t v) {
+    constexpr bool kMotion = (Fx & (kFxSweep | kFxVibrato | kFxLfo)) != 0;
+    bool dirty = false;
+    if constexpr ((Fx & kFxMacro) != 0) {
+        if (macro_tick(v)) dirty = true;
+    }
+    if constexpr ((Fx & kFxPitchCurve) != 0) {
+        if (pitch_curve_tick(v)) dirty = true;
+    }
+
+    bool adsr_running = false;
+    if constexpr ((Fx & kFxAdsr) != 0) {
+        // ADSR replaces the legacy envelope while it runs.
+        adsr_running = adsr_on_[v] && adsr_phase_[v] != kAdsrOff;
+        if (adsr_running && adsr_tick(v)) dirty = true;
+    }
+    if (!adsr_running) {
+        // Same early-out as the driver: nothing left to animate.
+        bool busy = dirty;
+        if constexpr ((Fx & kFxEnv) != 0) {
+            busy = busy || env_on_[v];
+        }
+        if constexpr (kMotion) {
+            busy = busy || (mode_[v] == 0 &&
+                            (sweep_on_[v] || vib_on_[v] ||
+                             (lfo_on_[v] && lfo_depth_[v] > 0) ||
+                             (lfo2_on_[v] && lfo2_depth_[v] > 0)));
+        }
+        if (!busy) {
+            return false;
+        }
+        if constexpr ((Fx & kFxEnv) != 0) {
+            if (env_on_[v] && env_tick(v)) dirty = true;
+        }
+    }
+
+    if constexpr (kMotion) {
+        if (mode_[v] != 0) {
+            if (lfo_pitch_delta_[v] != 0 || lfo_attn_delta_[v] != 0) {
+                lfo_pitch_delta_[v] = 0;
+                lfo_attn_delta_[v] = 0;
+                dirty = true;
+            }
+            return dirty;
+        }
+        if constexpr ((Fx & kFxSweep) != 0) {
+            if (sweep_tick(v)) dirty = true;
+        }
+        if constexpr ((Fx & kFxVibrato) != 0) {
+            if (vibrato_tick(v)) dirty = true;
+        }
+        if constexpr ((Fx & kFxLfo) != 0) {
+            if (lfo_tick(v)) dirty = true;
+        }
+    }
+    return dirty;
+}
+
+template <size_t... Fx>
+constexpr std::array<BgmVoiceBank::Kernel, sizeof...(Fx)> BgmVoiceBank::make_kernels(
+    std::index_sequence<Fx...>) {
+    return {{&BgmVoiceBank::update_fx<static_cast<uint8_t>(Fx)>...}};
+}
+
+const std::array<BgmVoiceBank::Kernel, BgmVoiceBank::kFxAll + 1> BgmVoiceBank::kKernels =
+    BgmVoiceBank::make_kernels(std::make_index_sequence<BgmVoiceBank::kFxAll + 1>{});
+
+// ============================================================
+// Output
+// ============================================================
+
+uint16_t BgmVoiceBank::output_divider(int vi) const {
+    const size_t v = static_cast<size_t>(vi);
+    int32_t div = tone_div_[v];
+    // Non-vibrato modifiers are summed and clamped once (sounds.c
+    // BgmVoice_CommandFromState); vibrato is applied on top.
+    const int32_t delta = static_cast<int32_t>(macro_pitch_[v]) + pitch_offset_[v] +
+                          pitch_bend_[v] + lfo_pitch_delta_[v];
+    if (delta != 0) {
+        div = std::clamp<int32_t>(div + delta, 1, 1023);
+    }
+    if (vib_on_[v] && vib_depth_[v] > 0 && vib_delay_counter_[v] == 0) {
+        div = std::clamp<int32_t>(div + static_cast<int32_t>(vib_depth_[v]) * vib_dir_[v], 1, 1023);
+    }
+    return static_cast<uint16_t>(div);
+}
+
+uint8_t BgmVoiceBank::output_attn(int vi, uint8_t fade_attn) const {
+    const size_t v = static_cast<size_t>(vi);
+    int attn = ClampAttn(static_cast<int>(attn_cur_[v]) + lfo_attn_delta_[v]);
+    attn = std::min(attn + expression_[v], 15);
+    attn = std::min(attn + fade_attn, 15);
+    return static_cast<uint8_t>(attn);
+}
+
+}  // namespace ngpc
@@ -0,0 +1,126 @@
+#include "ngpc/buffer_pressure.h"
+
+#include <algorithm>
+
+#include "ngpc/bgm_stream.h"
+
+namespace ngpc {
+
+namespace {
+
+uint8_t Saturate(size_t n) {
+    return static_cast<uint8_t>(std::min<size_t>(n, 255));
+}
+
+// Runs of dropping frames, worst (most commands lost) first.
+std::vector<PressureBurst> FindBursts(const std::vector<FramePressure>& timeline, size_t max_bursts) {
+    std::vector<PressureBurst> bursts;
+    for (size_t i = 0; i < timeline.size(); ++i) {
+        if (timeline[i].dropped == 0) {
+            continue;
+        }
+        if (bursts.empty() || bursts.back().first_frame + bursts.back().frames != i + 1) {
+            PressureBurst burst;
+            burst.first_frame = static_cast<uint32_t>(i + 1);
+            bursts.push_back(burst);
+        }
+        PressureBurst& burst = bursts.back();
+        ++burst.frames;
+        burst.dropped += timeline[i].dropped;
+        burst.peak = std::max(burst.peak, timeline[i].queued);
+    }
+    std::stable_sort(bursts.begin(), bursts.end(), [](const PressureBurst& a, const PressureBurst& b) {
+        return a.dropped != b.dropped ? a.dropped > b.dropped : a.peak > b.peak;
+    });
+    if (bursts.size() > max_bursts) {
+        bursts.resize(max_bursts);
+    }
+    return bursts;
+}
+
+}  // namespace
+
+bool AnalyzeBufferPressure(const BgmExportStreams& song,
+                           const BufferPressureOptions& options,
+                           BufferPressureReport* report,
+                           std::string* error) {
+    *report = BufferPressureReport{};
+    const std::vector<uint8_t> note_table = NoteTableBytes(song.note_table);
+
+    // The player's load also refuses streams that would hang the driver.
+    BgmStreamPlayer player;
+    if (!player.load(note_table, song.streams, song.loop_offsets, error)) {
+        return false;
+    }
+    uint32_t frames = options.frames;
+    if (frames == 0) {
+        frames = player.pass_frames() * static_cast<uint32_t>(std::max(options.passes, 1));
+    }
+
+    NativeSounds& native = NativeSounds::instance();
+    native.set_z80_timed(false);
+    native.init();
+    if (!native.start_bgm(note_table, song.streams, song.loop_offsets, error)) {
+        return false;
+    }
+    native.clear_psg_writes();
+    native.set_z80_timed(true);
+    native.reset_z80_stats();
+
+    report->timeline.resize(frames);
+    uint16_t drops = native.drops();
+    NativeSounds::Z80Stats z80;
+    size_t next_sfx = 0;
+    for (uint32_t f = 1; f <= frames; ++f) {
+        if (options.sfx_interval > 0 && !options.sfx.empty() && f >= options.sfx_offset &&
+            (f - options.sfx_offset) % options.sfx_interval == 0) {
+            native.play_sfx(options.sfx[next_sfx]);
+            next_sfx = (next_sfx + 1) % options.sfx.size();
+        }
+        const bool lag = options.lag_interval > 0 && f % options.lag_interval == 0;
+        native.update(lag ? 2 : 1);
+        if (options.game_send_interval > 0 && f % options.game_send_interval == 0) {
+            native.advance_main_cpu(options.game_send_delay);
+            native.send_bytes(0xFF, 0xFF, 0xFF);
+            ++report->game_sends;
+        }
+
+        // Sounds_DebugDrops counts a refused commit once, whatever it held;
+        // the shim's counts turn that back into commands.
+        const uint16_t now = native.drops();
+        const auto driver_drops = static_cast<uint16_t>(now - drops);
+        drops = now;
+        const NativeSounds::Z80Stats z80_now = native.z80_stats();
+        const uint32_t pushed = z80_now.pushed - z80.pushed;
+        const uint32_t refused = pushed - std::min(pushed, z80_now.committed - z80.committed);
+        const uint32_t refused_commits = z80_now.refused - z80.refused;
+        const uint32_t full = driver_drops - std::min<uint32_t>(driver_drops, refused_commits);
+        z80 = z80_now;
+
+        FramePressure& frame = report->timeline[f - 1];
+        frame.dropped = Saturate(full + refused);
+        frame.refused = Saturate(refused);
+        frame.queued = Saturate(pushed + full);
+        native.clear_psg_writes();
+
+        report->dropped += frame.dropped;
+        report->refused_commits += refused_commits;
+        if (frame.dropped > 0) {
+            ++report->overflow_frames;
+        } else if (frame.queued == kDriverBufferCommands) {
+            ++report->full_frames;
+        }
+        if (frame.queued > report->peak) {
+            report->peak = frame.queued;
+            report->peak_frame = f;
+        }
+    }
+    native.set_z80_timed(false);
+    native.stop_bgm();
+    native.clear_psg_writes();
+
+    report->bursts = FindBursts(report->timeline, options.max_bursts);
+    return true;
+}
+
+}  // namespace ngpc
@@ -0,0 +1,113 @@
+#include "ngpc/cycle_budget.h"
+
+#include <algorithm>
+#include <array>
+
+namespace ngpc {
+
+namespace {
+
+// UpdateFx stages of one voice in its current state.
+uint32_t FxCycles(const BgmVoiceBank& voices, int v, const BgmCycleCosts& c) {
+    const uint8_t fx = voices.features(v);
+    uint32_t cycles = c.fx;
+    if (fx & BgmVoiceBank::kFxMacro) cycles += c.macro;
+    if (fx & BgmVoiceBank::kFxPitchCurve) cycles += c.pitch_curve;
+    if (fx & BgmVoiceBank::kFxEnv) cycles += c.env;
+    if (fx & BgmVoiceBank::kFxAdsr) cycles += c.adsr;
+    if (fx & BgmVoiceBank::kFxSweep) cycles += c.sweep;
+    if (fx & BgmVoiceBank::kFxVibrato) cycles += c.vibrato;
+    if (fx & BgmVoiceBank::kFxLfo) {
+        cycles += c.lfo * static_cast<uint32_t>(voices.lfo_count(v)) + c.lfo_resolve;
+    }
+    return cycles;
+}
+
+}  // namespace
+
+bool EstimateBgmCycles(BgmStreamPlayer* player,
+                       const BgmCycleOptions& options,
+                       BgmCycleReport* report,
+                       std::string* error) {
+    *report = BgmCycleReport{};
+    if (!player->loaded()) {
+        if (error) {
+            *error = "No song loaded";
+        }
+        return false;
+    }
+    const BgmCycleCosts& c = options.costs;
+    const uint32_t frames = options.frames > 0
+        ? options.frames
+        : player->pass_frames() * static_cast<uint32_t>(std::max(options.passes, 1));
+
+    // Indexed by instrument id; kNoInstrument has its own slot.
+    std::array<InstrumentCycles, 256> by_inst{};
+    BgmStreamPlayer::StepTrace trace;
+    player->reset();
+    player->set_trace(&trace);
+    report->timeline.resize(frames);
+    uint64_t total = 0;
+    for (uint32_t f = 0; f < frames; ++f) {
+        std::array<bool, BgmStreamPlayer::kVoices> enabled{};
+        for (int v = 0; v < BgmStreamPlayer::kVoices; ++v) {
+            enabled[static_cast<size_t>(v)] = player->stream_active(v);
+        }
+        player->run(1);
+
+        const BgmVoiceBank& voices = player->voices();
+        uint32_t cycles = c.frame;
+        for (int v = 0; v < BgmStreamPlayer::kVoices; ++v) {
+            const size_t i = static_cast<size_t>(v);
+            if (!enabled[i]) {
+                continue;
+            }
+            uint32_t voice = c.voice;
+            if (trace.events[i] > 0 || trace.opcodes[i] > 0) {
+                voice += c.event * trace.events[i] + c.opcode * trace.opcodes[i] +
+                         c.operand_byte * trace.operand_bytes[i] + c.command + c.push;
+            } else if (voices.active(v)) {
+                voice += FxCycles(voices, v, c);
+                if (trace.fx_dirty & (1u << v)) {
+                    voice += c.command + c.push;
+                }
+            }
+            InstrumentCycles& inst = by_inst[player->instrument(v)];
+            inst.voice_frames++;
+            inst.cycles += voice;
+            inst.peak = std::max(inst.peak, voice);
+            inst.features |= voices.features(v);
+            cycles += voice;
+        }
+
+        report->timeline[f] = cycles;
+        total += cycles;
+        if (cycles > report->max) {
+            report->max = cycles;
+            report->max_frame = f + 1;
+        }
+        if (options.budget > 0 && cycles > options.budget) {
+            ++report->over_budget;
+        }
+    }
+    player->set_trace(nullptr);
+
+    if (frames > 0) {
+        report->mean = static_cast<double>(total) / frames;
+        std::vector<uint32_t> sorted = report->timeline;
+        const size_t rank = std::min<size_t>(sorted.size() - 1, (sorted.size() * 99 + 99) / 100 - 1);
+        std::nth_element(sorted.begin(), sorted.begin() + static_cast<std::ptrdiff_t>(rank), sorted.end());
+        report->p99 = sorted[rank];
+    }
+    for (size_t id = 0; id < by_inst.size(); ++id) {
+        if (by_inst[id].voice_frames > 0) {
+            by_inst[id].inst = static_cast<uint8_t>(id);
+            report->instruments.push_back(by_inst[id]);
+        }
+    }
+    std::stable_sort(report->instruments.begin(), report->instruments.end(),
+                     [](const InstrumentCycles& a, const InstrumentCycles& b) { return a.cycles > b.cycles; });
+    return true;
+}
+
+}  // namespace ngpc
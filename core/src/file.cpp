@@ -2,6 +2,21 @@
 
 #include <fstream>
 
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 namespace ngpc {
 
 bool ReadBinaryFile(const std::string& path, std::vector<uint8_t>* out, std::string* error) {
@@ -40,4 +55,76 @@ bool ReadBinaryFile(const std::string& path, std::vector<uint8_t>* out, std::str
     return true;
 }
 
+// ============================================================
+// MappedFile
+// ============================================================
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+void MappedFile::close() {
+    if (mapping_) {
+#if defined(_WIN32)
+        UnmapViewOfFile(mapping_);
+#else
+        munmap(mapping_, size_);
+#endif
+        mapping_ = nullptr;
+    }
+    fallback_.clear();
+    fallback_.shrink_to_fit();
+    data_ = nullptr;
+    size_ = 0;
+}
+
+bool MappedFile::open(const std::string& path, std::string* error) {
+    close();
+
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file != INVALID_HANDLE_VALUE) {
+        LARGE_INTEGER size{};
+        if (GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+            HANDLE section = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (section) {
+                mapping_ = MapViewOfFile(section, FILE_MAP_READ, 0, 0, 0);
+                CloseHandle(section);
+                if (mapping_) {
+                    size_ = static_cast<size_t>(size.QuadPart);
+                }
+            }
+        }
+        CloseHandle(file);
+    }
+#else
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        struct stat st {};
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* view = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (view != MAP_FAILED) {
+                mapping_ = view;
+                size_ = static_cast<size_t>(st.st_size);
+            }
+        }
+        ::close(fd);
+    }
+#endif
+
+    if (mapping_) {
+        data_ = static_cast<const uint8_t*>(mapping_);
+        return true;
+    }
+    // Pipes, empty files, platforms without mapping: fall back to a copy,
+    // which also produces the usual error messages.
+    if (!ReadBinaryFile(path, &fallback_, error)) {
+        return false;
+    }
+    data_ = fallback_.data();
+    size_ = fallback_.size();
+    return true;
+}
+
 }  // namespace ngpc
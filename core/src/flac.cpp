@@ -0,0 +1,666 @@
+#include "ngpc/flac.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace ngpc {
+
+namespace {
+
+constexpr int kBitsPerSample = 16;
+constexpr int kMaxFixedOrder = 4;
+constexpr int kMaxLpcOrder = 8;
+constexpr int kLpcPrecision = 14;      // bits per quantised coefficient
+constexpr int kMaxPartitionOrder = 6;
+constexpr uint32_t kMaxRiceParam = 14;  // 4-bit parameters; 15 is the escape
+constexpr uint32_t kMaxRice2Param = 30;  // 5-bit parameters; 31 is the escape
+
+// ------------------------------------------------------------
+// CRCs (frame header CRC-8 poly 0x07, frame CRC-16 poly 0x8005)
+// ------------------------------------------------------------
+
+struct CrcTables {
+    uint8_t crc8[256];
+    uint16_t crc16[256];
+
+    CrcTables() {
+        for (int i = 0; i < 256; ++i) {
+            uint8_t c8 = static_cast<uint8_t>(i);
+            uint16_t c16 = static_cast<uint16_t>(i << 8);
+            for (int b = 0; b < 8; ++b) {
+                c8 = static_cast<uint8_t>((c8 & 0x80) ? (c8 << 1) ^ 0x07 : (c8 << 1));
+                c16 = static_cast<uint16_t>((c16 & 0x8000) ? (c16 << 1) ^ 0x8005 : (c16 << 1));
+            }
+            crc8[i] = c8;
+            crc16[i] = c16;
+        }
+    }
+};
+
+const CrcTables& Crc() {
+    static const CrcTables kTables;
+    return kTables;
+}
+
+uint8_t Crc8(const uint8_t* data, size_t size) {
+    uint8_t crc = 0;
+    for (size_t i = 0; i < size; ++i) {
+        crc = Crc().crc8[crc ^ data[i]];
+    }
+    return crc;
+}
+
+uint16_t Crc16(const uint8_t* data, size_t size) {
+    uint16_t crc = 0;
+    for (size_t i = 0; i < size; ++i) {
+        crc = static_cast<uint16_t>((crc << 8) ^ Crc().crc16[(crc >> 8) ^ data[i]]);
+    }
+    return crc;
+}
+
+// ------------------------------------------------------------
+// MD5 (RFC 1321) of the input samples, as STREAMINFO wants it
+// ------------------------------------------------------------
+
+constexpr uint32_t kMd5K[64] = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391,
+};
+constexpr int kMd5Shift[64] = {
+    7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 5, 9,  14, 20, 5, 9,  14, 20, 5, 9,  14, 20,
+    5, 9,  14, 20, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 6, 10, 15, 21, 6, 10, 15, 21,
+    6, 10, 15, 21, 6, 10, 15, 21,
+};
+
+void Md5Block(std::array<uint32_t, 4>& state, const uint8_t* block) {
+    uint32_t m[16];
+    for (int i = 0; i < 16; ++i) {
+        m[i] = static_cast<uint32_t>(block[i * 4]) | (static_cast<uint32_t>(block[i * 4 + 1]) << 8) |
+               (static_cast<uint32_t>(block[i * 4 + 2]) << 16) | (static_cast<uint32_t>(block[i * 4 + 3]) << 24);
+    }
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    for (int i = 0; i < 64; ++i) {
+        uint32_t f;
+        int g;
+        if (i < 16) {
+            f = (b & c) | (~b & d);
+            g = i;
+        } else if (i < 32) {
+            f = (d & b) | (~d & c);
+            g = (5 * i + 1) % 16;
+        } else if (i < 48) {
+            f = b ^ c ^ d;
+            g = (3 * i + 5) % 16;
+        } else {
+            f = c ^ (b | ~d);
+            g = (7 * i) % 16;
+        }
+        const uint32_t rotated = a + f + kMd5K[i] + m[g];
+        a = d;
+        d = c;
+        c = b;
+        b = b + ((rotated << kMd5Shift[i]) | (rotated >> (32 - kMd5Shift[i])));
+    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+}
+
+// ------------------------------------------------------------
+// Bit writer (MSB first)
+// ------------------------------------------------------------
+
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<uint8_t>* out) : out_(out) {}
+
+    void put(uint32_t value, int bits) {
+        if (bits == 0) {
+            return;
+        }
+        acc_ = (acc_ << bits) | (static_cast<uint64_t>(value) & ((uint64_t{1} << bits) - 1));
+        count_ += bits;
+        while (count_ >= 8) {
+            count_ -= 8;
+            out_->push_back(static_cast<uint8_t>(acc_ >> count_));
+        }
+    }
+
+    void put_signed(int32_t value, int bits) { put(static_cast<uint32_t>(value), bits); }
+
+    // `zeros` zero bits, then a one.
+    void put_unary(uint32_t zeros) {
+        while (zeros >= 32) {
+            put(0, 32);
+            zeros -= 32;
+        }
+        put(1, static_cast<int>(zeros) + 1);
+    }
+
+    void put_rice(uint32_t folded, uint32_t param) {
+        put_unary(folded >> param);
+        put(folded, static_cast<int>(param));
+    }
+
+    void align() {
+        if (count_ > 0) {
+            put(0, 8 - count_);
+        }
+    }
+
+private:
+    std::vector<uint8_t>* out_;
+    uint64_t acc_ = 0;
+    int count_ = 0;
+};
+
+// Signed residual -> unsigned Rice input (0, -1, 1, -2, ... -> 0, 1, 2, 3, ...).
+uint32_t Fold(int32_t r) {
+    return (static_cast<uint32_t>(r) << 1) ^ static_cast<uint32_t>(r >> 31);
+}
+
+// ------------------------------------------------------------
+// Residual coding
+// ------------------------------------------------------------
+
+struct RicePlan {
+    int partition_order = 0;
+    bool rice2 = false;
+    std::vector<uint32_t> params;
+    uint64_t bits = std::numeric_limits<uint64_t>::max();
+};
+
+// Exact bits of `count` folded values at Rice parameter `param`.
+uint64_t RiceBits(const uint32_t* folded, size_t count, uint32_t param) {
+    uint64_t bits = count * (uint64_t{param} + 1);
+    for (size_t i = 0; i < count; ++i) {
+        bits += folded[i] >> param;
+    }
+    return bits;
+}
+
+// Cheapest parameter for one partition: the mean picks the neighbourhood,
+// exact counts decide.
+uint32_t BestRiceParam(const uint32_t* folded, size_t count, uint64_t sum, uint32_t max_param, uint64_t* bits) {
+    uint32_t guess = 0;
+    while (guess < max_param && (uint64_t{count} << (guess + 1)) < sum) {
+        ++guess;
+    }
+    uint32_t best = guess;
+    *bits = RiceBits(folded, count, guess);
+    for (uint32_t p : {guess > 0 ? guess - 1 : guess, std::min(guess + 1, max_param)}) {
+        if (p == guess) {
+            continue;
+        }
+        const uint64_t b = RiceBits(folded, count, p);
+        if (b < *bits) {
+            *bits = b;
+            best = p;
+        }
+    }
+    return best;
+}
+
+// Residual of `count` samples whose first `order` are warm-up, so the first
+// partition is `order` shorter.
+RicePlan PlanResidual(const std::vector<uint32_t>& folded, int count, int order) {
+    RicePlan best;
+    for (int po = 0; po <= kMaxPartitionOrder; ++po) {
+        const int parts = 1 << po;
+        if (count % parts != 0 || (count >> po) <= order) {
+            break;
+        }
+        RicePlan plan;
+        plan.partition_order = po;
+        plan.params.resize(static_cast<size_t>(parts));
+        plan.bits = 2 + 4;  // coding method + partition order
+        uint32_t max_param = 0;
+        size_t pos = 0;
+        for (int p = 0; p < parts; ++p) {
+            const size_t len = static_cast<size_t>((count >> po) - (p == 0 ? order : 0));
+            uint64_t sum = 0;
+            for (size_t i = 0; i < len; ++i) {
+                sum += folded[pos + i];
+            }
+            uint64_t bits = 0;
+            const uint32_t param = BestRiceParam(folded.data() + pos, len, sum, kMaxRice2Param, &bits);
+            plan.params[static_cast<size_t>(p)] = param;
+            plan.bits += bits;
+            max_param = std::max(max_param, param);
+            pos += len;
+        }
+        plan.rice2 = max_param > kMaxRiceParam;
+        plan.bits += static_cast<uint64_t>(parts) * (plan.rice2 ? 5 : 4);
+        if (plan.bits < best.bits) {
+            best = std::move(plan);
+        }
+    }
+    return best;
+}
+
+void WriteResidual(BitWriter& bw, const std::vector<uint32_t>& folded, int count, int order, const RicePlan& plan) {
+    bw.put(plan.rice2 ? 1 : 0, 2);
+    bw.put(static_cast<uint32_t>(plan.partition_order), 4);
+    size_t pos = 0;
+    for (size_t p = 0; p < plan.params.size(); ++p) {
+        const size_t len = static_cast<size_t>((count >> plan.partition_order) - (p == 0 ? order : 0));
+        const uint32_t param = plan.params[p];
+        bw.put(param, plan.rice2 ? 5 : 4);
+        for (size_t i = 0; i < len; ++i) {
+            bw.put_rice(folded[pos + i], param);
+        }
+        pos += len;
+    }
+}
+
+// ------------------------------------------------------------
+// Predictors
+// ------------------------------------------------------------
+
+// FIXED predictor residual; false when it does not fit 32 bits.
+bool FixedResidual(const int32_t* x, int count, int order, std::vector<uint32_t>* folded) {
+    folded->clear();
+    for (int i = order; i < count; ++i) {
+        int64_t r = 0;
+        switch (order) {
+            case 0: r = x[i]; break;
+            case 1: r = int64_t{x[i]} - x[i - 1]; break;
+            case 2: r = int64_t{x[i]} - 2 * int64_t{x[i - 1]} + x[i - 2]; break;
+            case 3: r = int64_t{x[i]} - 3 * int64_t{x[i - 1]} + 3 * int64_t{x[i - 2]} - x[i - 3]; break;
+            default:
+                r = int64_t{x[i]} - 4 * int64_t{x[i - 1]} + 6 * int64_t{x[i - 2]} - 4 * int64_t{x[i - 3]} + x[i - 4];
+                break;
+        }
+        if (r > (int64_t{1} << 30) || r < -(int64_t{1} << 30)) {
+            return false;
+        }
+        folded->push_back(Fold(static_cast<int32_t>(r)));
+    }
+    return true;
+}
+
+struct Lpc {
+    int order = 0;
+    int shift = 0;
+    std::vector<int32_t> coefs;
+};
+
+// Levinson-Durbin on the windowed autocorrelation; one coefficient set per
+// order, and the order whose prediction error promises the fewest bits.
+bool ChooseLpc(const int32_t* x, int count, int bps, Lpc* out) {
+    const int max_order = std::min(kMaxLpcOrder, count - 1);
+    if (max_order < 1) {
+        return false;
+    }
+    // Welch window keeps the block edges from skewing the autocorrelation.
+    std::vector<double> w(static_cast<size_t>(count));
+    const double half = (count - 1) / 2.0;
+    for (int i = 0; i < count; ++i) {
+        const double t = (i - half) / (half + 1.0);
+        w[static_cast<size_t>(i)] = x[i] * (1.0 - t * t);
+    }
+    double autoc[kMaxLpcOrder + 1] = {};
+    for (int lag = 0; lag <= max_order; ++lag) {
+        double sum = 0.0;
+        for (int i = lag; i < count; ++i) {
+            sum += w[static_cast<size_t>(i)] * w[static_cast<size_t>(i - lag)];
+        }
+        autoc[lag] = sum;
+    }
+    if (autoc[0] <= 0.0) {
+        return false;
+    }
+
+    double lpc[kMaxLpcOrder][kMaxLpcOrder] = {};
+    double error[kMaxLpcOrder] = {};
+    double a[kMaxLpcOrder] = {};
+    double err = autoc[0];
+    for (int i = 0; i < max_order; ++i) {
+        double r = -autoc[i + 1];
+        for (int j = 0; j < i; ++j) {
+            r -= a[j] * autoc[i - j];
+        }
+        r /= err;
+        a[i] = r;
+        for (int j = 0; j < i / 2; ++j) {
+            const double tmp = a[j];
+            a[j] += r * a[i - 1 - j];
+            a[i - 1 - j] += r * tmp;
+        }
+        if (i % 2) {
+            a[i / 2] += a[i / 2] * r;
+        }
+        err *= 1.0 - r * r;
+        for (int j = 0; j <= i; ++j) {
+            lpc[i][j] = -a[j];
+        }
+        error[i] = err;
+    }
+
+    int best_order = 1;
+    double best_bits = std::numeric_limits<double>::max();
+    for (int i = 0; i < max_order; ++i) {
+        const int order = i + 1;
+        // Roughly the bits per residual of a Laplacian with that variance.
+        const double variance = error[i] / static_cast<double>(count);
+        const double per_sample = variance > 1.0 ? 0.5 * std::log2(variance) : 0.0;
+        const double bits = per_sample * (count - order) + order * (bps + kLpcPrecision);
+        if (bits < best_bits) {
+            best_bits = bits;
+            best_order = order;
+        }
+    }
+
+    // Quantise with the error carried from one coefficient to the next.
+    const double* c = lpc[best_order - 1];
+    double cmax = 0.0;
+    for (int j = 0; j < best_order; ++j) {
+        cmax = std::max(cmax, std::abs(c[j]));
+    }
+    if (cmax <= 0.0) {
+        return false;
+    }
+    int exponent = 0;
+    std::frexp(cmax, &exponent);
+    const int qmax = (1 << (kLpcPrecision - 1)) - 1;
+    int shift = std::clamp(kLpcPrecision - 1 - exponent, 0, 15);
+    out->order = best_order;
+    out->shift = shift;
+    out->coefs.assign(static_cast<size_t>(best_order), 0);
+    double carry = 0.0;
+    for (int j = 0; j < best_order; ++j) {
+        carry += c[j] * static_cast<double>(1 << shift);
+        const long q = std::lround(carry);
+        out->coefs[static_cast<size_t>(j)] = static_cast<int32_t>(std::clamp<long>(q, -qmax - 1, qmax));
+        carry -= static_cast<double>(out->coefs[static_cast<size_t>(j)]);
+    }
+    return true;
+}
+
+bool LpcResidual(const int32_t* x, int count, const Lpc& lpc, std::vector<uint32_t>* folded) {
+    folded->clear();
+    for (int i = lpc.order; i < count; ++i) {
+        int64_t sum = 0;
+        for (int j = 0; j < lpc.order; ++j) {
+            sum += int64_t{lpc.coefs[static_cast<size_t>(j)]} * x[i - j - 1];
+        }
+        const int64_t r = x[i] - (sum >> lpc.shift);
+        if (r > (int64_t{1} << 30) || r < -(int64_t{1} << 30)) {
+            return false;
+        }
+        folded->push_back(Fold(static_cast<int32_t>(r)));
+    }
+    return true;
+}
+
+// UTF-8-style coded frame number.
+void PutFrameNumber(BitWriter& bw, uint32_t n) {
+    if (n < 0x80) {
+        bw.put(n, 8);
+        return;
+    }
+    int extra = 1;
+    while (extra < 5 && n >= (uint32_t{1} << (6 + 5 * extra))) {
+        ++extra;
+    }
+    const uint32_t lead_bits = static_cast<uint32_t>(0xFF00 >> (extra + 1)) & 0xFF;
+    bw.put(lead_bits | (n >> (6 * extra)), 8);
+    for (int i = extra - 1; i >= 0; --i) {
+        bw.put(0x80 | ((n >> (6 * i)) & 0x3F), 8);
+    }
+}
+
+// Frame header sample-rate code, and the extra bits some codes take.
+uint32_t SampleRateCode(int rate, int* extra_bits, uint32_t* extra) {
+    *extra_bits = 0;
+    switch (rate) {
+        case 88200: return 1;
+        case 176400: return 2;
+        case 192000: return 3;
+        case 8000: return 4;
+        case 16000: return 5;
+        case 22050: return 6;
+        case 24000: return 7;
+        case 32000: return 8;
+        case 44100: return 9;
+        case 48000: return 10;
+        case 96000: return 11;
+        default: break;
+    }
+    if (rate % 1000 == 0 && rate / 1000 <= 255) {
+        *extra_bits = 8;
+        *extra = static_cast<uint32_t>(rate / 1000);
+        return 12;
+    }
+    if (rate <= 65535) {
+        *extra_bits = 16;
+        *extra = static_cast<uint32_t>(rate);
+        return 13;
+    }
+    if (rate % 10 == 0 && rate / 10 <= 65535) {
+        *extra_bits = 16;
+        *extra = static_cast<uint32_t>(rate / 10);
+        return 14;
+    }
+    return 0;  // from STREAMINFO
+}
+
+}  // namespace
+
+FlacEncoder::FlacEncoder(int sample_rate)
+    : sample_rate_(std::clamp(sample_rate, 1, 655350)),
+      md5_state_{0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476} {
+    pending_.reserve(kBlockSize);
+}
+
+std::array<uint8_t, FlacEncoder::kHeaderBytes> FlacEncoder::header() const {
+    std::vector<uint8_t> bytes = {'f', 'L', 'a', 'C'};
+    BitWriter bw(&bytes);
+    bw.put(1, 1);   // last metadata block
+    bw.put(0, 7);   // STREAMINFO
+    bw.put(34, 24);
+    bw.put(kBlockSize, 16);
+    bw.put(kBlockSize, 16);
+    bw.put(min_frame_bytes_, 24);
+    bw.put(max_frame_bytes_, 24);
+    bw.put(static_cast<uint32_t>(sample_rate_), 20);
+    bw.put(0, 3);   // channels - 1
+    bw.put(kBitsPerSample - 1, 5);
+    bw.put(static_cast<uint32_t>(total_samples_ >> 32), 4);
+    bw.put(static_cast<uint32_t>(total_samples_), 32);
+    for (uint8_t b : md5_) {
+        bw.put(b, 8);  // zero until finish(): "not computed"
+    }
+    std::array<uint8_t, kHeaderBytes> out{};
+    std::copy(bytes.begin(), bytes.end(), out.begin());
+    return out;
+}
+
+void FlacEncoder::write(const int16_t* samples, size_t count, std::vector<uint8_t>* out) {
+    if (finished_ || !samples) {
+        return;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        const uint16_t u = static_cast<uint16_t>(samples[i]);
+        md5_buffer_[md5_bytes_ % 64] = static_cast<uint8_t>(u & 0xFF);
+        md5_buffer_[(md5_bytes_ + 1) % 64] = static_cast<uint8_t>(u >> 8);
+        md5_bytes_ += 2;
+        if (md5_bytes_ % 64 == 0) {
+            Md5Block(md5_state_, md5_buffer_.data());
+        }
+        pending_.push_back(samples[i]);
+        if (pending_.size() == static_cast<size_t>(kBlockSize)) {
+            encode_block(pending_.data(), kBlockSize, out);
+            pending_.clear();
+        }
+    }
+}
+
+void FlacEncoder::finish(std::vector<uint8_t>* out) {
+    if (finished_) {
+        return;
+    }
+    if (!pending_.empty()) {
+        encode_block(pending_.data(), static_cast<int>(pending_.size()), out);
+        pending_.clear();
+    }
+
+    // MD5 padding: 0x80, zeros, then the message length in bits.
+    const uint64_t length_bits = md5_bytes_ * 8;
+    size_t used = static_cast<size_t>(md5_bytes_ % 64);
+    md5_buffer_[used++] = 0x80;
+    if (used > 56) {
+        std::fill(md5_buffer_.begin() + static_cast<long>(used), md5_buffer_.end(), 0);
+        Md5Block(md5_state_, md5_buffer_.data());
+        used = 0;
+    }
+    std::fill(md5_buffer_.begin() + static_cast<long>(used), md5_buffer_.begin() + 56, 0);
+    for (int i = 0; i < 8; ++i) {
+        md5_buffer_[static_cast<size_t>(56 + i)] = static_cast<uint8_t>(length_bits >> (8 * i));
+    }
+    Md5Block(md5_state_, md5_buffer_.data());
+    for (size_t i = 0; i < 16; ++i) {
+        md5_[i] = static_cast<uint8_t>(md5_state_[i / 4] >> (8 * (i % 4)));
+    }
+    finished_ = true;
+}
+
+void FlacEncoder::encode_block(const int32_t* samples, int count, std::vector<uint8_t>* out) {
+    const size_t frame_start = out->size();
+    BitWriter bw(out);
+
+    // --- Frame header ---
+    int rate_bits = 0;
+    uint32_t rate_extra = 0;
+    const uint32_t rate_code = SampleRateCode(sample_rate_, &rate_bits, &rate_extra);
+    const bool full_block = (count == kBlockSize);
+    bw.put(0x3FFE, 14);  // sync
+    bw.put(0, 1);
+    bw.put(0, 1);        // fixed block size
+    bw.put(full_block ? 12 : 7, 4);  // 4096, or a 16-bit (size - 1) below
+    bw.put(rate_code, 4);
+    bw.put(0, 4);        // mono
+    bw.put(4, 3);        // 16 bits per sample
+    bw.put(0, 1);
+    PutFrameNumber(bw, frame_number_++);
+    if (!full_block) {
+        bw.put(static_cast<uint32_t>(count - 1), 16);
+    }
+    bw.put(rate_extra, rate_bits);
+    out->push_back(Crc8(out->data() + frame_start, out->size() - frame_start));
+
+    // --- Subframe ---
+    bool constant = true;
+    int32_t all_bits = 0;
+    for (int i = 0; i < count; ++i) {
+        constant = constant && samples[i] == samples[0];
+        all_bits |= samples[i];
+    }
+    if (constant) {
+        bw.put(0, 1);
+        bw.put(0x00, 6);  // CONSTANT
+        bw.put(0, 1);
+        bw.put_signed(samples[0], kBitsPerSample);
+    } else {
+        // Zero low bits shared by every sample are signalled once and dropped.
+        int wasted = 0;
+        while (wasted < kBitsPerSample - 1 && ((all_bits >> wasted) & 1) == 0) {
+            ++wasted;
+        }
+        const int bps = kBitsPerSample - wasted;
+        std::vector<int32_t> x(samples, samples + count);
+        for (int32_t& v : x) {
+            v >>= wasted;
+        }
+
+        uint64_t best_bits = static_cast<uint64_t>(count) * static_cast<uint64_t>(bps);  // VERBATIM
+        int best_kind = 0;  // 0 verbatim, 1 fixed, 2 lpc
+        int best_fixed = 0;
+        RicePlan best_plan;
+        std::vector<uint32_t> folded;
+        std::vector<uint32_t> best_folded;
+
+        for (int order = 0; order <= std::min(kMaxFixedOrder, count - 1); ++order) {
+            if (!FixedResidual(x.data(), count, order, &folded)) {
+                continue;
+            }
+            RicePlan plan = PlanResidual(folded, count, order);
+            const uint64_t bits = plan.bits + static_cast<uint64_t>(order) * static_cast<uint64_t>(bps);
+            if (bits < best_bits) {
+                best_bits = bits;
+                best_kind = 1;
+                best_fixed = order;
+                best_plan = std::move(plan);
+                best_folded.swap(folded);
+            }
+        }
+
+        Lpc lpc;
+        if (ChooseLpc(x.data(), count, bps, &lpc) && LpcResidual(x.data(), count, lpc, &folded)) {
+            RicePlan plan = PlanResidual(folded, count, lpc.order);
+            const uint64_t bits = plan.bits + static_cast<uint64_t>(lpc.order) * (bps + kLpcPrecision) + 4 + 5;
+            if (bits < best_bits) {
+                best_bits = bits;
+                best_kind = 2;
+                best_plan = std::move(plan);
+                best_folded.swap(folded);
+            }
+        }
+
+        bw.put(0, 1);
+        if (best_kind == 0) {
+            bw.put(0x01, 6);
+        } else if (best_kind == 1) {
+            bw.put(0x08 | static_cast<uint32_t>(best_fixed), 6);
+        } else {
+            bw.put(0x20 | static_cast<uint32_t>(lpc.order - 1), 6);
+        }
+        if (wasted > 0) {
+            bw.put(1, 1);
+            bw.put_unary(static_cast<uint32_t>(wasted - 1));
+        } else {
+            bw.put(0, 1);
+        }
+
+        if (best_kind == 0) {
+            for (int i = 0; i < count; ++i) {
+                bw.put_signed(x[static_cast<size_t>(i)], bps);
+            }
+        } else {
+            const int order = (best_kind == 1) ? best_fixed : lpc.order;
+            for (int i = 0; i < order; ++i) {
+                bw.put_signed(x[static_cast<size_t>(i)], bps);
+            }
+            if (best_kind == 2) {
+                bw.put(kLpcPrecision - 1, 4);
+                bw.put_signed(lpc.shift, 5);
+                for (int32_t c : lpc.coefs) {
+                    bw.put_signed(c, kLpcPrecision);
+                }
+            }
+            WriteResidual(bw, best_folded, count, order, best_plan);
+        }
+    }
+
+    // --- Footer ---
+    bw.align();
+    const uint16_t crc = Crc16(out->data() + frame_start, out->size() - frame_start);
+    out->push_back(static_cast<uint8_t>(crc >> 8));
+    out->push_back(static_cast<uint8_t>(crc & 0xFF));
+
+    const uint32_t frame_bytes = static_cast<uint32_t>(out->size() - frame_start);
+    min_frame_bytes_ = (min_frame_bytes_ == 0) ? frame_bytes : std::min(min_frame_bytes_, frame_bytes);
+    max_frame_bytes_ = std::max(max_frame_bytes_, frame_bytes);
+    total_samples_ += static_cast<uint64_t>(count);
+}
+
+}  // namespace ngpc
@@ -4,6 +4,88 @@
 
 namespace ngpc {
 
+bool InstrumentDefEquals(const BgmInstrumentDef& a, const BgmInstrumentDef& b) {
+    return
+        a.attn == b.attn &&
+        a.env_on == b.env_on &&
+        a.env_step == b.env_step &&
+        a.env_speed == b.env_speed &&
+        a.env_curve_id == b.env_curve_id &&
+        a.pitch_curve_id == b.pitch_curve_id &&
+        a.vib_on == b.vib_on &&
+        a.vib_depth == b.vib_depth &&
+        a.vib_speed == b.vib_speed &&
+        a.vib_delay == b.vib_delay &&
+        a.sweep_on == b.sweep_on &&
+        a.sweep_end == b.sweep_end &&
+        a.sweep_step == b.sweep_step &&
+        a.sweep_speed == b.sweep_speed &&
+        a.mode == b.mode &&
+        a.noise_config == b.noise_config &&
+        a.macro_id == b.macro_id &&
+        a.adsr_on == b.adsr_on &&
+        a.adsr_attack == b.adsr_attack &&
+        a.adsr_decay == b.adsr_decay &&
+        a.adsr_sustain == b.adsr_sustain &&
+        a.adsr_sustain_rate == b.adsr_sustain_rate &&
+        a.adsr_release == b.adsr_release &&
+        a.lfo_on == b.lfo_on &&
+        a.lfo_wave == b.lfo_wave &&
+        a.lfo_hold == b.lfo_hold &&
+        a.lfo_rate == b.lfo_rate &&
+        a.lfo_depth == b.lfo_depth &&
+        a.lfo2_on == b.lfo2_on &&
+        a.lfo2_wave == b.lfo2_wave &&
+        a.lfo2_hold == b.lfo2_hold &&
+        a.lfo2_rate == b.lfo2_rate &&
+        a.lfo2_depth == b.lfo2_depth &&
+        a.lfo_algo == b.lfo_algo;
+}
+
+uint64_t InstrumentDefHash(const BgmInstrumentDef& def, uint64_t h) {
+    auto mix = [&h](auto value) {
+        for (size_t i = 0; i < sizeof(value); ++i) {
+            h ^= static_cast<uint8_t>(static_cast<uint64_t>(value) >> (8 * i));
+            h *= 1099511628211ull;
+        }
+    };
+    mix(def.attn);
+    mix(def.env_on);
+    mix(def.env_step);
+    mix(def.env_speed);
+    mix(def.env_curve_id);
+    mix(def.pitch_curve_id);
+    mix(def.vib_on);
+    mix(def.vib_depth);
+    mix(def.vib_speed);
+    mix(def.vib_delay);
+    mix(def.sweep_on);
+    mix(def.sweep_end);
+    mix(def.sweep_step);
+    mix(def.sweep_speed);
+    mix(def.mode);
+    mix(def.noise_config);
+    mix(def.macro_id);
+    mix(def.adsr_on);
+    mix(def.adsr_attack);
+    mix(def.adsr_decay);
+    mix(def.adsr_sustain);
+    mix(def.adsr_sustain_rate);
+    mix(def.adsr_release);
+    mix(def.lfo_on);
+    mix(def.lfo_wave);
+    mix(def.lfo_hold);
+    mix(def.lfo_rate);
+    mix(def.lfo_depth);
+    mix(def.lfo2_on);
+    mix(def.lfo2_wave);
+    mix(def.lfo2_hold);
+    mix(def.lfo2_rate);
+    mix(def.lfo2_depth);
+    mix(def.lfo_algo);
+    return h;
+}
+
 std::vector<InstrumentPreset> FactoryInstrumentPresets() {
     //                     attn env_on step spd crv pcrv vib_on vdp vsp vdl sw_on sw_end sw_step sw_spd mode ncfg macro adsr_on a d s r sr lfo_on w r d h lfo2_on w h r d algo
     auto presets = std::vector<InstrumentPreset>{
@@ -1,5 +1,6 @@
 #include "ngpc/midi.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <cstring>
 #include <vector>
@@ -9,16 +10,16 @@
 namespace ngpc {
 
 namespace {
-bool ReadU16BE(const std::vector<uint8_t>& data, size_t pos, uint16_t* out) {
-    if (pos + 1 >= data.size()) {
+bool ReadU16BE(const uint8_t* data, size_t size, size_t pos, uint16_t* out) {
+    if (pos + 2 > size) {
         return false;
     }
     *out = static_cast<uint16_t>((data[pos] << 8) | data[pos + 1]);
     return true;
 }
 
-bool ReadU32BE(const std::vector<uint8_t>& data, size_t pos, uint32_t* out) {
-    if (pos + 3 >= data.size()) {
+bool ReadU32BE(const uint8_t* data, size_t size, size_t pos, uint32_t* out) {
+    if (pos + 4 > size) {
         return false;
     }
     *out = (static_cast<uint32_t>(data[pos]) << 24) |
@@ -28,10 +29,10 @@ bool ReadU32BE(const std::vector<uint8_t>& data, size_t pos, uint32_t* out) {
     return true;
 }
 
-bool ReadVLQ(const std::vector<uint8_t>& data, size_t* pos, uint32_t* out) {
+bool ReadVLQ(const uint8_t* data, size_t end, size_t* pos, uint32_t* out) {
     uint32_t value = 0;
     int count = 0;
-    while (*pos < data.size()) {
+    while (*pos < end) {
         const uint8_t byte = data[*pos];
         (*pos)++;
         value = (value << 7) | (byte & 0x7F);
@@ -55,196 +56,279 @@ uint32_t Gcd32(uint32_t a, uint32_t b) {
     }
     return a;
 }
-}  // namespace
 
-MidiInfo InspectMidi(const std::string& path) {
-    MidiInfo info;
-    if (path.empty()) {
-        info.error = "Empty path";
-        return info;
+// Same tick: tempo, program, note-off, then note-on.
+constexpr uint8_t kRank[4] = {2, 3, 1, 0};
+
+bool EventBefore(const MidiEvent& a, const MidiEvent& b) {
+    if (a.tick != b.tick) {
+        return a.tick < b.tick;
     }
+    return kRank[a.type] < kRank[b.type];
+}
 
-    std::vector<uint8_t> data;
-    std::string error;
-    if (!ReadBinaryFile(path, &data, &error)) {
-        info.error = error.empty() ? "Read failed" : error;
-        return info;
+// Appends `ev` to the current track's run, which starts at `run_begin` and is
+// kept in EventBefore order. Ticks never decrease within a track, so at most a
+// few same-tick events are stepped over.
+void PushEvent(const MidiEvent& ev, size_t run_begin, MidiSong* song) {
+    std::vector<MidiEvent>& events = song->events;
+    events.push_back(ev);
+    size_t i = events.size() - 1;
+    while (i > run_begin && EventBefore(ev, events[i - 1])) {
+        events[i] = events[i - 1];
+        --i;
     }
+    events[i] = ev;
+}
 
-    if (data.size() < 14) {
-        info.error = "File too small for MIDI header";
-        return info;
+// Decodes one MTrk body into `song` as one sorted run. Returns the first
+// problem, or nullptr.
+const char* ParseTrack(const uint8_t* data, size_t pos, size_t track_end, int track_index, MidiSong* song) {
+    const size_t run_begin = song->events.size();
+    uint32_t tick = 0;
+    uint8_t running_status = 0;
+    while (pos < track_end) {
+        uint32_t delta = 0;
+        if (!ReadVLQ(data, track_end, &pos, &delta)) {
+            return "Invalid MIDI delta time";
+        }
+        if (delta > 0) {
+            tick += delta;
+            song->delta_gcd = (song->delta_gcd == 0) ? delta : Gcd32(song->delta_gcd, delta);
+        }
+        if (pos >= track_end) {
+            return "Unexpected end of track data";
+        }
+
+        uint8_t status = data[pos];
+        if (status < 0x80) {
+            if (running_status == 0) {
+                return "Running status without prior status byte";
+            }
+            status = running_status;
+        } else {
+            ++pos;
+            if (status < 0xF0) {
+                running_status = status;
+            }
+        }
+
+        if (status == 0xFF) {
+            if (pos >= track_end) {
+                return "Unexpected end of meta event";
+            }
+            const uint8_t meta_type = data[pos++];
+            uint32_t len = 0;
+            if (!ReadVLQ(data, track_end, &pos, &len)) {
+                return "Invalid meta event length";
+            }
+            if (pos + len > track_end) {
+                return "Meta event exceeds track length";
+            }
+            if (meta_type == 0x51 && len == 3) {
+                MidiEvent ev;
+                ev.tick = tick;
+                ev.type = kMidiTempo;
+                ev.channel = data[pos];
+                ev.key = data[pos + 1];
+                ev.velocity = data[pos + 2];
+                PushEvent(ev, run_begin, song);
+                if (track_index != 0) {
+                    song->tempo_events_outside_track0++;
+                }
+            }
+            pos += len;
+            continue;
+        }
+
+        if (status == 0xF0 || status == 0xF7) {
+            uint32_t len = 0;
+            if (!ReadVLQ(data, track_end, &pos, &len)) {
+                return "Invalid SysEx length";
+            }
+            if (pos + len > track_end) {
+                return "SysEx exceeds track length";
+            }
+            pos += len;
+            continue;
+        }
+
+        const uint8_t hi = status & 0xF0;
+        size_t data_len = 0;
+        switch (hi) {
+        case 0x80:
+        case 0x90:
+        case 0xA0:
+        case 0xB0:
+        case 0xE0:
+            data_len = 2;
+            break;
+        case 0xC0:
+        case 0xD0:
+            data_len = 1;
+            break;
+        default:
+            return "Unknown MIDI status byte";
+        }
+        if (pos + data_len > track_end) {
+            return "MIDI event exceeds track length";
+        }
+
+        if (hi == 0x90 || hi == 0x80 || hi == 0xC0) {
+            MidiEvent ev;
+            ev.tick = tick;
+            ev.channel = status & 0x0F;
+            ev.key = data[pos] & 0x7F;
+            if (hi == 0xC0) {
+                ev.type = kMidiProgram;
+            } else {
+                ev.velocity = (hi == 0x90) ? (data[pos + 1] & 0x7F) : 0;
+                ev.type = ev.velocity ? kMidiNoteOn : kMidiNoteOff;
+            }
+            PushEvent(ev, run_begin, song);
+        }
+        pos += data_len;
     }
-    if (std::memcmp(data.data(), "MThd", 4) != 0) {
-        info.error = "Missing MThd header";
-        return info;
+    return nullptr;
+}
+}  // namespace
+
+bool ParseMidi(const uint8_t* data, size_t size, MidiSong* out, std::string* error) {
+    auto fail = [&](const char* message) {
+        if (error) {
+            *error = message;
+        }
+        return false;
+    };
+    if (!out) {
+        return fail("Output song is null");
+    }
+    if (size < 14) {
+        return fail("File too small for MIDI header");
+    }
+    if (std::memcmp(data, "MThd", 4) != 0) {
+        return fail("Missing MThd header");
     }
 
     uint32_t header_len = 0;
-    if (!ReadU32BE(data, 4, &header_len) || header_len < 6) {
-        info.error = "Invalid MIDI header length";
-        return info;
+    if (!ReadU32BE(data, size, 4, &header_len) || header_len < 6) {
+        return fail("Invalid MIDI header length");
     }
-    const size_t header_end = 8 + header_len;
-    if (header_end > data.size()) {
-        info.error = "Header length exceeds file size";
-        return info;
+    const size_t header_end = 8 + static_cast<size_t>(header_len);
+    if (header_end > size) {
+        return fail("Header length exceeds file size");
     }
 
     uint16_t format = 0;
     uint16_t tracks = 0;
     uint16_t division = 0;
-    if (!ReadU16BE(data, 8, &format) ||
-        !ReadU16BE(data, 10, &tracks) ||
-        !ReadU16BE(data, 12, &division)) {
-        info.error = "Unable to read MIDI header fields";
-        return info;
+    if (!ReadU16BE(data, size, 8, &format) ||
+        !ReadU16BE(data, size, 10, &tracks) ||
+        !ReadU16BE(data, size, 12, &division)) {
+        return fail("Unable to read MIDI header fields");
     }
-
-    if (format != 1) {
-        info.error = "Unsupported MIDI type (only type 1 accepted)";
-        return info;
+    if (format > 1) {
+        return fail("Only MIDI type 0 and 1 supported");
     }
-    if (tracks == 0) {
-        info.error = "MIDI contains no tracks";
-        return info;
-    }
-
     if (division & 0x8000) {
-        info.error = "SMPTE time division not supported";
-        return info;
+        return fail("SMPTE time division not supported");
+    }
+    if (division == 0) {
+        return fail("Invalid MIDI division (0)");
     }
 
-    info.tracks = tracks;
-    info.ticks_per_beat = division;
+    MidiSong song;
+    song.format = format;
+    song.tracks = tracks;
+    song.ticks_per_beat = division;
+    // A channel event is at least 3 bytes with its delta; most files average
+    // a little more, so this rarely reallocates.
+    song.events.reserve(size / 4);
 
+    std::vector<size_t> runs = {0};
     size_t pos = header_end;
-    uint32_t delta_gcd = 0;
-    uint8_t running_status = 0;
-
     for (uint16_t track_index = 0; track_index < tracks; ++track_index) {
-        if (pos + 8 > data.size()) {
-            info.error = "Unexpected end of file while reading track header";
-            return info;
+        if (pos + 8 > size) {
+            return fail("Unexpected end of file while reading track header");
         }
-        if (std::memcmp(&data[pos], "MTrk", 4) != 0) {
-            info.error = "Missing MTrk header";
-            return info;
+        if (std::memcmp(data + pos, "MTrk", 4) != 0) {
+            return fail("Missing MTrk header");
         }
-
         uint32_t track_len = 0;
-        if (!ReadU32BE(data, pos + 4, &track_len)) {
-            info.error = "Unable to read track length";
-            return info;
-        }
+        ReadU32BE(data, size, pos + 4, &track_len);
         pos += 8;
-        const size_t track_end = pos + track_len;
-        if (track_end > data.size()) {
-            info.error = "Track length exceeds file size";
-            return info;
-        }
-
-        running_status = 0;
-        while (pos < track_end) {
-            uint32_t delta = 0;
-            if (!ReadVLQ(data, &pos, &delta)) {
-                info.error = "Invalid MIDI delta time";
-                return info;
-            }
-            if (delta > 0) {
-                delta_gcd = (delta_gcd == 0) ? delta : Gcd32(delta_gcd, delta);
-            }
-
-            if (pos >= track_end) {
-                info.error = "Unexpected end of track data";
-                return info;
-            }
-
-            uint8_t status = data[pos];
-            if (status < 0x80) {
-                if (running_status == 0) {
-                    info.error = "Running status without prior status byte";
-                    return info;
-                }
-                status = running_status;
-            } else {
-                ++pos;
-                if (status < 0xF0) {
-                    running_status = status;
-                }
-            }
-
-            if (status == 0xFF) {
-                if (pos >= track_end) {
-                    info.error = "Unexpected end of meta event";
-                    return info;
-                }
-                const uint8_t meta_type = data[pos++];
-                uint32_t len = 0;
-                if (!ReadVLQ(data, &pos, &len)) {
-                    info.error = "Invalid meta event length";
-                    return info;
-                }
-                if (pos + len > track_end) {
-                    info.error = "Meta event exceeds track length";
-                    return info;
-                }
-                if (meta_type == 0x51) {
-                    info.tempo_events++;
-                    if (track_index != 0) {
-                        info.tempo_events_outside_track0++;
-                    }
-                }
-                pos += len;
-                continue;
-            }
-
-            if (status == 0xF0 || status == 0xF7) {
-                uint32_t len = 0;
-                if (!ReadVLQ(data, &pos, &len)) {
-                    info.error = "Invalid SysEx length";
-                    return info;
-                }
-                if (pos + len > track_end) {
-                    info.error = "SysEx exceeds track length";
-                    return info;
-                }
-                pos += len;
-                continue;
-            }
-
-            const uint8_t hi = status & 0xF0;
-            int data_len = 0;
-            switch (hi) {
-            case 0x80:
-            case 0x90:
-            case 0xA0:
-            case 0xB0:
-            case 0xE0:
-                data_len = 2;
-                break;
-            case 0xC0:
-            case 0xD0:
-                data_len = 1;
-                break;
-            default:
-                info.error = "Unknown MIDI status byte";
-                return info;
+        size_t track_end = pos + track_len;
+        if (track_end > size) {
+            if (song.damage.empty()) {
+                song.damage = "Track length exceeds file size";
             }
+            track_end = size;
+        }
+        const char* problem = ParseTrack(data, pos, track_end, track_index, &song);
+        if (problem && song.damage.empty()) {
+            song.damage = problem;
+        }
+        pos = track_end;
+        runs.push_back(song.events.size());
+    }
 
-            if (pos + data_len > track_end) {
-                info.error = "MIDI event exceeds track length";
-                return info;
-            }
-            pos += data_len;
+    // Every track is already a sorted run: merge them pairwise, which keeps
+    // track order on ties like a stable sort would.
+    while (runs.size() > 2) {
+        std::vector<size_t> merged = {0};
+        for (size_t r = 0; r + 2 < runs.size(); r += 2) {
+            std::inplace_merge(song.events.begin() + static_cast<std::ptrdiff_t>(runs[r]),
+                               song.events.begin() + static_cast<std::ptrdiff_t>(runs[r + 1]),
+                               song.events.begin() + static_cast<std::ptrdiff_t>(runs[r + 2]), EventBefore);
+            merged.push_back(runs[r + 2]);
+        }
+        if (runs.size() % 2 == 0) {
+            merged.push_back(runs.back());
         }
+        runs.swap(merged);
+    }
+    *out = std::move(song);
+    return true;
+}
 
-        if (pos != track_end) {
-            info.error = "Track parse did not end on track boundary";
-            return info;
+bool ReadMidiSong(const std::string& path, MidiSong* out, std::string* error) {
+    if (path.empty()) {
+        if (error) {
+            *error = "Empty path";
+        }
+        return false;
+    }
+    MappedFile file;
+    std::string read_error;
+    if (!file.open(path, &read_error)) {
+        if (error) {
+            *error = read_error.empty() ? "Read failed" : read_error;
         }
+        return false;
+    }
+    return ParseMidi(file.data(), file.size(), out, error);
+}
+
+MidiInfo InspectMidi(const MidiSong& song) {
+    MidiInfo info;
+    if (song.format != 1) {
+        info.error = "Unsupported MIDI type (only type 1 accepted)";
+        return info;
+    }
+    if (song.tracks == 0) {
+        info.error = "MIDI contains no tracks";
+        return info;
+    }
+    if (!song.damage.empty()) {
+        info.error = song.damage;
+        return info;
     }
 
+    info.tracks = song.tracks;
+    info.ticks_per_beat = song.ticks_per_beat;
+    info.tempo_events = static_cast<int>(std::count_if(song.events.begin(), song.events.end(),
+                                                       [](const MidiEvent& ev) { return ev.type == kMidiTempo; }));
+    info.tempo_events_outside_track0 = song.tempo_events_outside_track0;
     if (info.tempo_events_outside_track0 > 0) {
         info.error = "Tempo events must be in track 1 only";
         return info;
@@ -268,7 +352,7 @@ MidiInfo InspectMidi(const std::string& path) {
             return info;
         }
 
-        if (delta_gcd != 0 && (delta_gcd % needed_div) != 0) {
+        if (song.delta_gcd != 0 && (song.delta_gcd % needed_div) != 0) {
             info.warning =
                 "Delta times not divisible enough to downscale to 48; quantization may add jitter";
             info.valid = true;
@@ -284,4 +368,15 @@ MidiInfo InspectMidi(const std::string& path) {
     return info;
 }
 
+MidiInfo InspectMidi(const std::string& path) {
+    MidiSong song;
+    std::string error;
+    if (!ReadMidiSong(path, &song, &error)) {
+        MidiInfo info;
+        info.error = error;
+        return info;
+    }
+    return InspectMidi(song);
+}
+
 }  // namespace ngpc
@@ -0,0 +1,292 @@
+#include "ngpc/midi_convert.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "ngpc/note_table.h"
+
+namespace ngpc {
+
+namespace {
+
+constexpr uint32_t kGridTicksPerBeat = 48;
+constexpr uint32_t kFramesPerSecond = 60;
+constexpr uint32_t kDefaultTempoUs = 500000;  // 120 BPM
+constexpr uint8_t kDrumChannel = 9;
+constexpr int kToneVoices = 3;
+constexpr int kNoiseVoice = 3;
+
+uint16_t MidiNoteDivider(uint8_t key) {
+    const double freq = 440.0 * std::pow(2.0, (static_cast<double>(key) - 69.0) / 12.0);
+    const int d = static_cast<int>(std::lround(3072000.0 / (32.0 * freq)));
+    return static_cast<uint16_t>(std::clamp(d, 1, 1023));
+}
+
+// velocity (1-127) to PSG attenuation (0-14), 0=loud
+uint8_t VelocityToAttn(uint8_t vel) {
+    const int a = 14 - (vel - 1) * 14 / 126;
+    return static_cast<uint8_t>(std::clamp(a, 0, 14));
+}
+
+// GM drum key to noise stream byte (val + 1; val bit 2 = white, bits 0-1 = rate).
+uint8_t GmDrumToNoise(uint8_t key) {
+    switch (key) {
+    case 35: case 36:                   return 1;  // Kick        -> P.H
+    case 41: case 43: case 45:          return 2;  // Low toms    -> P.M
+    case 47: case 48: case 50:          return 3;  // High toms   -> P.L
+    case 38: case 39: case 40:          return 6;  // Snare/clap  -> W.M
+    case 42: case 44: case 46:          return 5;  // Hi-hats     -> W.H
+    case 49: case 52: case 55: case 57: return 7;  // Crash/China -> W.L
+    case 51: case 53: case 59:          return 5;  // Ride/Bell   -> W.H
+    case 37: case 56: case 54:          return 4;  // Rimshot/cowbell -> P.T
+    default:                            return 5;
+    }
+}
+
+// File ticks -> 60 Hz frames through the tempo map, on the 48-tick grid.
+class FrameClock {
+public:
+    explicit FrameClock(const MidiSong& song) : ticks_per_beat_(static_cast<uint64_t>(song.ticks_per_beat)) {
+        segments_.push_back({0, kDefaultTempoUs, 0});
+        for (const MidiEvent& ev : song.events) {
+            if (ev.type != kMidiTempo || ev.tempo_us() == 0) {
+                continue;
+            }
+            const uint64_t tick = grid(ev.tick);
+            const uint64_t us = us_at(tick);
+            if (segments_.back().tick == tick) {
+                segments_.back().tempo_us = ev.tempo_us();
+            } else {
+                segments_.push_back({tick, ev.tempo_us(), us});
+            }
+        }
+    }
+
+    uint32_t frame(uint32_t tick) const {
+        const uint64_t us = us_at(grid(tick));
+        return static_cast<uint32_t>((us * kFramesPerSecond + 500000) / 1000000);
+    }
+
+private:
+    struct Segment {
+        uint64_t tick;  // grid ticks
+        uint32_t tempo_us;
+        uint64_t start_us;
+    };
+
+    uint64_t grid(uint32_t tick) const {
+        return (static_cast<uint64_t>(tick) * kGridTicksPerBeat + ticks_per_beat_ / 2) / ticks_per_beat_;
+    }
+
+    uint64_t us_at(uint64_t tick) const {
+        auto it = std::upper_bound(segments_.begin(), segments_.end(), tick,
+                                   [](uint64_t t, const Segment& s) { return t < s.tick; });
+        const Segment& s = *(it - 1);
+        return s.start_us + (tick - s.tick) * s.tempo_us / kGridTicksPerBeat;
+    }
+
+    uint64_t ticks_per_beat_;
+    std::vector<Segment> segments_;
+};
+
+struct VoiceNote {
+    uint32_t start;
+    uint32_t end;
+    uint8_t index;     // stream note byte
+    uint8_t attn;
+    uint16_t divider;  // tone voices: resolved to `index` once the table is built
+};
+
+struct VoiceSlot {
+    bool active = false;
+    uint8_t key = 0;
+    uint8_t channel = 0;
+    uint32_t start_tick = 0;
+};
+
+}  // namespace
+
+bool ConvertMidi(const MidiSong& song, const MidiConvertOptions& options,
+                 MidiConversion* out, std::string* error) {
+    if (!out) {
+        if (error) {
+            *error = "Output conversion is null";
+        }
+        return false;
+    }
+    if (song.ticks_per_beat <= 0) {
+        if (error) {
+            *error = "Invalid MIDI division";
+        }
+        return false;
+    }
+
+    MidiConversion conv;
+    const FrameClock clock(song);
+    NoteTablePlanner note_planner;
+
+    std::array<std::vector<VoiceNote>, 4> voices;
+    std::array<VoiceSlot, 4> slots{};
+    uint32_t last_frame = 0;
+
+    auto close = [&](int v, uint32_t frame) {
+        auto& notes = voices[static_cast<size_t>(v)];
+        slots[static_cast<size_t>(v)].active = false;
+        if (notes.empty()) {
+            return;
+        }
+        notes.back().end = frame;
+        if (notes.back().end <= notes.back().start) {
+            notes.pop_back();  // quantized away
+            conv.notes--;
+        }
+    };
+    auto open = [&](int v, const MidiEvent& ev, uint32_t frame, uint8_t index, uint16_t divider) {
+        voices[static_cast<size_t>(v)].push_back({frame, frame, index, VelocityToAttn(ev.velocity), divider});
+        slots[static_cast<size_t>(v)] = {true, ev.key, ev.channel, ev.tick};
+        conv.notes++;
+    };
+
+    for (const MidiEvent& ev : song.events) {
+        if (ev.type != kMidiNoteOn && ev.type != kMidiNoteOff) {
+            continue;
+        }
+        const uint32_t frame = clock.frame(ev.tick);
+        last_frame = std::max(last_frame, frame);
+        const bool drum = (ev.channel == kDrumChannel);
+
+        if (ev.type == kMidiNoteOff) {
+            if (drum) {
+                const VoiceSlot& s = slots[kNoiseVoice];
+                if (s.active && s.key == ev.key) {
+                    close(kNoiseVoice, frame);
+                }
+                continue;
+            }
+            for (int v = 0; v < kToneVoices; ++v) {
+                const VoiceSlot& s = slots[static_cast<size_t>(v)];
+                if (s.active && s.key == ev.key && s.channel == ev.channel) {
+                    close(v, frame);
+                    break;
+                }
+            }
+            continue;
+        }
+
+        if (drum) {
+            if (slots[kNoiseVoice].active) {
+                close(kNoiseVoice, frame);
+            }
+            open(kNoiseVoice, ev, frame, GmDrumToNoise(ev.key), 0);
+            continue;
+        }
+
+        int slot = -1;
+        for (int v = 0; v < kToneVoices; ++v) {
+            if (!slots[static_cast<size_t>(v)].active) { slot = v; break; }
+        }
+        if (slot < 0) {
+            // Voice stealing: oldest note
+            slot = 0;
+            for (int v = 1; v < kToneVoices; ++v) {
+                if (slots[static_cast<size_t>(v)].start_tick < slots[static_cast<size_t>(slot)].start_tick) {
+                    slot = v;
+                }
+            }
+            close(slot, frame);
+            conv.notes_dropped++;
+        }
+        const uint16_t divider = MidiNoteDivider(ev.key);
+        note_planner.add(divider);
+        open(slot, ev, frame, 0, divider);
+    }
+    for (int v = 0; v < 4; ++v) {
+        if (slots[static_cast<size_t>(v)].active) {
+            close(v, last_frame);
+        }
+    }
+
+    if (conv.notes == 0) {
+        if (error) {
+            *error = "No note events found in MIDI file";
+        }
+        return false;
+    }
+
+    note_planner.build();
+    std::vector<uint16_t>& note_table = conv.streams.note_table;
+    note_table = note_planner.table();
+    for (int v = 0; v < kToneVoices; ++v) {
+        for (VoiceNote& n : voices[static_cast<size_t>(v)]) {
+            n.index = static_cast<uint8_t>(note_planner.index_of(n.divider) + 1);
+        }
+    }
+
+    for (int v = 0; v < 4; ++v) {
+        auto& stream = conv.streams.streams[static_cast<size_t>(v)];
+        uint32_t cursor = 0;
+        uint8_t cur_attn = 0xFF;
+        for (const VoiceNote& n : voices[static_cast<size_t>(v)]) {
+            if (n.start > cursor) {
+                AppendBgmEvent(stream, 0xFF, static_cast<int>(n.start - cursor));
+            }
+            if (options.opcodes && n.attn != cur_attn) {
+                stream.push_back(0xF0);  // SET_ATTN
+                stream.push_back(n.attn);
+                cur_attn = n.attn;
+            }
+            AppendBgmEvent(stream, n.index, static_cast<int>(n.end - n.start));
+            cursor = n.end;
+        }
+        stream.push_back(0x00);
+        conv.frames = std::max(conv.frames, cursor);
+    }
+    if (note_table.empty()) note_table.push_back(1);
+
+    conv.mono = !options.force_tone_streams && !options.force_noise_stream &&
+                voices[1].empty() && voices[2].empty() && voices[kNoiseVoice].empty();
+
+    if (song.ticks_per_beat % static_cast<int>(kGridTicksPerBeat) != 0) {
+        conv.warnings.push_back("Division not divisible by 48; timing quantized to the 48-tick grid");
+    }
+    if (note_planner.capped()) {
+        const auto worst = note_planner.worst_detunings(1);
+        char detune[48] = "";
+        if (!worst.empty()) {
+            std::snprintf(detune, sizeof(detune), " (worst %.1f cents)", worst.front().cents);
+        }
+        conv.warnings.push_back("More than 51 distinct pitches; NOTE_TABLE chosen for the least "
+                                "usage-weighted detune" + std::string(detune));
+    }
+    if (conv.notes_dropped > 0) {
+        conv.warnings.push_back(std::to_string(conv.notes_dropped) +
+                                " notes cut short by voice stealing (3 tone voices)");
+    }
+
+    *out = std::move(conv);
+    return true;
+}
+
+bool ConvertMidiFile(const std::string& path, const MidiConvertOptions& options,
+                     MidiConversion* out, std::string* error) {
+    MidiSong song;
+    if (!ReadMidiSong(path, &song, error)) {
+        return false;
+    }
+    return ConvertMidi(song, options, out, error);
+}
+
+std::string FormatMidiConversion(const MidiConversion& conversion, const MidiConvertOptions& options) {
+    BgmSourceOptions source;
+    source.mode_label = options.opcodes ? "MIDI Hybrid" : "MIDI";
+    source.warnings = conversion.warnings;
+    source.mono = conversion.mono;
+    return options.c_array ? FormatBgmC(conversion.streams, source)
+                           : FormatBgmAsm(conversion.streams, source);
+}
+
+}  // namespace ngpc
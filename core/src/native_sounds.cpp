@@ -0,0 +1,191 @@
+#include "ngpc/native_sounds.h"
+
+#include <algorithm>
+
+#include "ngpc/polling_driver.h"
+#include "ngpc/psg.h"
+
+extern "C" {
+#include "sounds.h"
+}
+
+namespace ngpc {
+
+namespace {
+
+// Init, start and stop run outside the main-CPU clock: whatever they commit,
+// the Z80 takes at once, timed or not.
+class UntimedZ80 {
+public:
+    explicit UntimedZ80(bool timed) : timed_(timed) { NgpcHost_SetZ80Timed(0); }
+    ~UntimedZ80() {
+        NgpcHost_RunZ80();
+        NgpcHost_SetZ80Timed(timed_ ? 1 : 0);
+    }
+
+private:
+    bool timed_;
+};
+
+}  // namespace
+
+NativeSounds& NativeSounds::instance() {
+    static NativeSounds sounds;
+    return sounds;
+}
+
+NativeSounds::NativeSounds() {
+    NgpcHost_SetPsgSink(&NativeSounds::OnPsgCommands, this);
+    init();
+}
+
+void NativeSounds::OnPsgCommands(void* user, const uint8_t* cmds, uint8_t count) {
+    auto* self = static_cast<NativeSounds*>(user);
+    self->psg_writes_.insert(self->psg_writes_.end(), cmds, cmds + count * 3);
+}
+
+void NativeSounds::init() {
+    UntimedZ80 untimed(z80_timed_);
+    Sounds_Init();
+}
+
+bool NativeSounds::start_bgm(const std::vector<uint8_t>& note_table,
+                             const std::array<std::vector<uint8_t>, kVoices>& streams,
+                             const std::array<uint16_t, kVoices>& loop_offsets,
+                             std::string* error) {
+    if (note_table.size() < 2) {
+        if (error) {
+            *error = "NOTE_TABLE missing or too small";
+        }
+        return false;
+    }
+    for (int v = 0; v < kVoices; ++v) {
+        const auto& s = streams[static_cast<size_t>(v)];
+        if (!s.empty() && loop_offsets[static_cast<size_t>(v)] >= s.size()) {
+            if (error) {
+                *error = "Loop offset past end of stream";
+            }
+            return false;
+        }
+    }
+
+    // The driver reads notes 1..51 unchecked; pad short tables with zeros.
+    note_table_ = note_table;
+    note_table_.resize(std::max<size_t>(note_table_.size(), kNoteTableEntries * 2), 0);
+    streams_ = streams;
+    auto ptr = [this](int v) -> const u8* {
+        const auto& s = streams_[static_cast<size_t>(v)];
+        return s.empty() ? nullptr : s.data();
+    };
+
+    UntimedZ80 untimed(z80_timed_);
+    Bgm_SetNoteTable(note_table_.data());
+    Bgm_StartLoop4Ex(ptr(0), loop_offsets[0], ptr(1), loop_offsets[1],
+                     ptr(2), loop_offsets[2], ptr(3), loop_offsets[3]);
+    return true;
+}
+
+void NativeSounds::stop_bgm() {
+    UntimedZ80 untimed(z80_timed_);
+    Bgm_Stop();
+}
+
+void NativeSounds::set_tempo(uint8_t speed) {
+    Bgm_SetTempo(speed);
+}
+
+void NativeSounds::set_gate(uint8_t percent) {
+    Bgm_SetGate(percent);
+}
+
+void NativeSounds::fade_out(uint8_t speed) {
+    Bgm_FadeOut(speed);
+}
+
+bool NativeSounds::bgm_playing() const {
+    BgmDebug dbg;
+    Bgm_DebugSnapshot(&dbg);
+    return dbg.v0_enabled || dbg.v1_enabled || dbg.v2_enabled || dbg.vn_enabled;
+}
+
+void NativeSounds::play_sfx(const NativeSfx& sfx) {
+    if (sfx.tone_on) {
+        Sfx_PlayToneEx(sfx.tone_ch, sfx.tone_div, sfx.tone_attn, sfx.tone_frames,
+                       sfx.tone_sw_end, sfx.tone_sw_step, sfx.tone_sw_speed, sfx.tone_sw_ping, sfx.tone_sw_on,
+                       sfx.tone_env_on, sfx.tone_env_step, sfx.tone_env_spd);
+    }
+    if (sfx.noise_on) {
+        Sfx_PlayNoiseEx(sfx.noise_rate, sfx.noise_type, sfx.noise_attn, sfx.noise_frames,
+                        sfx.noise_burst, sfx.noise_burst_dur,
+                        sfx.noise_env_on, sfx.noise_env_step, sfx.noise_env_spd);
+    }
+}
+
+void NativeSounds::update(uint8_t vblanks) {
+    // The rest of the frame(s) since the last VBlank passes first: the game's
+    // time, then the Z80 catching up with what was committed.
+    const uint32_t frame_states = kMainCpuFrameStates * std::max<uint32_t>(vblanks, 1);
+    NgpcHost_AdvanceMainCpu(frame_states - std::min(game_states_, frame_states));
+    game_states_ = 0;
+    VBCounter = static_cast<u8>(VBCounter + std::max<uint8_t>(vblanks, 1));
+    Sounds_Update();
+    NgpcHost_AdvanceMainCpu(0);
+}
+
+void NativeSounds::advance_main_cpu(uint32_t states) {
+    game_states_ += states;
+    NgpcHost_AdvanceMainCpu(states);
+}
+
+void NativeSounds::send_bytes(uint8_t b1, uint8_t b2, uint8_t b3) {
+    Sfx_SendBytes(b1, b2, b3);
+    NgpcHost_AdvanceMainCpu(0);
+}
+
+void NativeSounds::set_z80_timed(bool timed) {
+    z80_timed_ = timed;
+    NgpcHost_SetZ80Timed(timed ? 1 : 0);
+}
+
+NativeSounds::Z80Stats NativeSounds::z80_stats() const {
+    NgpcHostZ80Stats host;
+    NgpcHost_Z80Stats(&host);
+    Z80Stats stats;
+    stats.pushed = host.pushed_bytes / 3;
+    stats.committed = host.committed;
+    stats.refused = host.refused;
+    return stats;
+}
+
+void NativeSounds::reset_z80_stats() {
+    NgpcHost_ResetZ80Stats();
+}
+
+void NativeSounds::write_to(PsgMixer& psg) const {
+    for (uint8_t b : psg_writes_) {
+        psg.write_tone(b);
+        psg.write_noise(b);
+    }
+}
+
+bool NativeSounds::forward_to(PollingDriverHost& host) const {
+    for (size_t i = 0; i + 2 < psg_writes_.size(); i += 15) {
+        if (!host.buffer_begin()) {
+            return false;
+        }
+        const size_t end = std::min(psg_writes_.size(), i + 15);
+        for (size_t j = i; j + 2 < end; j += 3) {
+            host.buffer_push(psg_writes_[j], psg_writes_[j + 1], psg_writes_[j + 2]);
+        }
+        if (!host.buffer_commit()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint16_t NativeSounds::drops() const {
+    return Sounds_DebugDrops();
+}
+
+}  // namespace ngpc
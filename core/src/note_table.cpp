@@ -0,0 +1,161 @@
+#include "ngpc/note_table.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace ngpc {
+
+double DividerCents(uint16_t wanted, uint16_t played) {
+    if (wanted == 0 || played == 0) {
+        return 0.0;
+    }
+    return 1200.0 * std::log2(static_cast<double>(wanted) / static_cast<double>(played));
+}
+
+void NoteTablePlanner::add(uint16_t divider, uint64_t weight) {
+    auto [it, inserted] = uses_.emplace(divider, 0);
+    if (inserted) {
+        first_seen_.push_back(divider);
+    }
+    it->second += weight;
+}
+
+void NoteTablePlanner::build(int capacity) {
+    table_.clear();
+    index_.clear();
+    capped_ = false;
+    const size_t n = first_seen_.size();
+    const size_t k = static_cast<size_t>(std::max(capacity, 1));
+    if (n <= k) {
+        table_ = first_seen_;
+        for (size_t i = 0; i < n; ++i) {
+            index_[table_[i]] = static_cast<int>(i);
+        }
+        return;
+    }
+    capped_ = true;
+
+    // Points on a cents scale, so cluster cost is the summed pitch error.
+    std::vector<uint16_t> divs = first_seen_;
+    std::sort(divs.begin(), divs.end());
+    std::vector<double> x(n);
+    std::vector<double> pw(n + 1, 0.0);  // prefix weights
+    std::vector<double> ps(n + 1, 0.0);  // prefix weight * x
+    for (size_t i = 0; i < n; ++i) {
+        x[i] = 1200.0 * std::log2(static_cast<double>(std::max<uint16_t>(divs[i], 1)));
+        const double w = static_cast<double>(uses_.at(divs[i]));
+        pw[i + 1] = pw[i] + w;
+        ps[i + 1] = ps[i] + w * x[i];
+    }
+
+    // cost[i * n + j]: error of points i..j played at their weighted median.
+    // The median only moves right as j grows.
+    std::vector<double> cost(n * n, 0.0);
+    for (size_t i = 0; i < n; ++i) {
+        size_t m = i;
+        for (size_t j = i; j < n; ++j) {
+            const double half = (pw[j + 1] - pw[i]) / 2.0;
+            while (m < j && pw[m + 1] - pw[i] < half) {
+                ++m;
+            }
+            const double left = x[m] * (pw[m + 1] - pw[i]) - (ps[m + 1] - ps[i]);
+            const double right = (ps[j + 1] - ps[m + 1]) - x[m] * (pw[j + 1] - pw[m + 1]);
+            cost[i * n + j] = left + right;
+        }
+    }
+
+    // dp[j]: best error for points 0..j in c clusters; split[c][j]: first
+    // point of the last cluster.
+    constexpr double kInf = std::numeric_limits<double>::infinity();
+    std::vector<double> dp(n), next(n);
+    std::vector<std::vector<uint16_t>> split(k, std::vector<uint16_t>(n, 0));
+    for (size_t j = 0; j < n; ++j) {
+        dp[j] = cost[j];
+    }
+    for (size_t c = 1; c < k; ++c) {
+        for (size_t j = 0; j < n; ++j) {
+            next[j] = kInf;
+            for (size_t i = c; i <= j; ++i) {
+                const double v = dp[i - 1] + cost[i * n + j];
+                if (v < next[j]) {
+                    next[j] = v;
+                    split[c][j] = static_cast<uint16_t>(i);
+                }
+            }
+        }
+        dp.swap(next);
+    }
+
+    // Walk the splits back; each cluster plays at its median divider.
+    std::unordered_map<uint16_t, uint16_t> entry_of;
+    size_t j = n - 1;
+    for (size_t c = k; c-- > 0;) {
+        const size_t i = (c == 0) ? 0 : split[c][j];
+        size_t m = i;
+        const double half = (pw[j + 1] - pw[i]) / 2.0;
+        while (m < j && pw[m + 1] - pw[i] < half) {
+            ++m;
+        }
+        for (size_t p = i; p <= j; ++p) {
+            entry_of[divs[p]] = divs[m];
+        }
+        if (i == 0) {
+            break;
+        }
+        j = i - 1;
+    }
+
+    // Entries keep first-seen order, like an uncapped table.
+    for (uint16_t div : first_seen_) {
+        const uint16_t entry = entry_of.at(div);
+        if (index_.find(entry) == index_.end() && entry == div) {
+            index_[entry] = static_cast<int>(table_.size());
+            table_.push_back(entry);
+        }
+    }
+    for (uint16_t div : first_seen_) {
+        index_[div] = index_.at(entry_of.at(div));
+    }
+}
+
+int NoteTablePlanner::index_of(uint16_t divider) const {
+    const auto it = index_.find(divider);
+    if (it != index_.end()) {
+        return it->second;
+    }
+    int best = 0;
+    double best_cents = std::numeric_limits<double>::infinity();
+    for (size_t i = 0; i < table_.size(); ++i) {
+        const double cents = std::abs(DividerCents(divider, table_[i]));
+        if (cents < best_cents) {
+            best_cents = cents;
+            best = static_cast<int>(i);
+        }
+    }
+    return best;
+}
+
+std::vector<NoteTablePlanner::Detune> NoteTablePlanner::worst_detunings(size_t max_count) const {
+    std::vector<Detune> out;
+    if (table_.empty()) {
+        return out;
+    }
+    for (uint16_t div : first_seen_) {
+        const uint16_t entry = table_[static_cast<size_t>(index_of(div))];
+        if (entry != div) {
+            out.push_back({div, entry, DividerCents(div, entry), uses_.at(div)});
+        }
+    }
+    std::sort(out.begin(), out.end(), [](const Detune& a, const Detune& b) {
+        const double ca = std::abs(a.cents);
+        const double cb = std::abs(b.cents);
+        return ca != cb ? ca > cb : a.uses > b.uses;
+    });
+    if (out.size() > max_count) {
+        out.resize(max_count);
+    }
+    return out;
+}
+
+}  // namespace ngpc
@@ -0,0 +1,50 @@
+#include "ngpc/parallel.h"
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace ngpc {
+
+unsigned DefaultWorkerCount() {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+void ParallelFor(size_t count,
+                 unsigned workers,
+                 const std::function<void(size_t index)>& fn,
+                 const std::atomic<bool>* cancel) {
+    if (count == 0) {
+        return;
+    }
+    if (workers == 0) {
+        workers = DefaultWorkerCount();
+    }
+    workers = static_cast<unsigned>(std::min<size_t>(workers, count));
+
+    std::atomic<size_t> next{0};
+    auto drain = [&]() {
+        for (;;) {
+            if (cancel && cancel->load(std::memory_order_relaxed)) {
+                return;
+            }
+            const size_t i = next.fetch_add(1, std::memory_order_relaxed);
+            if (i >= count) {
+                return;
+            }
+            fn(i);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(workers - 1);
+    for (unsigned t = 1; t < workers; ++t) {
+        threads.emplace_back(drain);
+    }
+    drain();
+    for (std::thread& t : threads) {
+        t.join();
+    }
+}
+
+}  // namespace ngpc
@@ -5,9 +5,40 @@
 #include <vector>
 
 #include "apu_core.hpp"
+#include "ngpc/vgm.h"
 
 namespace ngpc {
 
+namespace {
+
+// Takes up to `frames` queued samples and averages the two sides.
+uint32_t DrainMono(apu::Apu& chip, std::vector<int16_t>& scratch, int16_t* out, uint32_t frames) {
+    const size_t need = size_t(frames) * 2;
+    if (scratch.size() < need) {
+        scratch.resize(need);
+    }
+    const uint32_t got = chip.drain(scratch.data(), frames);
+    for (uint32_t i = 0; i < got; ++i) {
+        const int l = scratch[i * 2];
+        const int r = scratch[i * 2 + 1];
+        out[i] = int16_t((l + r) / 2);
+    }
+    return got;
+}
+
+// The fewest chip clocks that queue exactly `n` more samples (1..4096): c
+// clocks buy floor((residue + c*rate) / clock) samples, so the smallest c
+// reaching n cannot reach n + 1.
+uint32_t ClocksFor(const apu::Apu& chip, uint32_t n) {
+    const uint64_t rate = chip.sample_rate_hz ? chip.sample_rate_hz : 44100u;
+    const uint64_t need = uint64_t(n) * apu::kApuClockHz - chip.chip_residue;
+    return uint32_t((need + rate - 1) / rate);
+}
+
+constexpr uint32_t kChunkFrames = 4096;
+
+}  // namespace
+
 struct PsgMixer::Impl {
     apu::Apu chip;
     std::mutex mutex;
@@ -15,8 +46,21 @@ struct PsgMixer::Impl {
     // grown on demand: render() runs in the AUDIO CALLBACK, which must not allocate
     // once it is up to size.
     std::vector<int16_t> scratch;
+    // Samples skip() advanced past without producing; with chip.produced, the
+    // chip's sample clock.
+    uint64_t skipped = 0;
+    PsgLog* recorder = nullptr;
+    uint64_t record_start = 0;
 
     Impl() { chip.reset(44100); }
+
+    uint64_t clock() const { return chip.produced + skipped; }
+
+    void record(uint8_t port, uint8_t data) {
+        if (recorder) {
+            recorder->append(clock() - record_start, port, data);
+        }
+    }
 };
 
 PsgMixer::PsgMixer() : impl_(new Impl()) {}
@@ -25,16 +69,23 @@ PsgMixer::~PsgMixer() = default;
 void PsgMixer::reset(int sample_rate_hz) {
     std::lock_guard<std::mutex> lock(impl_->mutex);
     impl_->chip.reset(sample_rate_hz > 0 ? uint32_t(sample_rate_hz) : 44100u);
+    impl_->skipped = 0;
+    impl_->record_start = 0;
+    if (impl_->recorder) {
+        impl_->recorder->clear(int(impl_->chip.sample_rate_hz));
+    }
 }
 
 void PsgMixer::write_tone(uint8_t data) {
     std::lock_guard<std::mutex> lock(impl_->mutex);
     impl_->chip.write_left(data);      // 0x4001 = LEFT
+    impl_->record(kPsgPortLeft, data);
 }
 
 void PsgMixer::write_noise(uint8_t data) {
     std::lock_guard<std::mutex> lock(impl_->mutex);
     impl_->chip.write_right(data);     // 0x4000 = RIGHT
+    impl_->record(kPsgPortRight, data);
 }
 
 void PsgMixer::render(int16_t* out, int frames) {
@@ -44,31 +95,105 @@ void PsgMixer::render(int16_t* out, int frames) {
     std::lock_guard<std::mutex> lock(impl_->mutex);
     apu::Apu& chip = impl_->chip;
 
-    // Advance the oscillators by exactly the chip-clocks this many samples are
-    // worth, then take them. The loop tops up the odd sample lost to the
-    // integer division; the guard is there so a pathological rate can never spin.
-    for (int guard = 0; chip.available() < uint64_t(frames) && guard < 64; ++guard) {
-        const uint64_t missing = uint64_t(frames) - chip.available();
-        const uint32_t rate = chip.sample_rate_hz ? chip.sample_rate_hz : 44100u;
-        uint64_t chip_clocks = (missing * apu::kApuClockHz + rate - 1) / rate;
-        chip_clocks = std::min<uint64_t>(chip_clocks, apu::kApuClockHz);   // <= 1 s
-        chip.tick(uint32_t(chip_clocks));
+    // Advance the oscillators by exactly the samples asked for and take them.
+    // Nothing is left queued, so the chip clock the recorder stamps writes with
+    // is the sample the caller has reached, and a write made between two
+    // render() calls lands on the first sample of the second.
+    int done = 0;
+    while (done < frames) {
+        const uint32_t n = uint32_t(std::min<int>(frames - done, int(kChunkFrames)));
+        if (chip.available() < n) {
+            chip.tick(ClocksFor(chip, n - uint32_t(chip.available())));
+        }
+        const uint32_t got = DrainMono(chip, impl_->scratch, out + done, n);
+        if (got == 0) {
+            break;
+        }
+        done += int(got);
     }
+    for (int i = done; i < frames; ++i) {
+        out[i] = 0;
+    }
+}
 
-    const size_t need = size_t(frames) * 2;
-    if (impl_->scratch.size() < need) {
-        impl_->scratch.resize(need);
+void PsgMixer::skip(int frames) {
+    if (frames <= 0) {
+        return;
     }
-    const uint32_t got = chip.drain(impl_->scratch.data(), uint32_t(frames));
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    apu::Apu& chip = impl_->chip;
 
-    for (uint32_t i = 0; i < got; ++i) {
-        const int l = impl_->scratch[i * 2];
-        const int r = impl_->scratch[i * 2 + 1];
-        out[i] = int16_t((l + r) / 2);
+    // The same chip-clock requests as render(). Queued samples (left by a
+    // copied state) are what render() would return first; the new ones it would
+    // return only move the oscillators.
+    uint64_t want = uint64_t(frames);
+    const uint64_t queued = std::min(chip.available(), want);
+    chip.drained += queued;
+    want -= queued;
+    while (want > 0) {
+        const uint32_t n = uint32_t(std::min<uint64_t>(want, kChunkFrames));
+        const uint64_t discarded = chip.tick_discard(ClocksFor(chip, n), n);
+        if (discarded == 0) {
+            break;
+        }
+        impl_->skipped += discarded;
+        want -= discarded;
     }
-    for (int i = int(got); i < frames; ++i) {
-        out[i] = 0;
+}
+
+void PsgMixer::copy_state_from(const PsgMixer& other) {
+    if (&other == this) {
+        return;
+    }
+    std::scoped_lock lock(impl_->mutex, other.impl_->mutex);
+    impl_->chip = other.impl_->chip;
+    impl_->skipped = other.impl_->skipped;
+}
+
+void PsgMixer::set_recorder(PsgLog* log) {
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    impl_->recorder = log;
+    impl_->record_start = impl_->clock();
+    if (log) {
+        log->clear(int(impl_->chip.sample_rate_hz));
+    }
+}
+
+void PsgMixer::replay(const PsgLog& log, int16_t* out, uint64_t frames) {
+    if (!out) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    apu::Apu& chip = impl_->chip;
+    chip.reset(uint32_t(log.sample_rate()));
+    impl_->skipped = 0;
+
+    // Emit exactly up to `target`, as render() does.
+    uint64_t done = 0;
+    auto produce_to = [&](uint64_t target) {
+        while (done < target) {
+            const uint32_t n = uint32_t(std::min<uint64_t>(target - done, kChunkFrames));
+            chip.tick(ClocksFor(chip, n));
+            const uint32_t got = DrainMono(chip, impl_->scratch, out + done, n);
+            if (got == 0) {
+                std::fill(out + done, out + target, int16_t(0));
+                done = target;
+            }
+            done += got;
+        }
+    };
+
+    PsgLog::Reader reader(log);
+    PsgWrite w;
+    while (reader.next(&w) && w.sample < frames) {
+        produce_to(w.sample);
+        if (w.port == kPsgPortLeft) {
+            chip.write_left(w.data);
+        } else {
+            chip.write_right(w.data);
+        }
     }
+    produce_to(frames);
 }
 
 }  // namespace ngpc
@@ -1,5 +1,7 @@
 #include "ngpc/sound_engine.h"
 
+#include <algorithm>
+#include <utility>
 #include <vector>
 
 #include "ngpc/file.h"
@@ -11,6 +13,9 @@ bool SoundEngine::init(int sample_rate_hz) {
         return false;
     }
     sample_rate_hz_ = sample_rate_hz;
+    samples_rendered_ = 0;
+    frame_samples_left_ = 0;
+    frame_phase_ = 0;
     psg_.reset(sample_rate_hz_);
     z80_.reset();
     z80_.set_psg(&psg_);
@@ -18,6 +23,9 @@ bool SoundEngine::init(int sample_rate_hz) {
 }
 
 void SoundEngine::reset() {
+    samples_rendered_ = 0;
+    frame_samples_left_ = 0;
+    frame_phase_ = 0;
     psg_.reset(sample_rate_hz_ > 0 ? sample_rate_hz_ : 44100);
     z80_.reset();
     z80_.set_psg(&psg_);
@@ -53,7 +61,97 @@ void SoundEngine::request_nmi() {
 }
 
 void SoundEngine::render(int16_t* out, int frames) {
-    psg_.render(out, frames);
+    if (!out || frames <= 0) {
+        return;
+    }
+    run(out, frames);
+}
+
+void SoundEngine::skip(int frames) {
+    if (frames <= 0) {
+        return;
+    }
+    run(nullptr, frames);
+}
+
+void SoundEngine::run(int16_t* out, int frames) {
+    if (!frame_callback_ && !timed_callback_) {
+        if (out) {
+            psg_.render(out, frames);
+        } else {
+            psg_.skip(frames);
+        }
+        samples_rendered_ += static_cast<uint64_t>(frames);
+        return;
+    }
+
+    // Render up to each frame boundary, fire the callback there, carry on. The
+    // PSG lock is only held inside psg_.render(), so the callback can write the
+    // chip between slices.
+    int done = 0;
+    while (done < frames) {
+        if (frame_samples_left_ <= 0) {
+            if (timed_callback_) {
+                frame_samples_left_ = std::max(1, timed_callback_(samples_rendered_));
+            } else {
+                frame_callback_(samples_rendered_);
+                frame_samples_left_ = next_frame_length();
+            }
+        }
+        const int slice = std::min(frames - done, frame_samples_left_);
+        if (out) {
+            psg_.render(out + done, slice);
+        } else {
+            psg_.skip(slice);
+        }
+        done += slice;
+        frame_samples_left_ -= slice;
+        samples_rendered_ += static_cast<uint64_t>(slice);
+    }
+}
+
+void SoundEngine::copy_state_from(const SoundEngine& other) {
+    if (&other == this) {
+        return;
+    }
+    sample_rate_hz_ = other.sample_rate_hz_;
+    frame_rate_hz_ = other.frame_rate_hz_;
+    frame_samples_left_ = other.frame_samples_left_;
+    frame_phase_ = other.frame_phase_;
+    samples_rendered_ = other.samples_rendered_;
+    psg_.copy_state_from(other.psg_);
+}
+
+void SoundEngine::set_frame_callback(FrameCallback callback, int frame_rate_hz) {
+    frame_callback_ = std::move(callback);
+    timed_callback_ = nullptr;
+    frame_rate_hz_ = (frame_rate_hz > 0) ? frame_rate_hz : 60;
+    frame_samples_left_ = 0;
+    frame_phase_ = 0;
+}
+
+bool SoundEngine::has_frame_callback() const {
+    return static_cast<bool>(frame_callback_);
+}
+
+void SoundEngine::set_timed_callback(TimedCallback callback) {
+    timed_callback_ = std::move(callback);
+    frame_callback_ = nullptr;
+    frame_samples_left_ = 0;
+    frame_phase_ = 0;
+}
+
+uint64_t SoundEngine::samples_rendered() const {
+    return samples_rendered_;
+}
+
+int SoundEngine::next_frame_length() {
+    // Integer Bresenham split: 44100/60 and 48000/60 come out exact, and a rate
+    // like 22050 alternates 367/368 instead of drifting.
+    const int rate = (sample_rate_hz_ > 0) ? sample_rate_hz_ : 44100;
+    const int total = frame_phase_ + rate;
+    frame_phase_ = total % frame_rate_hz_;
+    return std::max(1, total / frame_rate_hz_);
 }
 
 int SoundEngine::sample_rate() const {
@@ -0,0 +1,385 @@
+#include "ngpc/vgm.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+
+#include "apu_core.hpp"
+#include "ngpc/psg.h"
+
+namespace ngpc {
+
+namespace {
+
+constexpr uint32_t kVgmRate = 44100;
+constexpr uint32_t kVgmVersion = 0x151;
+constexpr size_t kVgmHeaderBytes = 0x40;
+constexpr uint32_t kDualChipBit = 0x40000000u;
+constexpr uint32_t kT6W28Bit = 0x80000000u;
+
+constexpr uint8_t kCmdToneChip = 0x50;
+constexpr uint8_t kCmdNoiseChip = 0x30;
+constexpr uint8_t kCmdWait = 0x61;
+constexpr uint8_t kCmdWait735 = 0x62;
+constexpr uint8_t kCmdWait882 = 0x63;
+constexpr uint8_t kCmdEnd = 0x66;
+constexpr uint8_t kCmdDataBlock = 0x67;
+
+uint32_t GetLe32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) | (static_cast<uint32_t>(p[2]) << 16) |
+           (static_cast<uint32_t>(p[3]) << 24);
+}
+
+// Bytes taken by the commands next() steps over (opcode included); 0 for
+// reserved opcodes, whose size the format does not fix.
+size_t CommandLength(uint8_t cmd) {
+    if (cmd >= 0x30 && cmd <= 0x3F) return 2;  // one-operand chips (0x30 = second SN76489)
+    if (cmd >= 0x40 && cmd <= 0x4E) return 3;
+    if (cmd == 0x4F) return 2;                 // Game Gear stereo
+    if (cmd >= 0x51 && cmd <= 0x5F) return 3;
+    if (cmd == 0x64) return 4;
+    if (cmd == 0x68) return 12;
+    if (cmd >= 0x80 && cmd <= 0x8F) return 1;  // YM2612 DAC + wait
+    switch (cmd) {
+        case 0x90: return 5;
+        case 0x91: return 5;
+        case 0x92: return 6;
+        case 0x93: return 11;
+        case 0x94: return 2;
+        case 0x95: return 5;
+        default: break;
+    }
+    if (cmd >= 0xA0 && cmd <= 0xBF) return 3;
+    if (cmd >= 0xC0 && cmd <= 0xDF) return 4;
+    if (cmd >= 0xE0) return 5;
+    return 0;
+}
+
+void PutLe(std::vector<uint8_t>& out, size_t at, uint32_t value, int bytes) {
+    for (int i = 0; i < bytes; ++i) {
+        out[at + static_cast<size_t>(i)] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+void PutWait(std::vector<uint8_t>& out, uint64_t samples) {
+    while (samples > 0) {
+        if (samples <= 16) {
+            out.push_back(static_cast<uint8_t>(0x70 + samples - 1));
+            return;
+        }
+        if (samples == 735 || samples == 882) {
+            out.push_back(samples == 735 ? kCmdWait735 : kCmdWait882);
+            return;
+        }
+        const uint64_t n = std::min<uint64_t>(samples, 0xFFFF);
+        out.push_back(kCmdWait);
+        out.push_back(static_cast<uint8_t>(n & 0xFF));
+        out.push_back(static_cast<uint8_t>(n >> 8));
+        samples -= n;
+    }
+}
+
+}  // namespace
+
+void PsgLog::clear(int sample_rate) {
+    sample_rate_ = sample_rate > 0 ? sample_rate : 44100;
+    bytes_.clear();
+    count_ = 0;
+    last_sample_ = 0;
+}
+
+void PsgLog::append(uint64_t sample, uint8_t port, uint8_t data) {
+    uint64_t delta = sample > last_sample_ ? sample - last_sample_ : 0;
+    last_sample_ += delta;
+    const uint8_t bit = port & 1;
+    if (delta < 127) {
+        bytes_.push_back(static_cast<uint8_t>((delta << 1) | bit));
+    } else {
+        bytes_.push_back(static_cast<uint8_t>((127 << 1) | bit));
+        delta -= 127;
+        while (delta >= 0x80) {
+            bytes_.push_back(static_cast<uint8_t>(0x80 | (delta & 0x7F)));
+            delta >>= 7;
+        }
+        bytes_.push_back(static_cast<uint8_t>(delta));
+    }
+    bytes_.push_back(data);
+    ++count_;
+}
+
+bool PsgLog::Reader::next(PsgWrite* out) {
+    const std::vector<uint8_t>& b = log_->bytes_;
+    if (pos_ >= b.size()) {
+        return false;
+    }
+    const uint8_t tag = b[pos_++];
+    uint64_t delta = tag >> 1;
+    if (delta == 127) {
+        uint64_t extra = 0;
+        int shift = 0;
+        while (pos_ < b.size()) {
+            const uint8_t byte = b[pos_++];
+            extra |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            shift += 7;
+            if ((byte & 0x80) == 0) {
+                break;
+            }
+        }
+        delta += extra;
+    }
+    if (pos_ >= b.size()) {
+        return false;
+    }
+    sample_ += delta;
+    if (out) {
+        out->sample = sample_;
+        out->port = tag & 1;
+        out->data = b[pos_];
+    }
+    ++pos_;
+    return true;
+}
+
+std::vector<uint8_t> FormatVgm(const PsgLog& log, uint64_t total_samples) {
+    const uint64_t rate = static_cast<uint64_t>(log.sample_rate());
+    auto to_vgm = [rate](uint64_t sample) { return sample * kVgmRate / rate; };
+
+    std::vector<uint8_t> out(kVgmHeaderBytes, 0);
+    out.reserve(kVgmHeaderBytes + log.bytes() + log.bytes() / 2 + 16);
+    uint64_t at = 0;
+    PsgLog::Reader reader(log);
+    PsgWrite w;
+    while (reader.next(&w)) {
+        const uint64_t t = to_vgm(w.sample);
+        PutWait(out, t - at);
+        at = t;
+        out.push_back(w.port == kPsgPortLeft ? kCmdToneChip : kCmdNoiseChip);
+        out.push_back(w.data);
+    }
+    const uint64_t end = std::max(to_vgm(total_samples), at);
+    PutWait(out, end - at);
+    out.push_back(kCmdEnd);
+
+    out[0] = 'V';
+    out[1] = 'g';
+    out[2] = 'm';
+    out[3] = ' ';
+    PutLe(out, 0x04, static_cast<uint32_t>(out.size() - 4), 4);
+    PutLe(out, 0x08, kVgmVersion, 4);
+    PutLe(out, 0x0C, apu::kApuClockHz | kDualChipBit | kT6W28Bit, 4);
+    PutLe(out, 0x18, static_cast<uint32_t>(std::min<uint64_t>(end, 0xFFFFFFFFu)), 4);
+    PutLe(out, 0x24, 60, 4);                      // frame rate
+    PutLe(out, 0x28, 0x0003, 2);                  // noise feedback taps (bits 0 and 1)
+    PutLe(out, 0x2A, 15, 1);                      // 15-bit shift register
+    PutLe(out, 0x34, static_cast<uint32_t>(kVgmHeaderBytes - 0x34), 4);
+    return out;
+}
+
+// ------------------------------------------------------------
+// VgmReader
+// ------------------------------------------------------------
+
+bool VgmReader::open(const std::string& path, std::string* error) {
+    close();
+    if (!file_.open(path, error)) {
+        return false;
+    }
+    const uint8_t* d = file_.data();
+    const size_t size = file_.size();
+    auto fail = [&](const char* message) {
+        if (error) {
+            *error = message;
+        }
+        close();
+        return false;
+    };
+    if (size >= 2 && d[0] == 0x1F && d[1] == 0x8B) {
+        return fail("Gzipped VGM (.vgz): decompress it first");
+    }
+    if (size < kVgmHeaderBytes || d[0] != 'V' || d[1] != 'g' || d[2] != 'm' || d[3] != ' ') {
+        return fail("Not a VGM file");
+    }
+    const uint32_t clock = GetLe32(d + 0x0C);
+    if ((clock & 0x3FFFFFFFu) == 0) {
+        return fail("No SN76489 / T6W28 in this VGM");
+    }
+    version_ = GetLe32(d + 0x08);
+    t6w28_ = (clock & kT6W28Bit) != 0;
+    end_ = std::min<size_t>(size, static_cast<size_t>(GetLe32(d + 0x04)) + 4);
+    const uint32_t data_offset = (version_ >= 0x150) ? GetLe32(d + 0x34) : 0;
+    start_ = data_offset ? 0x34 + static_cast<size_t>(data_offset) : kVgmHeaderBytes;
+    const uint32_t loop_offset = GetLe32(d + 0x1C);
+    loop_ = loop_offset ? 0x1C + static_cast<size_t>(loop_offset) : 0;
+    if (loop_ < start_ || loop_ >= end_) {
+        loop_ = 0;
+    }
+    total_samples_ = GetLe32(d + 0x18);
+    loop_samples_ = GetLe32(d + 0x20);
+    if (start_ >= end_) {
+        return fail("VGM has no command data");
+    }
+    data_ = d;
+    rewind();
+    return true;
+}
+
+void VgmReader::close() {
+    file_.close();
+    data_ = nullptr;
+    end_ = start_ = loop_ = pos_ = 0;
+    time_ = 0;
+    error_.clear();
+}
+
+void VgmReader::rewind() {
+    pos_ = start_;
+    time_ = 0;
+    loops_left_ = passes_ - 1;
+    mirror_pending_ = false;
+    error_.clear();
+}
+
+uint64_t VgmReader::expected_samples() const {
+    return total_samples_ + static_cast<uint64_t>(passes_ - 1) * loop_samples();
+}
+
+bool VgmReader::next(PsgWrite* out) {
+    PsgWrite w;
+    if (mirror_pending_) {
+        mirror_pending_ = false;
+        w = {time_, kPsgPortRight, mirror_data_};
+        if (out) *out = w;
+        return true;
+    }
+    while (data_ && pos_ < end_) {
+        const uint8_t cmd = data_[pos_];
+        if (cmd == kCmdToneChip || cmd == kCmdNoiseChip) {
+            if (pos_ + 2 > end_) {
+                break;
+            }
+            const uint8_t value = data_[pos_ + 1];
+            pos_ += 2;
+            if (cmd == kCmdNoiseChip && !t6w28_) {
+                continue;  // a second SN76489: not this chip
+            }
+            w = {time_, cmd == kCmdToneChip ? kPsgPortLeft : kPsgPortRight, value};
+            if (!t6w28_) {
+                mirror_pending_ = true;
+                mirror_data_ = value;
+            }
+            if (out) *out = w;
+            return true;
+        }
+        if (cmd >= 0x70 && cmd <= 0x7F) {
+            time_ += static_cast<uint64_t>(cmd - 0x70) + 1;
+            pos_ += 1;
+            continue;
+        }
+        switch (cmd) {
+            case kCmdWait:
+                if (pos_ + 3 > end_) {
+                    pos_ = end_;
+                    continue;
+                }
+                time_ += static_cast<uint64_t>(data_[pos_ + 1]) | (static_cast<uint64_t>(data_[pos_ + 2]) << 8);
+                pos_ += 3;
+                continue;
+            case kCmdWait735:
+                time_ += 735;
+                pos_ += 1;
+                continue;
+            case kCmdWait882:
+                time_ += 882;
+                pos_ += 1;
+                continue;
+            case kCmdEnd:
+                if (loop_ && loops_left_ > 0) {
+                    --loops_left_;
+                    pos_ = loop_;
+                    continue;
+                }
+                pos_ = end_;
+                continue;
+            case kCmdDataBlock:
+                if (pos_ + 7 > end_) {
+                    pos_ = end_;
+                    continue;
+                }
+                pos_ += 7 + static_cast<size_t>(GetLe32(data_ + pos_ + 3) & 0x7FFFFFFFu);
+                continue;
+            default:
+                break;
+        }
+        if (cmd >= 0x80 && cmd <= 0x8F) {
+            time_ += cmd & 0x0F;
+        }
+        const size_t length = CommandLength(cmd);
+        if (length == 0) {
+            char message[64];
+            std::snprintf(message, sizeof(message), "Unknown VGM command 0x%02X at 0x%zX", cmd, pos_);
+            error_ = message;
+            pos_ = end_;
+            break;
+        }
+        pos_ += length;
+    }
+    return false;
+}
+
+// ------------------------------------------------------------
+// VgmPlayer
+// ------------------------------------------------------------
+
+bool VgmPlayer::open(const std::string& path, int passes, std::string* error) {
+    finished_ = true;
+    reader_.set_passes(passes);
+    return reader_.open(path, error);
+}
+
+void VgmPlayer::start(PsgMixer* psg, int sample_rate) {
+    psg_ = psg;
+    sample_rate_ = sample_rate > 0 ? sample_rate : 44100;
+    reader_.rewind();
+    started_ = false;
+    finished_ = !reader_.is_open();
+    have_pending_ = false;
+    origin_ = position_ = end_sample_ = 0;
+}
+
+uint64_t VgmPlayer::to_engine(uint64_t vgm_samples) const {
+    return vgm_samples * static_cast<uint64_t>(sample_rate_) / VgmReader::kSampleRate;
+}
+
+int VgmPlayer::on_sample(uint64_t sample_pos) {
+    if (!started_) {
+        started_ = true;
+        origin_ = sample_pos;
+    }
+    position_ = sample_pos - origin_;
+    while (!finished_) {
+        if (!have_pending_) {
+            if (!reader_.next(&pending_)) {
+                finished_ = true;
+                end_sample_ = origin_ + to_engine(reader_.time());
+                break;
+            }
+            have_pending_ = true;
+        }
+        const uint64_t at = to_engine(pending_.sample);
+        if (at > position_) {
+            return static_cast<int>(std::min<uint64_t>(at - position_, INT_MAX));
+        }
+        if (psg_) {
+            if (pending_.port == kPsgPortLeft) {
+                psg_->write_tone(pending_.data);
+            } else {
+                psg_->write_noise(pending_.data);
+            }
+        }
+        have_pending_ = false;
+    }
+    // Done: nothing left to time, so come back once a second.
+    return sample_rate_;
+}
+
+}  // namespace ngpc
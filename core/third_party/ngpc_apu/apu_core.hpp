@@ -17,6 +17,10 @@
  * used the constant (the 16.16 sample step, and tick()'s chip-clock -> sample
  * conversion) read the member instead. Keep that in mind when re-syncing.
  *
+ * The other addition is tick_discard()/advance(): the exporter fast-forwards to
+ * render checkpoints without mixing samples nobody will hear. advance() must move
+ * the oscillators exactly as emit_sample() does; re-check it when re-syncing.
+ *
  * WHO WRITES TO IT, AND WHERE — MEASURED, NOT ASSUMED (emulator DEVLOG pass 209)
  * ------------------------------------------------------------------------------
  * Every write the sound drivers of all 73 commercial ROMs aim at the chip was
@@ -133,6 +137,59 @@ struct Apu {
         for (uint64_t i = 0; i < samples; ++i) emit_sample();
     }
 
+    /* tick(), but the first `discard` samples these chip-clocks buy only advance the
+     * oscillators; the rest are queued as usual. Returns how many were discarded. */
+    uint64_t tick_discard(uint32_t chip_cycles, uint64_t discard) {
+        if (chip_cycles == 0) return 0;
+        chip_residue += uint64_t(chip_cycles) * sample_rate_hz;
+        uint64_t samples = chip_residue / kApuClockHz;
+        chip_residue %= kApuClockHz;
+        samples = std::min<uint64_t>(samples, kRingFrames);
+        const uint64_t skipped = std::min(samples, discard);
+        advance(skipped);
+        for (uint64_t i = skipped; i < samples; ++i) emit_sample();
+        return skipped;
+    }
+
+    /* The oscillator state `n` emit_sample() calls would leave, without the mix. The
+     * squares only see the summed step: counter / period toggles add up the same
+     * whether taken one sample at a time or at once. The noise LFSR is capped per
+     * sample, so it still steps sample by sample -- and only while it is audible,
+     * as in emit_sample(). */
+    void advance(uint64_t n) {
+        if (n == 0) return;
+        const uint32_t step_inc =
+            uint32_t((uint64_t(kApuClockHz) << 16) / (sample_rate_hz ? sample_rate_hz : 44100u));
+
+        if (noise.vol_left || noise.vol_right) {
+            const int period = std::max(1, 2 * active_noise_period());
+            uint32_t fp = step_fp;
+            for (uint64_t s = 0; s < n; ++s) {
+                fp += step_inc;
+                noise.counter += int(fp >> 16);
+                fp &= 0xFFFF;
+                int steps = noise.counter / period;
+                noise.counter %= period;
+                steps = std::min(steps, 64);
+                for (int i = 0; i < steps; ++i) {
+                    noise.shifter = (((noise.shifter << 14) ^ (noise.shifter << noise.tap)) & 0x4000)
+                                  | (noise.shifter >> 1);
+                }
+            }
+        }
+
+        const uint64_t total = uint64_t(step_fp) + n * step_inc;
+        const uint64_t step = total >> 16;
+        step_fp = uint32_t(total & 0xFFFF);
+        for (int i = 0; i < 3; ++i) {
+            Square& sq = square[i];
+            if (sq.period <= kMinAudiblePeriod || (!sq.vol_left && !sq.vol_right)) continue;
+            const uint64_t counter = uint64_t(sq.counter) + step;
+            sq.phase ^= int((counter / uint64_t(sq.period)) & 1);
+            sq.counter = int(counter % uint64_t(sq.period));
+        }
+    }
+
     /* Copy up to `n` stereo frames (interleaved L,R) out; returns how many. */
     uint32_t drain(int16_t* out, uint32_t n) {
         const uint32_t want = uint32_t(std::min<uint64_t>(available(), n));
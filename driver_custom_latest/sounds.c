@@ -47,9 +47,16 @@ static const u8 s_z80drv[] = {
     0x18, 0xD6                  /* jr loop (-42)          */
 };
 
-/* Shared RAM (main CPU side) */
+/* Shared RAM (main CPU side). A host build may map these elsewhere. */
+#ifndef SND_RAM
+#define SND_RAM     ((u8 *)0x7000)
+#endif
+#ifndef SND_COUNT
 #define SND_COUNT   (*(volatile u8 *)0x7003)
+#endif
+#ifndef SND_BUF
 #define SND_BUF     ((volatile u8 *)0x7004)
+#endif
 #define SND_BUF_MAX 5
 
 /*
@@ -661,6 +668,10 @@ typedef struct {
     u8 expression;   /* additional attn offset per-voice (0-15, 0=no reduction) */
     s16 pitch_bend;  /* additional divider offset (signed, 0=no bend) */
     const u8 *loop;
+    /* Subroutine call (BGM_EXT_CALL): body start, return address, plays left */
+    const u8 *call_start;
+    const u8 *call_ret;
+    u8 call_count;
 } BgmVoice;
 
 static BgmVoice s_bgm_v0;
@@ -879,6 +890,9 @@ static void BgmVoice_Reset(BgmVoice *v)
     v->dbg_last_cmd = 0;
 #endif
     v->loop = 0;
+    v->call_start = 0;
+    v->call_ret = 0;
+    v->call_count = 0;
 }
 
 static void BgmVoice_StartEx(BgmVoice *v, const u8 *stream, u16 loop_offset)
@@ -886,6 +900,9 @@ static void BgmVoice_StartEx(BgmVoice *v, const u8 *stream, u16 loop_offset)
     v->start = stream;
     v->ptr = stream;
     v->loop = (stream && loop_offset) ? (stream + loop_offset) : stream;
+    v->call_start = 0;
+    v->call_ret = 0;
+    v->call_count = 0;
     v->next_frame = s_bgm_song_frame;
     v->enabled = (stream != 0);
     v->inst_id = (v->freq_base == 0xE0 && s_bgm_instrument_count > 1) ? 1 : 0;
@@ -1689,6 +1706,24 @@ static void BgmVoice_Step(BgmVoice *v, PsgCmd *cmd)
                     v->lfo_attn_delta = 0;
                     if (v->lfo_depth == 0 || v->lfo_rate == 0) v->lfo_on = 0;
                     if (v->lfo2_depth == 0 || v->lfo2_rate == 0) v->lfo2_on = 0;
+                } else if (sub == BGM_EXT_CALL) {
+                    /* count, offset lo/hi from the stream start; no nesting */
+                    u8 count = *v->ptr++;
+                    u16 off = (u16)v->ptr[0] | ((u16)v->ptr[1] << 8);
+                    v->ptr += 2;
+                    if (count && v->start) {
+                        v->call_count = count;
+                        v->call_ret = v->ptr;
+                        v->call_start = v->start + off;
+                        v->ptr = v->call_start;
+                    }
+                } else if (sub == BGM_EXT_RET) {
+                    if (v->call_count && --v->call_count) {
+                        v->ptr = v->call_start;
+                    } else if (v->call_ret) {
+                        v->ptr = v->call_ret;
+                        v->call_ret = 0;
+                    }
                 } else {
                     /* Unknown ext subcommand: consume one byte guard to avoid lock. */
                     v->ptr++;
@@ -1900,7 +1935,7 @@ void Sounds_Init(void)
 
     SOUNDCPU_CTRL = 0xAAAA;
 
-    ram = (u8 *)0x7000;
+    ram = SND_RAM;
     for (i = 0; i < sizeof(s_z80drv); i++) {
         ram[i] = s_z80drv[i];
     }
@@ -36,6 +36,8 @@ extern const u8 NOTE_TABLE[] SOUNDS_WEAK_SYMBOL;
 
 #define BGM_EXT_SET_ADSR5 0x01
 #define BGM_EXT_SET_MOD2  0x02
+#define BGM_EXT_CALL      0x03
+#define BGM_EXT_RET       0x04
 
 #ifndef BGM_DEBUG
 #define BGM_DEBUG 0